@@ -0,0 +1,676 @@
+/**
+ * \file MyAsyncWeb.h
+ * \page asyncweb Serveur Web asynchrone
+ * \brief Serveur HTTP sur l'API TCP brute de lwIP : plusieurs connexions, envois non bloquants, keep-alive
+ *
+ * ESP8266WebServer traite un client par appel de handleClient(), de façon synchrone : un client lent
+ * (réseau, lecture de la réponse) bloque la loop, donc le traitement MQTT et les chaînes.
+ *
+ * Ici, les entrées/sorties sont faites par les callbacks de lwIP, dans le contexte système :
+ * - réception : les octets sont copiés dans le tampon de la connexion ; quand la requête est complète
+ *   (en-têtes et Content-Length), elle est marquée prête et la loop est réveillée (esp_schedule()) ;
+ * - la loop (loopAsyncWeb()) appelle le handler de la route, qui construit la réponse ;
+ * - envoi : la réponse est confiée à lwIP au rythme de la place dans son tampon d'émission, la suite
+ *   part depuis le callback d'accusé (sent) : la loop n'attend jamais un client ;
+ * - keep-alive : HTTP/1.1 garde la connexion ouverte (sauf « Connection: close »), la requête suivante
+ *   peut déjà être dans le tampon ;
+ * - limites : ASYNC_WEB_MAX_CLIENTS connexions, ASYNC_WEB_REQUEST_MAX octets par requête (413 au-delà),
+ *   fermeture après ASYNC_WEB_IDLE_MS sans requête ou ASYNC_WEB_SEND_TIMEOUT_MS sans progression.
+ * Comme pour les Tickers, le contexte système ne fait que copier et signaler : les handlers (qui
+ * construisent des String, publient en MQTT...) s'exécutent dans la loop.
+ *
+ * Un handler peut différer sa réponse (long-poll) : request.defer() rend un jeton, la connexion reste
+ * ouverte sans occuper la loop, et la réponse est donnée plus tard par asyncWebRespond(jeton, ...).
+ * Si le client ferme entre-temps, le jeton est périmé et la réponse ignorée ; sans réponse après
+ * ASYNC_WEB_DEFER_MAX_MS, la connexion est fermée.
+ *
+ * Les routes sont déclarées comme avec ESP8266WebServer :
+ * \code
+ * asyncWebOn("/", HTTP_GET, handler);        // void handler(AsyncWebRequest &request)
+ * asyncWebOnNotFound(handler);
+ * asyncWebBegin(80);
+ * \endcode
+ *
+ * Fichier \ref MyAsyncWeb.h
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+#include <coredecls.h>
+#include <lwip/tcp.h>
+
+#define ASYNC_WEB_MAX_CLIENTS      4
+#define ASYNC_WEB_REQUEST_MAX      1024    // Ligne de requête, en-têtes et corps
+#define ASYNC_WEB_IDLE_MS          10000   // Connexion ouverte sans requête complète
+#define ASYNC_WEB_SEND_TIMEOUT_MS  20000   // Réponse sans progression : le client ne lit plus
+#define ASYNC_WEB_DEFER_MAX_MS     30000   // Réponse différée jamais donnée
+#define ASYNC_WEB_POLL_TICKS       2       // Vérification des délais toutes les 2 × 500 ms
+#define ASYNC_WEB_MAX_ROUTES       24
+
+enum AsyncConnState : uint8_t {
+    ASYNC_FREE,
+    ASYNC_READING,   // Requête en cours de réception
+    ASYNC_READY,     // Requête complète, à traiter par la loop
+    ASYNC_WAITING,   // Réponse différée par le handler (long-poll)
+    ASYNC_SENDING,   // Réponse en cours d'envoi
+};
+
+struct AsyncWebStats {
+    uint32_t accepted = 0;
+    uint32_t refused = 0;          // Toutes les connexions occupées
+    uint32_t requests = 0;
+    uint32_t keepAliveReused = 0;  // Requêtes sur une connexion déjà utilisée
+    uint32_t tooLarge = 0;
+    uint32_t timeouts = 0;
+    uint32_t errors = 0;           // Connexions perdues (reset, mémoire)
+    uint32_t bytesSent = 0;
+    uint8_t maxConcurrent = 0;
+    bool listening = false;        // asyncWebBegin() réussi
+};
+
+struct AsyncWebConn {
+    tcp_pcb *pcb = nullptr;
+    AsyncConnState state = ASYNC_FREE;
+    char buf[ASYNC_WEB_REQUEST_MAX + 1];
+    uint16_t len = 0;              // Octets reçus dans buf
+    uint16_t requestLen = 0;       // Requête complète au début de buf (en-têtes et corps)
+    uint16_t status = 0;           // Erreur détectée à la réception : réponse sans handler
+    bool keepAlive = false;
+    uint16_t served = 0;           // Requêtes servies sur cette connexion
+    uint16_t generation = 0;       // Change à chaque libération : invalide les jetons de réponse différée
+    bool headOnly = false;         // Requête HEAD : réponse sans corps
+    String head;                   // Ligne de statut et en-têtes de la réponse
+    String body;
+    size_t written = 0;            // Octets de head + body confiés à lwIP
+    size_t unacked = 0;
+    unsigned long lastActivity = 0;
+};
+
+// Jeton d'une réponse différée
+struct AsyncWebDeferred {
+    int8_t slot = -1;
+    uint16_t generation = 0;
+};
+
+class AsyncWebRequest;
+
+typedef void (*AsyncWebHandler)(AsyncWebRequest &request);
+
+struct AsyncWebRoute {
+    const char *path;
+    HTTPMethod method;
+    AsyncWebHandler handler;
+};
+
+inline AsyncWebConn asyncWebConns[ASYNC_WEB_MAX_CLIENTS];
+inline AsyncWebRoute asyncWebRoutes[ASYNC_WEB_MAX_ROUTES];
+inline uint8_t asyncWebRouteCount = 0;
+inline AsyncWebHandler asyncWebNotFound = nullptr;
+inline AsyncWebHandler asyncWebObserver = nullptr;   // Voit chaque requête valide avant sa route (capture)
+inline tcp_pcb *asyncWebListener = nullptr;
+inline AsyncWebStats asyncWebStats;
+inline unsigned long asyncWebLastRequest = 0;
+inline bool asyncWebRequestSeen = false;
+
+inline const char *asyncWebStatusText(const int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 202: return "Accepted";
+        case 307: return "Temporary Redirect";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 409: return "Conflict";
+        case 413: return "Payload Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "";
+    }
+}
+
+inline String asyncWebDecode(const char *in, const size_t length) {
+    String out;
+    out.reserve(length);
+    for (size_t i = 0; i < length; i++) {
+        if (in[i] == '+') {
+            out += ' ';
+        } else if (in[i] == '%' && i + 2 < length && isxdigit(in[i + 1]) && isxdigit(in[i + 2])) {
+            const char hex[3] = {in[i + 1], in[i + 2], 0};
+            out += static_cast<char>(strtol(hex, nullptr, 16));
+            i += 2;
+        } else {
+            out += in[i];
+        }
+    }
+    return out;
+}
+
+/**
+ * Ligne de statut et en-têtes de la réponse ; l'envoi commence au prochain asyncWebPump()
+ */
+inline void asyncWebCompose(AsyncWebConn &conn, const int code, const char *type, const String &headers,
+                            String content) {
+    char line[160];
+    snprintf(line, sizeof(line), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: %s\r\n",
+             code, asyncWebStatusText(code), type, content.length(), conn.keepAlive ? "keep-alive" : "close");
+    conn.head = line;
+    conn.head += headers;
+    conn.head += "\r\n";
+    conn.body = conn.headOnly ? String() : std::move(content);
+    conn.written = 0;
+}
+
+/**
+ * Requête prête, vue par un handler. Les chaînes pointent dans le tampon de la connexion.
+ */
+class AsyncWebRequest {
+    AsyncWebConn &_conn;
+    String _headers;
+    bool _sent = false;
+
+    // Paramètre index (requête puis corps urlencoded), false s'il n'existe pas
+    bool pair(uint8_t index, const char *&name, size_t &nameLen, const char *&value, size_t &valueLen) const {
+        for (const char *source: {query, body}) {
+            const char *cursor = source;
+            while (*cursor) {
+                const char *end = strchr(cursor, '&');
+                if (!end) end = cursor + strlen(cursor);
+                if (end > cursor && index-- == 0) {
+                    const char *equal = static_cast<const char *>(memchr(cursor, '=', end - cursor));
+                    name = cursor;
+                    nameLen = (equal ? equal : end) - cursor;
+                    value = equal ? equal + 1 : end;
+                    valueLen = end - value;
+                    return true;
+                }
+                cursor = *end ? end + 1 : end;
+            }
+        }
+        return false;
+    }
+
+public:
+    HTTPMethod method = HTTP_GET;
+    const char *path = "";
+    const char *query = "";   // Après « ? », non décodée
+    const char *body = "";    // Corps, pris en compte comme paramètres s'il est urlencoded
+    const char *headers = ""; // Lignes d'en-têtes, séparées par CRLF
+
+    explicit AsyncWebRequest(AsyncWebConn &conn) : _conn(conn) {
+    }
+
+    /**
+     * Découpage sur place de la ligne de requête, false si elle est invalide
+     */
+    bool parse() {
+        char *buf = _conn.buf;
+        char *headerEnd = strstr(buf, "\r\n\r\n");
+        if (!headerEnd) return false;
+        *headerEnd = 0;
+        body = headerEnd + 4;
+        if (char *lineEnd = strstr(buf, "\r\n")) {
+            *lineEnd = 0;
+            headers = lineEnd + 2;
+        }
+
+        char *space = strchr(buf, ' ');
+        if (!space) return false;
+        *space = 0;
+        if (strcmp(buf, "GET") == 0) method = HTTP_GET;
+        else if (strcmp(buf, "POST") == 0) method = HTTP_POST;
+        else if (strcmp(buf, "HEAD") == 0) method = HTTP_HEAD;
+        else if (strcmp(buf, "PUT") == 0) method = HTTP_PUT;
+        else if (strcmp(buf, "DELETE") == 0) method = HTTP_DELETE;
+        else return false;
+
+        char *target = space + 1;
+        char *targetEnd = strchr(target, ' ');
+        if (!targetEnd || *target != '/') return false;
+        *targetEnd = 0;
+        char *question = strchr(target, '?');
+        if (question) {
+            *question = 0;
+            query = question + 1;
+        }
+        path = target;
+        return true;
+    }
+
+    [[nodiscard]] uint8_t args() const {
+        uint8_t count = 0;
+        const char *name, *value;
+        size_t nameLen, valueLen;
+        while (pair(count, name, nameLen, value, valueLen)) count++;
+        return count;
+    }
+
+    [[nodiscard]] String argName(const uint8_t index) const {
+        const char *name, *value;
+        size_t nameLen, valueLen;
+        return pair(index, name, nameLen, value, valueLen) ? asyncWebDecode(name, nameLen) : String();
+    }
+
+    [[nodiscard]] String arg(const uint8_t index) const {
+        const char *name, *value;
+        size_t nameLen, valueLen;
+        return pair(index, name, nameLen, value, valueLen) ? asyncWebDecode(value, valueLen) : String();
+    }
+
+    [[nodiscard]] bool hasArg(const char *wanted) const {
+        const char *name, *value;
+        size_t nameLen, valueLen;
+        for (uint8_t i = 0; pair(i, name, nameLen, value, valueLen); i++) {
+            if (nameLen == strlen(wanted) && strncmp(name, wanted, nameLen) == 0) return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] String arg(const char *wanted) const {
+        const char *name, *value;
+        size_t nameLen, valueLen;
+        for (uint8_t i = 0; pair(i, name, nameLen, value, valueLen); i++) {
+            if (nameLen == strlen(wanted) && strncmp(name, wanted, nameLen) == 0) {
+                return asyncWebDecode(value, valueLen);
+            }
+        }
+        return String();
+    }
+
+    /**
+     * Valeur d'un en-tête de la requête, vide s'il est absent
+     */
+    [[nodiscard]] String header(const char *wanted) const {
+        const size_t wantedLen = strlen(wanted);
+        const char *line = headers;
+        while (*line) {
+            const char *end = strstr(line, "\r\n");
+            if (!end) end = line + strlen(line);
+            if (static_cast<size_t>(end - line) > wantedLen && line[wantedLen] == ':' &&
+                strncasecmp(line, wanted, wantedLen) == 0) {
+                const char *value = line + wantedLen + 1;
+                while (value < end && *value == ' ') value++;
+                String out;
+                out.reserve(end - value);
+                while (value < end) out += *value++;
+                return out;
+            }
+            line = *end ? end + 2 : end;
+        }
+        return String();
+    }
+
+    [[nodiscard]] const char *methodName() const {
+        switch (method) {
+            case HTTP_POST: return "POST";
+            case HTTP_HEAD: return "HEAD";
+            case HTTP_PUT: return "PUT";
+            case HTTP_DELETE: return "DELETE";
+            default: return "GET";
+        }
+    }
+
+    [[nodiscard]] bool sent() const { return _sent; }
+
+    void addHeader(const char *name, const String &value) {
+        _headers += name;
+        _headers += ": ";
+        _headers += value;
+        _headers += "\r\n";
+    }
+
+    /**
+     * Réponse complète, envoyée par la loop et les callbacks d'accusé : content est conservé jusque-là
+     */
+    void send(const int code, const char *type, String content) {
+        if (_sent) return;
+        _sent = true;
+        _conn.headOnly = method == HTTP_HEAD;
+        asyncWebCompose(_conn, code, type, _headers, std::move(content));
+    }
+
+    /**
+     * Réponse différée : la connexion attend asyncWebRespond() avec ce jeton
+     */
+    AsyncWebDeferred defer() {
+        AsyncWebDeferred deferred;
+        if (_sent) return deferred;
+        _sent = true;
+        _conn.headOnly = method == HTTP_HEAD;
+        _conn.state = ASYNC_WAITING;
+        _conn.lastActivity = millis();
+        deferred.slot = static_cast<int8_t>(&_conn - asyncWebConns);
+        deferred.generation = _conn.generation;
+        return deferred;
+    }
+};
+
+inline void asyncWebRelease(AsyncWebConn &conn) {
+    conn.pcb = nullptr;
+    conn.state = ASYNC_FREE;
+    conn.generation++;
+    conn.headOnly = false;
+    conn.len = 0;
+    conn.requestLen = 0;
+    conn.status = 0;
+    conn.served = 0;
+    conn.head = String();
+    conn.body = String();
+    conn.written = 0;
+    conn.unacked = 0;
+}
+
+/**
+ * Fermeture par le serveur
+ * @return ERR_ABRT si la connexion a dû être avortée (à renvoyer par le callback en cours)
+ */
+inline err_t asyncWebClose(AsyncWebConn &conn) {
+    tcp_pcb *pcb = conn.pcb;
+    asyncWebRelease(conn);
+    if (!pcb) return ERR_OK;
+    tcp_arg(pcb, nullptr);
+    tcp_recv(pcb, nullptr);
+    tcp_sent(pcb, nullptr);
+    tcp_err(pcb, nullptr);
+    tcp_poll(pcb, nullptr, 0);
+    if (tcp_close(pcb) == ERR_OK) return ERR_OK;
+    tcp_abort(pcb);
+    return ERR_ABRT;
+}
+
+/**
+ * Requête complète au début du tampon ? Seuls les en-têtes utiles sont lus (contexte système)
+ */
+inline void asyncWebScan(AsyncWebConn &conn, const bool overflow) {
+    const char *headerEnd = strstr(conn.buf, "\r\n\r\n");
+    if (!headerEnd) {
+        if (overflow || conn.len >= ASYNC_WEB_REQUEST_MAX) {
+            conn.status = 413;
+            conn.requestLen = conn.len;
+        }
+        if (conn.status) {
+            conn.keepAlive = false;
+            conn.state = ASYNC_READY;
+            esp_schedule();
+        }
+        return;
+    }
+
+    const char *lineEnd = strstr(conn.buf, "\r\n");
+    conn.keepAlive = lineEnd - conn.buf >= 8 && strncmp(lineEnd - 8, "HTTP/1.1", 8) == 0;
+    uint32_t contentLength = 0;
+    for (const char *line = lineEnd + 2; line < headerEnd; line = strstr(line, "\r\n") + 2) {
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            contentLength = strtoul(line + 15, nullptr, 10);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            const char *value = line + 11;
+            while (*value == ' ') value++;
+            if (strncasecmp(value, "close", 5) == 0) conn.keepAlive = false;
+            if (strncasecmp(value, "keep-alive", 10) == 0) conn.keepAlive = true;
+        }
+    }
+
+    const uint32_t headerLen = headerEnd - conn.buf + 4;
+    if (headerLen + contentLength > ASYNC_WEB_REQUEST_MAX) {
+        conn.status = 413;
+        conn.keepAlive = false;
+        conn.requestLen = conn.len;
+    } else if (conn.len < headerLen + contentLength) {
+        return; // Corps incomplet
+    } else {
+        conn.requestLen = headerLen + contentLength;
+    }
+    conn.state = ASYNC_READY;
+    esp_schedule(); // Réveil de la loop si elle dort (voir MySleep.h)
+}
+
+/**
+ * Réponse confiée à lwIP autant que son tampon d'émission le permet
+ */
+inline void asyncWebPump(AsyncWebConn &conn) {
+    const size_t total = conn.head.length() + conn.body.length();
+    bool progressed = false;
+    while (conn.written < total) {
+        const size_t space = tcp_sndbuf(conn.pcb);
+        if (space == 0) break;
+        const bool inHead = conn.written < conn.head.length();
+        const String &part = inHead ? conn.head : conn.body;
+        const size_t offset = inHead ? conn.written : conn.written - conn.head.length();
+        const auto n = static_cast<u16_t>(std::min<size_t>({space, part.length() - offset, 0xFFFF}));
+        // ERR_MEM : nouvel essai au prochain accusé ou au prochain poll
+        if (tcp_write(conn.pcb, part.c_str() + offset, n, TCP_WRITE_FLAG_COPY) != ERR_OK) break;
+        conn.written += n;
+        conn.unacked += n;
+        asyncWebStats.bytesSent += n;
+        progressed = true;
+    }
+    if (progressed) {
+        conn.lastActivity = millis();
+        tcp_output(conn.pcb);
+    }
+}
+
+/**
+ * Réponse entièrement accusée : requête suivante (keep-alive) ou fermeture
+ * @return ERR_ABRT si la connexion a été avortée
+ */
+inline err_t asyncWebFinish(AsyncWebConn &conn) {
+    if (!conn.keepAlive || conn.status) return asyncWebClose(conn);
+    const uint16_t rest = conn.len - conn.requestLen;
+    memmove(conn.buf, conn.buf + conn.requestLen, rest);
+    conn.len = rest;
+    conn.buf[conn.len] = 0;
+    conn.requestLen = 0;
+    conn.head = String();
+    conn.body = String();
+    conn.written = 0;
+    conn.state = ASYNC_READING;
+    conn.lastActivity = millis();
+    if (rest) asyncWebScan(conn, false);
+    return ERR_OK;
+}
+
+inline err_t asyncWebOnSent(void *arg, tcp_pcb *, const u16_t len) {
+    auto *conn = static_cast<AsyncWebConn *>(arg);
+    if (!conn) return ERR_OK;
+    conn->unacked -= std::min<size_t>(len, conn->unacked);
+    conn->lastActivity = millis();
+    if (conn->state != ASYNC_SENDING) return ERR_OK;
+    asyncWebPump(*conn);
+    if (conn->written == conn->head.length() + conn->body.length() && conn->unacked == 0) return asyncWebFinish(*conn);
+    return ERR_OK;
+}
+
+inline err_t asyncWebOnRecv(void *arg, tcp_pcb *pcb, pbuf *p, const err_t err) {
+    auto *conn = static_cast<AsyncWebConn *>(arg);
+    if (!conn) {
+        if (p) pbuf_free(p);
+        return ERR_OK;
+    }
+    if (!p) return asyncWebClose(*conn); // Fermeture par le client
+    if (err != ERR_OK) {
+        pbuf_free(p);
+        return err;
+    }
+
+    const uint16_t room = ASYNC_WEB_REQUEST_MAX - conn->len;
+    const uint16_t n = std::min<uint16_t>(room, p->tot_len);
+    pbuf_copy_partial(p, conn->buf + conn->len, n, 0);
+    conn->len += n;
+    conn->buf[conn->len] = 0;
+    conn->lastActivity = millis();
+    const bool overflow = p->tot_len > room;
+    tcp_recved(pcb, p->tot_len);
+    pbuf_free(p);
+    if (conn->state == ASYNC_READING) asyncWebScan(*conn, overflow);
+    return ERR_OK;
+}
+
+inline void asyncWebOnError(void *arg, err_t) {
+    auto *conn = static_cast<AsyncWebConn *>(arg);
+    if (!conn) return;
+    asyncWebStats.errors++;
+    asyncWebRelease(*conn); // lwIP a déjà libéré le pcb
+}
+
+inline err_t asyncWebOnPoll(void *arg, tcp_pcb *) {
+    auto *conn = static_cast<AsyncWebConn *>(arg);
+    if (!conn) return ERR_OK;
+    const unsigned long idle = millis() - conn->lastActivity;
+    if ((conn->state == ASYNC_READING && idle >= ASYNC_WEB_IDLE_MS) ||
+        (conn->state == ASYNC_SENDING && idle >= ASYNC_WEB_SEND_TIMEOUT_MS) ||
+        (conn->state == ASYNC_WAITING && idle >= ASYNC_WEB_DEFER_MAX_MS)) {
+        asyncWebStats.timeouts++;
+        return asyncWebClose(*conn);
+    }
+    if (conn->state == ASYNC_SENDING) asyncWebPump(*conn);
+    return ERR_OK;
+}
+
+inline err_t asyncWebOnAccept(void *, tcp_pcb *pcb, const err_t err) {
+    if (err != ERR_OK || !pcb) return ERR_OK;
+    AsyncWebConn *conn = nullptr;
+    uint8_t active = 0;
+    for (AsyncWebConn &candidate: asyncWebConns) {
+        if (candidate.state != ASYNC_FREE) {
+            active++;
+        } else if (!conn) {
+            conn = &candidate;
+        }
+    }
+    if (!conn) {
+        asyncWebStats.refused++;
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+
+    asyncWebRelease(*conn);
+    conn->pcb = pcb;
+    conn->state = ASYNC_READING;
+    conn->buf[0] = 0;
+    conn->lastActivity = millis();
+    asyncWebStats.accepted++;
+    asyncWebStats.maxConcurrent = std::max<uint8_t>(asyncWebStats.maxConcurrent, active + 1);
+
+    tcp_arg(pcb, conn);
+    tcp_recv(pcb, asyncWebOnRecv);
+    tcp_sent(pcb, asyncWebOnSent);
+    tcp_err(pcb, asyncWebOnError);
+    tcp_poll(pcb, asyncWebOnPoll, ASYNC_WEB_POLL_TICKS);
+    return ERR_OK;
+}
+
+inline void asyncWebOn(const char *path, const HTTPMethod method, const AsyncWebHandler handler) {
+    if (asyncWebRouteCount < ASYNC_WEB_MAX_ROUTES) asyncWebRoutes[asyncWebRouteCount++] = {path, method, handler};
+}
+
+inline void asyncWebOnNotFound(const AsyncWebHandler handler) {
+    asyncWebNotFound = handler;
+}
+
+/**
+ * Requête prête : route, handler et début de l'envoi
+ */
+inline void asyncWebHandle(AsyncWebConn &conn) {
+    conn.state = ASYNC_SENDING;
+    asyncWebStats.requests++;
+    if (conn.served++ > 0) asyncWebStats.keepAliveReused++;
+    asyncWebLastRequest = millis();
+    asyncWebRequestSeen = true;
+
+    // Le corps s'arrête où commence la requête suivante, déjà reçue en keep-alive : octet restauré après
+    const char next = conn.buf[conn.requestLen];
+    conn.buf[conn.requestLen] = 0;
+    AsyncWebRequest request(conn);
+    if (conn.status == 413) {
+        asyncWebStats.tooLarge++;
+        request.send(413, "text/plain", "Requête trop grande\n");
+    } else if (!request.parse()) {
+        conn.status = 400;
+        request.send(400, "text/plain", "Requête invalide\n");
+    } else {
+        if (asyncWebObserver) asyncWebObserver(request);
+        for (uint8_t i = 0; i < asyncWebRouteCount && !request.sent(); i++) {
+            const AsyncWebRoute &route = asyncWebRoutes[i];
+            if (strcmp(route.path, request.path) == 0 && (route.method == HTTP_ANY || route.method == request.method)) {
+                route.handler(request);
+            }
+        }
+        if (!request.sent() && asyncWebNotFound) asyncWebNotFound(request);
+        if (!request.sent()) request.send(404, "text/plain", "Not found\n");
+    }
+    conn.buf[conn.requestLen] = next;
+    if (conn.state == ASYNC_SENDING) asyncWebPump(conn);
+}
+
+// Le client d'une réponse différée attend toujours
+inline bool asyncWebDeferredAlive(const AsyncWebDeferred &deferred) {
+    if (deferred.slot < 0 || deferred.slot >= ASYNC_WEB_MAX_CLIENTS) return false;
+    const AsyncWebConn &conn = asyncWebConns[deferred.slot];
+    return conn.state == ASYNC_WAITING && conn.generation == deferred.generation;
+}
+
+/**
+ * Réponse à une requête différée par request.defer()
+ * @return false si le client est parti entre-temps
+ */
+inline bool asyncWebRespond(const AsyncWebDeferred &deferred, const int code, const char *type, String content,
+                            const String &headers = String()) {
+    if (!asyncWebDeferredAlive(deferred)) return false;
+    AsyncWebConn &conn = asyncWebConns[deferred.slot];
+    asyncWebCompose(conn, code, type, headers, std::move(content));
+    conn.state = ASYNC_SENDING;
+    asyncWebPump(conn);
+    return true;
+}
+
+/**
+ * Requêtes prêtes traitées dans la loop ; les envois se poursuivent dans les callbacks
+ */
+inline void loopAsyncWeb() {
+    for (AsyncWebConn &conn: asyncWebConns) {
+        if (conn.state == ASYNC_READY) asyncWebHandle(conn);
+    }
+}
+
+// Une requête attend la loop
+inline bool asyncWebPending() {
+    for (const AsyncWebConn &conn: asyncWebConns) {
+        if (conn.state == ASYNC_READY) return true;
+    }
+    return false;
+}
+
+inline bool asyncWebBegin(const uint16_t port) {
+    tcp_pcb *pcb = tcp_new();
+    if (!pcb) return false;
+    if (tcp_bind(pcb, IP_ADDR_ANY, port) != ERR_OK) {
+        tcp_close(pcb);
+        return false;
+    }
+    asyncWebListener = tcp_listen(pcb);
+    if (!asyncWebListener) {
+        tcp_close(pcb);
+        return false;
+    }
+    tcp_accept(asyncWebListener, asyncWebOnAccept);
+    asyncWebStats.listening = true;
+    return true;
+}
+
+inline size_t asyncWebReport(char *out, const size_t size) {
+    uint8_t active = 0;
+    uint8_t waiting = 0;
+    for (const AsyncWebConn &conn: asyncWebConns) {
+        if (conn.state != ASYNC_FREE) active++;
+        if (conn.state == ASYNC_WAITING) waiting++;
+    }
+    const AsyncWebStats &s = asyncWebStats;
+    return snprintf(out, size,
+                    "ecoute=%s connexions=%u/%u attente=%u max=%u acceptees=%u refusees=%u requetes=%u "
+                    "keepalive=%u trop_grandes=%u delais=%u erreurs=%u envoyes=%u o\n",
+                    s.listening ? "oui" : "non", active, ASYNC_WEB_MAX_CLIENTS, waiting, s.maxConcurrent, s.accepted,
+                    s.refused, s.requests, s.keepAliveReused, s.tooLarge, s.timeouts, s.errors, s.bytesSent);
+}
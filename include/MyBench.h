@@ -0,0 +1,143 @@
+/**
+ * \file MyBench.h
+ * \page bench Microbenchmarks sur la carte
+ * \brief Route /bench : la suite de MyMicroBench.h et les opérations propres à la carte, en JSON
+ *
+ * Les discussions sur le coût des concaténations de String, de serializeJson, des ajouts sur LittleFS
+ * manquaient de mesures faites sur la carte. La route
+ * \code
+ * GET /bench            (toute la suite)
+ * GET /bench?cas=log_line
+ * \endcode
+ * exécute dans la loop une suite fixe et rend :
+ * \code
+ * {"plateforme":"esp8266","mhz":80,"resultats":[{"nom":"config_parse","iterations":50,"cycles":...},...]}
+ * \endcode
+ * Les cas portables (MyMicroBench.h) sont mesurés avec les mêmes entrées par la cible hôte
+ * (environnement native de platformio.ini, cible bench_host de CMakeLists) : les deux sorties se
+ * comparent ligne à ligne. Cas propres à la carte :
+ * - dashboard_render / dashboard_cached : rootPage(), sans puis avec le cache de rendu ;
+ * - string_concat : ligne construite par concaténations de String, à comparer à snprintf_line ;
+ * - log_line : ajout d'un enregistrement au tampon de logs (les lignes « -BENCH » y restent) ;
+ * - commande_tick : commande() acceptée par le dernier niveau puis annulée, stock inchangé. Ignoré si
+ *   un envoi ou une commande est en cours, ou si la commande déclencherait une copulation. Ses lignes
+ *   de debug partent sur le port série (comptées dans la mesure) mais pas dans le tampon de logs ;
+ * - state_crc : somme de contrôle de la table d'état des distributeurs ;
+ * - tracking_append : logTracking() dans un segment de suivi temporaire, supprimé ensuite.
+ * Les publications MQTT réelles ne font pas partie de la suite (limite de débit d'Adafruit IO) : le
+ * débit et la latence du broker se mesurent avec MyPipelineBench.h.
+ *
+ * La suite bloque la loop le temps de la mesure (moins d'une seconde), le watchdog est nourri entre
+ * les cas. Comme les autres routes déclarées par webOn(), /bench répond sur le port 80 (serveur
+ * asynchrone) et sur WEB_SYNC_PORT (8080) ; avec WEB_ASYNC=0, sur le seul port 80.
+ *
+ * Fichier \ref MyBench.h
+ */
+#pragma once
+
+#include "MyMicroBench.h"
+#include "MyChain.h"
+#include "MyTracking.h"
+#include "MyWatchdog.h"
+#include "MyWebServer.h"
+
+#define BENCH_TRACKING_SEGMENT   999999   // Segment de suivi temporaire
+
+inline void benchDashboardRender() {
+    microBenchSink = rootPage().length();
+}
+
+inline void benchDashboardCached() {
+    microBenchSink = rootPageCached().length();
+}
+
+inline void benchStringConcat() {
+    const String line = "-BENCH : " + String(microBenchSink) + " rations dans " + String("Achigan du Restaurant");
+    microBenchSink = line.length();
+}
+
+inline void benchLogLine() {
+    addToLogBuffer("-BENCH : ligne de mesure");
+}
+
+// Commande acceptée sans copulation, sur un niveau au repos
+inline bool benchCommandeSetup() {
+    return !achiganResto.envoiEnCours() && defaultChain.ordersQueued() == 0 &&
+           achiganResto.getRation() - 1 >= achiganResto.getNbMin();
+}
+
+inline void benchCommandeTick() {
+    const LogMute mute; // Les lignes de commande() restent sur le port série, hors de /api/logs
+    microBenchSink = achiganResto.commande(1);
+    achiganResto.annulerEnvoi();
+}
+
+inline void benchStateCrc() {
+    microBenchSink = distribStateCrc();
+}
+
+inline uint32_t benchTrackingSegment = 0;
+inline uint32_t benchTrackingHour = 0;
+
+inline bool benchTrackingSetup() {
+    benchTrackingSegment = trackingLastSegment;
+    benchTrackingHour = trackingLastIndexedHour;
+    trackingLastSegment = BENCH_TRACKING_SEGMENT;
+    trackingLastIndexedHour = 0;
+    return true;
+}
+
+inline void benchTrackingTeardown() {
+    SPIFFS.remove(trackingSegmentFile(BENCH_TRACKING_SEGMENT, ".log"));
+    SPIFFS.remove(trackingSegmentFile(BENCH_TRACKING_SEGMENT, ".idx"));
+    trackingLastSegment = benchTrackingSegment;
+    trackingLastIndexedHour = benchTrackingHour;
+}
+
+inline void benchTrackingAppend() {
+    logTracking("bench");
+}
+
+inline const MicroBenchCase benchDeviceCases[] = {
+    {"dashboard_render", 20, benchDashboardRender, nullptr, nullptr},
+    {"dashboard_cached", 50, benchDashboardCached, nullptr, nullptr},
+    {"string_concat", 200, benchStringConcat, nullptr, nullptr},
+    {"log_line", 10, benchLogLine, nullptr, nullptr},
+    {"commande_tick", 5, benchCommandeTick, benchCommandeSetup, nullptr},
+    {"state_crc", 100, benchStateCrc, nullptr, nullptr},
+    {"tracking_append", 10, benchTrackingAppend, benchTrackingSetup, benchTrackingTeardown},
+};
+
+inline void benchAppend(String &out, const MicroBenchCase &benchCase, bool &first) {
+    loopWatchdogFeed(); // Chaque cas est borné
+    char line[MICRO_BENCH_LINE_MAX];
+    microBenchFormat(microBenchRun(benchCase), line, sizeof(line));
+    if (!first) out += ",";
+    out += line;
+    first = false;
+}
+
+/**
+ * Fonction de gestion de la route /bench
+ */
+inline void handleBench(WebRequest &request) {
+    if (request.heapUnavailable()) return;
+    const String only = request.arg("cas");
+    String out;
+    out.reserve(128 + MICRO_BENCH_LINE_MAX * (MICRO_BENCH_PORTABLE + std::size(benchDeviceCases)));
+    out += "{\"plateforme\":\"" MICRO_BENCH_PLATFORM "\",\"mhz\":" + String(ESP.getCpuFreqMHz()) + ",\"resultats\":[";
+    bool first = true;
+    for (const MicroBenchCase &benchCase: microBenchPortableCases) {
+        if (only.length() == 0 || only == benchCase.name) benchAppend(out, benchCase, first);
+    }
+    for (const MicroBenchCase &benchCase: benchDeviceCases) {
+        if (only.length() == 0 || only == benchCase.name) benchAppend(out, benchCase, first);
+    }
+    out += "]}";
+    MYDEBUG_PRINTLN("-BENCH : Suite exécutée" + (only.length() ? " (" + only + ")" : String()));
+    request.send(first ? 404 : 200, "application/json", out);
+}
+
+inline void setupBench() {
+    webOn("/bench", HTTP_GET, handleBench);
+}
@@ -0,0 +1,187 @@
+/**
+ * \file MyBoot.h
+ * \page boot Démarrage
+ * \brief Chronologie des phases du démarrage, conservée en mémoire RTC, et démarrage rapide
+ *
+ * Chaque phase du setup() est exécutée par bootRun() qui note son début, sa durée et son résultat.
+ * La chronologie est écrite en mémoire RTC au début et à la fin de chaque phase : si la carte
+ * redémarre pendant le démarrage, la phase en cours (RUNNING) est visible au démarrage suivant.
+ *
+ * La route /debug/boot affiche la chronologie du démarrage courant et celle du précédent.
+ *
+ * <H2>Démarrage rapide</H2>
+ *
+ * Avec BOOT_FAST_START (par défaut), il n'y a plus d'attentes fixes et seules les vraies dépendances
+ * bloquent :
+ * - l'association WiFi est lancée sans attendre, le montage du système de fichiers, la lecture de la
+ *   configuration, le serveur web (joignable sur le point d'accès), les tickers et l'historique
+ *   démarrent pendant ce temps ;
+ * - le plan de contrôle est alors prêt (bootReady()), l'objectif est de moins de 3 s ;
+ * - le distributeur, qui a besoin du broker MQTT, est démarré par la loop dès que le WiFi est connecté,
+ *   avec une seule tentative de connexion au broker, sans délai : les suivantes sont faites par
+ *   loopDistributeur() (voir connectAdafruitIO()).
+ *
+ * Avec BOOT_FAST_START à 0, les phases s'enchaînent comme avant, avec leurs délais de stabilisation.
+ *
+ * Fichier \ref MyBoot.h
+ */
+#pragma once
+
+#include "MyDebug.h"
+#include "MyRTC.h"
+#include "MyWebServer.h"
+
+#ifndef BOOT_FAST_START
+#define BOOT_FAST_START    1
+#endif
+#define BOOT_MAX_EVENTS    12
+#define BOOT_READY_GOAL_MS 3000
+
+enum BootPhase : uint8_t {
+    BOOT_PHASE_WIFI,
+    BOOT_PHASE_WIFI_CONNECT,
+    BOOT_PHASE_SPIFFS,
+    BOOT_PHASE_CONFIG,
+    BOOT_PHASE_JOURNAL,
+    BOOT_PHASE_WEBSERVER,
+    BOOT_PHASE_TICKER,
+    BOOT_PHASE_NTP,
+    BOOT_PHASE_HISTORY,
+    BOOT_PHASE_DISTRIBUTEUR,
+    BOOT_PHASE_COUNT
+};
+
+inline const char *bootPhaseNames[BOOT_PHASE_COUNT] = {
+    "wifi", "wifi-connect", "spiffs", "config", "journal", "webserver", "ticker", "ntp", "history", "distributeur"
+};
+
+enum BootOutcome : uint8_t {
+    BOOT_RUNNING,
+    BOOT_OK,
+    BOOT_FAILED,
+};
+
+inline const char *bootOutcomeNames[] = {"RUNNING", "OK", "FAILED"};
+
+struct BootEvent {
+    uint32_t startMs = 0;
+    uint16_t durationMs = 0;
+    uint8_t phase = 0;
+    uint8_t outcome = BOOT_RUNNING;
+};
+
+struct BootTimeline {
+    uint32_t bootCount = 0;
+    uint32_t readyMs = 0;      // Plan de contrôle prêt, 0 si jamais atteint
+    uint8_t count = 0;
+    uint8_t fastStart = BOOT_FAST_START;
+    uint16_t reserved = 0;
+    BootEvent events[BOOT_MAX_EVENTS];
+};
+
+static_assert(sizeof(RtcRecord<BootTimeline>) <= (RTC_SLOT_WATCHDOG - RTC_SLOT_BOOT) * RTC_BLOCK_SIZE,
+              "Chronologie du démarrage trop grande pour sa zone RTC");
+
+inline BootTimeline bootTimeline;
+inline BootTimeline bootPrevious;
+inline bool bootHasPrevious = false;
+
+inline void bootPhaseBegin(const BootPhase phase) {
+    if (bootTimeline.count >= BOOT_MAX_EVENTS) return;
+    BootEvent &event = bootTimeline.events[bootTimeline.count++];
+    event.phase = phase;
+    event.startMs = millis();
+    event.outcome = BOOT_RUNNING;
+    rtcStore(RTC_SLOT_BOOT, bootTimeline);
+}
+
+inline void bootPhaseEnd(const BootPhase phase, const BootOutcome outcome) {
+    for (uint8_t i = bootTimeline.count; i-- > 0;) {
+        BootEvent &event = bootTimeline.events[i];
+        if (event.phase == phase && event.outcome == BOOT_RUNNING) {
+            event.durationMs = std::min<unsigned long>(millis() - event.startMs, UINT16_MAX);
+            event.outcome = outcome;
+            rtcStore(RTC_SLOT_BOOT, bootTimeline);
+            return;
+        }
+    }
+}
+
+/**
+ * Exécution d'une phase du démarrage, avec la gestion d'erreur du setup()
+ * @return false si la phase a levé une exception
+ */
+template<typename F>
+bool bootRun(const BootPhase phase, F &&fn) {
+    bootPhaseBegin(phase);
+    try {
+        fn();
+        bootPhaseEnd(phase, BOOT_OK);
+        MYDEBUG_PRINTLN("----- " + String(bootPhaseNames[phase]) + " OK -----");
+        return true;
+    } catch (const std::exception &e) {
+        bootPhaseEnd(phase, BOOT_FAILED);
+        MYDEBUG_PRINT("Erreur " + String(bootPhaseNames[phase]) + " : ");
+        MYDEBUG_PRINTLN(e.what());
+        return false;
+    }
+}
+
+/**
+ * Attente de stabilisation, uniquement hors démarrage rapide
+ */
+inline void bootSettle([[maybe_unused]] const unsigned long ms) {
+#if !BOOT_FAST_START
+    delay(ms);
+#endif
+}
+
+/**
+ * Le plan de contrôle (serveur web, configuration) est prêt
+ */
+inline void bootReady() {
+    bootTimeline.readyMs = millis();
+    rtcStore(RTC_SLOT_BOOT, bootTimeline);
+    MYDEBUG_PRINTLN("-BOOT : Plan de contrôle prêt en " + String(bootTimeline.readyMs) + " ms" +
+        (bootTimeline.readyMs > BOOT_READY_GOAL_MS ? " (objectif dépassé)" : ""));
+}
+
+inline void bootPrintTimeline(String &out, const BootTimeline &timeline) {
+    out += "Boot #" + String(timeline.bootCount) + (timeline.fastStart ? " (rapide)" : " (séquentiel)") + "\n";
+    for (uint8_t i = 0; i < timeline.count && i < BOOT_MAX_EVENTS; i++) {
+        const BootEvent &event = timeline.events[i];
+        const char *name = event.phase < BOOT_PHASE_COUNT ? bootPhaseNames[event.phase] : "?";
+        const char *outcome = event.outcome <= BOOT_FAILED ? bootOutcomeNames[event.outcome] : "?";
+        char line[80];
+        snprintf(line, sizeof(line), "  %-14s début %6u ms  durée %5u ms  %s\n", name, event.startMs,
+                 event.durationMs, outcome);
+        out += line;
+    }
+    out += timeline.readyMs ? "  prêt à " + String(timeline.readyMs) + " ms\n" : String("  jamais prêt\n");
+}
+
+/**
+ * Fonction de gestion de la route /debug/boot
+ */
+inline void handleDebugBoot(WebRequest &request) {
+    String out;
+    out.reserve(1024);
+    out += "Reset reason: " + ESP.getResetReason() + "\n\n";
+    bootPrintTimeline(out, bootTimeline);
+    if (bootHasPrevious) {
+        out += "\nDémarrage précédent :\n";
+        bootPrintTimeline(out, bootPrevious);
+    }
+    request.send(200, "text/plain", out);
+}
+
+/**
+ * Début de la chronologie : à appeler en tout premier dans setup()
+ */
+inline void setupBoot() {
+    bootHasPrevious = rtcLoad(RTC_SLOT_BOOT, bootPrevious);
+    bootTimeline = BootTimeline();
+    bootTimeline.bootCount = bootHasPrevious ? bootPrevious.bootCount + 1 : 1;
+    rtcStore(RTC_SLOT_BOOT, bootTimeline);
+    webOn("/debug/boot", HTTP_GET, handleDebugBoot);
+}
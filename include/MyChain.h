@@ -0,0 +1,541 @@
+/**
+ * \file MyChain.h
+ * \page chain Chaînes de distributeurs
+ * \brief Plusieurs bacs indépendants sur une même carte, ordonnancés à tour de rôle avec des budgets
+ *
+ * Une chaîne regroupe les DISTRIBUTEUR_COUNT niveaux d'un bac (croquette → poisson rouge → achigan →
+ * restaurant) avec :
+ * - son espace de noms de feeds : la chaîne par défaut utilise les feeds FEED_* tels quels, une chaîne
+ *   « bac2 » utilise « bac2-commande », « bac2-ready », « bac2-croquette.nbration »... ;
+ * - sa file de commandes : une commande attend que l'envoi précédent du dernier niveau soit terminé ;
+ * - ses Tickers : celui d'envoi de chaque distributeur et ceux de copulation.
+ *
+ * Les Tickers ne font que lever des drapeaux. Le travail (étapes d'envoi, copulations, commandes en
+ * attente) est fait dans la loop par loopChains(), qui donne un tour à chaque chaîne. Pendant son tour,
+ * une chaîne enchaîne les travaux tant que :
+ * - son budget CPU (budgetUs par tour) n'est pas épuisé ;
+ * - son seau de publications n'est pas vide (publishPerSec, rempli en continu ; les publications
+ *   réellement écrites, comptées par le multiplexeur, en sont retirées).
+ * Le travail restant attend le tour suivant : un bac très actif ne peut pas affamer les autres.
+ *
+ * Les chaînes supplémentaires sont déclarées dans /config.json :
+ * \code
+ * "chainBudgetUs": 20000, "chainPublishPerSec": 2,
+ * "chaines": [{"ns": "bac2", "budgetUs": 10000, "publishPerSec": 1,
+ *              "distributeurs": {"croquette": {...}, "poissonRouge": {...}, "achigan": {...}, "achiganResto": {...}}}]
+ * \endcode
+ * La clé « origineTransactions » (globale pour la chaîne par défaut, ou d'une entrée de « chaines »)
+ * désigne la carte dont les transactions (MyTransaction.h) peuvent modifier les stocks de la chaîne.
+ * Les identifiants du journal sont attribués dans l'ordre des chaînes : on ajoute une chaîne à la fin
+ * de la liste. L'historique des stocks ne suit que la chaîne par défaut.
+ *
+ * La route /debug/chains affiche l'état et les compteurs de chaque chaîne.
+ *
+ * Fichier \ref MyChain.h
+ */
+#pragma once
+
+#include "MyDistributeur.h"
+#include "MyJournal.h"
+#include "MyRemote.h"
+#include "MyWatchdog.h"
+#include "MyWebServer.h"
+
+#define CHAIN_MAX                4       // Chaîne par défaut comprise
+#define CHAIN_LEVELS             DISTRIBUTEUR_COUNT
+#define CHAIN_ORDER_QUEUE        4
+#define CHAIN_ROUTE_STRIDE       16      // Routes par chaîne dans l'index du multiplexeur
+#define CHAIN_NS_SEPARATOR       '-'
+#define CHAIN_BUDGET_US          20000   // Temps CPU par tour
+#define CHAIN_PUBLISH_PER_SEC    2.0f
+#define CHAIN_PUBLISH_BURST      6.0f    // Contenance du seau : une étape d'envoi en publie 3
+#define CHAIN_REPORT_LINE        320     // Plus longue ligne de /debug/chains : txnReport(), 157 + 15 × 10 chiffres
+
+static_assert(CHAIN_MAX * CHAIN_LEVELS <= JOURNAL_MAX_IDS, "Instantané du journal trop petit pour les chaînes");
+static_assert(CHAIN_LEVELS <= TXN_MAX_PARTS, "Transaction trop petite pour l'instantané d'une chaîne");
+
+// Feeds des niveaux, sans préfixe ni espace de noms
+inline const char *const chainLevelFeeds[CHAIN_LEVELS] = {
+    FEED_KEY(FEED_NB_RATION_CROQUETTE), FEED_KEY(FEED_NB_RATION_POISSON_ROUGE), FEED_KEY(FEED_NB_RATION_ACHIGAN),
+    FEED_KEY(FEED_NB_RATION_RESTO)
+};
+
+struct ChainStats {
+    uint32_t turns = 0;
+    uint32_t jobs = 0;             // Étapes d'envoi, copulations et commandes traitées
+    uint32_t published = 0;
+    uint32_t cpuDeferred = 0;      // Tours interrompus par le budget CPU
+    uint32_t publishDeferred = 0;  // Tours interrompus par le budget de publication
+    uint32_t ordersDropped = 0;    // File de commandes pleine ou commande invalide
+    uint32_t maxTurnUs = 0;
+    uint64_t cpuUs = 0;
+};
+
+class MyChain {
+    int _orders[CHAIN_ORDER_QUEUE] = {};
+    uint8_t _orderHead = 0;
+    uint8_t _orderCount = 0;
+    Ticker _copulationTickers[CHAIN_LEVELS];
+    volatile uint8_t _copulationDue = 0;   // Un bit par niveau, levé par son Ticker
+    unsigned long _copulationArmedAt[CHAIN_LEVELS] = {};
+    float _tokens = CHAIN_PUBLISH_BURST;
+    unsigned long _lastRefill = 0;
+    bool _started = false;
+
+    // Un travail, par ordre de priorité : envoi en cours, copulation, nouvelle commande
+    bool step() {
+        for (MyDistributeur *level: levels) {
+            if (level->envoiStep()) return true;
+        }
+        for (uint8_t i = 0; i < CHAIN_LEVELS; i++) {
+            if (_copulationDue & (1 << i)) {
+                _copulationDue &= ~(1 << i);
+                copulationPlanifiee(*levels[i]);
+                return true;
+            }
+        }
+        if (_orderCount > 0 && !levels[CHAIN_LEVELS - 1]->envoiEnCours() && !remoteWaiting()) {
+            const int nombre = _orders[_orderHead];
+            _orderHead = (_orderHead + 1) % CHAIN_ORDER_QUEUE;
+            _orderCount--;
+            if (!levels[CHAIN_LEVELS - 1]->commande(nombre) && remoteWaiting()) {
+                // Copulation distante en cours : la commande reprend sa place en tête de file
+                _orderHead = (_orderHead + CHAIN_ORDER_QUEUE - 1) % CHAIN_ORDER_QUEUE;
+                _orders[_orderHead] = nombre;
+                _orderCount++;
+            }
+            return true;
+        }
+        return false;
+    }
+
+public:
+    String ns;                                // Espace de noms des feeds, vide pour la chaîne par défaut
+    MyDistributeur *levels[CHAIN_LEVELS];     // Du premier au dernier niveau
+    ChainFeeds feeds;
+    volatile int readyValue = 0;              // Feed ready des chaînes supplémentaires
+    TxnCursor txnCursors[CHAIN_LEVELS];       // Dernière transaction reçue appliquée à chaque niveau
+    char txnOrigin[MQTT_NODE_ID_SIZE] = "";   // Carte dont les transactions sont appliquées, vide : aucune
+    uint32_t budgetUs = CHAIN_BUDGET_US;
+    float publishPerSec = CHAIN_PUBLISH_PER_SEC;
+    ChainStats stats;
+
+    MyChain(String ns, MyDistributeur *const (&chainLevels)[CHAIN_LEVELS], const ChainFeeds &chainFeeds)
+        : ns(std::move(ns)), feeds(chainFeeds) {
+        for (uint8_t i = 0; i < CHAIN_LEVELS; i++) levels[i] = chainLevels[i];
+    }
+
+    MyChain(const MyChain &) = delete;
+    MyChain &operator=(const MyChain &) = delete;
+
+    /**
+     * Commande reçue sur le feed de la chaîne, traitée à son tour
+     */
+    void enqueueOrder(const int nombre) {
+        if (nombre < 0 || _orderCount >= CHAIN_ORDER_QUEUE) {
+            stats.ordersDropped++;
+            MYDEBUG_PRINTLN("-CHAIN : Commande de " + String(nombre) + " refusée (" + ns + ")");
+            return;
+        }
+        _orders[(_orderHead + _orderCount) % CHAIN_ORDER_QUEUE] = nombre;
+        _orderCount++;
+        stateChanged();
+    }
+
+    [[nodiscard]] uint8_t ordersQueued() const { return _orderCount; }
+
+    /**
+     * Rations encore dues : l'envoi en cours du dernier niveau, puis les commandes en file
+     * @return nombre de valeurs écrites dans out
+     */
+    uint8_t pendingOrders(int *out, const uint8_t max) const {
+        uint8_t n = 0;
+        const MyDistributeur *last = levels[CHAIN_LEVELS - 1];
+        if (last->envoiEnCours() && n < max) out[n++] = last->getNombreRestant();
+        for (uint8_t i = 0; i < _orderCount && n < max; i++) out[n++] = _orders[(_orderHead + i) % CHAIN_ORDER_QUEUE];
+        return n;
+    }
+    [[nodiscard]] float publishTokens() const { return _tokens; }
+
+    [[nodiscard]] bool hasWork() const {
+        if (_copulationDue) return true;
+        for (const MyDistributeur *level: levels) {
+            if (level->envoiDu()) return true;
+        }
+        return _orderCount > 0 && !levels[CHAIN_LEVELS - 1]->envoiEnCours() && !remoteWaiting();
+    }
+
+    // Une copulation distante de la chaîne attend sa réponse
+    [[nodiscard]] bool remoteWaiting() const {
+        for (const MyDistributeur *level: levels) {
+            if (level->remotePending()) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Tickers de copulation, une fois la connexion MQTT établie
+     */
+    void start() {
+        _started = true;
+        for (uint8_t i = 0; i < CHAIN_LEVELS; i++) rearmCopulation(i);
+        _lastRefill = millis();
+    }
+
+    /**
+     * Ticker de copulation d'un niveau, avec sa période courante (aussi après une configuration à chaud)
+     * @return true si le Ticker tourne
+     */
+    bool rearmCopulation(const uint8_t i) {
+        if (!_started || i >= CHAIN_LEVELS) return false;
+        _copulationTickers[i].detach();
+        if (levels[i]->getCopulationMs() == 0) return false;
+        _copulationTickers[i].attach_ms(levels[i]->getCopulationMs(), [this, i]() { _copulationDue |= 1 << i; });
+        _copulationArmedAt[i] = millis();
+        return true;
+    }
+
+    /**
+     * Temps avant le prochain Ticker de la chaîne (envoi ou copulation), UINT32_MAX s'il n'y en a pas
+     */
+    [[nodiscard]] uint32_t nextTickerInMs(const unsigned long now) const {
+        uint32_t next = UINT32_MAX;
+        for (uint8_t i = 0; i < CHAIN_LEVELS; i++) {
+            next = std::min(next, levels[i]->envoiInMs(now));
+            if (_started && levels[i]->getCopulationMs() > 0) {
+                next = std::min(next, tickerNextInMs(_copulationArmedAt[i], levels[i]->getCopulationMs(), now));
+            }
+        }
+        return next;
+    }
+
+    /**
+     * Tour de la chaîne : des travaux tant que les budgets le permettent
+     */
+    void turn() {
+        const unsigned long now = millis();
+        _tokens = std::min(CHAIN_PUBLISH_BURST, _tokens + (now - _lastRefill) * publishPerSec / 1000.0f);
+        _lastRefill = now;
+        stats.turns++;
+
+        const unsigned long start = micros();
+        while (hasWork()) {
+            if (micros() - start >= budgetUs) {
+                stats.cpuDeferred++;
+                break;
+            }
+            if (_tokens < 1) {
+                stats.publishDeferred++;
+                break;
+            }
+            const uint32_t before = mqttMux.getStats().published;
+            if (!step()) break;
+            const uint32_t published = mqttMux.getStats().published - before;
+            _tokens -= published; // Peut devenir négatif : la dette est remboursée avant le prochain travail
+            stats.published += published;
+            stats.jobs++;
+        }
+        const uint32_t elapsed = micros() - start;
+        stats.cpuUs += elapsed;
+        stats.maxTurnUs = std::max(stats.maxTurnUs, elapsed);
+    }
+};
+
+inline MyChain defaultChain("", distributeurs, defaultChainFeeds);
+inline MyChain *chains[CHAIN_MAX] = {&defaultChain};
+inline uint8_t chainCount = 1;
+inline uint8_t chainNext = 0;
+inline MyChain *chainRouted = &defaultChain;   // Chaîne destinataire du message en cours d'aiguillage
+
+/**
+ * Distributeur désigné par une demande distante : chaîne (« - » pour la chaîne par défaut) et niveau
+ */
+inline MyDistributeur *chainLevel(const char *ns, const uint8_t level) {
+    if (level >= CHAIN_LEVELS) return nullptr;
+    for (uint8_t c = 0; c < chainCount; c++) {
+        const String &chainNs = chains[c]->ns;
+        if (chainNs.length() ? chainNs.equalsIgnoreCase(ns) : strcmp(ns, "-") == 0) return chains[c]->levels[level];
+    }
+    return nullptr;
+}
+
+/**
+ * Routes des feeds d'une chaîne, indexées à la compilation par une table de hachage parfaite
+ */
+inline constexpr FeedRoute feedRoutes[] = {
+    {FEED_KEY(FEED_NB_RATION_CROQUETTE), [](const char *data, uint16_t) { distributeurSetRation(*chainRouted->levels[0], atoi(data)); }},
+    {FEED_KEY(FEED_NB_RATION_POISSON_ROUGE), [](const char *data, uint16_t) { distributeurSetRation(*chainRouted->levels[1], atoi(data)); }},
+    {FEED_KEY(FEED_NB_RATION_ACHIGAN), [](const char *data, uint16_t) { distributeurSetRation(*chainRouted->levels[2], atoi(data)); }},
+    {FEED_KEY(FEED_NB_RATION_RESTO), [](const char *data, uint16_t) { distributeurSetRation(*chainRouted->levels[3], atoi(data)); }},
+    {FEED_KEY(FEED_COMMANDE), [](const char *data, uint16_t) {
+        MYDEBUG_PRINTLN("Commande reçue : " + String(data));
+        chainRouted->enqueueOrder(atoi(data));
+    }},
+    {FEED_KEY(FEED_READY), [](const char *data, uint16_t) {
+        *chainRouted->feeds.readyValue = atoi(data);
+        stateChanged();
+    }},
+    {FEED_KEY(FEED_REMOTE_EAT), [](const char *data, uint16_t len) { remoteHandleRequest(data, len, chainLevel); }},
+    {FEED_KEY(FEED_REMOTE_REPLY), remoteHandleReply},
+    {FEED_KEY(FEED_TXN), [](const char *data, uint16_t len) {
+        txnHandle(data, len, chainRouted->txnOrigin, [](const char *origin, const uint8_t level, const int32_t value,
+                                                        const uint32_t epoch, const uint32_t seq) {
+            if (level >= CHAIN_LEVELS || !chainRouted->txnCursors[level].accept(origin, epoch, seq)) return false;
+            distributeurSetRation(*chainRouted->levels[level], value);
+            return true;
+        });
+    }},
+};
+
+inline constexpr FeedDispatchTable feedTable(feedRoutes);
+static_assert(feedTable.valid(), "Aucune graine sans collision pour la table des feeds");
+static_assert(feedTable.size() <= CHAIN_ROUTE_STRIDE, "Trop de feeds par chaîne pour l'index des routes");
+
+/**
+ * Clé de feed → route : chaîne * CHAIN_ROUTE_STRIDE + route dans la table
+ */
+inline int chainLookup(const char *key, const size_t len) {
+    const int route = feedTable.lookup(key, len);
+    if (route >= 0) return route;
+    for (uint8_t c = 1; c < chainCount; c++) {
+        const String &ns = chains[c]->ns;
+        const size_t nsLen = ns.length();
+        if (len > nsLen + 1 && key[nsLen] == CHAIN_NS_SEPARATOR && strncasecmp(key, ns.c_str(), nsLen) == 0) {
+            const int r = feedTable.lookup(key + nsLen + 1, len - nsLen - 1);
+            if (r >= 0) return c * CHAIN_ROUTE_STRIDE + r;
+        }
+    }
+    return -1;
+}
+
+inline void chainDispatch(const int route, const char *payload, const uint16_t len) {
+    const uint8_t c = route / CHAIN_ROUTE_STRIDE;
+    if (c >= chainCount) return;
+    chainRouted = chains[c];
+    feedTable.dispatch(route % CHAIN_ROUTE_STRIDE, payload, len);
+    chainRouted = &defaultChain;
+}
+
+/**
+ * Création d'une chaîne supplémentaire ; les objets sont alloués une fois au démarrage, jamais libérés
+ */
+inline MyChain *chainCreate(const String &ns, JsonObject cfgDistributeurs) {
+    const String base = String(IO_USERNAME FEED_PREFIX) + ns + CHAIN_NS_SEPARATOR;
+    auto *topics = new String[CHAIN_LEVELS + 3];
+    for (uint8_t i = 0; i < CHAIN_LEVELS; i++) topics[i] = base + chainLevelFeeds[i];
+    topics[CHAIN_LEVELS] = base + FEED_KEY(FEED_COMMANDE);
+    topics[CHAIN_LEVELS + 1] = base + FEED_KEY(FEED_READY);
+    topics[CHAIN_LEVELS + 2] = base + FEED_KEY(FEED_TXN);
+
+    MyDistributeur *levels[CHAIN_LEVELS];
+    MyDistributeur *precedent = nullptr;
+    for (uint8_t i = 0; i < CHAIN_LEVELS; i++) {
+        // Valeurs de départ de la chaîne par défaut, remplacées par la configuration de la chaîne
+        levels[i] = new MyDistributeur(distributeurs[i]->getName(), distributeurs[i]->getRation(),
+                                       Adafruit_MQTT_Publish(&MyAdafruitMqtt, topics[i].c_str()), precedent);
+        if (JsonObject cfg = cfgDistributeurs[distributeurKeys[i]]) applyDistributeurConfig(*levels[i], cfg);
+        precedent = levels[i];
+    }
+
+    auto *chain = new MyChain(ns, levels, ChainFeeds{
+                                  new Adafruit_MQTT_Publish(&MyAdafruitMqtt, topics[CHAIN_LEVELS].c_str()),
+                                  new Adafruit_MQTT_Publish(&MyAdafruitMqtt, topics[CHAIN_LEVELS + 1].c_str()),
+                                  nullptr,
+                                  new Adafruit_MQTT_Publish(&MyAdafruitMqtt, topics[CHAIN_LEVELS + 2].c_str())
+                              });
+    chain->feeds.readyValue = &chain->readyValue;
+    return chain;
+}
+
+/**
+ * Précédent distant d'une chaîne : {"noeud": "a1b2c3", "ns": "bac1", "niveau": 1, "depuis": 2}
+ */
+inline void chainLinkRemote(MyChain &chain, JsonObject cfg) {
+    if (!cfg) return;
+    const uint8_t depuis = cfg["depuis"] | 0;
+    const char *node = cfg["noeud"] | "";
+    if (depuis >= CHAIN_LEVELS) return;
+    if (!node[0]) {
+        MYDEBUG_WARNLN("-CHAIN : Précédent distant ignoré, carte productrice (noeud) manquante");
+        return;
+    }
+    MyDistributeur *consumer = chain.levels[depuis];
+    consumer->setPrecedent(nullptr);
+    consumer->setRemote(new MyRemoteLink(node, cfg["ns"] | "", cfg["niveau"] | 0));
+    MYDEBUG_PRINTLN("-CHAIN : " + consumer->getName() + " mange dans " + node + "/" + (cfg["ns"] | "-") + "/" +
+        String(cfg["niveau"] | 0));
+}
+
+/**
+ * Carte autorisée à modifier la chaîne par ses transactions
+ */
+inline void chainTxnOrigin(MyChain &chain, const char *node) {
+    strlcpy(chain.txnOrigin, node ? node : "", sizeof(chain.txnOrigin));
+    if (chain.txnOrigin[0]) {
+        MYDEBUG_PRINTLN("-CHAIN : Transactions de " + String(chain.txnOrigin) + " acceptées");
+    }
+}
+
+/**
+ * Chaînes supplémentaires et budgets lus dans /config.json
+ */
+inline void chainLoadConfig() {
+    File configFile = SPIFFS.open(strConfigFile, "r");
+    if (!configFile) return;
+    StaticJsonDocument<128> filter;
+    filter["chainBudgetUs"] = true;
+    filter["chainPublishPerSec"] = true;
+    filter["chaines"] = true;
+    filter["precedent"] = true;
+    filter["origineTransactions"] = true;
+    DynamicJsonDocument doc(3072);
+    const DeserializationError error = deserializeJson(doc, configFile, DeserializationOption::Filter(filter));
+    configFile.close();
+    if (error) return;
+
+    const uint32_t budgetUs = doc["chainBudgetUs"] | CHAIN_BUDGET_US;
+    const float publishPerSec = doc["chainPublishPerSec"] | CHAIN_PUBLISH_PER_SEC;
+    defaultChain.budgetUs = budgetUs;
+    defaultChain.publishPerSec = publishPerSec;
+    chainLinkRemote(defaultChain, doc["precedent"]);
+    chainTxnOrigin(defaultChain, doc["origineTransactions"]);
+
+    for (JsonObject cfg: doc["chaines"].as<JsonArray>()) {
+        const String ns = cfg["ns"] | "";
+        if (ns.length() == 0 || chainCount >= CHAIN_MAX) {
+            MYDEBUG_PRINTLN("-CHAIN : Chaîne ignorée (espace de noms vide ou trop de chaînes)");
+            continue;
+        }
+        MyChain *chain = chainCreate(ns, cfg["distributeurs"]);
+        chainLinkRemote(*chain, cfg["precedent"]);
+        chainTxnOrigin(*chain, cfg["origineTransactions"]);
+        chain->budgetUs = cfg["budgetUs"] | budgetUs;
+        chain->publishPerSec = cfg["publishPerSec"] | publishPerSec;
+        chains[chainCount++] = chain;
+    }
+}
+
+/**
+ * Tour de chaque chaîne, en commençant par une chaîne différente à chaque itération
+ */
+inline void loopChains() {
+    LoopScope scope(LOOP_CHAIN);
+    loopRemote();
+    loopTransactions();
+    for (uint8_t n = 0; n < chainCount; n++) {
+        chains[(chainNext + n) % chainCount]->turn();
+    }
+    chainNext = (chainNext + 1) % chainCount;
+}
+
+/**
+ * État des distributeurs de toutes les chaînes, indexé par identifiant de journal : une copie du bloc
+ * des stocks de la table d'état, les cases étant attribuées chaîne par chaîne
+ */
+inline uint8_t chainValues(int32_t *values) {
+    return distribStateStocks(values, chainCount * CHAIN_LEVELS);
+}
+
+/**
+ * État des distributeurs reconstruit à partir du journal, après la lecture de la configuration
+ */
+inline void restoreDistributeurs() {
+    int32_t values[JOURNAL_MAX_IDS];
+    const uint8_t count = chainValues(values);
+    if (!journalReplay(values, count)) return;
+    for (uint8_t c = 0; c < chainCount; c++) {
+        for (uint8_t i = 0; i < CHAIN_LEVELS; i++) {
+            MyDistributeur *level = chains[c]->levels[i];
+            level->setRation(values[c * CHAIN_LEVELS + i]);
+            MYDEBUG_PRINTLN("-JOURNAL : " + level->getName() + " : " + String(level->getRation()) + " rations");
+        }
+    }
+}
+
+/**
+ * Écriture des événements en attente, avec l'état courant pour l'instantané
+ */
+inline void flushDistributeurJournal() {
+    int32_t values[JOURNAL_MAX_IDS];
+    const uint8_t count = chainValues(values);
+    journalFlush(values, count);
+}
+
+/**
+ * Fonction de gestion de la route /debug/chains
+ */
+inline void handleDebugChains(WebRequest &request) {
+    String out;
+    out.reserve(256 * chainCount);
+    char line[CHAIN_REPORT_LINE];
+    for (uint8_t c = 0; c < chainCount; c++) {
+        const MyChain &chain = *chains[c];
+        const ChainStats &s = chain.stats;
+        snprintf(line, sizeof(line),
+                 "[%s] budget=%u us publications=%.1f/s jetons=%.1f commandes=%u tours=%u travaux=%u publiees=%u\n",
+                 chain.ns.length() ? chain.ns.c_str() : "defaut", chain.budgetUs, chain.publishPerSec,
+                 chain.publishTokens(), chain.ordersQueued(), s.turns, s.jobs, s.published);
+        out += line;
+        snprintf(line, sizeof(line), "  differes_cpu=%u differes_pub=%u refusees=%u cpu=%u ms tour_max=%u us\n",
+                 s.cpuDeferred, s.publishDeferred, s.ordersDropped, static_cast<uint32_t>(s.cpuUs / 1000),
+                 s.maxTurnUs);
+        out += line;
+        for (const MyDistributeur *level: chain.levels) {
+            out += "  " + level->getName() + " : " + String(level->getRation()) +
+                   (level->envoiEnCours() ? " (envoi)" : "") + "\n";
+        }
+    }
+    remoteReport(line, sizeof(line));
+    out += line;
+    txnReport(line, sizeof(line));
+    out += line;
+    distribStateReport(line, sizeof(line));
+    out += line;
+    request.send(200, "text/plain", out);
+}
+
+/**
+ * Transaction abandonnée sans écho : l'état complet de sa chaîne est republié en un instantané
+ */
+inline void chainResync(Adafruit_MQTT_Publish *txnFeed) {
+    for (uint8_t c = 0; c < chainCount; c++) {
+        MyChain &chain = *chains[c];
+        if (chain.feeds.transaction != txnFeed) continue;
+        TxnPart parts[CHAIN_LEVELS];
+        for (uint8_t i = 0; i < CHAIN_LEVELS; i++) {
+            parts[i] = {&chain.levels[i]->feed(), i, chain.levels[i]->getRation()};
+        }
+        MYDEBUG_WARNLN("-TXN : Transaction abandonnée, instantané de la chaîne " +
+                       (chain.ns.length() ? chain.ns : String("defaut")));
+        txnCommit(txnFeed, parts, CHAIN_LEVELS, true);
+        return;
+    }
+}
+
+/**
+ * Chaînes et aiguillage des feeds : après la lecture de la configuration, avant le rejeu du journal et
+ * toute connexion MQTT. La case de chaque distributeur dans la table d'état est son identifiant de journal.
+ */
+inline void setupChains() {
+    setupRemote();
+    setupTransactions();
+    txnResync = chainResync;
+    chainLoadConfig();
+    for (uint8_t c = 0; c < chainCount; c++) {
+        for (uint8_t i = 0; i < CHAIN_LEVELS; i++) {
+            chains[c]->levels[i]->setNiveau(i);
+            chains[c]->levels[i]->setFeeds(&chains[c]->feeds);
+        }
+    }
+    journalIdCount = chainCount * CHAIN_LEVELS; // Les cases allouées ensuite (benchmark) ne sont pas journalisées
+    mqttMux.setRouter(chainLookup, chainDispatch);
+    webOn("/debug/chains", HTTP_GET, handleDebugChains);
+    MYDEBUG_PRINTLN("-CHAIN : " + String(chainCount) + " chaîne(s)");
+}
+
+/**
+ * Démarrage des Tickers de copulation de chaque chaîne
+ */
+inline void startChains() {
+    for (uint8_t c = 0; c < chainCount; c++) chains[c]->start();
+}
@@ -0,0 +1,326 @@
+/**
+ * \file MyConfigApi.h
+ * \page configapi Configuration à chaud
+ * \brief POST /api/config : document partiel validé, seuls les champs modifiés sont appliqués
+ *
+ * Changer un paramètre de distributeur demandait de modifier /config.json puis de redémarrer (plus
+ * de 30 s d'interruption, commandes en cours perdues). La route POST /api/config reçoit un document
+ * partiel, de même forme que /config.json :
+ * \code
+ * {"distributeurs": {"achigan": {"nbMax": 25, "copulationSec": 20}},
+ *  "chaines": [{"ns": "bac2", "budgetUs": 10000, "distributeurs": {"croquette": {"nbMin": 500}}}],
+ *  "chainBudgetUs": 15000, "chainPublishPerSec": 3, "loopBudgetMs": 80}
+ * \endcode
+ *
+ * Traitement :
+ * 1. validation du document entier, contre l'état courant complété par les valeurs reçues
+ *    (nbMin <= nbRation, nbMin <= nbMax, périodes positives...). Au moindre problème, rien n'est
+ *    appliqué ni écrit dans /config.json (400) ;
+ * 2. application des seuls champs dont la valeur change. Un changement de copulationSec réarme le
+ *    Ticker de copulation du niveau, un changement de nbBySecSend celui de l'envoi en cours ;
+ *    nbRation est un nombre de rations imposé, journalisé ;
+ * 3. fusion dans /config.json, écrit dans un fichier temporaire puis renommé : le fichier reste
+ *    valide même si la carte s'arrête pendant l'écriture.
+ *
+ * Ce qui demande une reconstruction des chaînes (nouvelle chaîne, précédent distant, WiFi) n'est pas
+ * modifiable à chaud et est refusé. chainBudgetUs et chainPublishPerSec s'appliquent à la chaîne par
+ * défaut ; les chaînes supplémentaires ont leurs propres budgetUs et publishPerSec.
+ *
+ * Fichier \ref MyConfigApi.h
+ */
+#pragma once
+
+#include "MyChain.h"
+#include "MySPIFFS.h"
+#include "MyWatchdog.h"
+#include "MyWebServer.h"
+
+#define CONFIG_TMP_FILE     "/config.tmp"
+#define CONFIG_BODY_MAX     1024
+#define CONFIG_REQUEST_DOC  1536
+#define CONFIG_FILE_DOC     3072    // Comme chainLoadConfig()
+
+enum ConfigField : uint8_t {
+    CONFIG_NB_RATION,
+    CONFIG_NB_MIN,
+    CONFIG_NB_MAX,
+    CONFIG_NB_BY_SEC_SEND,
+    CONFIG_NB_SEND_RATION,
+    CONFIG_COPULATION,
+    CONFIG_COPULATION_SEC,
+    CONFIG_EAT,
+    CONFIG_FIELD_COUNT
+};
+
+inline const char *const configFieldKeys[CONFIG_FIELD_COUNT] = {
+    "nbRation", "nbMin", "nbMax", "nbBySecSend", "nbSendRation", "copulation", "copulationSec", "eat"
+};
+
+// Champs réels (périodes en secondes) ; les autres sont des entiers
+constexpr bool configFieldIsFloat(const uint8_t field) {
+    return field == CONFIG_NB_BY_SEC_SEND || field == CONFIG_COPULATION_SEC;
+}
+
+struct ConfigResult {
+    uint8_t changed = 0;      // Champs modifiés
+    uint8_t rearmed = 0;      // Tickers réarmés
+};
+
+inline double configGet(const MyDistributeur &distributeur, const uint8_t field) {
+    switch (field) {
+        case CONFIG_NB_RATION: return distributeur.getRation();
+        case CONFIG_NB_MIN: return distributeur.getNbMin();
+        case CONFIG_NB_MAX: return distributeur.getNbMax();
+        case CONFIG_NB_BY_SEC_SEND: return distributeur.getNbBySecSend();
+        case CONFIG_NB_SEND_RATION: return distributeur.getNbSendRation();
+        case CONFIG_COPULATION: return distributeur.getCopulation();
+        case CONFIG_COPULATION_SEC: return distributeur.getCopulationSec();
+        case CONFIG_EAT: return distributeur.getEat();
+        default: return 0;
+    }
+}
+
+inline void configSet(MyDistributeur &distributeur, const uint8_t field, const double value) {
+    switch (field) {
+        case CONFIG_NB_RATION: distributeurSetRation(distributeur, static_cast<int>(value)); break;
+        case CONFIG_NB_MIN: distributeur.setNbMin(static_cast<int>(value)); break;
+        case CONFIG_NB_MAX: distributeur.setNbMax(static_cast<int>(value)); break;
+        case CONFIG_NB_BY_SEC_SEND: distributeur.setNbBySecSend(static_cast<float>(value)); break;
+        case CONFIG_NB_SEND_RATION: distributeur.setNbSendRation(static_cast<int>(value)); break;
+        case CONFIG_COPULATION: distributeur.setCopulation(static_cast<int>(value)); break;
+        case CONFIG_COPULATION_SEC: distributeur.setCopulationSec(static_cast<float>(value)); break;
+        case CONFIG_EAT: distributeur.setEat(static_cast<int>(value)); break;
+        default: break;
+    }
+}
+
+/**
+ * Cohérence des paramètres d'un distributeur après fusion : invariants du constructeur de MyDistributeur
+ * (nbRation >= nbMin) et valeurs que la table d'état peut garder sans les tronquer
+ */
+inline const char *configCheck(const double (&v)[CONFIG_FIELD_COUNT]) {
+    if (v[CONFIG_NB_MIN] < 0 || v[CONFIG_NB_MAX] < v[CONFIG_NB_MIN]) return "nbMin doit être entre 0 et nbMax";
+    if (v[CONFIG_NB_RATION] < v[CONFIG_NB_MIN]) return "nbRation ne peut pas être inférieur à nbMin";
+    if (distribPeriodMs(static_cast<float>(v[CONFIG_NB_BY_SEC_SEND])) == 0) {
+        return "nbBySecSend doit être d'au moins 1 ms";
+    }
+    if (v[CONFIG_NB_SEND_RATION] < 1) return "nbSendRation doit être au moins 1";
+    if (v[CONFIG_COPULATION] < 0 || v[CONFIG_EAT] < 0) return "copulation et eat doivent être positifs";
+    if (v[CONFIG_COPULATION_SEC] < 0) return "copulationSec doit être positif";
+    if (v[CONFIG_NB_SEND_RATION] > UINT16_MAX || v[CONFIG_COPULATION] > UINT16_MAX || v[CONFIG_EAT] > UINT16_MAX) {
+        return "nbSendRation, copulation et eat doivent être au plus 65535";
+    }
+    return nullptr;
+}
+
+/**
+ * Distributeurs d'une chaîne : validation (apply à false) ou application des champs modifiés
+ */
+inline bool configDistributeurs(MyChain &chain, JsonObjectConst cfg, const bool apply, ConfigResult &result,
+                                String &error) {
+    for (JsonPairConst entry: cfg) {
+        uint8_t level = 0;
+        while (level < CHAIN_LEVELS && strcmp(entry.key().c_str(), distributeurKeys[level]) != 0) level++;
+        JsonObjectConst fields = entry.value().as<JsonObjectConst>();
+        if (level == CHAIN_LEVELS || fields.isNull()) {
+            error = String("Distributeur inconnu : ") + entry.key().c_str();
+            return false;
+        }
+        MyDistributeur &distributeur = *chain.levels[level];
+
+        double values[CONFIG_FIELD_COUNT];
+        for (uint8_t f = 0; f < CONFIG_FIELD_COUNT; f++) values[f] = configGet(distributeur, f);
+        const char *nom = nullptr;
+        for (JsonPairConst field: fields) {
+            const char *key = field.key().c_str();
+            if (strcmp(key, "nom") == 0 && field.value().is<const char *>()) {
+                nom = field.value().as<const char *>();
+                continue;
+            }
+            uint8_t f = 0;
+            while (f < CONFIG_FIELD_COUNT && strcmp(key, configFieldKeys[f]) != 0) f++;
+            if (f == CONFIG_FIELD_COUNT || !(configFieldIsFloat(f) ? field.value().is<float>()
+                                                                     : field.value().is<int>())) {
+                error = String("Champ invalide : ") + entry.key().c_str() + "." + key;
+                return false;
+            }
+            values[f] = field.value().as<double>();
+        }
+        if (const char *problem = configCheck(values)) {
+            error = String(entry.key().c_str()) + " : " + problem;
+            return false;
+        }
+        if (!apply) continue;
+
+        if (nom && distributeur.getName() != nom) {
+            distributeur.setName(nom);
+            result.changed++;
+        }
+        for (uint8_t f = 0; f < CONFIG_FIELD_COUNT; f++) {
+            if (values[f] == configGet(distributeur, f)) continue;
+            configSet(distributeur, f, values[f]);
+            result.changed++;
+            if (f == CONFIG_COPULATION_SEC && chain.rearmCopulation(level)) result.rearmed++;
+            if (f == CONFIG_NB_BY_SEC_SEND && distributeur.rearmEnvoi()) result.rearmed++;
+        }
+    }
+    return true;
+}
+
+/**
+ * Budgets d'une chaîne
+ */
+inline bool configBudgets(MyChain &chain, JsonVariantConst budgetUs, JsonVariantConst publishPerSec,
+                          const bool apply, ConfigResult &result, String &error) {
+    if ((!budgetUs.isNull() && (!budgetUs.is<uint32_t>() || budgetUs.as<uint32_t>() == 0)) ||
+        (!publishPerSec.isNull() && (!publishPerSec.is<float>() || publishPerSec.as<float>() <= 0))) {
+        error = "Budget de chaîne invalide";
+        return false;
+    }
+    if (!apply) return true;
+    if (!budgetUs.isNull() && budgetUs.as<uint32_t>() != chain.budgetUs) {
+        chain.budgetUs = budgetUs.as<uint32_t>();
+        result.changed++;
+    }
+    if (!publishPerSec.isNull() && publishPerSec.as<float>() != chain.publishPerSec) {
+        chain.publishPerSec = publishPerSec.as<float>();
+        result.changed++;
+    }
+    return true;
+}
+
+inline MyChain *configFindChain(const char *ns) {
+    for (uint8_t c = 1; c < chainCount; c++) {
+        if (ns && chains[c]->ns.equalsIgnoreCase(ns)) return chains[c];
+    }
+    return nullptr;
+}
+
+/**
+ * Parcours du document : validation complète, puis application si apply
+ */
+inline bool configWalk(JsonObjectConst request, const bool apply, ConfigResult &result, String &error) {
+    for (JsonPairConst entry: request) {
+        const char *key = entry.key().c_str();
+        if (strcmp(key, "distributeurs") == 0) {
+            if (!configDistributeurs(defaultChain, entry.value(), apply, result, error)) return false;
+        } else if (strcmp(key, "chainBudgetUs") == 0) {
+            if (!configBudgets(defaultChain, entry.value(), JsonVariantConst(), apply, result, error)) return false;
+        } else if (strcmp(key, "chainPublishPerSec") == 0) {
+            if (!configBudgets(defaultChain, JsonVariantConst(), entry.value(), apply, result, error)) return false;
+        } else if (strcmp(key, "loopBudgetMs") == 0) {
+            if (!entry.value().is<uint32_t>() || entry.value().as<uint32_t>() == 0) {
+                error = "loopBudgetMs invalide";
+                return false;
+            }
+            if (apply && loopBudgetMs != entry.value().as<uint32_t>()) {
+                loopBudgetMs = entry.value().as<uint32_t>();
+                result.changed++;
+            }
+        } else if (strcmp(key, "chaines") == 0) {
+            for (JsonObjectConst cfg: entry.value().as<JsonArrayConst>()) {
+                MyChain *chain = configFindChain(cfg["ns"]);
+                if (!chain) {
+                    error = String("Chaîne inconnue (une nouvelle chaîne demande un redémarrage) : ") +
+                            (cfg["ns"] | "");
+                    return false;
+                }
+                if (cfg.containsKey("precedent") || cfg.containsKey("origineTransactions")) {
+                    error = "Le précédent distant et l'origine des transactions ne sont pas modifiables à chaud";
+                    return false;
+                }
+                if (!configDistributeurs(*chain, cfg["distributeurs"], apply, result, error) ||
+                    !configBudgets(*chain, cfg["budgetUs"], cfg["publishPerSec"], apply, result, error)) {
+                    return false;
+                }
+            }
+        } else {
+            error = String("Clé non modifiable à chaud : ") + key;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Fusion d'un objet partiel ; les chaînes sont associées par leur espace de noms
+ */
+inline void configMerge(JsonObject target, JsonObjectConst patch) {
+    for (JsonPairConst entry: patch) {
+        if (strcmp(entry.key().c_str(), "chaines") == 0) {
+            for (JsonObjectConst cfg: entry.value().as<JsonArrayConst>()) {
+                for (JsonObject existing: target["chaines"].as<JsonArray>()) {
+                    if (strcasecmp(existing["ns"] | "", cfg["ns"] | "") == 0) configMerge(existing, cfg);
+                }
+            }
+        } else if (entry.value().is<JsonObjectConst>()) {
+            JsonObject child = target[entry.key().c_str()];
+            if (child.isNull()) child = target.createNestedObject(entry.key().c_str());
+            configMerge(child, entry.value());
+        } else {
+            target[entry.key().c_str()] = entry.value();
+        }
+    }
+}
+
+/**
+ * /config.json mis à jour par fichier temporaire et renommage
+ */
+inline bool configPersist(JsonObjectConst patch) {
+    HeapScope scope(HEAP_SPIFFS);
+    DynamicJsonDocument doc(CONFIG_FILE_DOC);
+    if (File file = SPIFFS.open(strConfigFile, "r")) {
+        const DeserializationError error = deserializeJson(doc, file);
+        file.close();
+        if (error) return false; // Fichier illisible : on ne l'écrase pas avec un document partiel
+    } else {
+        doc.to<JsonObject>();
+    }
+    configMerge(doc.as<JsonObject>(), patch);
+    if (doc.overflowed()) return false;
+
+    File file = SPIFFS.open(CONFIG_TMP_FILE, "w");
+    if (!file) return false;
+    const bool ok = serializeJson(doc, file) > 0;
+    file.close();
+    return ok && SPIFFS.rename(CONFIG_TMP_FILE, strConfigFile);
+}
+
+/**
+ * Fonction de gestion de la route POST /api/config
+ */
+inline void handleApiConfig(WebRequest &request) {
+    const unsigned long start = micros();
+    const String body = request.body();
+    if (body.length() == 0 || body.length() > CONFIG_BODY_MAX) {
+        request.send(413, "text/plain", "Document absent ou trop grand\n");
+        return;
+    }
+
+    DynamicJsonDocument document(CONFIG_REQUEST_DOC);
+    if (deserializeJson(document, body) || !document.is<JsonObject>()) {
+        request.send(400, "text/plain", "JSON invalide\n");
+        return;
+    }
+
+    ConfigResult result;
+    String error;
+    if (!configWalk(document.as<JsonObjectConst>(), false, result, error)) {
+        request.send(400, "text/plain", error + "\n");
+        return;
+    }
+    configWalk(document.as<JsonObjectConst>(), true, result, error);
+    const unsigned long appliedUs = micros() - start;
+    const bool persisted = result.changed == 0 || configPersist(document.as<JsonObjectConst>());
+    MYDEBUG_PRINTLN("-CONFIG : " + String(result.changed) + " champ(s) modifié(s), " + String(result.rearmed) +
+        " Ticker(s) réarmé(s) en " + String(appliedUs) + " us" + (persisted ? "" : ", NON ENREGISTRÉ"));
+
+    char out[112];
+    snprintf(out, sizeof(out), "{\"modifies\":%u,\"tickers\":%u,\"applique_us\":%lu,\"enregistre\":%s}",
+             result.changed, result.rearmed, appliedUs, persisted ? "true" : "false");
+    request.send(persisted ? 200 : 500, "application/json", out);
+}
+
+inline void setupConfigApi() {
+    webOn("/api/config", HTTP_POST, handleApiConfig);
+}
@@ -2,23 +2,95 @@
 #define MYDEBUG_H
 
 #include <Arduino.h>
+#include "MyHeap.h"
 
-// Buffer circulaire pour les logs
+// Niveau d'un enregistrement, filtre de /api/logs (MyLogApi.h)
+enum LogLevel : uint8_t {
+    LOG_INFO,
+    LOG_WARN,
+    LOG_ERROR,
+    LOG_LEVEL_COUNT
+};
+
+inline const char *const logLevelNames[LOG_LEVEL_COUNT] = {"info", "warn", "error"};
+
+// Buffer circulaire pour les logs : une ligne par enregistrement, numérotée
 constexpr int LOG_BUFFER_SIZE = 50; // Nombre de lignes à conserver
-inline String logBuffer[LOG_BUFFER_SIZE];
+constexpr int LOG_MODULE_SIZE = 12; // Module lu dans le préfixe « -MODULE : »
+
+struct LogRecord {
+    uint32_t seq = 0;               // 0 : case vide
+    uint32_t ms = 0;                // millis() à l'écriture
+    LogLevel level = LOG_INFO;
+    char module[LOG_MODULE_SIZE] = "";
+    String text;
+};
+
+inline LogRecord logBuffer[LOG_BUFFER_SIZE];
 inline int logIndex = 0;
+inline uint32_t logSeq = 0;         // Dernier numéro attribué, perdu ou non
+inline uint32_t logDropped = 0;     // Lignes non gardées (tas sous pression)
+inline String logLine;              // Ligne en cours (MYDEBUG_PRINT sans fin de ligne)
+inline LogLevel logLineLevel = LOG_INFO;
+inline uint8_t logMuted = 0;        // Portées LogMute ouvertes : les lignes ne vont plus que sur le port série
+
+// Lignes gardées hors du tampon le temps de la portée (mesures de /bench)
+struct LogMute {
+    LogMute() { logMuted++; }
+    ~LogMute() { logMuted--; }
+    LogMute(const LogMute &) = delete;
+    LogMute &operator=(const LogMute &) = delete;
+};
+
+/**
+ * Module d'un message « -MODULE : texte », vide sans préfixe
+ */
+inline void logParseModule(const String &message, char *module) {
+    module[0] = 0;
+    if (!message.startsWith("-")) return;
+    const int end = message.indexOf(" :");
+    if (end <= 1 || end > LOG_MODULE_SIZE) return;
+    memcpy(module, message.c_str() + 1, end - 1);
+    module[end - 1] = 0;
+}
 
 // Fonction pour ajouter un log au buffer
-inline void addToLogBuffer(const String &message) {
-    logBuffer[logIndex] = message;
+inline void addToLogBuffer(const String &message, const LogLevel level = LOG_INFO) {
+    if (message.length() == 0) return;
+    const uint32_t seq = ++logSeq;
+    // Tas sous pression : les logs ne partent plus que sur le port série, le numéro reste consommé
+    if (heapShedLogs()) {
+        logDropped++;
+        return;
+    }
+
+    HeapScope scope(HEAP_DEBUG);
+    LogRecord &record = logBuffer[logIndex];
+    record.seq = seq;
+    record.ms = millis();
+    record.level = level;
+    logParseModule(message, record.module);
+    record.text = message;
     logIndex = (logIndex + 1) % LOG_BUFFER_SIZE;
 }
 
+// Fragments accumulés jusqu'à la fin de ligne : un enregistrement par ligne
+inline void logAppend(const String &fragment) {
+    if (logMuted) return;
+    logLine += fragment;
+}
+
+inline void logCommit() {
+    if (!logMuted) addToLogBuffer(logLine, logLineLevel);
+    logLine = String();
+    logLineLevel = LOG_INFO;
+}
+
 #ifdef MYDEBUG
 // Fonction spéciale pour une nouvelle ligne sans argument
 inline void debugPrintln() {
     Serial.println();
-    addToLogBuffer("");
+    logCommit();
 }
 
 // Surcharge pour IPAddress
@@ -26,44 +98,58 @@ inline void debugPrint(const IPAddress &ip) {
     String ipStr = String(ip[0]) + "." + String(ip[1]) + "." +
                    String(ip[2]) + "." + String(ip[3]);
     Serial.print(ipStr);
-    addToLogBuffer(ipStr);
+    logAppend(ipStr);
 }
 
 inline void debugPrintln(const IPAddress &ip) {
     String ipStr = String(ip[0]) + "." + String(ip[1]) + "." +
                    String(ip[2]) + "." + String(ip[3]);
     Serial.println(ipStr);
-    addToLogBuffer(ipStr);
+    logAppend(ipStr);
+    logCommit();
 }
 
 // Surcharge pour les autres types
 template<typename T>
 void debugPrint(const T &x) {
     Serial.print(x);
-    addToLogBuffer(String(x));
+    logAppend(String(x));
 }
 
 template<typename T>
 void debugPrintln(const T &x) {
     Serial.println(x);
-    addToLogBuffer(String(x));
+    logAppend(String(x));
+    logCommit();
+}
+
+// Ligne d'un niveau donné : avertissement ou erreur
+template<typename T>
+void debugPrintln(const LogLevel level, const T &x) {
+    logLineLevel = level;
+    debugPrintln(x);
 }
 
 #define MYDEBUG_PRINT(x)     debugPrint(x)
-#define MYDEBUG_PRINTDEC(x)  { Serial.print(x, DEC); addToLogBuffer(String(x)); }
-#define MYDEBUG_PRINTHEX(x)  { Serial.print(x, HEX); addToLogBuffer(String(x, HEX)); }
+#define MYDEBUG_PRINTDEC(x)  { Serial.print(x, DEC); logAppend(String(x)); }
+#define MYDEBUG_PRINTHEX(x)  { Serial.print(x, HEX); logAppend(String(x, HEX)); }
 #define MYDEBUG_PRINTLN(...)   debugPrintln(__VA_ARGS__)
+#define MYDEBUG_WARNLN(x)    debugPrintln(LOG_WARN, x)
+#define MYDEBUG_ERRORLN(x)   debugPrintln(LOG_ERROR, x)
 #define MYDEBUG_PRINTF(a,b,c,d,e) { \
     Serial.printf(a,b,c,d,e); \
     char buffer[256]; \
     snprintf(buffer, sizeof(buffer), a,b,c,d,e); \
-    addToLogBuffer(String(buffer)); \
+    logAppend(String(buffer)); \
+    if (logLine.endsWith("\n")) { logLine.trim(); logCommit(); } \
     }
 #else
 #define MYDEBUG_PRINT(x)
 #define MYDEBUG_PRINTDEC(x)
 #define MYDEBUG_PRINTHEX(x)
 #define MYDEBUG_PRINTLN(...)
+#define MYDEBUG_WARNLN(x)
+#define MYDEBUG_ERRORLN(x)
 #define MYDEBUG_PRINTF(x)
 #endif
 
@@ -9,7 +9,53 @@
 #include "MyDebug.h"
 #include "Adafruit_MQTT_Client.h"
 #include "MyMQTT.h"
+#include "MyForecast.h"
+#include "MyJournal.h"
+#include "MyStateTable.h"
+#include "MyTransaction.h"
+#include "MyWatchdog.h"
+
+#ifndef DISTRIB_FORECAST_GATING
+#define DISTRIB_FORECAST_GATING 1 // 0 : copulation à chaque période, comme avant la prévision
+#endif
+
+/**
+ * Feeds communs aux distributeurs d'une chaîne : commande restante, poissons prêts et transactions
+ */
+struct ChainFeeds {
+    Adafruit_MQTT_Publish *commande;
+    Adafruit_MQTT_Publish *ready;
+    volatile int *readyValue;   // Dernière valeur reçue sur le feed ready
+    Adafruit_MQTT_Publish *transaction;
+};
+
+inline ChainFeeds defaultChainFeeds = {&pubCommande, &pubReady, &lastReadyValue, &pubTransaction};
+
+/**
+ * Temps avant le prochain déclenchement d'un Ticker périodique armé à armedAt (planification du sommeil)
+ */
+inline uint32_t tickerNextInMs(const unsigned long armedAt, const uint32_t period, const unsigned long now) {
+    if (period == 0) return 0;
+    return period - (now - armedAt) % period;
+}
 
+class MyDistributeur;
+
+/**
+ * Distributeur précédent situé sur une autre carte (voir MyRemote.h) : la copulation devient
+ * une demande asynchrone, le gain est appliqué par remoteGranted() à la réponse
+ */
+class RemotePrecedent {
+public:
+    virtual ~RemotePrecedent() = default;
+
+    // Envoi d'une demande de eat rations, false si la fenêtre de demandes est pleine
+    virtual bool request(MyDistributeur &consumer, int eat) = 0;
+    // Demandes envoyées sans réponse
+    [[nodiscard]] virtual uint8_t inflight(const MyDistributeur &consumer) const = 0;
+    // Refus ou délai dépassé depuis le dernier appel
+    virtual bool takeFailure(const MyDistributeur &consumer) = 0;
+};
 
 /**
  * Class Distributeur représente un distributeur de rations dans une suite N.
@@ -32,88 +78,95 @@
  * @param Distributeur* | nullptr precedent, le distributeur N - 1 (private)
  */
 class MyDistributeur {
-    int _nbMin = 2;
-    int _nbMax = 20;
-    int _copulation = 2;
-    float _copulationSec = 10;
-    float _nbBySecSend = 10;
-    int _nbSendRation = 1;
-    int _eat = 2;
-    int nombreRestant = 0;
+    const uint8_t _slot;              // Case dans la table d'état (MyStateTable.h), aussi identifiant du journal
+    volatile bool _envoiDu = false;   // Levé par le Ticker d'envoi, traité par l'ordonnanceur des chaînes
+    uint8_t _niveau = 0;              // Niveau dans la chaîne, désigne le distributeur dans les transactions
+    unsigned long _envoiArmedAt = 0;  // Armement du Ticker d'envoi, pour prévoir son échéance
+    ChainFeeds *_feeds = &defaultChainFeeds;
     Ticker envoyerRationTicker;
     Adafruit_MQTT_Publish adafruit_;
     MyDistributeur *_precedent;
+    RemotePrecedent *_remote = nullptr;
+    ConsumptionForecast _forecast;
+
+    // Champs de la case du distributeur
+    [[nodiscard]] int32_t &stock() const { return distribHot.stock[_slot]; }
+    [[nodiscard]] int32_t &restant() const { return distribHot.remaining[_slot]; }
+    [[nodiscard]] int32_t nbMin() const { return distribHot.nbMin[_slot]; }
+    [[nodiscard]] int32_t nbMax() const { return distribHot.nbMax[_slot]; }
+    [[nodiscard]] int copulationCount() const { return distribCold.copulation[_slot]; }
+    [[nodiscard]] int eatCount() const { return distribCold.eat[_slot]; }
+    [[nodiscard]] int sendRation() const { return distribCold.sendRation[_slot]; }
+
+    // Copulation avec un précédent distant : demande envoyée, résultat dans remoteGranted()
+    bool copulationDistante() {
+        if (_remote->takeFailure(*this)) {
+            MYDEBUG_PRINTLN("Échec de la copulation distante " + getName());
+            return false;
+        }
+        const uint8_t inflight = _remote->inflight(*this);
+        if (stock() >= 0 && stock() + (inflight + 1) * copulationCount() <= nbMax() &&
+            _remote->request(*this, eatCount())) {
+            MYDEBUG_PRINTLN("=== Copulation distante demandée " + getName() + " ===");
+        }
+        return false;
+    }
 
 public:
-    String name;
-    int nbRation;
-
-    explicit MyDistributeur(String name,
+    explicit MyDistributeur(const String &name,
                             const int nbRation, const Adafruit_MQTT_Publish &adafruit,
-                            MyDistributeur *precedent = nullptr) : adafruit_(adafruit), _precedent(precedent),
-                                                                   name(std::move(name)),
-                                                                   nbRation(nbRation) {
+                            MyDistributeur *precedent = nullptr) : _slot(distribStateAlloc()), adafruit_(adafruit),
+                                                                   _precedent(precedent) {
+        setName(name);
+        stock() = nbRation;
     }
 
-    MyDistributeur(String name, const int nbRation, const int nbMin, const int nbMax, const float nbBySecSend,
+    MyDistributeur(const String &name, const int nbRation, const int nbMin, const int nbMax, const float nbBySecSend,
                    const int nbSendRation,
                    const int copulation,
                    const float copulationSec, const int eat, const Adafruit_MQTT_Publish &adafruit,
                    MyDistributeur *precedent = nullptr)
-        : _nbMin(nbMin),
-          _nbMax(nbMax),
-          _copulation(copulation),
-          _copulationSec(copulationSec),
-          _nbBySecSend(nbBySecSend),
-          _nbSendRation(nbSendRation),
-          _eat(eat),
+        : _slot(distribStateAlloc()),
           adafruit_(adafruit),
-          _precedent(precedent),
-          name(std::move(name)) {
-        if (nbRation < _nbMin) {
+          _precedent(precedent) {
+        setName(name);
+        setNbMin(nbMin);
+        setNbMax(nbMax);
+        setNbBySecSend(nbBySecSend);
+        setNbSendRation(nbSendRation);
+        setCopulation(copulation);
+        setCopulationSec(copulationSec);
+        setEat(eat);
+        if (nbRation < nbMin) {
             throw std::invalid_argument("Le nombre de rations ne peut pas être inférieur au minimum requis");
         }
-        this->nbRation = nbRation;
+        stock() = nbRation;
     }
 
-    void commande(const int nombre) {
-        MYDEBUG_PRINTLN("========== Commande " + name + " ==============");
+    // Une case par objet : pas de copie
+    MyDistributeur(const MyDistributeur &) = delete;
+    MyDistributeur &operator=(const MyDistributeur &) = delete;
+
+    /**
+     * @return true si l'envoi progressif a démarré
+     */
+    bool commande(const int nombre) {
+        HeapScope scope(HEAP_DISTRIBUTEUR);
+        MYDEBUG_PRINTLN("========== Commande " + getName() + " ==============");
         MYDEBUG_PRINTLN("Demande de " + String(nombre) + " rations");
-        MYDEBUG_PRINTLN("État actuel : " + String(nbRation) + " rations disponibles");
+        MYDEBUG_PRINTLN("État actuel : " + String(stock()) + " rations disponibles");
 
 
         if (nombre < 0) {
             throw std::invalid_argument("La commande ne peut pas être de " + std::to_string(nombre));
         }
-        if (nbRation - nombre >= _nbMin) {
+        if (stock() - nombre >= nbMin()) {
             MYDEBUG_PRINTLN("Commande acceptée - Envoi progressif démarré");
-            nombreRestant = nombre;
-            auto pNombreRestant = &nombreRestant;
-
-            envoyerRationTicker.attach(_nbBySecSend, [this, pNombreRestant]() {
-                if (*pNombreRestant > 0) {
-                    const int envoi = std::min(this->_nbSendRation, *pNombreRestant);
-                    this->nbRation -= envoi;
-                    *pNombreRestant -= envoi;
-                    MYDEBUG_PRINTLN("=== Progression de l'envoi ===");
-                    MYDEBUG_PRINTLN("Rations envoyées : " + String(envoi));
-                    MYDEBUG_PRINTLN("Restant à envoyer : " + String(*pNombreRestant));
-                    MYDEBUG_PRINTLN("Rations restantes dans " + name + " : " + String(nbRation));
-
-                    const int ready = getReadyCount();
-                    // Publier le nombre de poissons prêts
-                    pubReady.publish(ready + envoi);
-                    // Mettre à jour le nombre de rations restantes
-                    this->adafruit_.publish(this->nbRation);
-                    pubCommande.publish(std::max(*pNombreRestant, 0));
-
-                    if (*pNombreRestant <= 0) {
-                        MYDEBUG_PRINTLN("=== Envoi terminé ===");
-
-                        this->envoyerRationTicker.detach();
-                    }
-                }
-            });
+            restant() = nombre;
+            // Le Ticker ne fait que signaler l'échéance : l'envoi est fait dans la loop (envoiStep())
+            envoyerRationTicker.attach_ms(distribCold.sendMs[_slot], [this]() { _envoiDu = true; });
+            _envoiArmedAt = millis();
+            return true;
         } else if (_precedent != nullptr) {
             // Tenter la copulation en cascade jusqu'à avoir assez de rations
             MyDistributeur *distributeurCourant = _precedent;
@@ -128,16 +181,77 @@ public:
 
             if (isCopul) {
                 // Réessayer la commande si une copulation a réussi
-                commande(nombre);
+                return commande(nombre);
             } else {
                 MYDEBUG_PRINT("Aucun distributeur n'a pu effectuer la copulation !");
             }
         } else {
-            MYDEBUG_PRINT("Le distributeur " + name + " n'a plus assez de rations !\nVeuillez le remplir !");
+            MYDEBUG_PRINT("Le distributeur " + getName() + " n'a plus assez de rations !\nVeuillez le remplir !");
         }
+        return false;
+    }
+
+    /**
+     * Une étape de l'envoi progressif, si le Ticker l'a demandée
+     * @return true si des rations ont été envoyées
+     */
+    bool envoiStep() {
+        if (!_envoiDu) return false;
+        _envoiDu = false;
+        if (restant() <= 0) {
+            envoyerRationTicker.detach();
+            return false;
+        }
+
+        const int32_t envoi = std::min<int32_t>(sendRation(), restant());
+        stock() -= envoi;
+        journalRecord(JOURNAL_DISPATCH, _slot, -envoi, stock());
+        restant() -= envoi;
+        _forecast.record(envoi, millis());
+        MYDEBUG_PRINTLN("=== Progression de l'envoi ===");
+        MYDEBUG_PRINTLN("Rations envoyées : " + String(envoi));
+        MYDEBUG_PRINTLN("Restant à envoyer : " + String(restant()));
+        MYDEBUG_PRINTLN("Rations restantes dans " + getName() + " : " + String(stock()));
+
+        const int ready = ensureConnected() ? *_feeds->readyValue : 0;
+        // Publier le nombre de poissons prêts
+        _feeds->ready->publish(ready + envoi);
+        // Mettre à jour le nombre de rations restantes
+        adafruit_.publish(stock());
+        _feeds->commande->publish(std::max<int32_t>(restant(), 0));
+
+        if (restant() <= 0) {
+            MYDEBUG_PRINTLN("=== Envoi terminé ===");
+
+            envoyerRationTicker.detach();
+        }
+        return true;
+    }
+
+    /**
+     * Nouvelle période d'envoi appliquée à l'envoi en cours (configuration à chaud)
+     * @return true si un envoi était en cours
+     */
+    bool rearmEnvoi() {
+        if (restant() <= 0) return false;
+        envoyerRationTicker.attach_ms(distribCold.sendMs[_slot], [this]() { _envoiDu = true; });
+        _envoiArmedAt = millis();
+        return true;
+    }
+
+    /**
+     * Abandon de l'envoi progressif en cours (banc de mesure)
+     */
+    void annulerEnvoi() {
+        restant() = 0;
+        _envoiDu = false;
+        envoyerRationTicker.detach();
     }
 
     bool copulation() {
+        if (_remote) {
+            return copulationDistante();
+        }
         if (!ensureConnected()) {
             return false;
         }
@@ -145,39 +259,34 @@ public:
         bool success = false;
 
         // Vérifications de base
-        if (nbRation < _nbMax && nbRation >= 0 && _precedent) {
+        if (stock() < nbMax() && stock() >= 0 && _precedent) {
             // Protection contre les débordements
-            if (_precedent->nbRation >= _eat + _precedent->_nbMin &&
-                nbRation + _copulation <= _nbMax) {
-                MYDEBUG_PRINTLN("=== Tentative de copulation " + name + " ===");
-                MYDEBUG_PRINTLN(("État actuel : " + std::to_string(nbRation) + "/" + std::to_string(_nbMax)).data());
-
-                // Sauvegarde des valeurs
-                const int oldPrecedentRation = _precedent->nbRation;
-                const int oldRation = nbRation;
-
-                // Application des modifications
-                _precedent->nbRation -= _eat;
-                nbRation += _copulation;
-
-                // Publication des modifications
-                if (ensureConnected() &&
-                    _precedent->adafruit_.publish(_precedent->nbRation) &&
-                    ensureConnected() &&
-                    adafruit_.publish(nbRation)) {
-                    success = true;
-                } else {
-                    // Restauration en cas d'échec
-                    _precedent->nbRation = oldPrecedentRation;
-                    nbRation = oldRation;
-                }
+            if (_precedent->stock() >= eatCount() + _precedent->nbMin() &&
+                stock() + copulationCount() <= nbMax()) {
+                MYDEBUG_PRINTLN("=== Tentative de copulation " + getName() + " ===");
+                MYDEBUG_PRINTLN(("État actuel : " + std::to_string(stock()) + "/" + std::to_string(nbMax())).data());
+
+                // Application et journalisation : l'état local fait foi
+                _precedent->stock() -= eatCount();
+                stock() += copulationCount();
+                journalRecord(JOURNAL_COPULATION, _precedent->_slot, -eatCount(), _precedent->stock());
+                journalRecord(JOURNAL_COPULATION, _slot, copulationCount(), stock());
+                _precedent->_forecast.record(eatCount(), millis());
+
+                // Les deux feeds en une transaction, renvoyée jusqu'à son écho (voir MyTransaction.h)
+                const TxnPart parts[] = {
+                    {&_precedent->adafruit_, _precedent->_niveau, _precedent->stock()},
+                    {&adafruit_, _niveau, stock()}
+                };
+                txnCommit(_feeds->transaction, parts, 2);
+                success = true;
             } else {
-                MYDEBUG_PRINTLN("==========IL N'Y A PLUS ASSEZ DE " + _precedent->name + " =============");
+                MYDEBUG_PRINTLN("==========IL N'Y A PLUS ASSEZ DE " + _precedent->getName() + " =============");
             }
         }
         if (success) {
-            MYDEBUG_PRINT(("Copulation réussie : " + std::to_string(nbRation)).data());
-            MYDEBUG_PRINTLN(" " + name + " après opération");
+            MYDEBUG_PRINT(("Copulation réussie : " + std::to_string(stock())).data());
+            MYDEBUG_PRINTLN(" " + getName() + " après opération");
         } else {
             MYDEBUG_PRINTLN("Échec de la copulation - Conditions non remplies");
         }
@@ -185,19 +294,90 @@ public:
         return success;
     }
 
-    void setRation(const int ration) { this->nbRation = ration; }
+    /**
+     * Réponse favorable du précédent distant : le gain de la copulation
+     */
+    void remoteGranted() {
+        stock() += copulationCount();
+        journalRecord(JOURNAL_COPULATION, _slot, copulationCount(), stock());
+        publierTransaction();
+        MYDEBUG_PRINTLN("Copulation distante réussie : " + String(stock()) + " " + getName());
+    }
+
+    /**
+     * Rations mangées par un distributeur distant, dans la limite du minimum
+     * @return false si le stock ne le permet pas
+     */
+    bool ceder(const int eat) {
+        if (eat < 0 || stock() < eat + nbMin()) return false;
+        stock() -= eat;
+        journalRecord(JOURNAL_COPULATION, _slot, -eat, stock());
+        _forecast.record(eat, millis());
+        publierTransaction();
+        return true;
+    }
+
+    /**
+     * Nombre de rations publié seul, avec le renvoi et la séquence d'une transaction
+     */
+    void publierTransaction() {
+        const TxnPart part = {&adafruit_, _niveau, stock()};
+        txnCommit(_feeds->transaction, &part, 1);
+    }
+
+    /**
+     * Le stock doit-il être réapprovisionné ? Vrai si la prévision atteint nbMin avant l'horizon
+     * (quelques périodes de copulation) et s'il reste de la place pour une copulation.
+     */
+    [[nodiscard]] bool needsReplenishment() const {
+        if ((!_precedent && !_remote) || copulationCount() <= 0 || stock() + copulationCount() > nbMax()) {
+            return false;
+        }
+        const float horizon = std::max(getCopulationSec() * FORECAST_HORIZON_PERIODS, FORECAST_MIN_HORIZON_SEC);
+        return _forecast.secondsToMin(stock(), nbMin(), millis()) <= horizon;
+    }
+
+    void setRation(const int ration) { stock() = ration; }
     void setPrecedent(MyDistributeur *precedent) { this->_precedent = precedent; }
-    void setNbMin(const int nbMin) { _nbMin = nbMin; }
-    void setNbMax(const int nbMax) { _nbMax = nbMax; }
-    void setCopulation(const int copulation) { _copulation = copulation; }
-    void setCopulationSec(const float copulationSec) { _copulationSec = copulationSec; }
-    void setNbBySecSend(const float nbBySecSend) { _nbBySecSend = nbBySecSend; }
-    void setNbSendRation(const int nbSendRation) { _nbSendRation = nbSendRation; }
-    void setEat(const int eat) { _eat = eat; }
-    void setName(const String &newName) { name = newName; }
-
-    [[nodiscard]] float getCopulationSec() const { return this->_copulationSec; }
+    void setRemote(RemotePrecedent *remote) { _remote = remote; }
+    void setNbMin(const int nbMin) { distribHot.nbMin[_slot] = nbMin; }
+    void setNbMax(const int nbMax) { distribHot.nbMax[_slot] = nbMax; }
+    void setCopulation(const int copulation) { distribCold.copulation[_slot] = distribNarrow(copulation); }
+    void setCopulationSec(const float copulationSec) {
+        distribCold.copulationMs[_slot] = distribPeriodMs(copulationSec);
+    }
+    void setNbBySecSend(const float nbBySecSend) { distribCold.sendMs[_slot] = distribPeriodMs(nbBySecSend); }
+    void setNbSendRation(const int nbSendRation) { distribCold.sendRation[_slot] = distribNarrow(nbSendRation); }
+    void setEat(const int eat) { distribCold.eat[_slot] = distribNarrow(eat); }
+    void setName(const String &newName) { distribCold.nameId[_slot] = distribNameIntern(newName.c_str()); }
+    void setNiveau(const uint8_t niveau) { _niveau = niveau; }
+    Adafruit_MQTT_Publish &feed() { return adafruit_; }
+    void setFeeds(ChainFeeds *feeds) { _feeds = feeds; }
+
+    [[nodiscard]] String getName() const { return distribNameOf(distribCold.nameId[_slot]); }
+    [[nodiscard]] int getRation() const { return stock(); }
+    [[nodiscard]] int getNbMin() const { return nbMin(); }
+    [[nodiscard]] int getNbMax() const { return nbMax(); }
+    [[nodiscard]] int getCopulation() const { return copulationCount(); }
+    [[nodiscard]] int getNbSendRation() const { return sendRation(); }
+    [[nodiscard]] int getEat() const { return eatCount(); }
+    [[nodiscard]] float getCopulationSec() const { return distribCold.copulationMs[_slot] / 1000.0f; }
+    [[nodiscard]] float getNbBySecSend() const { return distribCold.sendMs[_slot] / 1000.0f; }
+    [[nodiscard]] uint32_t getCopulationMs() const { return distribCold.copulationMs[_slot]; }
     [[nodiscard]] MyDistributeur *getPrecedent() const { return this->_precedent; }
+    [[nodiscard]] uint8_t getJournalId() const { return _slot; }
+    [[nodiscard]] RemotePrecedent *getRemote() const { return _remote; }
+    [[nodiscard]] bool remotePending() const { return _remote && _remote->inflight(*this) > 0; }
+    [[nodiscard]] bool envoiDu() const { return _envoiDu; }
+    [[nodiscard]] bool envoiEnCours() const { return restant() > 0; }
+    [[nodiscard]] int getNombreRestant() const { return std::max<int32_t>(restant(), 0); }
+
+    // Temps avant la prochaine étape d'envoi, UINT32_MAX sans envoi en cours
+    [[nodiscard]] uint32_t envoiInMs(const unsigned long now) const {
+        return envoiEnCours() ? tickerNextInMs(_envoiArmedAt, distribCold.sendMs[_slot], now) : UINT32_MAX;
+    }
+    [[nodiscard]] float getConsumptionRate() const { return _forecast.rate(millis()); }
+    [[nodiscard]] float getSecondsToMin() const { return _forecast.secondsToMin(stock(), nbMin(), millis()); }
 };
 
 
@@ -206,6 +386,92 @@ inline auto poissonRouge = MyDistributeur("Poisson Rouge", 30, pubNbRationPoisso
 inline auto achigan = MyDistributeur("Achigan", 10, pubNbRationAchigan, &poissonRouge);
 inline auto achiganResto = MyDistributeur("Achigan du Restaurant", 12, pubNbRationResto, &achigan);
 
+// La chaîne, du premier au dernier distributeur, avec les clés utilisées dans /config.json
+constexpr uint8_t DISTRIBUTEUR_COUNT = 4;
+inline MyDistributeur *const distributeurs[DISTRIBUTEUR_COUNT] = {&croquette, &poissonRouge, &achigan, &achiganResto};
+inline const char *const distributeurKeys[DISTRIBUTEUR_COUNT] = {"croquette", "poissonRouge", "achigan", "achiganResto"};
+
+/**
+ * Nombre de rations imposé (feed MQTT, banc), journalisé. La configuration utilise setRation() : elle précède le rejeu
+ */
+inline void distributeurSetRation(MyDistributeur &distributeur, const int ration) {
+    const int delta = ration - distributeur.getRation();
+    distributeur.setRation(ration);
+    journalRecord(JOURNAL_SET, distributeur.getJournalId(), delta, ration);
+}
+
+/**
+ * Membres de la classe MyDistributeur d'origine, dans son ordre, pour la comparaison de mémoire. Les
+ * membres ajoutés depuis (niveau, feeds, précédent distant, prévision...) ne sont comptés que dans
+ * « apres ».
+ */
+struct DistribLegacyLayout {
+    int nbMin, nbMax, copulation;
+    float copulationSec, nbBySecSend;
+    int nbSendRation, eat, nombreRestant;
+    Ticker envoyerRationTicker;
+    Adafruit_MQTT_Publish adafruit;
+    MyDistributeur *precedent;
+    String name;                    // Plus le nom lui-même, sur le tas
+    int nbRation;
+};
+
+/**
+ * Mémoire par distributeur, avant et après la table d'état
+ */
+inline size_t distribStateReport(char *out, const size_t size) {
+    const uint8_t count = std::max<uint8_t>(distribSlotCount, 1);
+    size_t names = 0;
+    for (uint8_t slot = 0; slot < distribSlotCount; slot++) {
+        names += distribNameOf(distribCold.nameId[slot]).length() + 1;
+    }
+    const size_t table = sizeof(DistribHot) + sizeof(DistribCold);
+    const size_t before = sizeof(DistribLegacyLayout) + names / count;
+    const size_t after = sizeof(MyDistributeur) + table / DISTRIB_SLOTS + distribNamePoolUsed / count;
+    return snprintf(out, size,
+                    "memoire/distributeur : avant=%u o (objet %u + nom %u) apres=%u o (objet %u + table %u + noms %u) "
+                    "cases=%u/%u bloc_chaud=%u o crc=%08x\n",
+                    static_cast<unsigned>(before), static_cast<unsigned>(sizeof(DistribLegacyLayout)),
+                    static_cast<unsigned>(names / count), static_cast<unsigned>(after),
+                    static_cast<unsigned>(sizeof(MyDistributeur)), static_cast<unsigned>(table / DISTRIB_SLOTS),
+                    static_cast<unsigned>(distribNamePoolUsed / count), distribSlotCount, DISTRIB_SLOTS,
+                    static_cast<unsigned>(sizeof(DistribHot)), distribStateCrc());
+}
+
+// Copulations planifiées évitées grâce à la prévision
+inline uint32_t copulationsEvitees = 0;
+
+/**
+ * Copulation demandée par le Ticker du distributeur, seulement si la prévision annonce un manque
+ */
+inline void copulationPlanifiee(MyDistributeur &distributeur) {
+#if DISTRIB_FORECAST_GATING
+    if (!distributeur.needsReplenishment()) {
+        copulationsEvitees++;
+        return;
+    }
+#endif
+    distributeur.copulation();
+}
+
+// Configuration déjà lue (le démarrage rapide la charge pendant l'association WiFi)
+inline bool distributeurConfigLoaded = false;
+
+/**
+ * Paramètres d'un distributeur lus dans un objet de /config.json
+ */
+inline void applyDistributeurConfig(MyDistributeur &distributeur, JsonObject cfg) {
+    distributeur.setName(cfg["nom"].as<String>());
+    distributeur.setRation(cfg["nbRation"].as<int>());
+    distributeur.setNbMin(cfg["nbMin"].as<int>());
+    distributeur.setNbMax(cfg["nbMax"].as<int>());
+    distributeur.setNbBySecSend(cfg["nbBySecSend"].as<float>());
+    distributeur.setNbSendRation(cfg["nbSendRation"].as<int>());
+    distributeur.setCopulation(cfg["copulation"].as<int>());
+    distributeur.setCopulationSec(cfg["copulationSec"].as<float>());
+    distributeur.setEat(cfg["eat"].as<int>());
+}
+
 inline void loadDistributeurConfig() {
     if (SPIFFS.exists("/config.json")) {
         File configFile = SPIFFS.open("/config.json", "r");
@@ -214,63 +480,17 @@ inline void loadDistributeurConfig() {
             DeserializationError error = deserializeJson(doc, configFile);
 
             if (!error) {
-                JsonObject distributeurs = doc["distributeurs"];
-
-                // Configuration de Croquette
-                if (JsonObject cfgCroquette = distributeurs["croquette"]) {
-                    croquette.setName(cfgCroquette["nom"].as<String>());
-                    croquette.setRation(cfgCroquette["nbRation"].as<int>());
-                    croquette.setNbMin(cfgCroquette["nbMin"].as<int>());
-                    croquette.setNbMax(cfgCroquette["nbMax"].as<int>());
-                    croquette.setNbBySecSend(cfgCroquette["nbBySecSend"].as<float>());
-                    croquette.setNbSendRation(cfgCroquette["nbSendRation"].as<int>());
-                    croquette.setCopulation(cfgCroquette["copulation"].as<int>());
-                    croquette.setCopulationSec(cfgCroquette["copulationSec"].as<float>());
-                    croquette.setEat(cfgCroquette["eat"].as<int>());
-                }
-
-                // Configuration de Poisson Rouge
-                if (JsonObject cfgPoissonRouge = distributeurs["poissonRouge"]) {
-                    poissonRouge.setName(cfgPoissonRouge["nom"].as<String>());
-                    poissonRouge.setRation(cfgPoissonRouge["nbRation"].as<int>());
-                    poissonRouge.setNbMin(cfgPoissonRouge["nbMin"].as<int>());
-                    poissonRouge.setNbMax(cfgPoissonRouge["nbMax"].as<int>());
-                    poissonRouge.setNbBySecSend(cfgPoissonRouge["nbBySecSend"].as<float>());
-                    poissonRouge.setNbSendRation(cfgPoissonRouge["nbSendRation"].as<int>());
-                    poissonRouge.setCopulation(cfgPoissonRouge["copulation"].as<int>());
-                    poissonRouge.setCopulationSec(cfgPoissonRouge["copulationSec"].as<float>());
-                    poissonRouge.setEat(cfgPoissonRouge["eat"].as<int>());
-                }
-
-                // Configuration d'Achigan
-                if (JsonObject cfgAchigan = distributeurs["achigan"]) {
-                    achigan.setName(cfgAchigan["nom"].as<String>());
-                    achigan.setRation(cfgAchigan["nbRation"].as<int>());
-                    achigan.setNbMin(cfgAchigan["nbMin"].as<int>());
-                    achigan.setNbMax(cfgAchigan["nbMax"].as<int>());
-                    achigan.setNbBySecSend(cfgAchigan["nbBySecSend"].as<float>());
-                    achigan.setNbSendRation(cfgAchigan["nbSendRation"].as<int>());
-                    achigan.setCopulation(cfgAchigan["copulation"].as<int>());
-                    achigan.setCopulationSec(cfgAchigan["copulationSec"].as<float>());
-                    achigan.setEat(cfgAchigan["eat"].as<int>());
-                }
-
-                // Configuration d'Achigan Restaurant
-                if (JsonObject cfgAchiganResto = distributeurs["achiganResto"]) {
-                    achiganResto.setName(cfgAchiganResto["nom"].as<String>());
-                    achiganResto.setRation(cfgAchiganResto["nbRation"].as<int>());
-                    achiganResto.setNbMin(cfgAchiganResto["nbMin"].as<int>());
-                    achiganResto.setNbMax(cfgAchiganResto["nbMax"].as<int>());
-                    achiganResto.setNbBySecSend(cfgAchiganResto["nbBySecSend"].as<float>());
-                    achiganResto.setNbSendRation(cfgAchiganResto["nbSendRation"].as<int>());
-                    achiganResto.setCopulation(cfgAchiganResto["copulation"].as<int>());
-                    achiganResto.setCopulationSec(cfgAchiganResto["copulationSec"].as<float>());
-                    achiganResto.setEat(cfgAchiganResto["eat"].as<int>());
+                JsonObject cfgDistributeurs = doc["distributeurs"];
+                for (uint8_t i = 0; i < DISTRIBUTEUR_COUNT; i++) {
+                    if (JsonObject cfg = cfgDistributeurs[distributeurKeys[i]]) {
+                        applyDistributeurConfig(*distributeurs[i], cfg);
+                    }
                 }
 
+                distributeurConfigLoaded = true;
                 MYDEBUG_PRINTLN("Configuration des distributeurs chargée avec succès");
             } else {
-                MYDEBUG_PRINTLN("Erreur lors du parsing du fichier de configuration");
+                MYDEBUG_ERRORLN("Erreur lors du parsing du fichier de configuration");
             }
             configFile.close();
         }
@@ -282,100 +502,35 @@ inline void loadDistributeurConfig() {
 inline void setupDistributeur() {
     setupMQTT();
 
-    loadDistributeurConfig();
+    if (!distributeurConfigLoaded) loadDistributeurConfig();
     // Vérification de la mémoire
-    if (EspClass::getFreeHeap() < 4096) {
-        MYDEBUG_PRINTLN("Mémoire insuffisante lors de l'initialisation");
+    if (EspClass::getFreeHeap() < HEAP_RESTART_FREE) {
+        MYDEBUG_ERRORLN("Mémoire insuffisante lors de l'initialisation");
         delay(1000);
         EspClass::restart();
     }
 
-    // Vérification du WiFi
+    // Vérification du WiFi (déjà connecté en démarrage rapide : startDistributeur() l'attend)
     if (WiFi.status() != WL_CONNECTED) {
         setupWiFi();
-        delay(2000);
     }
 
-    // Tentative de connexion initiale à Adafruit IO
+    // Tentative de connexion initiale à Adafruit IO, sans attente : loopDistributeur() réessaie
     MYDEBUG_PRINTLN("Tentative de connexion initiale à Adafruit IO...");
-    uint8_t retries = 5;
-    bool connected = false;
-
-    while (retries-- && !connected) {
-        connectAdafruitIO();
-        if (MyAdafruitMqtt.connected()) {
-            connected = true;
-            MYDEBUG_PRINTLN("Connexion initiale réussie !");
-            break;
-        }
-        delay(3000);
-    }
-
-    if (!connected) {
-        MYDEBUG_PRINTLN("Échec de la connexion initiale à Adafruit IO");
-    }
-
-
-    // Configuration des callbacks et souscription aux FEEDs
-    subNbRationCroquette.setCallback([](char *data, uint16_t len) {
-        croquette.setRation(atoi(data));
-    });
-    MyAdafruitMqtt.subscribe(&subNbRationCroquette);
-
-    subNbRationPoissonRouge.setCallback([](char *data, uint16_t len) {
-        poissonRouge.setRation(atoi(data));
-    });
-    MyAdafruitMqtt.subscribe(&subNbRationPoissonRouge);
-
-    subNbRationAchigan.setCallback([](char *data, uint16_t len) {
-        achigan.setRation(atoi(data));
-    });
-    MyAdafruitMqtt.subscribe(&subNbRationAchigan);
-
-    subNbRationResto.setCallback([](char *data, uint16_t len) {
-        achiganResto.setRation(atoi(data));
-    });
-    MyAdafruitMqtt.subscribe(&subNbRationResto);
-    delay(2000);
-
-    subCommande.setCallback([](char *data, uint16_t len) {
-        MYDEBUG_PRINTLN("Commande reçue : " + String(data));
-        achiganResto.commande(atoi(data));
-        MYDEBUG_PRINTLN("Commande traitée");
-    });
-    MyAdafruitMqtt.subscribe(&subCommande);
-
-
-    MyAdafruitMqtt.processPackets(2000);
-
-    if (croquette.getCopulationSec() > 0) {
-        croquetteTicker.attach(croquette.getCopulationSec(), []() {
-            croquette.copulation();
-        });
-    }
-
-    if (poissonRouge.getCopulationSec() > 0) {
-        poissonRougeTicker.attach(poissonRouge.getCopulationSec(), []() {
-            poissonRouge.copulation();
-        });
-    }
-
-    if (achigan.getCopulationSec() > 0) {
-        achiganTicker.attach(achigan.getCopulationSec(), []() {
-            achigan.copulation();
-        });
-    }
-
-    if (achiganResto.getCopulationSec() > 0) {
-        achiganRestoTicker.attach(achiganResto.getCopulationSec(), []() {
-            achiganResto.copulation();
-        });
+    connectAdafruitIO();
+    if (MyAdafruitMqtt.connected()) {
+        MYDEBUG_PRINTLN("Connexion initiale réussie !");
+        processMQTT();
+    } else {
+        MYDEBUG_WARNLN("Échec de la connexion initiale à Adafruit IO");
     }
 }
 
+inline unsigned long mqttLastPing = 0;   // Dernier ping, échéance du keepalive pour la planification du sommeil
+
 inline void loopDistributeur() {
+    HeapScope scope(HEAP_MQTT);
     static unsigned long lastProcess = 0;
-    static unsigned long lastPing = 0;
 
     const unsigned long now = millis();
     static unsigned long lastDebug = 0;
@@ -386,15 +541,14 @@ inline void loopDistributeur() {
     }
 
     // Gestion du ping
-    if (constexpr unsigned long pingInterval = 5000; now - lastPing >= pingInterval) {
-        lastPing = now;
+    if (constexpr unsigned long pingInterval = 5000; now - mqttLastPing >= pingInterval) {
+        mqttLastPing = now;
 
         if (MyAdafruitMqtt.connected()) {
             // Tentative de ping
             if (!MyAdafruitMqtt.ping()) {
-                MYDEBUG_PRINTLN("Ping échoué, tentative de reconnexion...");
+                MYDEBUG_WARNLN("Ping échoué, tentative de reconnexion...");
                 MyAdafruitMqtt.disconnect();
-                delay(1000);
                 connectAdafruitIO();
                 return;
             }
@@ -409,7 +563,7 @@ inline void loopDistributeur() {
         lastProcess = now;
 
         if (MyAdafruitMqtt.connected()) {
-            MyAdafruitMqtt.processPackets(100);
+            processMQTT();
         }
     }
 }
@@ -0,0 +1,70 @@
+/**
+ * \file MyForecast.h
+ * \page forecast Prévision d'épuisement
+ * \brief Estimation du débit de consommation d'un distributeur et du temps restant avant nbMin
+ *
+ * Chaque sortie de rations (envoi d'une commande, rations mangées par le distributeur suivant lors
+ * d'une copulation) est un événement. Le débit instantané (rations / seconde depuis l'événement
+ * précédent) est lissé par une moyenne mobile exponentielle (EWMA) : mise à jour en O(1),
+ * sans historique à conserver.
+ *
+ * Sans nouvel événement, le débit estimé décroît : il est borné par les dernières rations sorties
+ * divisées par le temps écoulé depuis.
+ *
+ * Le temps avant d'atteindre nbMin est (stock - nbMin) / débit. La copulation planifiée n'est
+ * déclenchée que si ce temps est inférieur à l'horizon de réapprovisionnement.
+ *
+ * Fichier \ref MyForecast.h
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define FORECAST_ALPHA             0.3f    // Poids du dernier débit observé
+#define FORECAST_HORIZON_PERIODS   3       // Horizon = copulationSec × FORECAST_HORIZON_PERIODS
+#define FORECAST_MIN_HORIZON_SEC   60.0f
+
+class ConsumptionForecast {
+    float _rate = 0;                // Rations par seconde, lissé
+    unsigned long _lastEventMs = 0;
+    int _lastUnits = 0;
+    bool _primed = false;           // Au moins deux événements observés
+
+public:
+    /**
+     * Enregistre la sortie de units rations à l'instant nowMs
+     */
+    void record(const int units, const unsigned long nowMs) {
+        if (units <= 0) return;
+
+        if (_lastUnits > 0) {
+            const float dt = (nowMs - _lastEventMs) / 1000.0f;
+            if (dt > 0) {
+                const float sample = units / dt;
+                _rate = _primed ? _rate + FORECAST_ALPHA * (sample - _rate) : sample;
+                _primed = true;
+            }
+        }
+        _lastEventMs = nowMs;
+        _lastUnits = units;
+    }
+
+    /**
+     * Débit estimé, décroissant si aucune sortie n'a eu lieu depuis longtemps
+     */
+    [[nodiscard]] float rate(const unsigned long nowMs) const {
+        if (!_primed) return 0;
+        const float elapsed = (nowMs - _lastEventMs) / 1000.0f;
+        if (elapsed <= 0) return _rate;
+        return std::min(_rate, _lastUnits / elapsed);
+    }
+
+    /**
+     * Secondes avant que le stock n'atteigne nbMin au débit actuel (INFINITY si rien ne sort)
+     */
+    [[nodiscard]] float secondsToMin(const int stock, const int nbMin, const unsigned long nowMs) const {
+        if (stock <= nbMin) return 0;
+        const float r = rate(nowMs);
+        return r > 0 ? (stock - nbMin) / r : INFINITY;
+    }
+};
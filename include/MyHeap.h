@@ -0,0 +1,204 @@
+/**
+ * \file MyHeap.h
+ * \page heap Suivi du tas
+ * \brief Fragmentation et niveaux bas du tas, par sous-système
+ *
+ * Les redémarrages intempestifs de l'ESP8266 arrivent souvent plusieurs heures après le démarrage :
+ * à force de créer et détruire des String (pages web, logs), le tas se fragmente jusqu'à ce qu'aucun
+ * bloc contigu ne soit assez grand pour une allocation.
+ *
+ * Chaque sous-système est encadré par un HeapScope qui relève, à l'entrée et à la sortie :
+ * - ESP.getFreeHeap() : mémoire libre totale
+ * - ESP.getMaxFreeBlockSize() : plus grand bloc allouable
+ * - ESP.getHeapFragmentation() : fragmentation en %
+ *
+ * On conserve pour chaque sous-système le plus bas niveau observé (high-water mark d'utilisation)
+ * et la variation de mémoire libre entre l'entrée et la sortie.
+ *
+ * Le niveau global (HEAP_OK, HEAP_LOW, HEAP_CRITICAL) permet une dégradation progressive :
+ * - HEAP_LOW : le buffer de logs n'est plus alimenté, les pages web sont servies sans mise en forme et
+ *   le cache des pages rendues est vidé
+ * - HEAP_CRITICAL : les pages web répondent 503, seul /debug/heap reste disponible
+ * - Si le niveau est critique et le tas libre reste sous HEAP_RESTART_FREE pendant HEAP_RESTART_GRACE_MS
+ *   (délai compté depuis le passage sous le seuil, pas depuis l'entrée en niveau critique), redémarrage
+ *   contrôlé
+ *
+ * Ce fichier ne dépend que d'Arduino.h pour pouvoir être utilisé par MyDebug.h ; les messages
+ * partent directement sur le port série, sans passer par le buffer de logs qui alloue.
+ *
+ * Fichier \ref MyHeap.h
+ */
+#pragma once
+
+#include <Arduino.h>
+
+// Seuils de dégradation (octets et %)
+#define HEAP_LOW_FREE              12288
+#define HEAP_LOW_BLOCK             4096
+#define HEAP_LOW_FRAG              50
+#define HEAP_CRITICAL_FREE         6144
+#define HEAP_CRITICAL_BLOCK        2048
+#define HEAP_CRITICAL_FRAG         70
+#define HEAP_HYSTERESIS            2048   // Marge à retrouver avant de remonter d'un niveau
+#define HEAP_RESTART_FREE          4096
+#define HEAP_RESTART_GRACE_MS      10000
+
+enum HeapSubsystem : uint8_t {
+    HEAP_WIFI,
+    HEAP_WEB,
+    HEAP_MQTT,
+    HEAP_DISTRIBUTEUR,
+    HEAP_SPIFFS,
+    HEAP_DEBUG,
+    HEAP_SUBSYSTEM_COUNT
+};
+
+inline const char *const heapSubsystemNames[HEAP_SUBSYSTEM_COUNT] = {
+    "wifi", "web", "mqtt", "distributeur", "spiffs", "debug"
+};
+
+enum HeapLevel : uint8_t {
+    HEAP_OK,
+    HEAP_LOW,
+    HEAP_CRITICAL
+};
+
+inline const char *const heapLevelNames[] = {"ok", "bas", "critique"};
+
+struct HeapSample {
+    uint32_t free;
+    uint32_t maxBlock;
+    uint8_t frag;
+};
+
+struct HeapStats {
+    uint32_t calls = 0;
+    uint32_t minFree = UINT32_MAX;     // Plus bas niveau de mémoire libre observé
+    uint32_t minMaxBlock = UINT32_MAX; // Plus petit "plus grand bloc" observé
+    uint8_t maxFrag = 0;
+    int32_t lastDelta = 0;             // Mémoire libre perdue entre l'entrée et la sortie (> 0 : conservée)
+    int32_t maxDelta = 0;
+    int32_t totalDelta = 0;            // Cumul : une dérive continue signale une fuite
+};
+
+inline HeapStats heapStats[HEAP_SUBSYSTEM_COUNT];
+inline HeapSample heapLastSample = {0, 0, 0};
+inline HeapLevel heapLevel = HEAP_OK;
+inline bool heapExhausted = false;          // Tas libre sous HEAP_RESTART_FREE au dernier échantillon
+inline unsigned long heapExhaustedSince = 0; // Passage sous HEAP_RESTART_FREE
+
+inline HeapSample heapTake() {
+    HeapSample s;
+    s.free = EspClass::getFreeHeap();
+    s.maxBlock = EspClass::getMaxFreeBlockSize();
+    s.frag = EspClass::getHeapFragmentation();
+    return s;
+}
+
+inline HeapLevel heapLevelFor(const HeapSample &s, const uint32_t margin) {
+    if (s.free < HEAP_CRITICAL_FREE + margin || s.maxBlock < HEAP_CRITICAL_BLOCK + margin ||
+        s.frag > HEAP_CRITICAL_FRAG) {
+        return HEAP_CRITICAL;
+    }
+    if (s.free < HEAP_LOW_FREE + margin || s.maxBlock < HEAP_LOW_BLOCK + margin || s.frag > HEAP_LOW_FRAG) {
+        return HEAP_LOW;
+    }
+    return HEAP_OK;
+}
+
+/**
+ * Mise à jour du niveau global : dégradation immédiate, retour à la normale avec hystérésis
+ */
+inline void heapUpdateLevel(const HeapSample &s) {
+    heapLastSample = s;
+
+    HeapLevel level = heapLevelFor(s, 0);
+    if (level < heapLevel && heapLevelFor(s, HEAP_HYSTERESIS) > level) {
+        level = heapLevel; // Pas encore assez de marge pour remonter
+    }
+
+    if (level != heapLevel) {
+#ifdef MYDEBUG
+        Serial.printf("-HEAP : niveau %s -> %s (libre %u, bloc %u, frag %u%%)\n",
+                      heapLevelNames[heapLevel], heapLevelNames[level], s.free, s.maxBlock, s.frag);
+#endif
+        heapLevel = level;
+    }
+}
+
+inline void heapRecord(const HeapSubsystem sub, const HeapSample &entry, const HeapSample &exit) {
+    HeapStats &st = heapStats[sub];
+    st.calls++;
+    st.minFree = std::min(st.minFree, std::min(entry.free, exit.free));
+    st.minMaxBlock = std::min(st.minMaxBlock, std::min(entry.maxBlock, exit.maxBlock));
+    st.maxFrag = std::max(st.maxFrag, std::max(entry.frag, exit.frag));
+    st.lastDelta = static_cast<int32_t>(entry.free) - static_cast<int32_t>(exit.free);
+    st.maxDelta = std::max(st.maxDelta, st.lastDelta);
+    st.totalDelta += st.lastDelta;
+    heapUpdateLevel(exit);
+}
+
+/**
+ * Relevé automatique à l'entrée et à la sortie d'un bloc de code :
+ * { HeapScope scope(HEAP_WEB); monWebServeur.handleClient(); }
+ */
+class HeapScope {
+    HeapSubsystem _sub;
+    HeapSample _entry;
+
+public:
+    explicit HeapScope(const HeapSubsystem sub) : _sub(sub), _entry(heapTake()) {
+    }
+
+    ~HeapScope() { heapRecord(_sub, _entry, heapTake()); }
+
+    HeapScope(const HeapScope &) = delete;
+    HeapScope &operator=(const HeapScope &) = delete;
+};
+
+// Politique de dégradation
+inline bool heapShedLogs() { return heapLevel >= HEAP_LOW; }
+inline bool heapShedWebStyle() { return heapLevel >= HEAP_LOW; }
+inline bool heapShedCache() { return heapLevel >= HEAP_LOW; }
+inline bool heapShedWeb() { return heapLevel >= HEAP_CRITICAL; }
+
+/**
+ * À appeler dans la loop : redémarrage contrôlé si le tas reste inutilisable trop longtemps
+ */
+inline void loopHeap() {
+    heapUpdateLevel(heapTake());
+
+    // Un échantillon repassé au-dessus du seuil relance le délai de grâce
+    if (heapLastSample.free >= HEAP_RESTART_FREE) {
+        heapExhausted = false;
+    } else if (!heapExhausted) {
+        heapExhausted = true;
+        heapExhaustedSince = millis();
+    }
+
+    if (heapLevel == HEAP_CRITICAL && heapExhausted && millis() - heapExhaustedSince >= HEAP_RESTART_GRACE_MS) {
+#ifdef MYDEBUG
+        Serial.printf("-HEAP : mémoire épuisée depuis %lu ms, redémarrage\n", millis() - heapExhaustedSince);
+#endif
+        delay(100);
+        EspClass::restart();
+    }
+}
+
+/**
+ * Rapport texte compact, écrit dans un tampon fixe pour rester utilisable quand le tas est critique
+ */
+inline size_t heapReport(char *out, const size_t size) {
+    size_t n = snprintf(out, size, "niveau=%s libre=%u bloc=%u frag=%u%%\n",
+                        heapLevelNames[heapLevel], heapLastSample.free, heapLastSample.maxBlock,
+                        heapLastSample.frag);
+    for (uint8_t i = 0; i < HEAP_SUBSYSTEM_COUNT && n < size; i++) {
+        const HeapStats &st = heapStats[i];
+        if (st.calls == 0) continue;
+        n += snprintf(out + n, size - n, "%s: appels=%u min_libre=%u min_bloc=%u frag_max=%u%% delta=%d "
+                      "delta_max=%d delta_total=%d\n",
+                      heapSubsystemNames[i], st.calls, st.minFree, st.minMaxBlock, st.maxFrag, st.lastDelta,
+                      st.maxDelta, st.totalDelta);
+    }
+    return std::min(n, size);
+}
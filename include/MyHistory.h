@@ -0,0 +1,332 @@
+/**
+ * \file MyHistory.h
+ * \page history Historique des stocks
+ * \brief Séries temporelles multi-résolution des rations, en RAM et sur LittleFS
+ *
+ * Chaque distributeur est échantillonné toutes les secondes. Les échantillons sont agrégés en
+ * « buckets » min / max / moyenne à trois résolutions :
+ * - 10 s sur les HISTORY_FINE_COUNT derniers buckets
+ * - 1 min sur les HISTORY_MINUTE_COUNT derniers buckets
+ * - 1 h sur les HISTORY_HOUR_COUNT derniers buckets
+ *
+ * Un bucket fermé est fusionné dans la résolution supérieure. Les buckets d'une heure sont en plus
+ * écrits sur LittleFS (/history/<d>.bin, enregistrements de taille fixe triés par date) : l'historique
+ * long survit aux redémarrages sans consommer de RAM. Quand le fichier dépasse HISTORY_SPILL_MAX_BYTES,
+ * il devient <d>.old et un nouveau fichier est commencé.
+ *
+ * La mémoire utilisée est fixe : HISTORY_RAM_BYTES pour tous les distributeurs.
+ *
+ * La route /api/history?d=&from=&to=&res=&format= diffuse les buckets en JSON compact
+ * ([t, min, max, moyenne]) ou en CSV, sans construire la réponse entière en mémoire.
+ * - d : index (0 à 3) ou clé du distributeur (croquette, poissonRouge, achigan, achiganResto)
+ * - from, to : bornes en secondes epoch (par défaut tout l'historique)
+ * - res : 10, 60 ou 3600 secondes (60 par défaut)
+ * - format : json (par défaut) ou csv
+ *
+ * Fichier \ref MyHistory.h
+ */
+#pragma once
+
+#include "MyDistributeur.h"
+#include "MySPIFFS.h"
+#include "MyWebServer.h"
+
+#define HISTORY_SAMPLE_MS        1000
+#define HISTORY_FINE_COUNT       18      // 10 s × 18 = 3 min
+#define HISTORY_MINUTE_COUNT     30      // 1 min × 30 = 30 min
+#define HISTORY_HOUR_COUNT       12      // 1 h × 12 = 12 h, le reste est sur LittleFS
+#define HISTORY_SPILL_MAX_BYTES  16384   // 1024 heures par fichier
+#define HISTORY_DIR              "/history"
+
+constexpr uint32_t historyResolutions[] = {10, 60, 3600};
+constexpr uint16_t historyCapacities[] = {HISTORY_FINE_COUNT, HISTORY_MINUTE_COUNT, HISTORY_HOUR_COUNT};
+constexpr uint8_t HISTORY_LEVELS = 3;
+
+/**
+ * Agrégat d'une période : 16 octets, écrit tel quel sur LittleFS
+ */
+struct HistoryBucket {
+    uint32_t start = 0;   // Début de la période (epoch, secondes)
+    uint32_t sum = 0;
+    uint16_t min = UINT16_MAX;
+    uint16_t max = 0;
+    uint16_t count = 0;
+    uint16_t reserved = 0;
+
+    void add(const uint16_t value) {
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        count++;
+    }
+
+    void merge(const HistoryBucket &other) {
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        count += other.count;
+    }
+
+    [[nodiscard]] uint16_t avg() const { return count ? sum / count : 0; }
+};
+
+static_assert(sizeof(HistoryBucket) == 16, "Format des buckets sur LittleFS");
+
+struct HistoryLevel {
+    HistoryBucket current;   // Bucket ouvert
+    uint16_t head = 0;       // Prochaine case à écrire
+    uint16_t count = 0;
+};
+
+struct HistorySeries {
+    HistoryLevel levels[HISTORY_LEVELS];
+    HistoryBucket fine[HISTORY_FINE_COUNT];
+    HistoryBucket minute[HISTORY_MINUTE_COUNT];
+    HistoryBucket hour[HISTORY_HOUR_COUNT];
+
+    HistoryBucket *ring(const uint8_t level) {
+        return level == 0 ? fine : level == 1 ? minute : hour;
+    }
+
+    [[nodiscard]] const HistoryBucket *ring(const uint8_t level) const {
+        return level == 0 ? fine : level == 1 ? minute : hour;
+    }
+};
+
+constexpr size_t HISTORY_RAM_BYTES = DISTRIBUTEUR_COUNT * sizeof(HistorySeries);
+static_assert(HISTORY_RAM_BYTES <= 4096, "Budget mémoire de l'historique dépassé");
+
+inline HistorySeries historySeries[DISTRIBUTEUR_COUNT];
+
+inline uint32_t historyNow() {
+    return nowEpoch();
+}
+
+inline String historyFile(const uint8_t d, const char *suffix) {
+    return String(HISTORY_DIR "/") + String(d) + suffix;
+}
+
+/**
+ * Écriture d'un bucket d'une heure sur LittleFS, avec rotation du fichier
+ */
+inline void historySpill(const uint8_t d, const HistoryBucket &bucket) {
+    HeapScope scope(HEAP_SPIFFS);
+    const String path = historyFile(d, ".bin");
+
+    File file = SPIFFS.open(path, "a");
+    if (!file) {
+        MYDEBUG_ERRORLN("-HISTORY : Impossible d'écrire " + path);
+        return;
+    }
+    file.write(reinterpret_cast<const uint8_t *>(&bucket), sizeof(bucket));
+    const size_t size = file.size();
+    file.close();
+
+    if (size >= HISTORY_SPILL_MAX_BYTES) {
+        const String old = historyFile(d, ".old");
+        SPIFFS.remove(old);
+        SPIFFS.rename(path, old);
+    }
+}
+
+inline void historyClose(uint8_t d, uint8_t level);
+
+/**
+ * Ajout d'un bucket fermé (ou d'un échantillon, level = 0) dans le bucket ouvert d'un niveau
+ */
+inline void historyMerge(const uint8_t d, const uint8_t level, const HistoryBucket &bucket) {
+    HistoryLevel &lvl = historySeries[d].levels[level];
+    const uint32_t start = bucket.start - bucket.start % historyResolutions[level];
+
+    if (lvl.current.count > 0 && lvl.current.start != start) {
+        historyClose(d, level);
+    }
+    if (lvl.current.count == 0) {
+        lvl.current = HistoryBucket();
+        lvl.current.start = start;
+    }
+    lvl.current.merge(bucket);
+}
+
+inline void historyClose(const uint8_t d, const uint8_t level) {
+    HistorySeries &series = historySeries[d];
+    HistoryLevel &lvl = series.levels[level];
+
+    series.ring(level)[lvl.head] = lvl.current;
+    lvl.head = (lvl.head + 1) % historyCapacities[level];
+    lvl.count = std::min<uint16_t>(lvl.count + 1, historyCapacities[level]);
+
+    if (level + 1 < HISTORY_LEVELS) {
+        historyMerge(d, level + 1, lvl.current);
+    } else {
+        historySpill(d, lvl.current);
+    }
+    lvl.current = HistoryBucket();
+}
+
+inline void historySample(const uint8_t d, const int value, const uint32_t epoch) {
+    HistoryBucket sample;
+    sample.start = epoch;
+    sample.add(static_cast<uint16_t>(constrain(value, 0, UINT16_MAX)));
+    historyMerge(d, 0, sample);
+}
+
+/************************* Diffusion HTTP ************************************/
+
+/**
+ * Tampon d'écriture : les points sont envoyés par blocs, la réponse n'est jamais entière en mémoire
+ */
+class HistoryWriter {
+    char _buf[512];
+    size_t _len = 0;
+    bool _csv;
+    bool _first = true;
+
+    void flush() {
+        if (_len > 0) {
+            monWebServeur.sendContent(_buf, _len);
+            _len = 0;
+        }
+    }
+
+    void append(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+        if (_len > sizeof(_buf) - 64) flush();
+        va_list args;
+        va_start(args, fmt);
+        const int n = vsnprintf(_buf + _len, sizeof(_buf) - _len, fmt, args);
+        va_end(args);
+        if (n > 0) _len = std::min(_len + n, sizeof(_buf) - 1);
+    }
+
+public:
+    explicit HistoryWriter(const bool csv) : _csv(csv) {
+    }
+
+    void begin(const uint8_t d, const uint32_t res) {
+        if (_csv) append("t,min,max,avg\n");
+        else append("{\"d\":%u,\"res\":%u,\"points\":[", d, res);
+    }
+
+    void point(const HistoryBucket &b) {
+        if (b.count == 0) return;
+        if (_csv) {
+            append("%u,%u,%u,%u\n", b.start, b.min, b.max, b.avg());
+        } else {
+            append("%s[%u,%u,%u,%u]", _first ? "" : ",", b.start, b.min, b.max, b.avg());
+        }
+        _first = false;
+    }
+
+    void end() {
+        if (!_csv) append("]}\n");
+        flush();
+        monWebServeur.sendContent("");
+    }
+};
+
+/**
+ * Lecture d'un fichier de buckets trié par date, en commençant par une recherche dichotomique sur from
+ */
+inline void historyStreamFile(HistoryWriter &writer, const String &path, const uint32_t from, const uint32_t to) {
+    File file = SPIFFS.open(path, "r");
+    if (!file) return;
+
+    size_t lo = 0;
+    size_t hi = file.size() / sizeof(HistoryBucket);
+    HistoryBucket b;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        file.seek(mid * sizeof(HistoryBucket));
+        file.read(reinterpret_cast<uint8_t *>(&b), sizeof(b));
+        if (b.start < from) lo = mid + 1;
+        else hi = mid;
+    }
+
+    file.seek(lo * sizeof(HistoryBucket));
+    while (file.read(reinterpret_cast<uint8_t *>(&b), sizeof(b)) == sizeof(b) && b.start <= to) {
+        writer.point(b);
+        yield();
+    }
+    file.close();
+}
+
+inline int historyParseDistributeur(const String &arg) {
+    if (arg.length() == 0) return -1;
+    for (uint8_t i = 0; i < DISTRIBUTEUR_COUNT; i++) {
+        if (arg == distributeurKeys[i]) return i;
+    }
+    const long index = arg.toInt();
+    return arg[0] >= '0' && arg[0] <= '9' && index < DISTRIBUTEUR_COUNT ? index : -1;
+}
+
+/**
+ * Fonction de gestion de la route /api/history
+ */
+inline void handleApiHistory() {
+    const int d = historyParseDistributeur(monWebServeur.arg("d"));
+    if (d < 0) {
+        monWebServeur.send(400, "text/plain", "Paramètre d invalide\n");
+        return;
+    }
+
+    const uint32_t from = monWebServeur.hasArg("from") ? strtoul(monWebServeur.arg("from").c_str(), nullptr, 10) : 0;
+    const uint32_t to = monWebServeur.hasArg("to")
+                            ? strtoul(monWebServeur.arg("to").c_str(), nullptr, 10)
+                            : UINT32_MAX;
+    const uint32_t res = monWebServeur.hasArg("res") ? strtoul(monWebServeur.arg("res").c_str(), nullptr, 10) : 60;
+    const uint8_t level = res <= 10 ? 0 : res <= 60 ? 1 : 2;
+    const bool csv = monWebServeur.arg("format") == "csv";
+
+    monWebServeur.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    monWebServeur.send(200, csv ? "text/csv" : "application/json", "");
+
+    HistoryWriter writer(csv);
+    writer.begin(d, historyResolutions[level]);
+
+    const HistorySeries &series = historySeries[d];
+    const HistoryLevel &lvl = series.levels[level];
+    const HistoryBucket *ring = series.ring(level);
+    const uint16_t capacity = historyCapacities[level];
+    const uint32_t oldestInRam = lvl.count > 0 ? ring[(lvl.head + capacity - lvl.count) % capacity].start : UINT32_MAX;
+
+    // Heures plus anciennes que la RAM : lecture sur LittleFS
+    if (level == HISTORY_LEVELS - 1 && from < oldestInRam) {
+        const uint32_t fileTo = std::min(to, oldestInRam - 1);
+        historyStreamFile(writer, historyFile(d, ".old"), from, fileTo);
+        historyStreamFile(writer, historyFile(d, ".bin"), from, fileTo);
+    }
+
+    for (uint16_t i = 0; i < lvl.count; i++) {
+        const HistoryBucket &b = ring[(lvl.head + capacity - lvl.count + i) % capacity];
+        if (b.start >= from && b.start <= to) writer.point(b);
+    }
+    if (lvl.current.start >= from && lvl.current.start <= to) {
+        writer.point(lvl.current); // Bucket en cours, partiel
+    }
+    writer.end();
+}
+
+/**
+ * Initialisation de l'historique : répertoire LittleFS et route HTTP
+ */
+inline void setupHistory() {
+    SPIFFS.mkdir(HISTORY_DIR);
+    webOnSyncOnly("/api/history", HTTP_GET, handleApiHistory);
+    MYDEBUG_PRINTLN("-HISTORY : " + String(HISTORY_RAM_BYTES) + " octets réservés pour " +
+        String(DISTRIBUTEUR_COUNT) + " distributeurs");
+}
+
+/**
+ * Échantillonnage des stocks, à appeler dans la loop
+ */
+inline void loopHistory() {
+    static unsigned long lastSample = 0;
+    const unsigned long now = millis();
+    if (now - lastSample < HISTORY_SAMPLE_MS) return;
+    lastSample = now;
+
+    const uint32_t epoch = historyNow();
+    for (uint8_t d = 0; d < DISTRIBUTEUR_COUNT; d++) {
+        historySample(d, distributeurs[d]->getRation(), epoch);
+    }
+}
@@ -0,0 +1,288 @@
+/**
+ * \file MyJournal.h
+ * \page journal Journal des opérations
+ * \brief Journal binaire des mutations de l'état, avec instantanés et rejeu au démarrage
+ *
+ * L'état des distributeurs change à trois endroits : l'envoi progressif d'une commande, la
+ * copulation et la réception d'un nombre de rations sur MQTT (les annulations de copulation ne sont
+ * plus produites depuis les transactions, voir MyTransaction.h, mais restent lisibles). Chaque mutation est un événement de taille fixe (24 octets) :
+ * type, identifiant du distributeur, variation, valeur obtenue, date en ms epoch et numéro de
+ * séquence, plus une somme de contrôle.
+ *
+ * Les événements peuvent être produits depuis un Ticker ou un callback MQTT : ils sont placés dans
+ * une file en RAM, et journalFlush() les écrit sur LittleFS depuis la loop.
+ *
+ * <H2>Instantanés</H2>
+ *
+ * Tous les JOURNAL_SNAPSHOT_EVENTS événements, l'état complet est écrit dans un instantané
+ * (fichier temporaire puis renommage : l'instantané précédent reste valide jusqu'au dernier moment),
+ * puis le journal courant devient events.old. Au démarrage, journalReplay() part de l'instantané
+ * et applique les événements postérieurs : la durée du rejeu est bornée.
+ *
+ * Un événement perdu (file pleine) rendrait faux le rejeu jusqu'à l'instantané suivant : le prochain
+ * journalFlush() écrit alors un instantané sans attendre JOURNAL_SNAPSHOT_EVENTS événements.
+ *
+ * La route /api/journal?since=&limit= permet l'audit des derniers événements (texte, un par ligne).
+ *
+ * Fichier \ref MyJournal.h
+ */
+#pragma once
+
+#include "MyHeap.h"
+#include "MyNTP.h"
+#include "MyRTC.h"
+#include "MyRenderCache.h"
+#include "MySPIFFS.h"
+#include "MyWebServer.h"
+
+#define JOURNAL_DIR              "/journal"
+#define JOURNAL_EVENTS_FILE      JOURNAL_DIR "/events.bin"
+#define JOURNAL_OLD_FILE         JOURNAL_DIR "/events.old"
+#define JOURNAL_SNAPSHOT_FILE    JOURNAL_DIR "/snapshot.bin"
+#define JOURNAL_SNAPSHOT_TMP     JOURNAL_DIR "/snapshot.tmp"
+#define JOURNAL_SNAPSHOT_EVENTS  256     // Événements entre deux instantanés
+#define JOURNAL_QUEUE_SIZE       32
+#define JOURNAL_MAX_IDS          16
+#define JOURNAL_AUDIT_LIMIT      200
+
+enum JournalEventType : uint8_t {
+    JOURNAL_DISPATCH,      // Rations envoyées pour une commande
+    JOURNAL_COPULATION,    // Rations mangées par le distributeur précédent ou gagnées
+    JOURNAL_ROLLBACK,      // Annulation d'une copulation non publiée (journaux antérieurs aux transactions)
+    JOURNAL_SET,           // Nombre de rations reçu sur MQTT
+    JOURNAL_TYPE_COUNT
+};
+
+inline const char *const journalTypeNames[JOURNAL_TYPE_COUNT] = {"dispatch", "copulation", "rollback", "set"};
+
+struct JournalEvent {
+    uint64_t epochMs = 0;
+    uint32_t seq = 0;
+    int32_t delta = 0;
+    int32_t value = 0;        // Valeur après la mutation : le rejeu n'a qu'à l'appliquer
+    uint8_t type = 0;
+    uint8_t id = 0;
+    uint16_t check = 0;       // CRC32 tronqué des champs précédents
+};
+
+static_assert(sizeof(JournalEvent) == 24, "Format des événements sur LittleFS");
+
+struct JournalSnapshot {
+    uint32_t seq = 0;         // Dernier événement inclus
+    uint8_t count = 0;
+    uint8_t reserved[3] = {};
+    uint64_t epochMs = 0;
+    int32_t values[JOURNAL_MAX_IDS] = {};
+    uint32_t crc = 0;
+    uint32_t padding = 0;
+};
+
+struct JournalStats {
+    uint32_t written = 0;
+    uint32_t dropped = 0;     // File pleine
+    uint32_t replayed = 0;
+    uint32_t corrupt = 0;     // Enregistrements invalides ignorés au rejeu
+    uint32_t snapshots = 0;
+};
+
+inline JournalEvent journalQueue[JOURNAL_QUEUE_SIZE];
+inline volatile uint8_t journalHead = 0;   // Écrit par les producteurs
+inline volatile uint8_t journalTail = 0;   // Écrit par journalFlush()
+inline uint32_t journalSeq = 0;            // Dernier numéro attribué
+inline uint32_t journalSinceSnapshot = 0;
+inline volatile bool journalLost = false;  // Événement perdu depuis le dernier instantané
+inline JournalStats journalStats;
+inline uint8_t journalIdCount = JOURNAL_MAX_IDS;  // Identifiants journalisés, au-delà : distributeurs de travail
+
+inline uint16_t journalCheck(const JournalEvent &event) {
+    return rtcCrc32(reinterpret_cast<const uint8_t *>(&event), offsetof(JournalEvent, check)) & 0xFFFF;
+}
+
+inline uint32_t journalSnapshotCrc(const JournalSnapshot &snapshot) {
+    return rtcCrc32(reinterpret_cast<const uint8_t *>(&snapshot), offsetof(JournalSnapshot, crc));
+}
+
+/**
+ * Enregistrement d'une mutation, utilisable depuis un Ticker ou un callback
+ */
+inline void journalRecord(const JournalEventType type, const uint8_t id, const int32_t delta, const int32_t value) {
+    stateChanged(); // Stock modifié : les pages en cache sont périmées
+    if (id >= journalIdCount) return;
+    const uint8_t next = (journalHead + 1) % JOURNAL_QUEUE_SIZE;
+    if (next == journalTail) {
+        journalStats.dropped++;
+        journalLost = true; // Le rejeu ne peut plus reconstruire l'état : instantané au prochain flush
+        return;
+    }
+    JournalEvent &event = journalQueue[journalHead];
+    event.epochMs = nowEpochMs();
+    event.seq = ++journalSeq;
+    event.delta = delta;
+    event.value = value;
+    event.type = type;
+    event.id = id;
+    event.check = journalCheck(event);
+    journalHead = next;
+}
+
+/**
+ * Instantané de l'état, puis le journal courant devient l'ancien
+ */
+inline bool journalSnapshot(const int32_t *values, const uint8_t count) {
+    JournalSnapshot snapshot;
+    snapshot.seq = journalSeq;
+    snapshot.count = std::min<uint8_t>(count, JOURNAL_MAX_IDS);
+    snapshot.epochMs = nowEpochMs();
+    memcpy(snapshot.values, values, snapshot.count * sizeof(int32_t));
+    snapshot.crc = journalSnapshotCrc(snapshot);
+
+    File file = SPIFFS.open(JOURNAL_SNAPSHOT_TMP, "w");
+    if (!file) return false;
+    const bool ok = file.write(reinterpret_cast<const uint8_t *>(&snapshot), sizeof(snapshot)) == sizeof(snapshot);
+    file.close();
+    if (!ok || !SPIFFS.rename(JOURNAL_SNAPSHOT_TMP, JOURNAL_SNAPSHOT_FILE)) return false;
+
+    SPIFFS.remove(JOURNAL_OLD_FILE);
+    SPIFFS.rename(JOURNAL_EVENTS_FILE, JOURNAL_OLD_FILE);
+    journalSinceSnapshot = 0;
+    journalStats.snapshots++;
+    return true;
+}
+
+/**
+ * Écriture des événements en attente, à appeler dans la loop avec l'état courant
+ */
+inline void journalFlush(const int32_t *values, const uint8_t count) {
+    if (journalTail == journalHead && !journalLost) return;
+
+    HeapScope scope(HEAP_SPIFFS);
+    if (journalTail != journalHead) {
+        File file = SPIFFS.open(JOURNAL_EVENTS_FILE, "a");
+        if (!file) return;
+        while (journalTail != journalHead) {
+            file.write(reinterpret_cast<const uint8_t *>(&journalQueue[journalTail]), sizeof(JournalEvent));
+            journalTail = (journalTail + 1) % JOURNAL_QUEUE_SIZE;
+            journalStats.written++;
+            journalSinceSnapshot++;
+        }
+        file.close();
+    }
+
+    // Après une perte, l'instantané est refait à chaque flush jusqu'à ce qu'il soit écrit
+    const bool lost = journalLost;
+    if (lost || journalSinceSnapshot >= JOURNAL_SNAPSHOT_EVENTS) {
+        journalLost = false;
+        if (!journalSnapshot(values, count) && lost) journalLost = true;
+    }
+}
+
+/**
+ * Application des événements d'un fichier postérieurs à l'instantané
+ */
+inline bool journalReplayFile(const char *path, int32_t *values, const uint8_t count, const uint32_t after) {
+    File file = SPIFFS.open(path, "r");
+    if (!file) return false;
+
+    bool applied = false;
+    JournalEvent event;
+    while (file.read(reinterpret_cast<uint8_t *>(&event), sizeof(event)) == sizeof(event)) {
+        if (event.check != journalCheck(event)) {
+            journalStats.corrupt++;  // Écriture interrompue : la suite n'est pas fiable
+            break;
+        }
+        journalSeq = std::max(journalSeq, event.seq);
+        if (event.seq <= after || event.id >= count) continue;
+        values[event.id] = event.value;
+        journalStats.replayed++;
+        applied = true;
+    }
+    file.close();
+    return applied;
+}
+
+/**
+ * Reconstruction de l'état : instantané puis rejeu des événements
+ * @param values état courant (configuration), remplacé par l'état reconstruit
+ * @return true si l'état a été reconstruit à partir du journal
+ */
+inline bool journalReplay(int32_t *values, const uint8_t count) {
+    HeapScope scope(HEAP_SPIFFS);
+    SPIFFS.mkdir(JOURNAL_DIR);
+
+    bool restored = false;
+    uint32_t after = 0;
+    File file = SPIFFS.open(JOURNAL_SNAPSHOT_FILE, "r");
+    if (file) {
+        JournalSnapshot snapshot;
+        if (file.read(reinterpret_cast<uint8_t *>(&snapshot), sizeof(snapshot)) == sizeof(snapshot) &&
+            snapshot.crc == journalSnapshotCrc(snapshot)) {
+            memcpy(values, snapshot.values, std::min(count, snapshot.count) * sizeof(int32_t));
+            after = snapshot.seq;
+            journalSeq = snapshot.seq;
+            restored = true;
+        }
+        file.close();
+    }
+
+    restored |= journalReplayFile(JOURNAL_OLD_FILE, values, count, after);
+    restored |= journalReplayFile(JOURNAL_EVENTS_FILE, values, count, after);
+    MYDEBUG_PRINTLN("-JOURNAL : " + String(journalStats.replayed) + " événements rejoués après l'instantané " +
+        String(after) + ", séquence " + String(journalSeq));
+    return restored;
+}
+
+/**
+ * Diffusion des événements d'un fichier à partir de la séquence since
+ */
+inline void journalAuditFile(const char *path, const uint32_t since, uint16_t &remaining) {
+    File file = SPIFFS.open(path, "r");
+    if (!file) return;
+
+    JournalEvent event;
+    if (file.read(reinterpret_cast<uint8_t *>(&event), sizeof(event)) == sizeof(event) && since > event.seq) {
+        // Séquences contiguës dans un fichier : accès direct
+        file.seek((since - event.seq) * sizeof(JournalEvent));
+    } else {
+        file.seek(0);
+    }
+
+    char line[96];
+    while (remaining > 0 && file.read(reinterpret_cast<uint8_t *>(&event), sizeof(event)) == sizeof(event)) {
+        if (event.seq < since) continue;
+        const int n = snprintf(line, sizeof(line), "%u %llu %s %u %d %d%s\n", event.seq,
+                               static_cast<unsigned long long>(event.epochMs),
+                               event.type < JOURNAL_TYPE_COUNT ? journalTypeNames[event.type] : "?", event.id,
+                               event.delta, event.value, event.check == journalCheck(event) ? "" : " corrompu");
+        monWebServeur.sendContent(line, n);
+        remaining--;
+        yield();
+    }
+    file.close();
+}
+
+/**
+ * Fonction de gestion de la route /api/journal : seq epoch_ms type id delta valeur
+ */
+inline void handleApiJournal() {
+    HeapScope scope(HEAP_SPIFFS);
+    const uint32_t since = strtoul(monWebServeur.arg("since").c_str(), nullptr, 10);
+    uint16_t remaining = monWebServeur.hasArg("limit")
+                             ? std::min<uint32_t>(strtoul(monWebServeur.arg("limit").c_str(), nullptr, 10),
+                                                  JOURNAL_AUDIT_LIMIT)
+                             : JOURNAL_AUDIT_LIMIT;
+
+    monWebServeur.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    monWebServeur.send(200, "text/plain", "");
+    char head[128];
+    const int n = snprintf(head, sizeof(head), "# seq=%u ecrits=%u perdus=%u rejoues=%u corrompus=%u instantanes=%u\n",
+                           journalSeq, journalStats.written, journalStats.dropped, journalStats.replayed,
+                           journalStats.corrupt, journalStats.snapshots);
+    monWebServeur.sendContent(head, n);
+    journalAuditFile(JOURNAL_OLD_FILE, since, remaining);
+    journalAuditFile(JOURNAL_EVENTS_FILE, since, remaining);
+    monWebServeur.sendContent("");
+}
+
+inline void setupJournal() {
+    webOnSyncOnly("/api/journal", HTTP_GET, handleApiJournal);
+}
@@ -0,0 +1,516 @@
+/**
+ * \file MyLocalBroker.h
+ * \page localbroker Broker MQTT local
+ * \brief Un broker MQTT 3.1.1 minimal, dans le même processus, pour tester la chaîne sans io.adafruit.com
+ *
+ * Le broker se présente comme un Client Arduino : le client Adafruit_MQTT_Client lui écrit ses paquets
+ * exactement comme il le ferait sur un WiFiClient, et lit les réponses du broker dans le même flux.
+ * Aucune connexion réseau n'est ouverte, la chaîne commande → envoi → ready peut donc être mesurée
+ * sans dépendre d'un service externe.
+ *
+ * Fonctionnalités supportées :
+ * - CONNECT / CONNACK, PINGREQ / PINGRESP, DISCONNECT
+ * - SUBSCRIBE / SUBACK et UNSUBSCRIBE / UNSUBACK avec les jokers « + » et « # »
+ * - PUBLISH en QoS 0 et QoS 1 (PUBACK), dans les deux sens
+ * - Messages retenus (retain), renvoyés à chaque nouvelle souscription
+ * - Latence injectable : chaque trame émise par le broker n'est lisible qu'après setLatency() ms
+ *
+ * Activation : compiler avec -DMYMQTT_LOCAL_BROKER (environnement nodemcuv2_localbroker),
+ * MyMQTT.h utilise alors ce broker à la place du WiFiClient.
+ *
+ * Fichier \ref MyLocalBroker.h
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+
+#ifndef LOCAL_BROKER_MAX_SUBSCRIPTIONS
+#define LOCAL_BROKER_MAX_SUBSCRIPTIONS 16
+#endif
+#ifndef LOCAL_BROKER_MAX_RETAINED
+#define LOCAL_BROKER_MAX_RETAINED      16
+#endif
+#define LOCAL_BROKER_RX_SIZE           512   // Paquets reçus du client en cours d'assemblage
+#define LOCAL_BROKER_TX_SIZE           1024  // Trames en attente de lecture par le client
+#define LOCAL_BROKER_MAX_FRAMES        24    // Trames retenues par la latence injectée
+
+class MyLocalBroker : public Client {
+public:
+    typedef void (*PublishHook)(const char *topic, const uint8_t *payload, uint16_t len);
+
+    struct Stats {
+        uint32_t packetsIn = 0;     // Paquets reçus du client
+        uint32_t packetsOut = 0;    // Trames envoyées au client
+        uint32_t published = 0;    // PUBLISH reçus (client ou injectés)
+        uint32_t delivered = 0;    // PUBLISH remis aux souscriptions
+        uint32_t acked = 0;        // PUBACK reçus du client
+        uint32_t dropped = 0;      // Trames perdues faute de place
+    };
+
+private:
+    struct Subscription {
+        String filter;
+        uint8_t qos = 0;
+    };
+
+    struct Retained {
+        String topic;
+        String payload;
+    };
+
+    struct Frame {
+        unsigned long due;
+        uint16_t len;
+    };
+
+    uint8_t _rx[LOCAL_BROKER_RX_SIZE] = {};
+    uint16_t _rxLen = 0;
+
+    // Tampon linéaire : [_txStart, _txReleased) lisible, [_txReleased, _txEnd) retenu par la latence
+    uint8_t _tx[LOCAL_BROKER_TX_SIZE] = {};
+    uint16_t _txStart = 0;
+    uint16_t _txReleased = 0;
+    uint16_t _txEnd = 0;
+    Frame _frames[LOCAL_BROKER_MAX_FRAMES] = {};
+    uint8_t _frameHead = 0;
+    uint8_t _frameCount = 0;
+
+    Subscription _subs[LOCAL_BROKER_MAX_SUBSCRIPTIONS];
+    Retained _retained[LOCAL_BROKER_MAX_RETAINED];
+
+    bool _connected = false;
+    uint16_t _nextPacketId = 1;
+    unsigned long _latencyMs = 0;
+    PublishHook _hook = nullptr;
+    Stats _stats;
+
+    // Encodage / décodage de la "remaining length" (1 à 4 octets)
+    static uint8_t encodeLength(uint8_t *out, uint32_t len) {
+        uint8_t n = 0;
+        do {
+            uint8_t digit = len % 128;
+            len /= 128;
+            if (len > 0) digit |= 0x80;
+            out[n++] = digit;
+        } while (len > 0 && n < 4);
+        return n;
+    }
+
+    void releaseDueFrames() {
+        const unsigned long now = millis();
+        while (_frameCount > 0 && static_cast<long>(now - _frames[_frameHead].due) >= 0) {
+            _txReleased += _frames[_frameHead].len;
+            _frameHead = (_frameHead + 1) % LOCAL_BROKER_MAX_FRAMES;
+            _frameCount--;
+        }
+    }
+
+    void compactTx() {
+        if (_txStart == 0) return;
+        memmove(_tx, _tx + _txStart, _txEnd - _txStart);
+        _txReleased -= _txStart;
+        _txEnd -= _txStart;
+        _txStart = 0;
+    }
+
+    // Mise en file d'une trame vers le client, visible après la latence injectée ; false si elle est perdue
+    bool enqueue(const uint8_t header, const uint8_t *body1, const uint16_t len1,
+                 const uint8_t *body2 = nullptr, const uint16_t len2 = 0) {
+        uint8_t lenBytes[4];
+        const uint8_t nLen = encodeLength(lenBytes, len1 + len2);
+        const uint16_t total = 1 + nLen + len1 + len2;
+
+        if (_txEnd + total > LOCAL_BROKER_TX_SIZE) compactTx();
+        if (_txEnd + total > LOCAL_BROKER_TX_SIZE || _frameCount >= LOCAL_BROKER_MAX_FRAMES) {
+            _stats.dropped++;
+            return false;
+        }
+
+        _tx[_txEnd++] = header;
+        memcpy(_tx + _txEnd, lenBytes, nLen);
+        _txEnd += nLen;
+        if (len1) memcpy(_tx + _txEnd, body1, len1);
+        _txEnd += len1;
+        if (len2) memcpy(_tx + _txEnd, body2, len2);
+        _txEnd += len2;
+
+        const uint8_t slot = (_frameHead + _frameCount) % LOCAL_BROKER_MAX_FRAMES;
+        _frames[slot].due = millis() + _latencyMs;
+        _frames[slot].len = total;
+        _frameCount++;
+        _stats.packetsOut++;
+        return true;
+    }
+
+    void sendAck(const uint8_t header, const uint16_t packetId) {
+        const uint8_t body[2] = {static_cast<uint8_t>(packetId >> 8), static_cast<uint8_t>(packetId & 0xFF)};
+        enqueue(header, body, 2);
+    }
+
+    void deliver(const String &topic, const uint8_t *payload, const uint16_t len, const uint8_t qos,
+                 const bool retain) {
+        if (!_connected) return;
+
+        uint8_t head[2 + 128 + 2];
+        const uint16_t topicLen = topic.length();
+        if (topicLen > 128) {
+            _stats.dropped++;
+            return;
+        }
+        uint16_t n = 0;
+        head[n++] = topicLen >> 8;
+        head[n++] = topicLen & 0xFF;
+        memcpy(head + n, topic.c_str(), topicLen);
+        n += topicLen;
+        if (qos > 0) {
+            const uint16_t id = _nextPacketId++;
+            if (_nextPacketId == 0) _nextPacketId = 1;
+            head[n++] = id >> 8;
+            head[n++] = id & 0xFF;
+        }
+        const uint8_t header = (PKT_PUBLISH << 4) | (qos > 0 ? 0x02 : 0x00) | (retain ? 0x01 : 0x00);
+        if (enqueue(header, head, n, payload, len)) _stats.delivered++;
+    }
+
+    void route(const String &topic, const uint8_t *payload, const uint16_t len, const uint8_t qos,
+               const bool retain) {
+        _stats.published++;
+
+        if (retain) {
+            storeRetained(topic, payload, len);
+        }
+
+        for (const auto &sub: _subs) {
+            if (sub.filter.length() > 0 && topicMatches(sub.filter.c_str(), topic.c_str())) {
+                deliver(topic, payload, len, std::min(qos, sub.qos), false);
+            }
+        }
+    }
+
+    void storeRetained(const String &topic, const uint8_t *payload, const uint16_t len) {
+        Retained *freeSlot = nullptr;
+        for (auto &r: _retained) {
+            if (r.topic == topic) {
+                // Un payload vide efface le message retenu (MQTT 3.1.1 §3.3.1.3)
+                if (len == 0) {
+                    r.topic = "";
+                    r.payload = "";
+                } else {
+                    r.payload = "";
+                    r.payload.concat(reinterpret_cast<const char *>(payload), len);
+                }
+                return;
+            }
+            if (!freeSlot && r.topic.length() == 0) freeSlot = &r;
+        }
+        if (len == 0) return;
+        if (!freeSlot) {
+            _stats.dropped++;
+            return;
+        }
+        freeSlot->topic = topic;
+        freeSlot->payload.concat(reinterpret_cast<const char *>(payload), len);
+    }
+
+    void handleConnect() {
+        // Session propre à chaque connexion : les souscriptions sont oubliées, les retenus conservés
+        for (auto &sub: _subs) sub.filter = "";
+        const uint8_t body[2] = {0x00, 0x00}; // Pas de session présente, connexion acceptée
+        enqueue(PKT_CONNACK << 4, body, 2);
+    }
+
+    void handlePublish(const uint8_t flags, const uint8_t *p, const uint16_t len) {
+        const uint8_t qos = (flags >> 1) & 0x03;
+        const bool retain = flags & 0x01;
+        if (len < 2) return;
+
+        const uint16_t topicLen = (p[0] << 8) | p[1];
+        if (2u + topicLen > len) return;
+        uint16_t offset = 2 + topicLen;
+
+        String topic;
+        topic.concat(reinterpret_cast<const char *>(p + 2), topicLen);
+
+        uint16_t packetId = 0;
+        if (qos > 0) {
+            if (offset + 2 > len) return;
+            packetId = (p[offset] << 8) | p[offset + 1];
+            offset += 2;
+        }
+
+        const uint8_t *payload = p + offset;
+        const uint16_t payloadLen = len - offset;
+
+        if (qos == 1) {
+            sendAck(PKT_PUBACK << 4, packetId);
+        }
+        if (_hook) {
+            _hook(topic.c_str(), payload, payloadLen);
+        }
+        route(topic, payload, payloadLen, qos > 1 ? 1 : qos, retain);
+    }
+
+    void handleSubscribe(const uint8_t *p, const uint16_t len) {
+        if (len < 2) return;
+        const uint16_t packetId = (p[0] << 8) | p[1];
+        uint8_t granted[8];
+        int8_t slots[sizeof(granted)];
+        uint8_t nGranted = 0;
+        uint16_t offset = 2;
+
+        while (offset + 2 < len && nGranted < sizeof(granted)) {
+            const uint16_t filterLen = (p[offset] << 8) | p[offset + 1];
+            offset += 2;
+            if (offset + filterLen >= len) break;
+            String filter;
+            filter.concat(reinterpret_cast<const char *>(p + offset), filterLen);
+            offset += filterLen;
+            const uint8_t qos = std::min<uint8_t>(p[offset++] & 0x03, 1);
+
+            slots[nGranted] = addSubscription(filter, qos);
+            granted[nGranted] = slots[nGranted] >= 0 ? qos : 0x80;
+            nGranted++;
+        }
+
+        uint8_t body[2 + sizeof(granted)];
+        body[0] = packetId >> 8;
+        body[1] = packetId & 0xFF;
+        memcpy(body + 2, granted, nGranted);
+        enqueue(PKT_SUBACK << 4, body, 2 + nGranted);
+
+        // Envoi des messages retenus correspondant aux filtres de ce SUBSCRIBE uniquement
+        for (const auto &r: _retained) {
+            if (r.topic.length() == 0) continue;
+            for (uint8_t i = 0; i < nGranted; i++) {
+                if (slots[i] < 0) continue;
+                const Subscription &sub = _subs[slots[i]];
+                if (topicMatches(sub.filter.c_str(), r.topic.c_str())) {
+                    deliver(r.topic, reinterpret_cast<const uint8_t *>(r.payload.c_str()), r.payload.length(),
+                            sub.qos, true);
+                    break;
+                }
+            }
+        }
+    }
+
+    void handleUnsubscribe(const uint8_t *p, const uint16_t len) {
+        if (len < 2) return;
+        const uint16_t packetId = (p[0] << 8) | p[1];
+        uint16_t offset = 2;
+        while (offset + 2 <= len) {
+            const uint16_t filterLen = (p[offset] << 8) | p[offset + 1];
+            offset += 2;
+            if (offset + filterLen > len) break;
+            String filter;
+            filter.concat(reinterpret_cast<const char *>(p + offset), filterLen);
+            offset += filterLen;
+            for (auto &sub: _subs) {
+                if (sub.filter == filter) sub.filter = "";
+            }
+        }
+        sendAck(PKT_UNSUBACK << 4, packetId);
+    }
+
+    // Ajout ou mise à jour d'une souscription, renvoie son emplacement ou -1 si la table est pleine
+    int8_t addSubscription(const String &filter, const uint8_t qos) {
+        int8_t freeSlot = -1;
+        for (uint8_t i = 0; i < LOCAL_BROKER_MAX_SUBSCRIPTIONS; i++) {
+            if (_subs[i].filter == filter) {
+                _subs[i].qos = qos;
+                return i;
+            }
+            if (freeSlot < 0 && _subs[i].filter.length() == 0) freeSlot = i;
+        }
+        if (freeSlot < 0) return -1;
+        _subs[freeSlot].filter = filter;
+        _subs[freeSlot].qos = qos;
+        return freeSlot;
+    }
+
+    void handlePacket(const uint8_t *packet, const uint8_t headerLen, const uint16_t bodyLen) {
+        _stats.packetsIn++;
+        const uint8_t type = packet[0] >> 4;
+        const uint8_t flags = packet[0] & 0x0F;
+        const uint8_t *body = packet + headerLen;
+
+        switch (type) {
+            case PKT_CONNECT: handleConnect();
+                break;
+            case PKT_PUBLISH: handlePublish(flags, body, bodyLen);
+                break;
+            case PKT_PUBACK: _stats.acked++;
+                break;
+            case PKT_SUBSCRIBE: handleSubscribe(body, bodyLen);
+                break;
+            case PKT_UNSUBSCRIBE: handleUnsubscribe(body, bodyLen);
+                break;
+            case PKT_PINGREQ: enqueue(PKT_PINGRESP << 4, nullptr, 0);
+                break;
+            case PKT_DISCONNECT: _connected = false;
+                break;
+            default: break;
+        }
+    }
+
+    // Découpe du flux reçu en paquets complets
+    void parseIncoming() {
+        while (_rxLen >= 2) {
+            uint32_t remaining = 0;
+            uint32_t multiplier = 1;
+            uint8_t i = 1;
+            bool complete = false;
+            while (i < _rxLen && i <= 4) {
+                const uint8_t digit = _rx[i++];
+                remaining += (digit & 0x7F) * multiplier;
+                multiplier *= 128;
+                if ((digit & 0x80) == 0) {
+                    complete = true;
+                    break;
+                }
+            }
+            if (!complete) {
+                if (i > 4) _rxLen = 0; // Longueur invalide : on abandonne le flux
+                return;
+            }
+
+            const uint32_t total = i + remaining;
+            if (total > LOCAL_BROKER_RX_SIZE) {
+                _stats.dropped++;
+                _rxLen = 0;
+                return;
+            }
+            if (_rxLen < total) return;
+
+            handlePacket(_rx, i, remaining);
+            memmove(_rx, _rx + total, _rxLen - total);
+            _rxLen -= total;
+        }
+    }
+
+public:
+    enum PacketType : uint8_t {
+        PKT_CONNECT = 1, PKT_CONNACK = 2, PKT_PUBLISH = 3, PKT_PUBACK = 4,
+        PKT_SUBSCRIBE = 8, PKT_SUBACK = 9, PKT_UNSUBSCRIBE = 10, PKT_UNSUBACK = 11,
+        PKT_PINGREQ = 12, PKT_PINGRESP = 13, PKT_DISCONNECT = 14
+    };
+
+    /**
+     * Correspondance d'un topic avec un filtre MQTT (« + » : un niveau, « # » : tous les niveaux suivants)
+     */
+    static bool topicMatches(const char *filter, const char *topic) {
+        while (*filter) {
+            if (*filter == '#') return true;
+            if (*filter == '+') {
+                while (*topic && *topic != '/') topic++;
+                filter++;
+                continue;
+            }
+            if (*filter != *topic) {
+                // "a/#" correspond aussi au niveau parent "a"
+                return *topic == '\0' && filter[0] == '/' && filter[1] == '#' && filter[2] == '\0';
+            }
+            filter++;
+            topic++;
+        }
+        return *topic == '\0';
+    }
+
+    // Configuration
+    void setLatency(const unsigned long ms) { _latencyMs = ms; }
+    [[nodiscard]] unsigned long getLatency() const { return _latencyMs; }
+    void setPublishHook(const PublishHook hook) { _hook = hook; }
+    [[nodiscard]] const Stats &getStats() const { return _stats; }
+    void resetStats() { _stats = Stats(); }
+
+    /**
+     * Publication par un client externe simulé (tableau de bord, autre carte...)
+     */
+    void inject(const char *topic, const char *payload, const uint8_t qos = 1, const bool retain = false) {
+        route(String(topic), reinterpret_cast<const uint8_t *>(payload), strlen(payload), qos, retain);
+    }
+
+    // Compatibilité avec WiFiClient utilisé par setupMQTT()
+    void setNoDelay(bool) {
+    }
+
+    // Interface Client
+    int connect(IPAddress, uint16_t) override {
+        return connect("", 0);
+    }
+
+    int connect(const char *, uint16_t) override {
+        _rxLen = 0;
+        _txStart = _txReleased = _txEnd = 0;
+        _frameHead = _frameCount = 0;
+        _connected = true;
+        return 1;
+    }
+
+    size_t write(const uint8_t b) override {
+        return write(&b, 1);
+    }
+
+    size_t write(const uint8_t *buf, const size_t size) override {
+        if (!_connected) return 0;
+        size_t written = 0;
+        while (written < size) {
+            const size_t chunk = std::min<size_t>(size - written, LOCAL_BROKER_RX_SIZE - _rxLen);
+            if (chunk == 0) {
+                // Paquet plus grand que le tampon : abandon
+                _stats.dropped++;
+                _rxLen = 0;
+                return written;
+            }
+            memcpy(_rx + _rxLen, buf + written, chunk);
+            _rxLen += chunk;
+            written += chunk;
+            parseIncoming();
+        }
+        return written;
+    }
+
+    int available() override {
+        releaseDueFrames();
+        return _txReleased - _txStart;
+    }
+
+    int read() override {
+        if (available() <= 0) return -1;
+        const uint8_t b = _tx[_txStart++];
+        if (_txStart == _txEnd) {
+            _txStart = _txReleased = _txEnd = 0;
+        }
+        return b;
+    }
+
+    int read(uint8_t *buf, const size_t size) override {
+        size_t n = 0;
+        while (n < size && available() > 0) {
+            buf[n++] = read();
+        }
+        return n;
+    }
+
+    int peek() override {
+        return available() > 0 ? _tx[_txStart] : -1;
+    }
+
+    void flush() override {
+    }
+
+    void stop() override {
+        _connected = false;
+        _rxLen = 0;
+        _txStart = _txReleased = _txEnd = 0;
+        _frameHead = _frameCount = 0;
+    }
+
+    uint8_t connected() override {
+        return _connected || available() > 0;
+    }
+
+    operator bool() override {
+        return _connected;
+    }
+};
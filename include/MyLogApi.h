@@ -0,0 +1,221 @@
+/**
+ * \file MyLogApi.h
+ * \page logapi API des logs
+ * \brief GET /api/logs : enregistrements plus récents qu'un curseur, en NDJSON, avec long-poll
+ *
+ * /debug n'affiche que les LOG_BUFFER_SIZE dernières lignes, en HTML : ce qui est plus ancien est
+ * perdu et la page n'est pas exploitable par un outil. Chaque ligne de log est un enregistrement
+ * numéroté (seq, voir MyDebug.h) avec un niveau et un module (préfixe « -MODULE : »). La route
+ * \code
+ * GET /api/logs?since=<seq>&level=warn&module=OTA&wait=20000
+ * \endcode
+ * rend, une ligne JSON par enregistrement, ceux dont le numéro est supérieur à since :
+ * \code
+ * {"seq":42,"ms":81234,"level":"warn","module":"WIFI","msg":"-WIFI : Association directe échouée, balayage"}
+ * \endcode
+ * - level : niveau minimal (info, warn, error) ; module : module exact, sans tenir compte de la casse ;
+ * - l'en-tête X-Log-Next donne le curseur de la requête suivante : il avance aussi sur les
+ *   enregistrements écartés par les filtres, un collecteur ne reçoit jamais deux fois le même ;
+ * - wait (ms, au plus LOG_API_WAIT_MAX_MS) : long-poll. Sans enregistrement à rendre, la réponse est
+ *   différée jusqu'au premier qui passe les filtres ou jusqu'à la fin de l'attente (corps vide) ;
+ * - des enregistrements écrasés dans le tampon circulaire ou non gardés (tas sous pression) sont
+ *   signalés à leur place par {"lost":n,"before":seq} ; {"restart":true} signale un curseur plus
+ *   récent que le dernier enregistrement : la carte a redémarré, tout le tampon est rendu ;
+ * - une réponse ne dépasse pas LOG_API_MAX_BYTES : la suite vient à la requête suivante.
+ *
+ * Un collecteur suit la carte en bouclant sur since=0, puis since=<X-Log-Next de la réponse
+ * précédente>, avec wait=20000 : une requête ouverte à la fois, rien n'est transféré deux fois.
+ *
+ * Le long-poll utilise les réponses différées du serveur asynchrone (MyAsyncWeb.h) : l'attente n'occupe
+ * pas la loop, qui vérifie les requêtes en attente à chaque itération (loopLogApi()). Sans
+ * WEB_ASYNC, la route est servie par ESP8266WebServer, sans attente.
+ *
+ * Fichier \ref MyLogApi.h
+ */
+#pragma once
+
+#include "MyDebug.h"
+#include "MyWebServer.h"
+
+#define LOG_API_MAX_BYTES     4096
+#define LOG_API_WAIT_MAX_MS   20000   // Sous ASYNC_WEB_DEFER_MAX_MS
+#define LOG_API_TYPE          "application/x-ndjson"
+
+struct LogQuery {
+    uint32_t since = 0;
+    LogLevel level = LOG_INFO;              // Niveau minimal
+    char module[LOG_MODULE_SIZE] = "";      // Vide : tous les modules
+};
+
+struct LogWaiter {
+    bool used = false;
+    AsyncWebDeferred deferred;
+    LogQuery query;
+    unsigned long since = 0;
+    uint32_t waitMs = 0;
+};
+
+inline LogWaiter logWaiters[ASYNC_WEB_MAX_CLIENTS];
+
+/**
+ * Paramètres de la requête, false si level est inconnu
+ */
+inline bool logQueryParse(const String &since, const String &level, const String &module, LogQuery &query) {
+    query.since = strtoul(since.c_str(), nullptr, 10);
+    if (level.length()) {
+        uint8_t l = 0;
+        while (l < LOG_LEVEL_COUNT && !level.equalsIgnoreCase(logLevelNames[l])) l++;
+        if (l == LOG_LEVEL_COUNT) return false;
+        query.level = static_cast<LogLevel>(l);
+    }
+    strlcpy(query.module, module.c_str(), sizeof(query.module));
+    return true;
+}
+
+inline bool logQueryMatch(const LogQuery &query, const LogRecord &record) {
+    return record.level >= query.level && (!query.module[0] || strcasecmp(query.module, record.module) == 0);
+}
+
+inline void logJsonEscape(String &out, const String &text) {
+    for (size_t i = 0; i < text.length(); i++) {
+        const char c = text[i];
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<uint8_t>(c) < 0x20) {
+            char escaped[7];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<uint8_t>(c));
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+}
+
+/**
+ * Lignes NDJSON des enregistrements postérieurs au curseur, directement depuis le tampon circulaire
+ * @param next curseur de la requête suivante
+ * @return nombre de lignes écrites
+ */
+inline uint16_t logApiRender(const LogQuery &query, String &out, uint32_t &next) {
+    char line[96];
+    uint16_t lines = 0;
+    uint32_t since = query.since;
+    if (since > logSeq) {
+        out += "{\"restart\":true}\n";
+        lines++;
+        since = 0;
+    }
+    next = since;
+    uint32_t expected = since + 1;
+    for (int i = 0; i < LOG_BUFFER_SIZE; i++) {
+        const LogRecord &record = logBuffer[(logIndex + i) % LOG_BUFFER_SIZE];
+        if (record.seq <= since) continue;
+        if (out.length() + record.text.length() + sizeof(line) > LOG_API_MAX_BYTES && lines > 0) return lines;
+        if (record.seq > expected) {
+            snprintf(line, sizeof(line), "{\"lost\":%u,\"before\":%u}\n", record.seq - expected, record.seq);
+            out += line;
+            lines++;
+        }
+        expected = record.seq + 1;
+        next = record.seq;
+        if (!logQueryMatch(query, record)) continue;
+        snprintf(line, sizeof(line), "{\"seq\":%u,\"ms\":%u,\"level\":\"%s\",\"module\":\"%s\",\"msg\":\"", record.seq,
+                 record.ms, logLevelNames[record.level], record.module);
+        out += line;
+        logJsonEscape(out, record.text);
+        out += "\"}\n";
+        lines++;
+    }
+    // Derniers numéros non gardés (tas sous pression)
+    if (logSeq >= expected) {
+        snprintf(line, sizeof(line), "{\"lost\":%u,\"before\":%u}\n", logSeq - expected + 1, logSeq + 1);
+        out += line;
+        lines++;
+    }
+    next = logSeq;
+    return lines;
+}
+
+inline String logApiHeaders(const uint32_t next) {
+    return "X-Log-Next: " + String(next) + "\r\n";
+}
+
+inline void asyncHandleApiLogs(AsyncWebRequest &request) {
+    if (asyncHeapUnavailable(request)) return;
+    LogWaiter waiter;
+    if (!logQueryParse(request.arg("since"), request.arg("level"), request.arg("module"), waiter.query)) {
+        request.send(400, "text/plain", "Paramètre level invalide (info, warn, error)\n");
+        return;
+    }
+    waiter.waitMs = std::min<uint32_t>(strtoul(request.arg("wait").c_str(), nullptr, 10), LOG_API_WAIT_MAX_MS);
+
+    String out;
+    uint32_t next;
+    const uint16_t lines = logApiRender(waiter.query, out, next);
+    LogWaiter *slot = nullptr;
+    for (LogWaiter &candidate: logWaiters) {
+        if (!candidate.used) slot = &candidate;
+    }
+    if (lines > 0 || waiter.waitMs == 0 || !slot) {
+        request.addHeader("X-Log-Next", String(next));
+        request.send(200, LOG_API_TYPE, std::move(out));
+        return;
+    }
+
+    // Rien à rendre : attente du prochain enregistrement, le tampon déjà parcouru n'est pas relu
+    waiter.used = true;
+    waiter.query.since = next;
+    waiter.since = millis();
+    waiter.deferred = request.defer();
+    *slot = waiter;
+}
+
+/**
+ * Requêtes en attente : réponse au premier enregistrement qui passe les filtres, ou à la fin de l'attente
+ */
+inline void loopLogApi() {
+    for (LogWaiter &waiter: logWaiters) {
+        if (!waiter.used) continue;
+        if (!asyncWebDeferredAlive(waiter.deferred)) {
+            waiter.used = false; // Client parti
+            continue;
+        }
+        String out;
+        uint32_t next = waiter.query.since;
+        if (logSeq != waiter.query.since && logApiRender(waiter.query, out, next) == 0) {
+            waiter.query.since = next; // Enregistrements écartés par les filtres
+        }
+        if (out.length() == 0 && millis() - waiter.since < waiter.waitMs) continue;
+        asyncWebRespond(waiter.deferred, 200, LOG_API_TYPE, std::move(out), logApiHeaders(next));
+        waiter.used = false;
+    }
+}
+
+/**
+ * Route /api/logs sur ESP8266WebServer (sans WEB_ASYNC) : pas d'attente
+ */
+inline void handleApiLogs() {
+    if (heapShedWeb()) {
+        sendHeapUnavailable();
+        return;
+    }
+    LogQuery query;
+    if (!logQueryParse(monWebServeur.arg("since"), monWebServeur.arg("level"), monWebServeur.arg("module"), query)) {
+        monWebServeur.send(400, "text/plain", "Paramètre level invalide (info, warn, error)\n");
+        return;
+    }
+    String out;
+    uint32_t next;
+    logApiRender(query, out, next);
+    monWebServeur.sendHeader("X-Log-Next", String(next));
+    monWebServeur.send(200, LOG_API_TYPE, out);
+}
+
+inline void setupLogApi() {
+#if WEB_ASYNC
+    asyncWebOn("/api/logs", HTTP_GET, asyncHandleApiLogs);
+#else
+    monWebServeur.on("/api/logs", HTTP_GET, handleApiLogs);
+#endif
+}
@@ -109,29 +109,50 @@
 //IO_USERNAME est ton nom sur adafruitIO
 //IO_KEY est ta clé sur adafruitIO
 // Feeds
+#define FEED_PREFIX       "/feeds/"
+#define FEED_ALL          FEED_PREFIX "#"   // Une seule souscription joker pour tous les feeds
+#define FEED_KEY(feed)    ((feed) + sizeof(FEED_PREFIX) - 1) // "/feeds/commande" -> "commande"
 #define FEED_NB_RATION_CROQUETTE       "/feeds/croquette.nbration"
 #define FEED_NB_RATION_POISSON_ROUGE       "/feeds/poisson-rouge.nbration"
 #define FEED_NB_RATION_ACHIGAN       "/feeds/achigan.nbration"
 #define FEED_NB_RATION_RESTO       "/feeds/resto.nbration"
 #define FEED_COMMANDE       "/feeds/commande"
 #define FEED_READY       "/feeds/ready"
+#define FEED_REMOTE_EAT     "/feeds/remote.eat"     // Demandes d'un distributeur dont le précédent est sur une autre carte
+#define FEED_REMOTE_REPLY   "/feeds/remote.reply"   // Réponses du distributeur précédent
+#define FEED_TXN            "/feeds/transaction"     // Mises à jour de plusieurs feeds en un seul message
+#define FEED_COURANT        "/feeds/courant"         // Courant moyen estimé (mA), voir MySleep.h
 #include <ESP8266WiFi.h>
 #include <Ticker.h>
 #include <WiFiClient.h>
 
 #include "Adafruit_MQTT_Client.h"
 #include "MyDebug.h"
+#include "MyMQTTMux.h"
+#include "MyWatchdog.h"
 
 /************************** Variables ****************************************/
+#ifdef MYMQTT_LOCAL_BROKER
+// Broker MQTT local dans le même processus (tests et benchmarks sans io.adafruit.com)
+#include "MyLocalBroker.h"
+inline MyLocalBroker client;
+#else
 // Instanciation du client WiFi qui servira à se connecter au broker Adafruit
 inline WiFiClient client;
+#endif
 // Instanciation du client Adafruit avec les informations de connexion
 // En haut du fichier Distributeur.h
 #define MQTT_TIMEOUT_MS     5000
 #define MQTT_MAX_PACKET_SIZE 1024
 
+// Multiplexeur entre le transport et la bibliothèque : aiguillage des PUBLISH vers les handlers
+inline MyMqttMux mqttMux(client, IO_USERNAME FEED_PREFIX);
+
 // Dans la création du client MQTT
-inline Adafruit_MQTT_Client MyAdafruitMqtt(&client, IO_SERVER, IO_SERVERPORT, IO_USERNAME, IO_USERNAME, IO_KEY);
+inline Adafruit_MQTT_Client MyAdafruitMqtt(&mqttMux, IO_SERVER, IO_SERVERPORT, IO_USERNAME, IO_USERNAME, IO_KEY);
+
+// Souscription unique à tous les feeds, les messages sont aiguillés par mqttMux
+inline Adafruit_MQTT_Subscribe subFeeds = Adafruit_MQTT_Subscribe(&MyAdafruitMqtt, IO_USERNAME FEED_ALL, MQTT_QOS_1);
 
 inline void setupMQTT() {
     client.setTimeout(MQTT_TIMEOUT_MS);
@@ -139,30 +160,17 @@ inline void setupMQTT() {
 
     // Configuration supplémentaire pour le client MQTT
     MyAdafruitMqtt.setKeepAliveInterval(30); // 30 secondes
+    // La bibliothèque n'envoie le SUBSCRIBE que dans connect() : inscription avant la première connexion
+    MyAdafruitMqtt.subscribe(&subFeeds);
 }
 
 
 // Variable de stockage de la valeur du slider
 inline Ticker MyAdafruitTicker;
 /****************************** Feeds ****************************************/
-// Création des Feed auxquels nous allons souscrire :
 
-inline Adafruit_MQTT_Subscribe subNbRationCroquette = Adafruit_MQTT_Subscribe(&MyAdafruitMqtt,
-                                                                              IO_USERNAME FEED_NB_RATION_CROQUETTE,
-                                                                              MQTT_QOS_1);
-inline Adafruit_MQTT_Subscribe subNbRationPoissonRouge = Adafruit_MQTT_Subscribe(&MyAdafruitMqtt,
-    IO_USERNAME FEED_NB_RATION_POISSON_ROUGE,
-    MQTT_QOS_1);
-inline Adafruit_MQTT_Subscribe subNbRationAchigan = Adafruit_MQTT_Subscribe(&MyAdafruitMqtt,
-                                                                            IO_USERNAME FEED_NB_RATION_ACHIGAN,
-                                                                            MQTT_QOS_1);
-inline Adafruit_MQTT_Subscribe subNbRationResto = Adafruit_MQTT_Subscribe(
-    &MyAdafruitMqtt, IO_USERNAME FEED_NB_RATION_RESTO,
-    MQTT_QOS_1);
-inline Adafruit_MQTT_Subscribe subCommande = Adafruit_MQTT_Subscribe(&MyAdafruitMqtt, IO_USERNAME FEED_COMMANDE,
-                                                                     MQTT_QOS_1);
-inline Adafruit_MQTT_Subscribe subReady = Adafruit_MQTT_Subscribe(&MyAdafruitMqtt, IO_USERNAME FEED_READY,
-                                                                  MQTT_QOS_1);
+// Dernière valeur reçue sur le feed ready
+inline volatile int lastReadyValue = 0;
 
 inline Adafruit_MQTT_Publish pubNbRationCroquette = Adafruit_MQTT_Publish(&MyAdafruitMqtt,
                                                                           IO_USERNAME FEED_NB_RATION_CROQUETTE);
@@ -174,68 +182,56 @@ inline Adafruit_MQTT_Publish pubNbRationResto =
         Adafruit_MQTT_Publish(&MyAdafruitMqtt, IO_USERNAME FEED_NB_RATION_RESTO);
 inline Adafruit_MQTT_Publish pubCommande = Adafruit_MQTT_Publish(&MyAdafruitMqtt, IO_USERNAME FEED_COMMANDE);
 inline Adafruit_MQTT_Publish pubReady = Adafruit_MQTT_Publish(&MyAdafruitMqtt, IO_USERNAME FEED_READY);
+inline Adafruit_MQTT_Publish pubTransaction = Adafruit_MQTT_Publish(&MyAdafruitMqtt, IO_USERNAME FEED_TXN);
+
+// Identifiant de la carte dans les messages échangés entre cartes : ChipId en hexadécimal
+#define MQTT_NODE_ID_SIZE   9
+
+inline const char *mqttNodeId() {
+    static char id[MQTT_NODE_ID_SIZE] = "";
+    if (!id[0]) snprintf(id, sizeof(id), "%x", ESP.getChipId());
+    return id;
+}
 
-inline Ticker croquetteTicker;
-inline Ticker poissonRougeTicker;
-inline Ticker achiganTicker;
-inline Ticker achiganRestoTicker;
 
+/**
+ * Une tentative de connexion au broker, au plus toutes les 15 s, sans attente : en cas d'échec, la
+ * tentative suivante vient de loopDistributeur(). Seul connect() bloque, borné par les délais de la
+ * bibliothèque, et le watchdog de la loop est nourri juste avant.
+ */
 inline void connectAdafruitIO() {
+    static bool attempted = false;
     static unsigned long lastAttempt = 0;
     constexpr unsigned long retryInterval = 15000;
 
     unsigned long now = millis();
-    if (now - lastAttempt < retryInterval) {
+    if (attempted && now - lastAttempt < retryInterval) {
         return;
     }
+    attempted = true;
     lastAttempt = now;
 
+#ifndef MYMQTT_LOCAL_BROKER
     // Vérification du WiFi
     if (WiFi.status() != WL_CONNECTED) {
         MYDEBUG_PRINTLN("WiFi non connecté");
         return;
     }
+#endif
 
     MYDEBUG_PRINT("-AdafruitIO : Connexion au broker... ");
 
     // Nettoyage des connexions existantes
-    client.stop();
-    delay(1000);
-
-    // Tentative de connexion avec plus de détails
-    int8_t ret = MyAdafruitMqtt.connect();
-    uint8_t retries = 3;
+    mqttMux.stop();
 
-    while (retries--) {
-        ret = MyAdafruitMqtt.connect();
-        if (ret == 0) break;
-
-        MYDEBUG_PRINT("\nErreur de connexion (");
-        MYDEBUG_PRINT(ret);
-        MYDEBUG_PRINT("): ");
-        MYDEBUG_PRINTLN(MyAdafruitMqtt.connectErrorString(ret));
-        delay(2000);
-    }
+    loopWatchdogFeed();
+    const int8_t ret = MyAdafruitMqtt.connect();
 
     if (ret == 0) {
         MYDEBUG_PRINTLN("OK");
-
-        // Configuration des souscriptions
-        if (!MyAdafruitMqtt.subscribe(&subNbRationCroquette))
-            MYDEBUG_PRINTLN("Échec sub croquette");
-        if (!MyAdafruitMqtt.subscribe(&subNbRationPoissonRouge))
-            MYDEBUG_PRINTLN("Échec sub poisson rouge");
-        if (!MyAdafruitMqtt.subscribe(&subNbRationAchigan))
-            MYDEBUG_PRINTLN("Échec sub achigan");
-        if (!MyAdafruitMqtt.subscribe(&subNbRationResto))
-            MYDEBUG_PRINTLN("Échec sub resto");
-        if (!MyAdafruitMqtt.subscribe(&subCommande))
-            MYDEBUG_PRINTLN("Échec sub commande");
-        if (!MyAdafruitMqtt.subscribe(&subReady))
-            MYDEBUG_PRINTLN("Échec sub ready");
         MYDEBUG_PRINTLN("=== Connexion Adafruit IO réussie ===");
     } else {
-        MYDEBUG_PRINTLN("=== Échec de connexion Adafruit IO ===");
+        MYDEBUG_WARNLN("=== Échec de connexion Adafruit IO ===");
         MYDEBUG_PRINTLN("Code d'erreur : " + String(ret));
         MYDEBUG_PRINTLN("Détail : " + String(MyAdafruitMqtt.connectErrorString(ret)));
     }
@@ -252,7 +248,7 @@ inline bool ensureConnected() {
 
 inline void publishToMQTT(const char *feed, const String &value) {
     if (!ensureConnected()) {
-        MYDEBUG_PRINTLN("Échec de la connexion MQTT");
+        MYDEBUG_WARNLN("Échec de la connexion MQTT");
         return;
     }
 
@@ -265,7 +261,7 @@ inline void publishToMQTT(const char *feed, const String &value) {
 
     if (publisher) {
         if (!publisher->publish(value.c_str())) {
-            MYDEBUG_PRINTLN("Échec de la publication MQTT");
+            MYDEBUG_WARNLN("Échec de la publication MQTT");
         } else {
             MYDEBUG_PRINTLN("Publication MQTT réussie : " + String(feed) + " = " + value);
         }
@@ -274,17 +270,18 @@ inline void publishToMQTT(const char *feed, const String &value) {
 
 inline int getReadyCount() {
     if (!ensureConnected()) {
-        MYDEBUG_PRINTLN("Échec de la connexion MQTT");
+        MYDEBUG_WARNLN("Échec de la connexion MQTT");
         return 0;
     }
 
-    // Vérifie s'il y a des données disponibles sur le feed ready
-    const Adafruit_MQTT_Subscribe *subscription = &subReady;
-
-    // Lecture de la dernière valeur
-    if (const auto readyValue = reinterpret_cast<const char *>(subscription->lastread)) {
-        return atoi(readyValue);
-    }
+    // Dernière valeur reçue sur le feed ready (mise à jour par le handler du multiplexeur)
+    return lastReadyValue;
+}
 
-    return 0;
+/**
+ * Lecture du transport et appel des handlers des messages reçus, à la place de processPackets()
+ */
+inline void processMQTT() {
+    mqttMux.poll();
+    mqttMux.dispatch();
 }
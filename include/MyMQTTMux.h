@@ -0,0 +1,401 @@
+/**
+ * \file MyMQTTMux.h
+ * \page mqttmux Multiplexeur de feeds MQTT
+ * \brief Une seule souscription joker, un aiguillage en O(1) vers les handlers des feeds
+ *
+ * La bibliothèque Adafruit MQTT ne gère que MAXSUBSCRIPTIONS souscriptions (5 par défaut) et,
+ * pour chaque paquet reçu, compare le topic à toutes les souscriptions une par une.
+ * Elle ne sait pas non plus associer un topic reçu à une souscription joker (« # »).
+ *
+ * Le multiplexeur s'intercale entre le client Adafruit et le transport (WiFiClient ou broker local) :
+ * - les paquets PUBLISH sont extraits du flux avant d'arriver à la bibliothèque, acquittés (QoS 1)
+ *   puis mis en file ;
+ * - tous les autres paquets (CONNACK, SUBACK, PINGRESP, PUBACK...) sont transmis tels quels ;
+ * - dispatch(), appelé depuis la loop, vide la file et appelle le handler du feed.
+ *
+ * Le handler est retrouvé grâce à une table de hachage parfaite construite à la compilation
+ * (FeedDispatchTable) : un hachage, une case, une comparaison de chaîne. Le nombre de feeds n'est
+ * limité que par la taille de la table, déclarée avec la liste des routes.
+ *
+ * Les messages arrivés pendant l'attente d'un PINGRESP ou d'un PUBACK ne sont plus perdus, et les
+ * handlers ne sont jamais appelés au milieu d'une lecture de la bibliothèque.
+ *
+ * Fichier \ref MyMQTTMux.h
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Client.h>
+
+#define MQTT_MUX_RX_SIZE      512   // Paquets en cours d'assemblage
+#define MQTT_MUX_PASS_SIZE    256   // Paquets de contrôle en attente de lecture par la bibliothèque
+#define MQTT_MUX_QUEUE        8     // Messages reçus en attente de dispatch()
+#define MQTT_MUX_PAYLOAD      96    // Taille maximale d'un payload de feed (instantané de transaction compris)
+
+/************************* Table de hachage parfaite *************************/
+
+typedef void (*FeedHandler)(const char *payload, uint16_t len);
+
+struct FeedRoute {
+    const char *key;
+    FeedHandler handler;
+};
+
+constexpr size_t feedKeyLength(const char *s) {
+    size_t n = 0;
+    while (s[n]) n++;
+    return n;
+}
+
+constexpr char feedLower(const char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+// FNV-1a insensible à la casse (Adafruit IO compare les topics sans tenir compte de la casse)
+constexpr uint32_t feedHash(const char *s, const size_t len, const uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) {
+        h ^= static_cast<uint8_t>(feedLower(s[i]));
+        h *= 16777619u;
+    }
+    return h;
+}
+
+constexpr size_t feedTableSize(const size_t n) {
+    size_t size = 1;
+    while (size < 2 * n) size <<= 1;
+    return size;
+}
+
+/**
+ * Table de hachage parfaite construite à la compilation : la graine est cherchée jusqu'à ce que
+ * chaque clé tombe dans une case différente. Une clé en double empêche la construction (static_assert).
+ */
+template<size_t N>
+class FeedDispatchTable {
+public:
+    static constexpr size_t SIZE = feedTableSize(N);
+    static constexpr uint32_t MAX_SEED = 4096;
+
+private:
+    FeedRoute _routes[N];
+    uint8_t _slots[SIZE];  // Index de la route + 1, 0 si la case est vide
+    uint32_t _seed;
+
+    constexpr bool tryFill(const uint32_t seed) {
+        for (size_t i = 0; i < SIZE; i++) _slots[i] = 0;
+        for (size_t i = 0; i < N; i++) {
+            const size_t slot = feedHash(_routes[i].key, feedKeyLength(_routes[i].key), seed) & (SIZE - 1);
+            if (_slots[slot] != 0) return false;
+            _slots[slot] = static_cast<uint8_t>(i + 1);
+        }
+        return true;
+    }
+
+public:
+    constexpr explicit FeedDispatchTable(const FeedRoute (&routes)[N]) : _routes(), _slots(), _seed(MAX_SEED) {
+        static_assert(N < 255, "Trop de feeds pour une table d'index 8 bits");
+        for (size_t i = 0; i < N; i++) _routes[i] = routes[i];
+        for (uint32_t seed = 0; seed < MAX_SEED; seed++) {
+            if (tryFill(seed)) {
+                _seed = seed;
+                break;
+            }
+        }
+    }
+
+    [[nodiscard]] constexpr bool valid() const { return _seed < MAX_SEED; }
+    [[nodiscard]] constexpr uint32_t seed() const { return _seed; }
+    [[nodiscard]] constexpr size_t size() const { return N; }
+    [[nodiscard]] const char *key(const int route) const { return _routes[route].key; }
+
+    /**
+     * @return l'index de la route, -1 si la clé est inconnue
+     */
+    [[nodiscard]] int lookup(const char *key, const size_t len) const {
+        const uint8_t index = _slots[feedHash(key, len, _seed) & (SIZE - 1)];
+        if (index == 0) return -1;
+        const char *candidate = _routes[index - 1].key;
+        for (size_t i = 0; i < len; i++) {
+            if (candidate[i] == '\0' || feedLower(candidate[i]) != feedLower(key[i])) return -1;
+        }
+        return candidate[len] == '\0' ? index - 1 : -1;
+    }
+
+    void dispatch(const int route, const char *payload, const uint16_t len) const {
+        if (route >= 0 && static_cast<size_t>(route) < N && _routes[route].handler) {
+            _routes[route].handler(payload, len);
+        }
+    }
+};
+
+/************************* Multiplexeur **************************************/
+
+class MyMqttMux : public Client {
+public:
+    typedef int (*Lookup)(const char *key, size_t len);
+    typedef void (*Dispatch)(int route, const char *payload, uint16_t len);
+    typedef void (*Capture)(const char *key, size_t keyLen, const char *payload, uint16_t len);
+
+    struct Stats {
+        uint32_t routed = 0;       // Messages remis à un handler
+        uint32_t unrouted = 0;     // Topics hors préfixe ou clés inconnues
+        uint32_t dropped = 0;      // File pleine, payload ou paquet trop grand
+        uint8_t maxQueued = 0;     // Profondeur maximale atteinte par la file
+        uint32_t published = 0;    // PUBLISH écrits vers le transport (budgets de publication)
+    };
+
+private:
+    struct Message {
+        int16_t route;
+        uint16_t len;
+        char payload[MQTT_MUX_PAYLOAD + 1];
+    };
+
+    Client &_inner;
+    const char *_prefix;
+    size_t _prefixLen;
+    Lookup _lookup = nullptr;
+    Dispatch _dispatch = nullptr;
+    Capture _capture = nullptr;
+
+    uint8_t _rx[MQTT_MUX_RX_SIZE] = {};
+    uint16_t _rxLen = 0;
+    uint32_t _discard = 0;  // Octets restants d'un paquet trop grand à ignorer
+
+    uint8_t _pass[MQTT_MUX_PASS_SIZE] = {};
+    uint16_t _passStart = 0;
+    uint16_t _passEnd = 0;
+
+    Message _queue[MQTT_MUX_QUEUE] = {};
+    uint8_t _queueHead = 0;
+    uint8_t _queueCount = 0;
+    Stats _stats;
+
+    void reset() {
+        _rxLen = 0;
+        _discard = 0;
+        _passStart = _passEnd = 0;
+    }
+
+    bool passThrough(const uint8_t *frame, const uint16_t len) {
+        if (_passEnd + len > MQTT_MUX_PASS_SIZE && _passStart > 0) {
+            memmove(_pass, _pass + _passStart, _passEnd - _passStart);
+            _passEnd -= _passStart;
+            _passStart = 0;
+        }
+        if (_passEnd + len > MQTT_MUX_PASS_SIZE) return false;
+        memcpy(_pass + _passEnd, frame, len);
+        _passEnd += len;
+        return true;
+    }
+
+    void handlePublish(const uint8_t flags, const uint8_t *p, const uint16_t len) {
+        const uint8_t qos = (flags >> 1) & 0x03;
+        if (len < 2) return;
+        const uint16_t topicLen = (p[0] << 8) | p[1];
+        uint16_t offset = 2 + topicLen;
+        if (offset > len) return;
+        const char *topic = reinterpret_cast<const char *>(p + 2);
+
+        if (qos > 0) {
+            if (offset + 2 > len) return;
+            // Acquittement immédiat : le message est pris en charge par la file
+            const uint8_t puback[4] = {0x40, 0x02, p[offset], p[offset + 1]};
+            _inner.write(puback, sizeof(puback));
+            offset += 2;
+        }
+
+        int route = -1;
+        if (topicLen > _prefixLen && strncasecmp(topic, _prefix, _prefixLen) == 0 && _lookup) {
+            route = _lookup(topic + _prefixLen, topicLen - _prefixLen);
+        }
+        if (route < 0) {
+            _stats.unrouted++;
+            return;
+        }
+
+        const uint16_t payloadLen = len - offset;
+        const char *payload = reinterpret_cast<const char *>(p + offset);
+        if (_capture) _capture(topic + _prefixLen, topicLen - _prefixLen, payload, payloadLen);
+        enqueue(route, payload, payloadLen);
+    }
+
+    bool enqueue(const int route, const char *payload, const uint16_t len) {
+        if (len > MQTT_MUX_PAYLOAD || _queueCount >= MQTT_MUX_QUEUE) {
+            _stats.dropped++;
+            return false;
+        }
+        Message &m = _queue[(_queueHead + _queueCount) % MQTT_MUX_QUEUE];
+        m.route = static_cast<int16_t>(route);
+        m.len = len;
+        memcpy(m.payload, payload, len);
+        m.payload[len] = '\0';
+        _queueCount++;
+        _stats.maxQueued = std::max(_stats.maxQueued, _queueCount);
+        return true;
+    }
+
+    // Extraction des paquets complets du tampon de réception
+    void parse() {
+        while (_rxLen >= 2) {
+            uint32_t remaining = 0;
+            uint32_t multiplier = 1;
+            uint8_t i = 1;
+            bool complete = false;
+            while (i < _rxLen && i <= 4) {
+                const uint8_t digit = _rx[i++];
+                remaining += (digit & 0x7F) * multiplier;
+                multiplier *= 128;
+                if ((digit & 0x80) == 0) {
+                    complete = true;
+                    break;
+                }
+            }
+            if (!complete) {
+                if (i > 4) _rxLen = 0;
+                return;
+            }
+
+            const uint32_t total = i + remaining;
+            if (total > MQTT_MUX_RX_SIZE) {
+                // Paquet trop grand : on ignore la suite du flux jusqu'à sa fin
+                _stats.dropped++;
+                _discard = total - _rxLen;
+                _rxLen = 0;
+                return;
+            }
+            if (_rxLen < total) return;
+
+            if ((_rx[0] >> 4) == 3) {
+                handlePublish(_rx[0] & 0x0F, _rx + i, remaining);
+            } else if (!passThrough(_rx, total)) {
+                return; // La bibliothèque n'a pas encore lu les paquets précédents
+            }
+            memmove(_rx, _rx + total, _rxLen - total);
+            _rxLen -= total;
+        }
+    }
+
+    void pump() {
+        while (_inner.available() > 0) {
+            if (_discard > 0) {
+                _inner.read();
+                _discard--;
+                continue;
+            }
+            const size_t space = MQTT_MUX_RX_SIZE - _rxLen;
+            if (space == 0) break;
+            const int n = _inner.read(_rx + _rxLen, space);
+            if (n <= 0) break;
+            _rxLen += n;
+            parse();
+        }
+    }
+
+public:
+    /**
+     * @param inner transport réel (WiFiClient, broker local...)
+     * @param prefix préfixe commun des topics routés, retiré avant la recherche de la clé
+     */
+    MyMqttMux(Client &inner, const char *prefix) : _inner(inner), _prefix(prefix), _prefixLen(strlen(prefix)) {
+    }
+
+    void setRouter(const Lookup lookup, const Dispatch dispatch) {
+        _lookup = lookup;
+        _dispatch = dispatch;
+    }
+
+    /**
+     * Copie des messages routés (clé sans le préfixe, payload), avant leur mise en file
+     */
+    void setCapture(const Capture capture) { _capture = capture; }
+
+    /**
+     * @return l'index de la route d'une clé de feed, -1 si elle est inconnue
+     */
+    [[nodiscard]] int route(const char *key, const size_t len) const { return _lookup ? _lookup(key, len) : -1; }
+
+    /**
+     * Mise en file d'un message comme s'il venait du transport (rejeu d'une trace)
+     */
+    bool inject(const int route, const char *payload, const uint16_t len) {
+        if (route < 0) return false;
+        return enqueue(route, payload, len);
+    }
+
+    [[nodiscard]] const Stats &getStats() const { return _stats; }
+    [[nodiscard]] uint8_t queued() const { return _queueCount; }
+
+    /**
+     * Lecture du transport sans passer par la bibliothèque : à appeler régulièrement dans la loop
+     */
+    void poll() { pump(); }
+
+    /**
+     * Appel des handlers pour les messages en file
+     * @return le nombre de messages traités
+     */
+    uint8_t dispatch(uint8_t max = MQTT_MUX_QUEUE) {
+        uint8_t n = 0;
+        while (_queueCount > 0 && n < max) {
+            // Copie puis retrait avant l'appel : le handler peut publier et donc relire le flux
+            Message m = _queue[_queueHead];
+            _queueHead = (_queueHead + 1) % MQTT_MUX_QUEUE;
+            _queueCount--;
+            if (_dispatch) _dispatch(m.route, m.payload, m.len);
+            _stats.routed++;
+            n++;
+        }
+        return n;
+    }
+
+    // Interface Client
+    int connect(IPAddress ip, uint16_t port) override {
+        reset();
+        return _inner.connect(ip, port);
+    }
+
+    int connect(const char *host, uint16_t port) override {
+        reset();
+        return _inner.connect(host, port);
+    }
+
+    size_t write(const uint8_t b) override { return _inner.write(b); }
+    size_t write(const uint8_t *buf, const size_t size) override {
+        // La bibliothèque écrit chaque paquet en un appel : le premier octet est l'en-tête
+        if (size > 0 && (buf[0] >> 4) == 3) _stats.published++;
+        return _inner.write(buf, size);
+    }
+
+    int available() override {
+        pump();
+        return _passEnd - _passStart;
+    }
+
+    int read() override {
+        if (available() <= 0) return -1;
+        const uint8_t b = _pass[_passStart++];
+        if (_passStart == _passEnd) _passStart = _passEnd = 0;
+        return b;
+    }
+
+    int read(uint8_t *buf, const size_t size) override {
+        size_t n = 0;
+        while (n < size && available() > 0) {
+            buf[n++] = read();
+        }
+        return n;
+    }
+
+    int peek() override { return available() > 0 ? _pass[_passStart] : -1; }
+    void flush() override { _inner.flush(); }
+
+    void stop() override {
+        _inner.stop();
+        reset();
+    }
+
+    uint8_t connected() override { return _inner.connected() || _passEnd > _passStart; }
+    operator bool() override { return static_cast<bool>(_inner); }
+};
@@ -0,0 +1,210 @@
+/**
+ * \file MyMicroBench.h
+ * \page microbench Microbenchmarks
+ * \brief Suite fixe de mesures des opérations du projet, compilable sur la carte et sur la machine hôte
+ *
+ * Chaque cas est une opération du projet répétée un nombre fixe de fois, après une exécution de mise
+ * en route non mesurée. Le résultat d'un cas :
+ * - cycles : cycles CPU par itération (compteur du processeur ; sur l'hôte, le TSC des x86, 0 ailleurs) ;
+ * - ns : durée par itération ;
+ * - tas : variation du tas libre sur toutes les itérations (négatif : mémoire gardée), 0 sur l'hôte ;
+ * - iterations.
+ *
+ * Ce fichier ne contient que les cas sans dépendance matérielle (analyse de la configuration,
+ * document JSON, ligne formatée, planification du sommeil) : ils se compilent tels quels sur la
+ * machine hôte (environnement native de platformio.ini, src/host/bench_host.cpp) et sur la carte, avec
+ * les mêmes entrées. Les cas propres à la carte (tableau de bord, logs, commande(), LittleFS) sont
+ * dans MyBench.h, qui sert l'ensemble sur la route /bench.
+ *
+ * Fichier \ref MyMicroBench.h
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ArduinoJson.h>
+
+#include "MySleepPlan.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define MICRO_BENCH_PLATFORM    "esp8266"
+#else
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#ifndef PROGMEM
+#define PROGMEM
+#define memcpy_P                memcpy
+#endif
+#define MICRO_BENCH_PLATFORM    "hote"
+#endif
+
+#define MICRO_BENCH_LINE_MAX    160     // Une ligne JSON de résultat
+
+struct MicroBenchCase {
+    const char *name;
+    uint16_t iterations;
+    void (*op)();
+    bool (*setup)();        // Préparation non mesurée, false : cas ignoré (nullptr : rien à préparer)
+    void (*teardown)();
+};
+
+struct MicroBenchResult {
+    const char *name = "";
+    uint16_t iterations = 0;
+    uint32_t cycles = 0;    // Par itération
+    uint32_t ns = 0;        // Par itération
+    int32_t heapDelta = 0;
+    bool skipped = false;
+};
+
+inline uint64_t microBenchCycles() {
+#ifdef ARDUINO
+    return ESP.getCycleCount();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+inline uint64_t microBenchCyclesSince(const uint64_t start) {
+#ifdef ARDUINO
+    // Compteur 32 bits : un cas dure bien moins que ses 53 s de cycle à 80 MHz
+    return static_cast<uint32_t>(ESP.getCycleCount() - static_cast<uint32_t>(start));
+#else
+    return microBenchCycles() - start;
+#endif
+}
+
+inline uint64_t microBenchNs() {
+#ifdef ARDUINO
+    return micros64() * 1000;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline int32_t microBenchFreeHeap() {
+#ifdef ARDUINO
+    return static_cast<int32_t>(EspClass::getFreeHeap());
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Exécution d'un cas : préparation, mise en route, itérations mesurées, nettoyage
+ */
+inline MicroBenchResult microBenchRun(const MicroBenchCase &benchCase) {
+    MicroBenchResult result;
+    result.name = benchCase.name;
+    if (benchCase.setup && !benchCase.setup()) {
+        result.skipped = true;
+        return result;
+    }
+    benchCase.op(); // Cache d'instructions, premières allocations
+
+    const int32_t heapBefore = microBenchFreeHeap();
+    const uint64_t ns = microBenchNs();
+    const uint64_t cycles = microBenchCycles();
+    for (uint16_t i = 0; i < benchCase.iterations; i++) benchCase.op();
+    const uint64_t elapsedCycles = microBenchCyclesSince(cycles);
+    const uint64_t elapsedNs = microBenchNs() - ns;
+    result.heapDelta = microBenchFreeHeap() - heapBefore;
+
+    if (benchCase.teardown) benchCase.teardown();
+    result.iterations = benchCase.iterations;
+    result.cycles = static_cast<uint32_t>(elapsedCycles / benchCase.iterations);
+    result.ns = static_cast<uint32_t>(elapsedNs / benchCase.iterations);
+    return result;
+}
+
+inline size_t microBenchFormat(const MicroBenchResult &result, char *out, const size_t size) {
+    if (result.skipped) return snprintf(out, size, "{\"nom\":\"%s\",\"ignore\":true}", result.name);
+    return snprintf(out, size, "{\"nom\":\"%s\",\"iterations\":%u,\"cycles\":%lu,\"ns\":%lu,\"tas\":%ld}",
+                    result.name, result.iterations, static_cast<unsigned long>(result.cycles),
+                    static_cast<unsigned long>(result.ns), static_cast<long>(result.heapDelta));
+}
+
+// Résultat gardé par le compilateur
+inline volatile uint32_t microBenchSink = 0;
+
+// /config.json créé par défaut (voir MySPIFFS.h), sans les identifiants WiFi
+inline const char microBenchConfigJson[] PROGMEM =
+    "{\"distributeurs\":{"
+    "\"croquette\":{\"nom\":\"Croquette\",\"nbRation\":30000,\"nbMin\":1000,\"nbMax\":50000,\"nbBySecSend\":10,"
+    "\"nbSendRation\":1000,\"copulation\":0,\"copulationSec\":0,\"eat\":0},"
+    "\"poissonRouge\":{\"nom\":\"Poisson Rouge\",\"nbRation\":30,\"nbMin\":20,\"nbMax\":100,\"nbBySecSend\":10,"
+    "\"nbSendRation\":3,\"copulation\":3,\"copulationSec\":15,\"eat\":2000},"
+    "\"achigan\":{\"nom\":\"Achigan\",\"nbRation\":10,\"nbMin\":5,\"nbMax\":20,\"nbBySecSend\":10,"
+    "\"nbSendRation\":2,\"copulation\":1,\"copulationSec\":40,\"eat\":4},"
+    "\"achiganResto\":{\"nom\":\"Achigan du Restaurant\",\"nbRation\":12,\"nbMin\":5,\"nbMax\":30,\"nbBySecSend\":10,"
+    "\"nbSendRation\":1,\"copulation\":1,\"copulationSec\":40,\"eat\":1}},"
+    "\"ssid\":\"\",\"password\":\"\",\"reseaux\":[]}";
+
+inline char *microBenchConfig = nullptr;   // Copie en RAM le temps du cas
+
+inline bool microBenchConfigSetup() {
+    microBenchConfig = static_cast<char *>(malloc(sizeof(microBenchConfigJson)));
+    if (!microBenchConfig) return false;
+    memcpy_P(microBenchConfig, microBenchConfigJson, sizeof(microBenchConfigJson));
+    return true;
+}
+
+inline void microBenchConfigTeardown() {
+    free(microBenchConfig);
+    microBenchConfig = nullptr;
+}
+
+// Analyse de la configuration, comme loadDistributeurConfig()
+inline void microBenchConfigParse() {
+    DynamicJsonDocument doc(2048);
+    deserializeJson(doc, static_cast<const char *>(microBenchConfig));
+    microBenchSink = doc["distributeurs"]["achiganResto"]["nbMax"].as<int>();
+}
+
+// Document d'état des quatre niveaux, construit puis sérialisé
+inline void microBenchJsonStatus() {
+    static const char *const keys[] = {"croquette", "poissonRouge", "achigan", "achiganResto"};
+    DynamicJsonDocument doc(512);
+    JsonArray levels = doc.createNestedArray("distributeurs");
+    for (uint8_t i = 0; i < 4; i++) {
+        JsonObject level = levels.createNestedObject();
+        level["nom"] = keys[i];
+        level["nbRation"] = 30000 - i * 1000;
+        level["restant"] = i;
+    }
+    char out[256];
+    microBenchSink = serializeJson(doc, out, sizeof(out));
+}
+
+// Ligne de log au format de /api/logs, dans un tampon fixe
+inline void microBenchSnprintfLine() {
+    char line[128];
+    microBenchSink = snprintf(line, sizeof(line), "{\"seq\":%u,\"ms\":%u,\"level\":\"%s\",\"module\":\"%s\"}",
+                              static_cast<unsigned>(microBenchSink), 81234u, "info", "BENCH");
+}
+
+// Décision de sommeil pour des échéances typiques
+inline void microBenchSleepPlan() {
+    static const SleepPolicy policy;
+    SleepInputs in;
+    in.timerInMs = 4000 + (microBenchSink & 0xFF);
+    in.keepaliveInMs = 20000;
+    microBenchSink = sleepPlan(policy, in).durationMs;
+}
+
+inline const MicroBenchCase microBenchPortableCases[] = {
+    {"config_parse", 50, microBenchConfigParse, microBenchConfigSetup, microBenchConfigTeardown},
+    {"json_status", 50, microBenchJsonStatus, nullptr, nullptr},
+    {"snprintf_line", 200, microBenchSnprintfLine, nullptr, nullptr},
+    {"sleep_plan", 500, microBenchSleepPlan, nullptr, nullptr},
+};
+constexpr uint8_t MICRO_BENCH_PORTABLE = sizeof(microBenchPortableCases) / sizeof(microBenchPortableCases[0]);
@@ -2,47 +2,248 @@
  * \file MyNTP.h
  * \page ntp Network Time Protocol (NTP)
  * \brief Quelle heure est il ?
- * 
- * Les cartes Arduino, ESP8266 et ESP32 ne disposent pas d’horloge temps réel. 
+ *
+ * Les cartes Arduino, ESP8266 et ESP32 ne disposent pas d’horloge temps réel.
  * La seule information dont dispose la carte est le nombre de microsecondes écoulées depuis son dernier démarrage.
- * 
+ *
  * Nous allons donc récupérer l'heure auprès d'un serveur de temps NTP : Network Time Protocol.
  * Network Time Protocol (« protocole de temps réseau ») est un protocole qui permet de synchroniser,
  * via un réseau informatique, l'horloge locale d'ordinateurs sur une référence d'heure.
- * 
- * Nous pourrons ainsi horodater (timestamp) des mesures, connaître le temps écoulé entre deux événements, 
+ *
+ * Nous pourrons ainsi horodater (timestamp) des mesures, connaître le temps écoulé entre deux événements,
  * afficher l’heure courante sur une interface WEB, déclencher une action programmée ...
- * 
- * La bibliothèque NTPClient est nécessaire.
- * 
+ *
+ * <H2>Service d'horloge</H2>
+ *
+ * Interroger le serveur NTP à chaque besoin bloque la loop pendant l'aller-retour réseau.
+ * L'horloge est donc un service synchronisé en tâche de fond :
+ * - loopNTP() envoie la requête NTP puis, aux itérations suivantes, lit la réponse si elle est
+ *   arrivée : aucune attente active ;
+ * - le nom du serveur est résolu de la même façon, par dns_gethostbyname() de lwIP : la requête DNS
+ *   part, le callback range l'adresse et la requête NTP part à l'itération suivante. L'adresse est
+ *   gardée tant que le serveur répond, et résolue à nouveau après un délai dépassé ;
+ * - entre deux synchronisations, l'heure est calculée à partir de millis() étendu sur 64 bits
+ *   (pas de saut au bout de 49,7 jours) plus le décalage mesuré ;
+ * - la dérive de l'oscillateur est estimée à chaque synchronisation (en ppm) et corrigée ;
+ * - l'heure renvoyée ne recule jamais : une correction négative est absorbée en ralentissant.
+ *
+ * nowEpochMs() est donc en temps constant et sans accès réseau, utilisable partout (logs, pages web,
+ * callbacks de Ticker).
+ *
  * Fichier \ref MyNTP.h
  */
 #ifndef MYNTP_H
 #define MYNTP_H
 #include <ESP8266WiFi.h>
-#include <NTPClient.h>
 #include <WiFiUdp.h>
+#include <lwip/dns.h>
 
 #include "MyDebug.h"
 
+#define NTP_SERVER             "europe.pool.ntp.org"
+#define NTP_PORT               123
+#define NTP_LOCAL_PORT         2390
+#define NTP_PACKET_SIZE        48
+#define NTP_TIMEOUT_MS         2000
+#define NTP_DNS_TIMEOUT_MS     5000       // Résolution sans réponse : nouvel essai après NTP_RETRY_MS
+#define NTP_SYNC_INTERVAL_MS   3600000UL  // Resynchronisation toutes les heures
+#define NTP_RETRY_MS           10000UL    // Nouvel essai après un échec
+#define NTP_MIN_DRIFT_INTERVAL 60000UL    // Intervalle minimal pour mesurer la dérive
+#define NTP_DRIFT_ALPHA        0.25f
+// Avec l'heure d'été, nous avons en France 1h (3600s) de décalage avec le méridien de Greenwich (Greenwich Meridian Time : GMT) en hiver.
+#define NTP_TZ_OFFSET_SEC      3600
+#define NTP_UNIX_OFFSET        2208988800UL // Secondes entre 1900 (NTP) et 1970 (Unix)
+
 inline WiFiUDP ntpUDP;
-  // Avec l'heure d'été, nous avons en France 1h (3600s) de décalage avec le méridien de Greenwich (Greenwich Meridian Time : GMT) en hiver.
-inline NTPClient timeClient(ntpUDP, "europe.pool.ntp.org", 3600, 60000);
+
+struct NtpClock {
+  uint64_t baseEpochMs = 0;     // Heure de référence (dernière synchronisation)
+  uint64_t baseMillis = 0;      // millis64() au moment de la référence
+  uint64_t lastReturned = 0;    // Dernière valeur renvoyée (monotonie)
+  float driftPpm = 0;           // > 0 : l'oscillateur local avance
+  bool synced = false;
+  bool waiting = false;         // Requête envoyée, réponse attendue
+  volatile bool resolving = false; // Résolution DNS en cours, terminée par ntpDnsFound()
+  unsigned long sentAt = 0;
+  unsigned long nextSync = 0;
+  unsigned long lastSync = 0;
+  uint32_t syncs = 0;
+  uint32_t failures = 0;
+  IPAddress server;
+};
+
+inline NtpClock ntpClock;
+
+/**
+ * millis() étendu sur 64 bits : le débordement de millis() (49,7 jours) est compté.
+ * Doit être appelé au moins une fois par débordement, ce que fait loopNTP().
+ */
+inline uint64_t millis64() {
+  static uint32_t high = 0;
+  static uint32_t lastLow = 0;
+  const uint32_t low = millis();
+  if (low < lastLow) high++;
+  lastLow = low;
+  return (static_cast<uint64_t>(high) << 32) | low;
+}
+
+/**
+ * Heure courante en millisecondes depuis le 01/01/1970 UTC.
+ * Avant la première synchronisation, renvoie le temps écoulé depuis le démarrage.
+ */
+inline uint64_t nowEpochMs() {
+  const uint64_t m = millis64();
+  uint64_t now = m;
+  if (ntpClock.synced) {
+    const int64_t elapsed = static_cast<int64_t>(m - ntpClock.baseMillis);
+    now = ntpClock.baseEpochMs + elapsed - static_cast<int64_t>(elapsed * (ntpClock.driftPpm * 1e-6f));
+  }
+  if (now < ntpClock.lastReturned) now = ntpClock.lastReturned;
+  ntpClock.lastReturned = now;
+  return now;
+}
+
+inline uint32_t nowEpoch() {
+  return nowEpochMs() / 1000;
+}
+
+inline bool clockSynced() {
+  return ntpClock.synced;
+}
+
+/**
+ * Heure locale au format HH:MM:SS
+ */
+inline String clockFormattedTime(const uint32_t epoch = nowEpoch()) {
+  const uint32_t local = (epoch + NTP_TZ_OFFSET_SEC) % 86400;
+  char buf[9];
+  snprintf(buf, sizeof(buf), "%02u:%02u:%02u", local / 3600, (local / 60) % 60, local % 60);
+  return String(buf);
+}
+
+inline void ntpApply(const uint64_t epochMs, const uint64_t atMillis) {
+  if (ntpClock.synced) {
+    const uint64_t interval = atMillis - ntpClock.baseMillis;
+    if (interval >= NTP_MIN_DRIFT_INTERVAL) {
+      // Écart entre l'heure locale prédite (sans correction) et l'heure mesurée
+      const int64_t predicted = ntpClock.baseEpochMs + static_cast<int64_t>(interval);
+      const float ppm = (predicted - static_cast<int64_t>(epochMs)) * 1e6f / interval;
+      ntpClock.driftPpm += NTP_DRIFT_ALPHA * (ppm - ntpClock.driftPpm);
+    }
+  }
+  ntpClock.baseEpochMs = epochMs;
+  ntpClock.baseMillis = atMillis;
+  ntpClock.synced = true;
+  ntpClock.syncs++;
+}
+
+inline void ntpFail(const unsigned long now) {
+  ntpClock.failures++;
+  ntpClock.nextSync = now + NTP_RETRY_MS;
+}
+
+/**
+ * Callback de dns_gethostbyname(), appelé par lwIP : adresse nulle si le nom n'a pas été résolu
+ */
+inline void ntpDnsFound(const char *, const ip_addr_t *address, void *) {
+  if (!ntpClock.resolving) return; // Délai déjà dépassé
+  ntpClock.resolving = false;
+  if (address) {
+    ntpClock.server = IPAddress(ip_2_ip4(address)->addr);
+  } else {
+    ntpFail(millis());
+  }
+}
+
+/**
+ * Résolution du serveur sans attente : immédiate si lwIP a le nom en cache, sinon par ntpDnsFound()
+ */
+inline void ntpResolve() {
+  ip_addr_t address;
+  ntpClock.sentAt = millis();
+  ntpClock.resolving = true;
+  const err_t err = dns_gethostbyname(NTP_SERVER, &address, ntpDnsFound, nullptr);
+  if (err == ERR_INPROGRESS) return;
+  ntpClock.resolving = false;
+  if (err == ERR_OK) {
+    ntpClock.server = IPAddress(ip_2_ip4(&address)->addr);
+  } else {
+    ntpFail(ntpClock.sentAt);
+  }
+}
+
+inline void ntpSend() {
+  if (!ntpClock.server.isSet()) {
+    ntpResolve();
+    if (!ntpClock.server.isSet()) return; // Requête NTP à l'itération qui suit la réponse DNS
+  }
+
+  uint8_t packet[NTP_PACKET_SIZE] = {};
+  packet[0] = 0x23; // LI = 0, version 4, mode client
+  while (ntpUDP.parsePacket() > 0) ntpUDP.flush(); // Réponses périmées
+  ntpUDP.beginPacket(ntpClock.server, NTP_PORT);
+  ntpUDP.write(packet, NTP_PACKET_SIZE);
+  ntpUDP.endPacket();
+  ntpClock.sentAt = millis();
+  ntpClock.waiting = true;
+}
+
+inline void ntpReceive() {
+  const unsigned long now = millis();
+  if (ntpUDP.parsePacket() >= NTP_PACKET_SIZE) {
+    uint8_t packet[NTP_PACKET_SIZE];
+    ntpUDP.read(packet, NTP_PACKET_SIZE);
+    ntpClock.waiting = false;
+
+    // Horodatage d'émission du serveur (octets 40 à 47) : secondes et fraction depuis 1900
+    const uint32_t seconds = (packet[40] << 24) | (packet[41] << 16) | (packet[42] << 8) | packet[43];
+    const uint32_t fraction = (packet[44] << 24) | (packet[45] << 16) | (packet[46] << 8) | packet[47];
+    if (seconds < NTP_UNIX_OFFSET) {
+      ntpFail(now);
+      return;
+    }
+    const uint64_t epochMs = static_cast<uint64_t>(seconds - NTP_UNIX_OFFSET) * 1000 +
+                             ((static_cast<uint64_t>(fraction) * 1000) >> 32);
+    // La réponse a voyagé pendant la moitié de l'aller-retour
+    ntpApply(epochMs + (now - ntpClock.sentAt) / 2, millis64());
+    ntpClock.lastSync = now;
+    ntpClock.nextSync = now + NTP_SYNC_INTERVAL_MS;
+  } else if (now - ntpClock.sentAt >= NTP_TIMEOUT_MS) {
+    ntpClock.waiting = false;
+    ntpClock.server = IPAddress(); // Nouvelle résolution DNS au prochain essai
+    ntpFail(now);
+  }
+}
+
+/**
+ * Synchronisation en tâche de fond, à appeler dans la loop : ne bloque jamais sur le réseau
+ */
+inline void loopNTP() {
+  millis64(); // Comptage des débordements de millis()
+
+  if (ntpClock.waiting) {
+    ntpReceive();
+  } else if (ntpClock.resolving) {
+    if (millis() - ntpClock.sentAt >= NTP_DNS_TIMEOUT_MS) {
+      ntpClock.resolving = false;
+      ntpFail(millis());
+    }
+  } else if (static_cast<long>(millis() - ntpClock.nextSync) >= 0 && WiFi.status() == WL_CONNECTED) {
+    ntpSend();
+  }
+}
 
 inline void getNTP(){
   MYDEBUG_PRINT("-NTP : ");
-  // mise à jour de l'heure
-  timeClient.update();
-  // Affichage de l'heure
-  MYDEBUG_PRINTLN(timeClient.getFormattedTime());
+  // Affichage de l'heure, sans requête réseau
+  MYDEBUG_PRINTLN(clockFormattedTime() + (clockSynced() ? "" : " (non synchronisée)"));
 }
 
 inline void setupNTP(){
-  // On a besoin d'une connexion à Internet !
-  if (WiFi.status() != WL_CONNECTED){
-    //setupWiFi();
-  }  
-  timeClient.begin();
+  // On a besoin d'une connexion à Internet ! La première requête part dès que le WiFi est connecté.
+  ntpUDP.begin(NTP_LOCAL_PORT);
+  ntpClock.nextSync = millis();
+  loopNTP();
   getNTP();
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,284 @@
+/**
+ * \file MyOta.h
+ * \page ota Mise à jour OTA
+ * \brief Firmware compressé téléchargé en HTTP et écrit par blocs dans la partition de mise à jour
+ *
+ * Sans OTA, une mise à jour passe par la cible upload (liaison série) : il faut avoir la carte en
+ * main. La route /api/ota demande le téléchargement d'une image :
+ * \code
+ * curl -u ota:<ota_password> -X POST \
+ *      "http://<carte>/api/ota?url=http://192.168.4.2:8000/firmware.bin.gz&md5=<md5 du .gz>"
+ * \endcode
+ * L'image est produite par la cible ota_image de CMakeLists (gzip -9 du firmware et son MD5).
+ *
+ * Sécurité :
+ * - le POST demande une authentification HTTP Basic, utilisateur « ota » et mot de passe ota_password
+ *   (WIFI_CREDENTIALS.h). Avec un mot de passe vide, la mise à jour est refusée (403) ;
+ * - le md5 est obligatoire : une image tronquée ou corrompue n'est jamais activée ;
+ * - tout passe en http clair, la route comme le téléchargement : le mot de passe et l'image peuvent être
+ *   lus ou remplacés sur le réseau (le md5 vient de la même requête). À n'utiliser que sur un réseau
+ *   de confiance, typiquement le point d'accès de la carte.
+ *
+ * Déroulement, dans la loop (la réponse HTTP est envoyée avant) :
+ * 1. point de contrôle : journal écrit, instantané de l'état et rations encore dues (envoi en cours et
+ *    commandes en file de chaque chaîne) dans OTA_STATE_FILE ;
+ * 2. requête GET de l'image : la connexion et les en-têtes bloquent la loop au plus OTA_READ_TIMEOUT_MS ;
+ * 3. téléchargement en flux, un bloc de OTA_CHUNK_SIZE octets par itération de la loop, écrit au fil
+ *    de l'eau par Update : l'image n'est jamais entière en mémoire et les chaînes continuent de servir ;
+ * 4. image complète : point de contrôle refait (les commandes ont pu avancer pendant le
+ *    téléchargement), vérification du MD5 et de la taille par Update.end(), puis redémarrage ;
+ * 5. au démarrage suivant, l'état est rejoué depuis le journal et les rations dues sont remises en
+ *    file par otaRestore().
+ * En cas d'échec, rien n'est écrit dans la partition active : le point de contrôle est effacé et la
+ * carte continue avec le firmware courant.
+ *
+ * L'image gzip est écrite telle quelle : c'est le chargeur de démarrage (eboot) qui la décompresse en
+ * la recopiant sur le firmware actif. Une image plus petite, c'est moins d'octets transmis et une
+ * fenêtre de téléchargement plus courte.
+ *
+ * Fichier \ref MyOta.h
+ */
+#pragma once
+
+#include <ESP8266HTTPClient.h>
+#include <Updater.h>
+
+#include "MyChain.h"
+#include "WIFI_CREDENTIALS.h"
+
+#define OTA_CHUNK_SIZE        1024
+#define OTA_READ_TIMEOUT_MS   5000
+#define OTA_STATE_FILE        "/ota.json"
+#define OTA_STATE_DOC         512
+#define OTA_URL_SIZE          128
+#define OTA_MD5_SIZE          33
+#define OTA_USER              "ota"
+
+enum OtaState : uint8_t {
+    OTA_IDLE,
+    OTA_PENDING,        // Demandée, lancée à la prochaine itération de la loop
+    OTA_DOWNLOADING,    // Un bloc par itération de la loop
+    OTA_FAILED,
+    OTA_DONE,           // Redémarrage en cours
+};
+
+inline const char *const otaStateNames[] = {"inactive", "demandee", "telechargement", "echec", "terminee"};
+
+inline OtaState otaState = OTA_IDLE;
+inline char otaUrl[OTA_URL_SIZE] = "";
+inline char otaMd5[OTA_MD5_SIZE] = "";
+inline String otaError;
+inline uint32_t otaSize = 0;
+inline uint32_t otaBytes = 0;
+inline uint32_t otaDurationMs = 0;
+inline bool otaCompressed = false;
+inline unsigned long otaStart = 0;
+inline unsigned long otaLastData = 0;
+inline WiFiClient *otaClient = nullptr;     // Connexion du téléchargement, libérée à la fin
+inline HTTPClient *otaHttp = nullptr;
+
+// Mise à jour en cours : la loop ne doit pas dormir entre deux blocs
+inline bool otaBusy() { return otaState == OTA_PENDING || otaState == OTA_DOWNLOADING; }
+
+/**
+ * Point de contrôle avant le téléchargement : état journalisé et rations encore dues
+ */
+inline bool otaCheckpoint() {
+    flushDistributeurJournal();
+    int32_t values[JOURNAL_MAX_IDS];
+    journalSnapshot(values, chainValues(values));
+
+    DynamicJsonDocument doc(OTA_STATE_DOC);
+    JsonArray chainsJson = doc.createNestedArray("chaines");
+    for (uint8_t c = 0; c < chainCount; c++) {
+        int orders[CHAIN_ORDER_QUEUE + 1];
+        const uint8_t count = chains[c]->pendingOrders(orders, CHAIN_ORDER_QUEUE + 1);
+        if (count == 0) continue;
+        JsonObject chain = chainsJson.createNestedObject();
+        chain["ns"] = chains[c]->ns;
+        JsonArray ordersJson = chain.createNestedArray("commandes");
+        for (uint8_t i = 0; i < count; i++) ordersJson.add(orders[i]);
+    }
+
+    File file = SPIFFS.open(OTA_STATE_FILE, "w");
+    if (!file) return false;
+    const bool ok = serializeJson(doc, file) > 0;
+    file.close();
+    return ok;
+}
+
+/**
+ * Rations dues avant la mise à jour, remises en file une fois les chaînes démarrées
+ */
+inline void otaRestore() {
+    File file = SPIFFS.open(OTA_STATE_FILE, "r");
+    if (!file) return;
+    DynamicJsonDocument doc(OTA_STATE_DOC);
+    const DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    SPIFFS.remove(OTA_STATE_FILE);
+    if (error) return;
+
+    uint8_t restored = 0;
+    for (JsonObjectConst chain: doc["chaines"].as<JsonArrayConst>()) {
+        const char *ns = chain["ns"] | "";
+        for (uint8_t c = 0; c < chainCount; c++) {
+            if (!chains[c]->ns.equalsIgnoreCase(ns)) continue;
+            for (const int nombre: chain["commandes"].as<JsonArrayConst>()) {
+                chains[c]->enqueueOrder(nombre);
+                restored++;
+            }
+        }
+    }
+    MYDEBUG_PRINTLN("-OTA : " + String(restored) + " commande(s) reprise(s) après la mise à jour");
+}
+
+inline void otaRelease() {
+    if (otaHttp) otaHttp->end();
+    delete otaHttp;
+    delete otaClient;
+    otaHttp = nullptr;
+    otaClient = nullptr;
+}
+
+inline bool otaFail(const String &error) {
+    otaRelease();
+    otaError = error;
+    otaState = OTA_FAILED;
+    SPIFFS.remove(OTA_STATE_FILE);
+    MYDEBUG_ERRORLN("-OTA : Échec : " + error);
+    return false;
+}
+
+/**
+ * Requête de l'image et ouverture de la partition de mise à jour
+ */
+inline bool otaBegin() {
+    otaClient = new WiFiClient();
+    otaHttp = new HTTPClient();
+    otaHttp->setTimeout(OTA_READ_TIMEOUT_MS);
+    if (!otaHttp->begin(*otaClient, otaUrl)) return otaFail("URL invalide");
+    const int code = otaHttp->GET();
+    if (code != 200) return otaFail("HTTP " + String(code) + " " + HTTPClient::errorToString(code));
+    const int size = otaHttp->getSize();
+    if (size <= 0) return otaFail("Taille de l'image inconnue");
+    otaSize = size;
+    if (!Update.begin(otaSize) || !Update.setMD5(otaMd5)) return otaFail("Update : " + Update.getErrorString());
+    otaLastData = millis();
+    return true;
+}
+
+/**
+ * Un bloc de l'image au plus, écrit dans la partition de mise à jour
+ * @return true si l'image est complète et son MD5 vérifié
+ */
+inline bool otaStep() {
+    WiFiClient *stream = otaHttp->getStreamPtr();
+    const size_t available = stream->available();
+    if (available == 0) {
+        if (otaHttp->connected() && millis() - otaLastData < OTA_READ_TIMEOUT_MS) return false;
+        Update.end(); // Image incomplète : abandonnée, jamais activée
+        return otaFail("Image incomplète (" + String(otaBytes) + "/" + String(otaSize) + ") " +
+                       Update.getErrorString());
+    }
+    uint8_t chunk[OTA_CHUNK_SIZE];
+    const size_t wanted = std::min<size_t>({sizeof(chunk), available, otaSize - otaBytes});
+    const size_t n = stream->readBytes(chunk, wanted);
+    if (otaBytes == 0 && n >= 2) otaCompressed = chunk[0] == 0x1f && chunk[1] == 0x8b;
+    if (Update.write(chunk, n) != n) {
+        Update.end();
+        return otaFail("Écriture : " + Update.getErrorString());
+    }
+    otaBytes += n;
+    otaLastData = millis();
+    if (otaBytes < otaSize) return false;
+
+    otaRelease();
+    // Commandes servies pendant le téléchargement : le point de contrôle est refait avant l'activation
+    if (!otaCheckpoint()) {
+        SPIFFS.remove(OTA_STATE_FILE);
+        MYDEBUG_WARNLN("-OTA : Point de contrôle final impossible, les commandes en file seront perdues");
+    }
+    if (!Update.end()) return otaFail("Vérification : " + Update.getErrorString());
+    return true;
+}
+
+/**
+ * Mise à jour demandée : point de contrôle et requête, puis un bloc par itération jusqu'au redémarrage
+ */
+inline void loopOta() {
+    if (otaState == OTA_PENDING) {
+        otaStart = millis();
+        otaBytes = 0;
+        otaSize = 0;
+        otaCompressed = false;
+        otaError = "";
+        MYDEBUG_PRINTLN("-OTA : Mise à jour depuis " + String(otaUrl));
+        if (!otaCheckpoint()) {
+            otaFail("Point de contrôle impossible");
+        } else if (otaBegin()) {
+            otaState = OTA_DOWNLOADING;
+        }
+        otaDurationMs = millis() - otaStart;
+        return;
+    }
+    if (otaState != OTA_DOWNLOADING) return;
+    const bool done = otaStep();
+    otaDurationMs = millis() - otaStart;
+    if (!done) return;
+
+    otaState = OTA_DONE;
+    MYDEBUG_PRINTLN("-OTA : " + String(otaBytes) + " octets" + (otaCompressed ? " (gzip)" : "") + " en " +
+                    String(otaDurationMs) + " ms, redémarrage");
+    flushDistributeurJournal();
+    delay(100);
+    EspClass::restart();
+}
+
+/**
+ * Fonction de gestion de la route /api/ota : GET pour l'état, POST authentifié (url, md5) pour lancer
+ * la mise à jour
+ */
+inline void handleApiOta(WebRequest &request) {
+    if (request.method() == HTTP_POST) {
+        if (!ota_password[0]) {
+            request.send(403, "text/plain", "Mise à jour désactivée : ota_password vide\n");
+            return;
+        }
+        if (!request.authenticate(OTA_USER, ota_password)) {
+            request.requestAuthentication();
+            return;
+        }
+        const String url = request.arg("url");
+        const String md5 = request.arg("md5");
+        if (!url.startsWith("http://") || url.length() >= OTA_URL_SIZE) {
+            request.send(400, "text/plain", "Paramètre url invalide (http:// uniquement)\n");
+            return;
+        }
+        bool md5Valid = md5.length() == OTA_MD5_SIZE - 1;
+        for (size_t i = 0; md5Valid && i < md5.length(); i++) md5Valid = isxdigit(md5[i]);
+        if (!md5Valid) {
+            request.send(400, "text/plain", "Paramètre md5 manquant ou invalide (32 chiffres hexadécimaux)\n");
+            return;
+        }
+        if (otaBusy() || otaState == OTA_DONE) {
+            request.send(409, "text/plain", "Mise à jour déjà en cours\n");
+            return;
+        }
+        strlcpy(otaUrl, url.c_str(), sizeof(otaUrl));
+        strlcpy(otaMd5, md5.c_str(), sizeof(otaMd5));
+        otaState = OTA_PENDING;
+    }
+
+    char out[256];
+    snprintf(out, sizeof(out),
+             "{\"etat\":\"%s\",\"url\":\"%s\",\"octets\":%u,\"taille\":%u,\"gzip\":%s,\"duree_ms\":%u,"
+             "\"erreur\":\"%s\"}",
+             otaStateNames[otaState], otaUrl, otaBytes, otaSize, otaCompressed ? "true" : "false", otaDurationMs,
+             otaError.c_str());
+    request.send(otaBusy() ? 202 : 200, "application/json", out);
+}
+
+inline void setupOta() {
+    webOn("/api/ota", HTTP_ANY, handleApiOta);
+}
@@ -0,0 +1,332 @@
+/**
+ * \file MyPipelineBench.h
+ * \page pipelinebench Benchmark de la chaîne de distribution
+ * \brief Latence commande → ready et débit de publication, mesurés sur le broker local
+ *
+ * Le benchmark ne s'exécute qu'avec le broker local (-DMYMQTT_LOCAL_BROKER), au démarrage de la carte ou
+ * sur la machine hôte (programme de src/host, sous-commande pipeline). Il travaille sur une chaîne de
+ * travail « bench » : quatre distributeurs créés pour l'occasion, avec leurs propres cases dans la table
+ * d'état (hors du journal, voir journalIdCount) et leurs propres feeds « bench-* ». Les stocks des bacs,
+ * le journal et les feeds de la chaîne par défaut ne sont pas touchés.
+ *
+ * Une commande est injectée sur le feed commande de la chaîne de travail comme si elle venait du tableau
+ * de bord Adafruit IO, puis on attend que le distributeur publie sur son feed ready. Le temps mesuré
+ * couvre donc toute la chaîne : réception MQTT → callback → commande() → Ticker d'envoi → publication.
+ *
+ * La mesure est répétée pour plusieurs latences injectées dans le broker, puis le débit de
+ * publication est mesuré en QoS 0 (sans accusé) et en QoS 1 (attente du PUBACK).
+ *
+ * Enfin, le coût d'une commande (cycles CPU de commande()) est comparé entre la chaîne configurable
+ * (MyDistributeur) et la chaîne figée à la compilation (MyStaticChain.h), pour une commande acceptée
+ * et pour une commande refusée après avoir parcouru toute la cascade.
+ *
+ * La planification du sommeil est rejouée sur une horloge virtuelle (sleepPlanSelfCheck()).
+ *
+ * Fichier \ref MyPipelineBench.h
+ */
+#pragma once
+
+#ifdef MYMQTT_LOCAL_BROKER
+
+#include "MyChain.h"
+#include "MyLocalBroker.h"
+#include "MyStaticChain.h"
+#include "MySleepPlan.h"
+
+#define BENCH_ORDERS            5       // Commandes par palier de latence
+#define BENCH_PUBLISHES         200     // Publications pour la mesure de débit
+#define BENCH_ORDER_TIMEOUT_MS  2000
+#define BENCH_SEND_PERIOD_SEC   0.01f   // Période d'envoi accélérée pendant le benchmark
+#define BENCH_REMOTE_REQUESTS   8       // Copulations distantes par palier de latence
+#define BENCH_CYCLE_ORDERS      50      // Commandes par mesure de cycles
+#define BENCH_NS                "bench" // Espace de noms des feeds de la chaîne de travail
+
+inline volatile unsigned long benchReadyAtUs = 0;
+inline MyChain *benchChain = nullptr;   // Chaîne de travail, créée au premier benchmark
+inline String benchReadyTopic;
+
+inline String benchTopic(const char *key) {
+    return String(IO_USERNAME FEED_PREFIX BENCH_NS) + CHAIN_NS_SEPARATOR + key;
+}
+
+inline void benchPublishHook(const char *topic, const uint8_t *, uint16_t) {
+    if (benchReadyAtUs == 0 && benchReadyTopic == topic) {
+        benchReadyAtUs = micros();
+    }
+}
+
+/**
+ * Niveaux de la chaîne de travail remis aux valeurs de la chaîne figée
+ */
+inline void benchChainReset(MyChain &chain) {
+    applyTraits<CroquetteTraits>(*chain.levels[0]);
+    applyTraits<PoissonRougeTraits>(*chain.levels[1]);
+    applyTraits<AchiganTraits>(*chain.levels[2]);
+    applyTraits<AchiganRestoTraits>(*chain.levels[3]);
+    for (MyDistributeur *level: chain.levels) level->annulerEnvoi();
+}
+
+/**
+ * Chaîne de travail ajoutée aux chaînes le temps du benchmark, pour l'aiguillage de ses feeds
+ * @return nullptr s'il ne reste pas de place pour une chaîne ou pour ses distributeurs
+ */
+inline MyChain *benchChainOpen() {
+    if (chainCount >= CHAIN_MAX) return nullptr;
+    if (!benchChain) {
+        if (distribSlotCount + CHAIN_LEVELS > DISTRIB_SLOTS) return nullptr;
+        benchChain = chainCreate(BENCH_NS, JsonObject());
+        for (uint8_t i = 0; i < CHAIN_LEVELS; i++) {
+            benchChain->levels[i]->setNiveau(i);
+            benchChain->levels[i]->setFeeds(&benchChain->feeds);
+        }
+        benchChain->publishPerSec = 1000; // Le benchmark mesure la chaîne, pas le budget de publication
+        benchReadyTopic = benchTopic(FEED_KEY(FEED_READY));
+    }
+    benchChainReset(*benchChain);
+    benchChain->levels[CHAIN_LEVELS - 1]->setNbBySecSend(BENCH_SEND_PERIOD_SEC);
+    chains[chainCount++] = benchChain;
+    return benchChain;
+}
+
+inline void benchChainClose() {
+    benchChainReset(*benchChain);
+    chains[--chainCount] = nullptr;
+    chainNext = 0;
+}
+
+/**
+ * Vide les trames déjà disponibles (échos de nos propres publications) sans attendre
+ */
+inline void benchDrain() {
+    do {
+        processMQTT();
+    } while (mqttMux.queued() > 0);
+}
+
+/**
+ * Attente des échos encore retenus par la latence du broker (nbration, commande), qui écraseraient
+ * l'état préparé pour la mesure suivante
+ */
+inline void benchSettle(const unsigned long latency) {
+    const unsigned long deadline = millis() + latency + 1;
+    while (static_cast<long>(millis() - deadline) < 0) {
+        processMQTT();
+        loopChains();
+        delay(1);
+    }
+    benchDrain();
+}
+
+/**
+ * Une commande de 1 ration, du feed commande jusqu'à la publication sur ready
+ * @return la latence en microsecondes, 0 si le délai est dépassé
+ */
+inline unsigned long benchOrder(const String &commandeTopic) {
+    loopWatchdogFeed(); // Le benchmark tourne dans la loop, chaque commande est bornée
+    benchReadyAtUs = 0;
+    const unsigned long start = micros();
+    client.inject(commandeTopic.c_str(), "1");
+
+    const unsigned long deadline = millis() + BENCH_ORDER_TIMEOUT_MS;
+    while (benchReadyAtUs == 0 && static_cast<long>(millis() - deadline) < 0) {
+        processMQTT();
+        loopChains();
+        delay(1);
+    }
+    return benchReadyAtUs ? benchReadyAtUs - start : 0;
+}
+
+inline float benchPublishRate(Adafruit_MQTT_Publish &publisher) {
+    loopWatchdogFeed();
+    uint16_t ok = 0;
+    const unsigned long start = micros();
+    for (uint16_t i = 0; i < BENCH_PUBLISHES; i++) {
+        if (publisher.publish(static_cast<int32_t>(i))) ok++;
+        benchDrain();
+    }
+    const unsigned long elapsed = micros() - start;
+    return elapsed ? ok * 1000000.0f / elapsed : 0;
+}
+
+/**
+ * Copulations distantes en pipeline : le dernier niveau de la chaîne de travail mange dans son niveau 2,
+ * chaque demande et chaque réponse fait l'aller-retour par le broker local (remoteLoopback)
+ * @param lateGranted réponses G arrivées après l'abandon de leur demande, appliquées au consommateur
+ * @return true si chaque cession du producteur a été reçue une fois par le consommateur, à temps ou en
+ * retard (idempotence des renvois, pas de rations perdues)
+ */
+inline bool benchRemote(MyChain &chain, const unsigned long latency, unsigned long &elapsedMs,
+                        uint32_t &granted, uint32_t &lateGranted) {
+    MyDistributeur &consumer = *chain.levels[CHAIN_LEVELS - 1];
+    MyDistributeur &producer = *chain.levels[2];
+    MyRemoteLink link(mqttNodeId(), BENCH_NS, 2);
+    consumer.setRemote(&link);
+    remoteLoopback = true;
+    const int producerBefore = producer.getRation();
+    const uint32_t grantedBefore = remoteStats.granted;
+    const uint32_t lateBefore = remoteStats.lateGranted;
+    client.setLatency(latency);
+
+    uint8_t sent = 0;
+    const unsigned long start = millis();
+    const unsigned long deadline = start + (REMOTE_RETRIES + 2) * REMOTE_TIMEOUT_MS + 2 * latency;
+    while ((sent < BENCH_REMOTE_REQUESTS || link.inflight(consumer) > 0) &&
+           static_cast<long>(millis() - deadline) < 0) {
+        loopWatchdogFeed();
+        if (sent < BENCH_REMOTE_REQUESTS && link.request(consumer, 1)) sent++;
+        processMQTT();
+        loopRemote();
+        delay(1);
+    }
+    elapsedMs = millis() - start;
+    link.cancel();
+    benchSettle(2 * latency); // Réponses des demandes abandonnées : appliquées en retard
+    remoteLoopback = false;
+    consumer.setRemote(nullptr);
+    granted = remoteStats.granted - grantedBefore;
+    lateGranted = remoteStats.lateGranted - lateBefore;
+    return producerBefore - producer.getRation() == static_cast<int>(granted + lateGranted);
+}
+
+/**
+ * Cycles moyens d'une commande sur la chaîne configurable puis sur la chaîne figée, depuis le même état,
+ * et comparaison des stocks des deux chaînes après chaque commande
+ * @param state rations du premier au dernier niveau
+ */
+inline void benchCommandeCycles(MyChain &bench, const char *label, const int nombre,
+                                const int32_t (&state)[DISTRIBUTEUR_COUNT]) {
+    static DefaultStaticChain chain(bench.levels[0]->feed(), bench.levels[1]->feed(), bench.levels[2]->feed(),
+                                    bench.levels[3]->feed());
+    std::apply([&bench](auto &... distributor) { ((distributor.feeds = &bench.feeds), ...); }, chain.levels);
+    MyDistributeur &last = *bench.levels[CHAIN_LEVELS - 1];
+    uint32_t runtimeCycles = 0;
+    uint32_t staticCycles = 0;
+    uint8_t runtimeOk = 0;
+    uint8_t staticOk = 0;
+    bool same = true;
+
+    loopWatchdogFeed();
+    for (uint8_t i = 0; i < BENCH_CYCLE_ORDERS; i++) {
+        for (uint8_t level = 0; level < DISTRIBUTEUR_COUNT; level++) bench.levels[level]->setRation(state[level]);
+        uint32_t start = ESP.getCycleCount();
+        runtimeOk += last.commande(nombre);
+        runtimeCycles += ESP.getCycleCount() - start;
+        last.annulerEnvoi();
+
+        chain.setValues(state);
+        start = ESP.getCycleCount();
+        staticOk += chain.commande(nombre);
+        staticCycles += ESP.getCycleCount() - start;
+        chain.last().annulerEnvoi();
+
+        int32_t staticState[DISTRIBUTEUR_COUNT];
+        chain.values(staticState);
+        for (uint8_t level = 0; level < DISTRIBUTEUR_COUNT; level++) {
+            same &= bench.levels[level]->getRation() == staticState[level];
+        }
+    }
+    MYDEBUG_PRINTLN("-BENCH : commande " + String(label) + " : configurable " +
+        String(runtimeCycles / BENCH_CYCLE_ORDERS) + " cycles (" + String(runtimeOk) + " acceptées), figée " +
+        String(staticCycles / BENCH_CYCLE_ORDERS) + " cycles (" + String(staticOk) + " acceptées), " +
+        (same && runtimeOk == staticOk ? "mêmes stocks" : "STOCKS DIFFÉRENTS"));
+}
+
+inline void benchPipeline() {
+    MYDEBUG_PRINTLN("===== BENCHMARK CHAINE (broker local) =====");
+
+    if (!MyAdafruitMqtt.connected() && MyAdafruitMqtt.connect() != 0) {
+        MYDEBUG_PRINTLN("-BENCH : Connexion au broker local impossible");
+        return;
+    }
+    MyChain *bench = benchChainOpen();
+    if (!bench) {
+        MYDEBUG_WARNLN("-BENCH : Plus de place pour la chaîne de travail");
+        return;
+    }
+    MyDistributeur &last = *bench->levels[CHAIN_LEVELS - 1];
+    client.setPublishHook(benchPublishHook);
+    client.resetStats();
+
+    // 1. Latence de bout en bout d'une commande
+    const String commandeTopic = benchTopic(FEED_KEY(FEED_COMMANDE));
+    for (const unsigned long latency: {0UL, 20UL, 100UL}) {
+        client.setLatency(latency);
+        unsigned long total = 0;
+        unsigned long worst = 0;
+        uint8_t ok = 0;
+
+        for (uint8_t i = 0; i < BENCH_ORDERS; i++) {
+            last.setRation(AchiganRestoTraits::nbRation);
+            if (const unsigned long us = benchOrder(commandeTopic)) {
+                total += us;
+                worst = std::max(worst, us);
+                ok++;
+            }
+            benchSettle(latency);
+        }
+
+        MYDEBUG_PRINTLN("-BENCH : commande -> ready, latence broker " + String(latency) + " ms : moyenne " +
+            String(ok ? total / ok : 0) + " us, max " + String(worst) + " us (" + String(ok) + "/" +
+            String(BENCH_ORDERS) + ")");
+    }
+
+    // 2. Débit de publication
+    client.setLatency(0);
+    Adafruit_MQTT_Publish pubBenchQos0(&MyAdafruitMqtt, benchReadyTopic.c_str());
+    Adafruit_MQTT_Publish pubBenchQos1(&MyAdafruitMqtt, benchReadyTopic.c_str(), MQTT_QOS_1);
+    const float rateQos0 = benchPublishRate(pubBenchQos0);
+    const float rateQos1 = benchPublishRate(pubBenchQos1);
+    MYDEBUG_PRINTLN("-BENCH : débit QoS0 " + String(rateQos0, 1) + " pub/s, QoS1 " + String(rateQos1, 1) + " pub/s");
+
+    const MyLocalBroker::Stats &stats = client.getStats();
+    MYDEBUG_PRINTLN("-BENCH : broker in=" + String(stats.packetsIn) + " out=" + String(stats.packetsOut) +
+        " publiés=" + String(stats.published) + " remis=" + String(stats.delivered) +
+        " perdus=" + String(stats.dropped));
+
+    // 3. Copulations distantes (requête/réponse), dont un palier au-delà du délai de renvoi
+    for (const unsigned long latency: {0UL, 20UL, REMOTE_TIMEOUT_MS + 200UL}) {
+        bench->levels[2]->setRation(1000);
+        const uint32_t retries = remoteStats.retries;
+        const uint32_t duplicates = remoteStats.duplicates;
+        unsigned long elapsed = 0;
+        uint32_t granted = 0;
+        uint32_t lateGranted = 0;
+        const bool conserved = benchRemote(*bench, latency, elapsed, granted, lateGranted);
+        MYDEBUG_PRINTLN("-BENCH : distant, latence broker " + String(latency) + " ms : " + String(granted) + "/" +
+            String(BENCH_REMOTE_REQUESTS) + " accordées en " + String(elapsed) + " ms (+" + String(lateGranted) +
+            " en retard), renvois " + String(remoteStats.retries - retries) + ", doublons " +
+            String(remoteStats.duplicates - duplicates) +
+            (conserved ? ", idempotent" : ", RATIONS PERDUES OU DÉBITÉES EN DOUBLE"));
+    }
+    client.setLatency(0);
+
+    // Transactions des copulations distantes : toutes doivent avoir reçu leur écho
+    loopTransactions();
+    char report[CHAIN_REPORT_LINE];
+    txnReport(report, sizeof(report));
+    MYDEBUG_PRINT("-BENCH : " + String(report));
+
+    // 4. Chaîne configurable et chaîne figée : même état, même commande
+    benchCommandeCycles(*bench, "acceptée", 1, {CroquetteTraits::nbRation, PoissonRougeTraits::nbRation,
+                                                AchiganTraits::nbRation, AchiganRestoTraits::nbRation});
+    // Dernier niveau au minimum, précédents pleins : toute la cascade est parcourue sans copulation
+    benchCommandeCycles(*bench, "refusée", 1, {CroquetteTraits::nbRation, PoissonRougeTraits::nbMax,
+                                               AchiganTraits::nbMax, AchiganRestoTraits::nbMin});
+    benchDrain();
+
+    // 5. Planification du sommeil, sur horloge virtuelle : aucune échéance manquée, courant estimé
+    SleepSimResult sleepResult;
+    const SleepPolicy policy;
+    const bool sleepOk = sleepPlanSelfCheck(policy, sleepResult);
+    MYDEBUG_PRINTLN("-BENCH : sommeil " + String(sleepOk ? "OK" : "ÉCHÉANCE MANQUÉE") + ", retard max " +
+        String(sleepResult.worstLateMs) + " ms, écart keepalive " + String(sleepResult.worstKeepaliveGapMs) +
+        " ms, " + String(sleepResult.wakeups) + " réveils, " + String(sleepResult.meter.averageMa(policy), 1) +
+        " mA moyens");
+
+    // Remise en état : la chaîne de travail quitte l'aiguillage
+    client.setPublishHook(nullptr);
+    benchChainClose();
+    MYDEBUG_PRINTLN("===== FIN BENCHMARK =====");
+}
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * \file MyRTC.h
+ * \page rtc Mémoire RTC
+ * \brief Données conservées à travers un redémarrage logiciel
+ *
+ * L'ESP8266 dispose de 512 octets de mémoire utilisateur dans le domaine RTC (128 blocs de 4 octets).
+ * Elle n'est pas effacée par un redémarrage logiciel, un reset du watchdog ou un réveil de deep sleep,
+ * mais l'est à la mise sous tension. Les 128 premiers octets (blocs 0 à 31) sont utilisés par la mise
+ * à jour OTA : nous ne les touchons pas.
+ *
+ * Chaque module dispose d'une zone fixe. Un enregistrement est précédé d'un nombre magique (qui dépend
+ * de la taille de la structure) et d'un CRC32 : après une mise sous tension ou un changement de format,
+ * la lecture échoue proprement au lieu de renvoyer des données aléatoires.
+ *
+ * Fichier \ref MyRTC.h
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#define RTC_BLOCK_SIZE  4
+#define RTC_BLOCK_COUNT 128
+#define RTC_MAGIC       0x44495300UL   // "DIS" + taille
+
+/**
+ * Zones de la mémoire RTC, en blocs de 4 octets
+ */
+enum RtcSlot : uint8_t {
+    RTC_SLOT_BOOT = 32,       // Chronologie du démarrage
+    RTC_SLOT_WATCHDOG = 64,   // Itérations lentes de la loop
+    RTC_SLOT_WIFI = 96,       // Cache de connexion WiFi
+};
+
+template<typename T>
+struct RtcRecord {
+    uint32_t magic;
+    uint32_t crc;
+    T data;
+};
+
+inline uint32_t rtcCrc32(const uint8_t *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (length--) {
+        crc ^= *data++;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+template<typename T>
+constexpr uint32_t rtcMagic() {
+    return RTC_MAGIC | (sizeof(T) & 0xFF);
+}
+
+/**
+ * Lecture d'une zone, false si elle ne contient pas un enregistrement valide de ce type
+ */
+template<typename T>
+bool rtcLoad(const RtcSlot slot, T &data) {
+    static_assert(sizeof(RtcRecord<T>) % RTC_BLOCK_SIZE == 0, "Taille RTC non multiple de 4 octets");
+    RtcRecord<T> record;
+    if (!ESP.rtcUserMemoryRead(slot, reinterpret_cast<uint32_t *>(&record), sizeof(record))) return false;
+    if (record.magic != rtcMagic<T>() ||
+        record.crc != rtcCrc32(reinterpret_cast<const uint8_t *>(&record.data), sizeof(T))) {
+        return false;
+    }
+    data = record.data;
+    return true;
+}
+
+template<typename T>
+bool rtcStore(const RtcSlot slot, const T &data) {
+    static_assert(sizeof(RtcRecord<T>) % RTC_BLOCK_SIZE == 0, "Taille RTC non multiple de 4 octets");
+    RtcRecord<T> record;
+    record.magic = rtcMagic<T>();
+    record.crc = rtcCrc32(reinterpret_cast<const uint8_t *>(&data), sizeof(T));
+    record.data = data;
+    return ESP.rtcUserMemoryWrite(slot, reinterpret_cast<uint32_t *>(&record), sizeof(record));
+}
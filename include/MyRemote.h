@@ -0,0 +1,308 @@
+/**
+ * \file MyRemote.h
+ * \page remote Précédent distant
+ * \brief Copulation avec un distributeur précédent situé sur une autre carte, par requête/réponse MQTT
+ *
+ * Un bac producteur (croquette, poisson rouge) peut alimenter des bacs consommateurs sur d'autres
+ * cartes. Le distributeur consommateur n'a plus de _precedent local mais un MyRemoteLink : sa
+ * copulation envoie une demande sur le feed remote.eat et le gain n'est appliqué qu'à la réponse.
+ *
+ * Messages (texte, séparés par des espaces) :
+ * - demande : « origine cible corrélation chaîne niveau eat », la chaîne du producteur étant « - »
+ *   pour sa chaîne par défaut ;
+ * - réponse sur remote.reply : « origine corrélation G|D restant » (G : accordé, D : refusé).
+ * L'origine est l'identifiant de la carte consommatrice, la cible celui de la carte productrice
+ * (ChipId en hexadécimal). Une carte ne sert que les demandes qui la ciblent, et jamais les siennes
+ * sauf en mode test (remoteLoopback).
+ *
+ * Fiabilité :
+ * - sans réponse après REMOTE_TIMEOUT_MS, la demande est renvoyée avec la même corrélation, au plus
+ *   REMOTE_RETRIES fois, puis elle échoue ;
+ * - le producteur garde les dernières réponses par (origine, corrélation) : une demande renvoyée est
+ *   répondue depuis ce cache sans manger une seconde fois (idempotence) ;
+ * - les corrélations partent d'une valeur aléatoire à chaque démarrage ;
+ * - une réponse G arrivée après l'abandon de sa demande (délai dépassé, annulation) est tout de même
+ *   appliquée au consommateur : le producteur a déjà cédé ses rations, elles ne sont pas perdues.
+ *
+ * Les demandes sont en pipeline : jusqu'à REMOTE_WINDOW demandes en vol par consommateur et
+ * REMOTE_PENDING_MAX pour la carte, publiées en QoS 0 sans attendre les réponses précédentes,
+ * qui sont associées à leur demande par la corrélation quel que soit leur ordre d'arrivée.
+ *
+ * Configuration d'une chaîne (dans /config.json, voir MyChain.h) :
+ * \code
+ * "precedent": {"noeud": "a1b2c3", "ns": "bac1", "niveau": 1, "depuis": 2}
+ * \endcode
+ * Le niveau depuis (achigan) de la chaîne mange dans le niveau 1 (poisson rouge) de la chaîne bac1
+ * de la carte a1b2c3. Les niveaux en amont ne sont plus utilisés (copulationSec à 0).
+ *
+ * Avec le broker local et remoteLoopback (mis par le benchmark de MyPipelineBench.h), une chaîne peut
+ * désigner une chaîne de la même carte : les messages font l'aller-retour par le broker, ce qui
+ * permet de tester le protocole sans seconde carte.
+ *
+ * Fichier \ref MyRemote.h
+ */
+#pragma once
+
+#include "MyDistributeur.h"
+
+#define REMOTE_PENDING_MAX   8       // Demandes en vol pour la carte
+#define REMOTE_WINDOW        2       // Demandes en vol par consommateur
+#define REMOTE_TIMEOUT_MS    1000
+#define REMOTE_RETRIES       3
+#define REMOTE_CACHE_SIZE    16      // Réponses conservées par le producteur
+#define REMOTE_NS_SIZE       16
+
+typedef MyDistributeur *(*RemoteResolver)(const char *ns, uint8_t level);
+
+struct RemoteStats {
+    uint32_t sent = 0;
+    uint32_t retries = 0;
+    uint32_t granted = 0;
+    uint32_t denied = 0;
+    uint32_t timeouts = 0;
+    uint32_t late = 0;             // Réponses arrivées après l'abandon ou en double
+    uint32_t lateGranted = 0;      // Dont réponses G appliquées au consommateur après l'abandon
+    uint32_t served = 0;           // Demandes traitées comme producteur
+    uint32_t duplicates = 0;       // Demandes renvoyées, répondues depuis le cache
+    uint32_t rttTotalMs = 0;
+    uint32_t rttMaxMs = 0;
+};
+
+class MyRemoteLink;
+
+struct RemoteRequest {
+    MyRemoteLink *link = nullptr;  // nullptr : case libre
+    MyDistributeur *consumer = nullptr;
+    uint32_t corr = 0;
+    unsigned long firstSentAt = 0;
+    unsigned long sentAt = 0;
+    int16_t eat = 0;
+    uint8_t attempts = 0;
+};
+
+// Demande abandonnée (les REMOTE_PENDING_MAX dernières) : sa réponse G revient encore au consommateur
+struct RemoteAbandoned {
+    MyDistributeur *consumer = nullptr;  // nullptr : case libre
+    uint32_t corr = 0;
+};
+
+struct RemoteServed {
+    char origin[MQTT_NODE_ID_SIZE] = "";
+    uint32_t corr = 0;
+    char status = 0;
+    int remaining = 0;
+};
+
+inline uint32_t remoteNextCorr = 0;
+inline RemoteRequest remotePending[REMOTE_PENDING_MAX];
+inline RemoteServed remoteServed[REMOTE_CACHE_SIZE];
+inline uint8_t remoteServedHead = 0;
+inline RemoteAbandoned remoteAbandoned[REMOTE_PENDING_MAX];
+inline uint8_t remoteAbandonedHead = 0;
+inline RemoteStats remoteStats;
+inline bool remoteLoopback = false;   // Mode test : la carte sert ses propres demandes (broker local)
+
+inline Adafruit_MQTT_Publish pubRemoteEat = Adafruit_MQTT_Publish(&MyAdafruitMqtt, IO_USERNAME FEED_REMOTE_EAT);
+inline Adafruit_MQTT_Publish pubRemoteReply = Adafruit_MQTT_Publish(&MyAdafruitMqtt, IO_USERNAME FEED_REMOTE_REPLY);
+
+inline void remoteSend(RemoteRequest &request);
+
+// Demande retirée des demandes en vol avant sa réponse (les distributeurs ne sont jamais libérés)
+inline void remoteAbandon(RemoteRequest &request) {
+    RemoteAbandoned &entry = remoteAbandoned[remoteAbandonedHead];
+    remoteAbandonedHead = (remoteAbandonedHead + 1) % REMOTE_PENDING_MAX;
+    entry.consumer = request.consumer;
+    entry.corr = request.corr;
+    request.link = nullptr;
+}
+
+class MyRemoteLink : public RemotePrecedent {
+    MyDistributeur *_consumer = nullptr;
+    bool _failed = false;
+
+public:
+    char node[MQTT_NODE_ID_SIZE] = "";  // Carte du producteur
+    String ns;        // Chaîne du producteur, « - » pour sa chaîne par défaut
+    uint8_t level;    // Niveau du producteur dans sa chaîne
+
+    MyRemoteLink(const char *producerNode, String ns, const uint8_t level)
+        : ns(ns.length() ? std::move(ns) : String("-")), level(level) {
+        strlcpy(node, producerNode, sizeof(node));
+    }
+
+    bool request(MyDistributeur &consumer, const int eat) override {
+        _consumer = &consumer;
+        if (inflight(consumer) >= REMOTE_WINDOW) return false;
+        for (RemoteRequest &request: remotePending) {
+            if (request.link) continue;
+            request.link = this;
+            request.consumer = &consumer;
+            request.corr = ++remoteNextCorr;
+            request.eat = eat;
+            request.attempts = 0;
+            request.firstSentAt = millis();
+            remoteSend(request);
+            remoteStats.sent++;
+            return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] uint8_t inflight(const MyDistributeur &) const override {
+        uint8_t n = 0;
+        for (const RemoteRequest &request: remotePending) {
+            if (request.link == this) n++;
+        }
+        return n;
+    }
+
+    bool takeFailure(const MyDistributeur &) override {
+        const bool failed = _failed;
+        _failed = false;
+        return failed;
+    }
+
+    void granted() {
+        _failed = false;
+        if (_consumer) _consumer->remoteGranted();
+    }
+
+    void failed() { _failed = true; }
+
+    // Abandon des demandes en vol : leurs réponses seront comptées comme tardives
+    void cancel() {
+        for (RemoteRequest &request: remotePending) {
+            if (request.link == this) remoteAbandon(request);
+        }
+        _failed = false;
+    }
+};
+
+inline void remoteSend(RemoteRequest &request) {
+    char payload[MQTT_MUX_PAYLOAD];
+    snprintf(payload, sizeof(payload), "%s %s %u %s %u %d", mqttNodeId(), request.link->node, request.corr,
+             request.link->ns.c_str(), request.link->level, request.eat);
+    request.sentAt = millis();
+    request.attempts++;
+    pubRemoteEat.publish(payload);
+}
+
+/**
+ * Demande reçue : traitée si elle cible cette carte et désigne un de ses distributeurs
+ */
+inline void remoteHandleRequest(const char *payload, uint16_t, const RemoteResolver resolve) {
+    char origin[MQTT_NODE_ID_SIZE];
+    char target[MQTT_NODE_ID_SIZE];
+    char ns[REMOTE_NS_SIZE];
+    uint32_t corr = 0;
+    unsigned level = 0;
+    int eat = 0;
+    if (sscanf(payload, "%8s %8s %u %15s %u %d", origin, target, &corr, ns, &level, &eat) != 6) return;
+    if (strcmp(target, mqttNodeId()) != 0) return;
+    if (!remoteLoopback && strcmp(origin, mqttNodeId()) == 0) return;
+    MyDistributeur *producer = resolve(ns, level);
+    if (!producer) return;
+
+    const RemoteServed *served = nullptr;
+    for (const RemoteServed &entry: remoteServed) {
+        if (entry.corr == corr && strcmp(entry.origin, origin) == 0) {
+            served = &entry;
+            break;
+        }
+    }
+    if (served) {
+        remoteStats.duplicates++;
+    } else {
+        RemoteServed &entry = remoteServed[remoteServedHead];
+        remoteServedHead = (remoteServedHead + 1) % REMOTE_CACHE_SIZE;
+        strlcpy(entry.origin, origin, sizeof(entry.origin));
+        entry.corr = corr;
+        entry.status = producer->ceder(eat) ? 'G' : 'D';
+        entry.remaining = producer->getRation();
+        served = &entry;
+        remoteStats.served++;
+    }
+
+    char reply[MQTT_MUX_PAYLOAD];
+    snprintf(reply, sizeof(reply), "%s %u %c %d", served->origin, served->corr, served->status, served->remaining);
+    pubRemoteReply.publish(reply);
+}
+
+/**
+ * Réponse reçue : associée à sa demande par la corrélation
+ */
+inline void remoteHandleReply(const char *payload, uint16_t) {
+    char origin[MQTT_NODE_ID_SIZE];
+    uint32_t corr = 0;
+    char status = 0;
+    int remaining = 0;
+    if (sscanf(payload, "%8s %u %c %d", origin, &corr, &status, &remaining) != 4) return;
+    if (strcmp(origin, mqttNodeId()) != 0) return;
+
+    for (RemoteRequest &request: remotePending) {
+        if (!request.link || request.corr != corr) continue;
+        const uint32_t rtt = millis() - request.firstSentAt;
+        remoteStats.rttTotalMs += rtt;
+        remoteStats.rttMaxMs = std::max(remoteStats.rttMaxMs, rtt);
+        MyRemoteLink *link = request.link;
+        request.link = nullptr;
+        request.consumer = nullptr;
+        if (status == 'G') {
+            remoteStats.granted++;
+            link->granted();
+        } else {
+            remoteStats.denied++;
+            link->failed();
+        }
+        return;
+    }
+    remoteStats.late++;
+
+    for (RemoteAbandoned &entry: remoteAbandoned) {
+        if (!entry.consumer || entry.corr != corr) continue;
+        MyDistributeur *consumer = entry.consumer;
+        entry.consumer = nullptr;
+        if (status == 'G') {
+            remoteStats.lateGranted++;
+            consumer->remoteGranted();
+        }
+        return;
+    }
+}
+
+/**
+ * Renvoi des demandes sans réponse, abandon après REMOTE_RETRIES renvois
+ */
+inline void loopRemote() {
+    const unsigned long now = millis();
+    for (RemoteRequest &request: remotePending) {
+        if (!request.link || now - request.sentAt < REMOTE_TIMEOUT_MS) continue;
+        if (request.attempts <= REMOTE_RETRIES) {
+            remoteStats.retries++;
+            remoteSend(request);
+        } else {
+            remoteStats.timeouts++;
+            request.link->failed();
+            remoteAbandon(request);
+        }
+    }
+}
+
+inline size_t remoteReport(char *out, const size_t size) {
+    uint8_t inflight = 0;
+    for (const RemoteRequest &request: remotePending) {
+        if (request.link) inflight++;
+    }
+    const uint32_t answered = remoteStats.granted + remoteStats.denied;
+    return snprintf(out, size,
+                    "distant %s : en_vol=%u envoyees=%u renvois=%u accordees=%u refusees=%u expirees=%u tardives=%u "
+                    "(appliquees %u) servies=%u doublons=%u rtt_moy=%u ms rtt_max=%u ms\n",
+                    mqttNodeId(), inflight, remoteStats.sent, remoteStats.retries, remoteStats.granted,
+                    remoteStats.denied, remoteStats.timeouts, remoteStats.late, remoteStats.lateGranted,
+                    remoteStats.served,
+                    remoteStats.duplicates, answered ? remoteStats.rttTotalMs / answered : 0, remoteStats.rttMaxMs);
+}
+
+inline void setupRemote() {
+    remoteNextCorr = ESP.random(); // Pas de collision avec les réponses en cache d'un démarrage précédent
+}
@@ -0,0 +1,162 @@
+/**
+ * \file MyRenderCache.h
+ * \page rendercache Cache des pages rendues
+ * \brief Pages du tableau de bord conservées tant que l'état de la carte n'a pas changé
+ *
+ * Le tableau de bord (/) était reconstruit à chaque requête, avec des dizaines de concaténations de
+ * String, alors que son contenu ne change qu'avec l'état : stocks, commandes, feed ready.
+ *
+ * stateVersion est incrémentée à chaque mutation de cet état : journalRecord() (toute variation du
+ * nombre de rations), commandes mises en file et valeurs reçues sur le feed ready. Une page rendue
+ * est gardée avec la version de son rendu ; tant que la version n'a pas changé, elle est servie
+ * depuis le cache. Plusieurs tableaux de bord qui rafraîchissent en même temps coûtent un rendu par
+ * changement d'état, pas un par requête.
+ *
+ * Une page peut contenir un emplacement vivant (RENDER_LIVE_MARK, l'heure du tableau de bord) :
+ * il est remplacé à chaque envoi, sans nouveau rendu.
+ *
+ * Mémoire : au plus RENDER_CACHE_BYTES pour toutes les pages, la moins récemment servie est évincée.
+ * Dès que le tas n'est plus au niveau ok, le cache est vidé et les pages sont rendues sans être
+ * gardées (heapShedCache()).
+ *
+ * Fichier \ref MyRenderCache.h
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "MyHeap.h"
+
+#define RENDER_CACHE_SLOTS   4
+#define RENDER_CACHE_BYTES   8192      // Plafond pour toutes les pages en cache
+#define RENDER_LIVE_MARK     '\x01'    // Emplacement remplacé à chaque envoi
+
+enum RenderPage : uint8_t {
+    RENDER_ROOT,
+};
+
+struct RenderEntry {
+    bool used = false;
+    RenderPage page = RENDER_ROOT;
+    uint8_t variant = 0;            // Variante de la page (connexion MQTT...)
+    uint32_t version = 0;
+    String body;
+    int liveAt = -1;                // Position de RENDER_LIVE_MARK, -1 sans emplacement vivant
+    unsigned long usedAt = 0;
+};
+
+struct RenderStats {
+    uint32_t hits = 0;
+    uint32_t renders = 0;
+    uint32_t evictions = 0;
+    uint32_t bypass = 0;            // Rendus non gardés : tas sous pression ou page plus grande que le plafond
+};
+
+typedef String (*RenderFunction)();
+
+inline volatile uint32_t stateVersion = 1;
+inline RenderEntry renderCache[RENDER_CACHE_SLOTS];
+inline RenderStats renderStats;
+
+/**
+ * Mutation de l'état affiché, utilisable depuis un Ticker ou un callback
+ */
+inline void stateChanged() {
+    stateVersion = stateVersion + 1;
+}
+
+inline size_t renderCacheBytes() {
+    size_t bytes = 0;
+    for (const RenderEntry &entry: renderCache) {
+        if (entry.used) bytes += entry.body.length();
+    }
+    return bytes;
+}
+
+inline RenderEntry *renderCacheFreeSlot() {
+    for (RenderEntry &entry: renderCache) {
+        if (!entry.used) return &entry;
+    }
+    return nullptr;
+}
+
+inline void renderCacheClear() {
+    for (RenderEntry &entry: renderCache) {
+        if (!entry.used) continue;
+        entry.used = false;
+        entry.body = String();
+        renderStats.evictions++;
+    }
+}
+
+inline String renderServe(const RenderEntry &entry, const RenderFunction live) {
+    if (entry.liveAt < 0 || !live) return entry.body;
+    const String value = live();
+    String out;
+    out.reserve(entry.body.length() + value.length());
+    out.concat(entry.body.c_str(), entry.liveAt);
+    out += value;
+    out += entry.body.c_str() + entry.liveAt + 1;
+    return out;
+}
+
+/**
+ * Page rendue pour la version courante de l'état, depuis le cache si possible
+ * @param live valeur de l'emplacement vivant (nullptr si la page n'en a pas)
+ */
+inline String renderCached(const RenderPage page, const uint8_t variant, const RenderFunction render,
+                           const RenderFunction live = nullptr) {
+    const uint32_t version = stateVersion;
+    for (RenderEntry &entry: renderCache) {
+        if (entry.used && entry.page == page && entry.variant == variant && entry.version == version) {
+            entry.usedAt = millis();
+            renderStats.hits++;
+            return renderServe(entry, live);
+        }
+    }
+
+    renderStats.renders++;
+    RenderEntry fresh;
+    fresh.body = render();
+    fresh.liveAt = fresh.body.indexOf(RENDER_LIVE_MARK);
+    if (heapShedCache() || fresh.body.length() > RENDER_CACHE_BYTES) {
+        renderCacheClear();
+        renderStats.bypass++;
+        return renderServe(fresh, live);
+    }
+
+    // La version périmée de la même page est remplacée
+    for (RenderEntry &entry: renderCache) {
+        if (!entry.used || entry.page != page || entry.variant != variant) continue;
+        entry.used = false;
+        entry.body = String();
+    }
+    // Plafond mémoire ou cases pleines : éviction de la page la moins récemment servie
+    const unsigned long now = millis();
+    RenderEntry *slot = renderCacheFreeSlot();
+    while (!slot || renderCacheBytes() + fresh.body.length() > RENDER_CACHE_BYTES) {
+        RenderEntry *oldest = nullptr;
+        for (RenderEntry &entry: renderCache) {
+            if (entry.used && (!oldest || now - entry.usedAt > now - oldest->usedAt)) oldest = &entry;
+        }
+        if (!oldest) break;
+        oldest->used = false;
+        oldest->body = String();
+        renderStats.evictions++;
+        if (!slot) slot = oldest;
+    }
+
+    fresh.used = true;
+    fresh.page = page;
+    fresh.variant = variant;
+    fresh.version = version;
+    fresh.usedAt = millis();
+    *slot = std::move(fresh);
+    return renderServe(*slot, live);
+}
+
+inline size_t renderReport(char *out, const size_t size) {
+    return snprintf(out, size, "version=%u rendus=%u succes=%u evictions=%u sans_cache=%u octets=%u/%u\n",
+                    stateVersion, renderStats.renders, renderStats.hits, renderStats.evictions, renderStats.bypass,
+                    static_cast<unsigned>(renderCacheBytes()), RENDER_CACHE_BYTES);
+}
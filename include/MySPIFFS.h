@@ -57,21 +57,7 @@ Sketch    OTA update   File system   EEPROM  WiFi config (SDK)
 
 inline String strConfigFile("/config.json");
 inline String strTestFile("/spiffs_test.txt");
-inline String strTrackingFile("/spiffs_tracking.txt");
-inline File configFile, trackingFile;
-
-inline void logTracking(const String &strTrackingText) {
-    trackingFile = SPIFFS.open(strTrackingFile, "a");
-    if (trackingFile) {
-        timeClient.update();
-        trackingFile.print(timeClient.getFormattedTime());
-        trackingFile.print("\t");
-        trackingFile.println(strTrackingText);
-        trackingFile.close();
-    } else {
-        MYDEBUG_PRINTLN("-SPIFFS : Impossible d'ouvrir le fichier");
-    }
-}
+inline File configFile;
 
 inline void setupSPIFFS(bool bFormat = false) {
     MYDEBUG_PRINTLN("-SPIFFS : Montage du système de fichier");
@@ -159,47 +145,35 @@ inline void setupSPIFFS(bool bFormat = false) {
                 // Ajout des paramètres WiFi
                 jsonDocument["ssid"] = String("");
                 jsonDocument["password"] = String("");
+                // Réseaux candidats supplémentaires, par ordre de préférence (voir MyWiFi.h)
+                jsonDocument.createNestedArray("reseaux");
+                // Point d'accès coupé après ce délai de connexion de la station (s, 0 : jamais)
+                jsonDocument["pointAcces"] = WIFI_AP_HOLD_SEC;
+
+                // Nombre de segments du journal de suivi conservés
+                jsonDocument["trackingRetention"] = 4;
+
+                // Budget de temps actif d'une itération de la loop (ms)
+                jsonDocument["loopBudgetMs"] = 100;
+
+                // Budgets des chaînes de distributeurs et chaînes supplémentaires (voir MyChain.h)
+                jsonDocument["chainBudgetUs"] = 20000;
+                jsonDocument["chainPublishPerSec"] = 2;
+                jsonDocument.createNestedArray("chaines");
 
                 // Sérialisation du JSON dans le fichier
                 if (serializeJson(jsonDocument, configFile) == 0) {
-                    MYDEBUG_PRINTLN("-SPIFFS : Impossible d'écrire le JSON dans le fichier de configuration");
+                    MYDEBUG_ERRORLN("-SPIFFS : Impossible d'écrire le JSON dans le fichier de configuration");
                 }
                 configFile.close();
                 MYDEBUG_PRINTLN("-SPIFFS : Fichier fermé");
             } else {
-                MYDEBUG_PRINTLN("-SPIFFS : Impossible d'ouvrir le fichier en écriture");
+                MYDEBUG_ERRORLN("-SPIFFS : Impossible d'ouvrir le fichier en écriture");
             }
         }
 
 
-        // Fichier de Tracking
-        if (SPIFFS.exists(strTrackingFile)) {
-            // ------------------------- Le fichier existe
-            //Ouverture du fichier en lecture
-            MYDEBUG_PRINTLN("-SPIFFS : Lecture du fichier de tracking");
-            trackingFile = SPIFFS.open(strTrackingFile, "r");
-            if (trackingFile) {
-                while (trackingFile.available()) {
-                    Serial.write(trackingFile.read());
-                }
-                MYDEBUG_PRINTLN("");
-            }
-            //trackingFile.close();
-            //MYDEBUG_PRINTLN("-SPIFFS: Fichier fermé");
-        } else {
-            // ------------------- Le fichier n'existe pas
-            // Initialisation du fichier de configuration avec des valeurs vides
-            MYDEBUG_PRINTLN("-SPIFFS: Le fichier de tracking n'existe pas");
-            trackingFile = SPIFFS.open(strTrackingFile, "w");
-            if (trackingFile) {
-                MYDEBUG_PRINTLN("-SPIFFS: Fichier créé");
-                // Fermeture du fichier
-                trackingFile.close();
-                MYDEBUG_PRINTLN("-SPIFFS : Fichier fermé");
-            } else {
-                MYDEBUG_PRINTLN("-SPIFFS : Impossible d'ouvrir le fichier en ecriture");
-            }
-        }
+        // Le journal de suivi (segments, fin affichée au démarrage) est géré par MyTracking.h
 
         //SPIFFS.end();
     } else {
@@ -0,0 +1,161 @@
+/**
+ * \file MySleep.h
+ * \page sleep Sommeil entre les échéances
+ * \brief La fin de la loop dort jusqu'à la prochaine échéance, radio coupée quand c'est possible
+ *
+ * La loop attendait 2 × 100 ms à chaque itération, radio allumée. Elle se termine désormais par
+ * loopSleep(), qui calcule la prochaine échéance :
+ * - Tickers des chaînes : étape d'envoi en cours (nbBySecSend) et copulations (copulationSec) ;
+ * - traitement MQTT périodique de la loop (1 s) et keepalive du broker (ping avant 30 s) ;
+ * - activité : travail en attente (commandes, messages, journal, blocs d'une mise à jour OTA) ou
+ *   requête HTTP récente ;
+ * et dort jusque-là avec le mode choisi par sleepPlan() (voir MySleepPlan.h) :
+ * - actif : radio allumée (travail en attente, client web, point d'accès) ;
+ * - modem : la radio ne se réveille qu'aux beacons, le CPU continue (intervalles courts) ;
+ * - léger : CPU suspendu aussi, réveil tous les listenInterval beacons, choisi pour qu'une commande
+ *   reçue attende au plus la moitié de orderLatencyMs.
+ * Le sommeil ne dépasse jamais orderLatencyMs : c'est le retard maximal ajouté à une commande. Une
+ * requête complète reçue par le serveur asynchrone (MyAsyncWeb.h) l'interrompt aussitôt.
+ *
+ * Le SDK ne coupe la radio qu'en mode Station seul : tant que le point d'accès de configuration
+ * est actif (WIFI_AP_STA), la loop attend sans couper la radio et le temps est compté comme actif.
+ * MyWiFi.h coupe ce point d'accès quand la station est connectée depuis "pointAcces" secondes et
+ * le rétablit à la perte du lien (voir wifiApPolicy()).
+ *
+ * Le courant moyen est estimé à partir du temps passé dans chaque mode (SleepPolicy::currentMa) ;
+ * il est publié toutes les SLEEP_TELEMETRY_MS sur le feed courant et affiché par /debug/sleep.
+ *
+ * Fichier \ref MySleep.h
+ */
+#pragma once
+
+#include "MySleepPlan.h"
+#include "MyChain.h"
+#include "MyOta.h"
+
+#define SLEEP_TELEMETRY_MS    60000
+#define SLEEP_KEEPALIVE_MS    30000   // Keepalive du client MQTT (setKeepAliveInterval)
+
+inline SleepPolicy sleepPolicy;
+inline SleepMeter sleepMeter;              // Depuis le démarrage
+inline SleepMeter sleepWindow;             // Depuis la dernière publication
+inline SleepDecision sleepLast;
+inline WiFiSleepType_t sleepRadio = WIFI_NONE_SLEEP;
+inline uint8_t sleepListen = 0;
+inline unsigned long sleepAwakeSince = 0;  // Fin du dernier sommeil : le temps de travail est compté actif
+inline unsigned long sleepWebAt = 0;
+inline bool sleepWebSeen = false;
+inline unsigned long sleepLastTelemetry = 0;
+
+inline Adafruit_MQTT_Publish pubCourant = Adafruit_MQTT_Publish(&MyAdafruitMqtt, IO_USERNAME FEED_COURANT);
+
+inline ESP8266WebServer::ClientFuture sleepWebHook(const String &, const String &, WiFiClient *,
+                                                   ESP8266WebServer::ContentTypeFunction) {
+    sleepWebAt = millis();
+    sleepWebSeen = true;
+    return ESP8266WebServer::CLIENT_REQUEST_CAN_CONTINUE;
+}
+
+inline void sleepAccount(const SleepMode mode, const uint32_t ms) {
+    sleepMeter.add(mode, ms);
+    sleepWindow.add(mode, ms);
+}
+
+/**
+ * Échéances et activité de la carte, vues de la planification
+ * @param processingInMs temps avant le prochain traitement MQTT de la loop
+ */
+inline SleepInputs sleepInputs(const uint32_t processingInMs) {
+    const unsigned long now = millis();
+    SleepInputs in;
+    in.timerInMs = processingInMs;
+    for (uint8_t c = 0; c < chainCount; c++) {
+        in.timerInMs = std::min(in.timerInMs, chains[c]->nextTickerInMs(now));
+        if (chains[c]->hasWork()) in.workPending = true;
+    }
+    if (mqttMux.queued() > 0 || journalHead != journalTail || asyncWebPending() || otaBusy()) in.workPending = true;
+    if (MyAdafruitMqtt.connected()) {
+        const uint32_t sincePing = now - mqttLastPing;
+        in.keepaliveInMs = sincePing < SLEEP_KEEPALIVE_MS ? SLEEP_KEEPALIVE_MS - sincePing : 0;
+    }
+    if (sleepWebSeen) in.webIdleMs = now - sleepWebAt;
+    if (asyncWebRequestSeen) in.webIdleMs = std::min<uint32_t>(in.webIdleMs, now - asyncWebLastRequest);
+    in.radioMaySleep = WiFi.getMode() == WIFI_STA && WiFi.status() == WL_CONNECTED;
+    return in;
+}
+
+/**
+ * Mode radio du SDK, changé seulement quand la décision change
+ */
+inline void sleepApplyRadio(const SleepDecision &decision) {
+    WiFiSleepType_t radio = WIFI_NONE_SLEEP;
+    if (decision.mode == SLEEP_MODEM) radio = WIFI_MODEM_SLEEP;
+    if (decision.mode == SLEEP_LIGHT) radio = WIFI_LIGHT_SLEEP;
+    const uint8_t listen = decision.mode == SLEEP_LIGHT ? decision.listenInterval : 0;
+    if (radio == sleepRadio && listen == sleepListen) return;
+    WiFi.setSleepMode(radio, listen);
+    sleepRadio = radio;
+    sleepListen = listen;
+}
+
+inline void sleepTelemetry() {
+    const unsigned long now = millis();
+    if (now - sleepLastTelemetry < SLEEP_TELEMETRY_MS || !MyAdafruitMqtt.connected()) return;
+    sleepLastTelemetry = now;
+    char payload[16];
+    snprintf(payload, sizeof(payload), "%.1f", sleepWindow.averageMa(sleepPolicy));
+    if (pubCourant.publish(payload)) sleepWindow = SleepMeter();
+}
+
+/**
+ * Fin de la loop : attente jusqu'à la prochaine échéance, dans le mode le plus économe possible
+ * @param processingInMs temps avant le prochain traitement MQTT de la loop
+ */
+inline void loopSleep(const uint32_t processingInMs) {
+    sleepTelemetry();
+    const unsigned long start = millis();
+    sleepAccount(SLEEP_NONE, start - sleepAwakeSince);
+
+    sleepLast = sleepPlan(sleepPolicy, sleepInputs(processingInMs));
+    sleepApplyRadio(sleepLast);
+    // Ne pas utiliser yield() directement : l'attente laisse la main au SDK, qui dort pendant ce temps.
+    // esp_schedule() (requête web complète) réveille la loop avant l'échéance
+    esp_delay(sleepLast.durationMs ? sleepLast.durationMs : 1, [] { return !asyncWebPending(); });
+
+    sleepAwakeSince = millis();
+    sleepAccount(sleepLast.mode, sleepAwakeSince - start);
+}
+
+inline size_t sleepReport(char *out, const size_t size) {
+    const uint64_t total = sleepMeter.total();
+    const auto percent = [total](const SleepMode mode) {
+        return total ? static_cast<unsigned>(sleepMeter.ms[mode] * 100 / total) : 0;
+    };
+    return snprintf(out, size,
+                    "sommeil : dernier=%s %u ms (ecoute %u) actif=%u%% modem=%u%% leger=%u%% "
+                    "courant_moyen=%.1f mA fenetre=%.1f mA\n",
+                    sleepModeNames[sleepLast.mode], sleepLast.durationMs, sleepLast.listenInterval,
+                    percent(SLEEP_NONE), percent(SLEEP_MODEM), percent(SLEEP_LIGHT),
+                    sleepMeter.averageMa(sleepPolicy), sleepWindow.averageMa(sleepPolicy));
+}
+
+inline void handleDebugSleep(WebRequest &request) {
+    char line[192];
+    String out;
+    sleepReport(line, sizeof(line));
+    out += line;
+    const SleepInputs in = sleepInputs(sleepPolicy.orderLatencyMs);
+    snprintf(line, sizeof(line), "echeances : ticker=%d ms keepalive=%d ms web=%d ms travail=%u radio=%s\n",
+             static_cast<int>(in.timerInMs), static_cast<int>(in.keepaliveInMs), static_cast<int>(in.webIdleMs),
+             in.workPending, in.radioMaySleep ? "peut dormir" : "allumee");
+    out += line;
+    request.send(200, "text/plain", out);
+}
+
+inline void setupSleep() {
+    sleepAwakeSince = millis();
+    monWebServeur.addHook(sleepWebHook);
+    webOn("/debug/sleep", HTTP_GET, handleDebugSleep);
+    MYDEBUG_PRINTLN("-SLEEP : Sommeil jusqu'à la prochaine échéance, au plus " +
+                    String(sleepPolicy.orderLatencyMs) + " ms");
+}
@@ -0,0 +1,203 @@
+/**
+ * \file MySleepPlan.h
+ * \page sleepplan Planification du sommeil
+ * \brief Choix du mode de sommeil et de sa durée à partir des prochaines échéances, sans dépendance matérielle
+ *
+ * La décision est une fonction pure : elle reçoit le temps restant avant chaque échéance (Tickers des
+ * distributeurs, traitement MQTT, keepalive) et l'activité en cours, et rend un mode et une durée.
+ * Ce fichier n'inclut rien de l'Arduino : il se compile tel quel sur la machine hôte, où
+ * sleepSimulate() rejoue des Tickers et un keepalive sur une horloge virtuelle pour vérifier
+ * qu'aucune échéance n'est manquée et estimer le courant moyen. Chaque réveil y coûte du temps actif
+ * (SleepPolicy::wakeActiveMs), plus le travail du Ticker échu ou du ping : sans ce coût, l'estimation
+ * ne ferait que redonner le courant du sommeil léger. MySleep.h branche la décision sur la loop ;
+ * test/test_sleep vérifie la décision et la simulation.
+ *
+ * Fichier \ref MySleepPlan.h
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define SLEEP_NO_DEADLINE   UINT32_MAX
+
+enum SleepMode : uint8_t {
+    SLEEP_NONE,     // Radio et CPU actifs
+    SLEEP_MODEM,    // Radio coupée entre les beacons, CPU actif
+    SLEEP_LIGHT,    // Radio et CPU suspendus entre les beacons écoutés
+    SLEEP_MODE_COUNT
+};
+
+inline const char *const sleepModeNames[SLEEP_MODE_COUNT] = {"actif", "modem", "leger"};
+
+struct SleepPolicy {
+    uint32_t busyDelayMs = 10;          // Du travail attend : la loop revient vite
+    uint32_t activeDelayMs = 100;       // Client web actif : réactivité de l'ancienne loop
+    uint32_t orderLatencyMs = 1000;     // Sommeil maximal, donc retard maximal d'une commande reçue
+    uint32_t modemMinMs = 200;          // Intervalle libre minimal pour couper la radio
+    uint32_t lightMinMs = 800;          // ... pour suspendre aussi le CPU
+    uint32_t keepaliveMarginMs = 2000;  // Réveil avant l'échéance du keepalive MQTT
+    uint32_t webActiveMs = 5000;        // Après une requête HTTP, pas de sommeil pendant ce temps
+    uint16_t beaconMs = 102;            // Intervalle des beacons du point d'accès (100 TU)
+    float currentMa[SLEEP_MODE_COUNT] = {75.0f, 16.0f, 3.0f};  // Modèle de consommation de l'ESP8266
+    uint32_t wakeActiveMs = 2;          // Modèle : reprise du SDK et itération de loop sans travail
+};
+
+struct SleepInputs {
+    uint32_t timerInMs = SLEEP_NO_DEADLINE;      // Prochain Ticker ou traitement périodique
+    uint32_t keepaliveInMs = SLEEP_NO_DEADLINE;  // Échéance du keepalive MQTT
+    uint32_t webIdleMs = SLEEP_NO_DEADLINE;      // Depuis la dernière requête HTTP
+    bool workPending = false;                    // Messages, travaux de chaîne ou journal en attente
+    bool radioMaySleep = true;                   // Faux en mode point d'accès : le SDK garde la radio
+};
+
+struct SleepDecision {
+    SleepMode mode = SLEEP_NONE;
+    uint32_t durationMs = 0;
+    uint8_t listenInterval = 1;   // Beacons sautés en sommeil léger
+};
+
+template <typename T>
+constexpr T sleepMin(const T a, const T b) { return a < b ? a : b; }
+
+/**
+ * Décision pour l'intervalle qui commence maintenant
+ */
+inline SleepDecision sleepPlan(const SleepPolicy &policy, const SleepInputs &in) {
+    SleepDecision decision;
+    if (in.workPending) {
+        decision.durationMs = policy.busyDelayMs;
+        return decision;
+    }
+    if (in.webIdleMs < policy.webActiveMs) {
+        decision.durationMs = policy.activeDelayMs;
+        return decision;
+    }
+
+    const uint32_t keepalive = in.keepaliveInMs > policy.keepaliveMarginMs
+                                   ? in.keepaliveInMs - policy.keepaliveMarginMs
+                                   : 0;
+    const uint32_t gap = sleepMin(sleepMin(in.timerInMs, keepalive), policy.orderLatencyMs);
+    decision.durationMs = gap;
+    if (!in.radioMaySleep || gap < policy.modemMinMs) return decision;
+
+    if (gap >= policy.lightMinMs) {
+        // Un message reçu attend au plus listenInterval beacons : la moitié du retard toléré
+        const uint32_t beacons = policy.orderLatencyMs / (2 * policy.beaconMs);
+        decision.mode = SLEEP_LIGHT;
+        decision.listenInterval = static_cast<uint8_t>(beacons < 1 ? 1 : sleepMin<uint32_t>(beacons, 10));
+    } else {
+        decision.mode = SLEEP_MODEM;
+    }
+    return decision;
+}
+
+/**
+ * Temps passé dans chaque mode et courant moyen estimé
+ */
+struct SleepMeter {
+    uint64_t ms[SLEEP_MODE_COUNT] = {};
+
+    void add(const SleepMode mode, const uint32_t duration) { ms[mode] += duration; }
+
+    [[nodiscard]] uint64_t total() const {
+        uint64_t sum = 0;
+        for (const uint64_t t: ms) sum += t;
+        return sum;
+    }
+
+    [[nodiscard]] float averageMa(const SleepPolicy &policy) const {
+        const uint64_t sum = total();
+        if (sum == 0) return policy.currentMa[SLEEP_NONE];
+        float charge = 0;
+        for (uint8_t m = 0; m < SLEEP_MODE_COUNT; m++) charge += ms[m] * policy.currentMa[m];
+        return charge / sum;
+    }
+};
+
+/**
+ * Horloge virtuelle : le temps n'avance que quand la simulation dort
+ */
+struct VirtualClock {
+    uint32_t now = 0;
+
+    void advance(const uint32_t ms) { now += ms; }
+};
+
+struct SleepSimTimer {
+    uint32_t periodMs;
+    uint32_t next;
+    uint32_t workMs;    // Temps actif du Ticker échu (envoi, copulation, traitement MQTT)
+};
+
+struct SleepSimResult {
+    uint32_t worstLateMs = 0;          // Plus grand retard d'un Ticker
+    uint32_t worstKeepaliveGapMs = 0;  // Plus grand écart entre deux pings
+    uint32_t wakeups = 0;
+    SleepMeter meter;
+};
+
+/**
+ * Simulation sur horloge virtuelle : Tickers périodiques, ping dès qu'il est dû, pas de trafic entrant.
+ * Chaque réveil compte wakeActiveMs actifs, plus le travail des Tickers échus et du ping, avant la
+ * décision suivante.
+ * @param keepaliveMs keepalive MQTT, un ping part quand il reste keepaliveMarginMs
+ * @param pingWorkMs temps actif d'un ping (envoi et réponse du broker)
+ */
+inline SleepSimResult sleepSimulate(const SleepPolicy &policy, SleepSimTimer *timers, const uint8_t count,
+                                    const uint32_t keepaliveMs, const uint32_t pingWorkMs,
+                                    const uint32_t durationMs) {
+    SleepSimResult result;
+    VirtualClock clock;
+    uint32_t lastPing = 0;
+    while (clock.now < durationMs) {
+        // Travail du réveil : lu à l'heure du réveil, avant que le temps actif ne s'écoule
+        uint32_t active = policy.wakeActiveMs;
+        for (uint8_t i = 0; i < count; i++) {
+            SleepSimTimer &timer = timers[i];
+            if (clock.now >= timer.next) {
+                const uint32_t late = clock.now - timer.next;
+                if (late > result.worstLateMs) result.worstLateMs = late;
+                while (timer.next <= clock.now) timer.next += timer.periodMs;
+                active += timer.workMs;
+            }
+        }
+        if (clock.now - lastPing + policy.keepaliveMarginMs >= keepaliveMs) {
+            if (clock.now - lastPing > result.worstKeepaliveGapMs) result.worstKeepaliveGapMs = clock.now - lastPing;
+            lastPing = clock.now;
+            active += pingWorkMs;
+        }
+        result.meter.add(SLEEP_NONE, active);
+        clock.advance(active);
+
+        SleepInputs in;
+        for (uint8_t i = 0; i < count; i++) {
+            // Ticker échu pendant le travail : la loop y revient sans dormir
+            const uint32_t next = timers[i].next;
+            in.timerInMs = sleepMin(in.timerInMs, next > clock.now ? next - clock.now : 0);
+        }
+        const uint32_t pingAt = lastPing + keepaliveMs;
+        in.keepaliveInMs = pingAt > clock.now ? pingAt - clock.now : 0;
+
+        const SleepDecision decision = sleepPlan(policy, in);
+        const uint32_t step = decision.durationMs ? decision.durationMs : 1;
+        result.meter.add(decision.mode, step);
+        result.wakeups++;
+        clock.advance(step);
+    }
+    return result;
+}
+
+/**
+ * Vérification de la planification : les Tickers du bac par défaut (copulations à 15 et 40 s, envoi
+ * à 10 s, traitement MQTT à 1 s) et un keepalive de 30 s pendant 10 minutes virtuelles. Travail
+ * estimé : 10 ms pour une copulation ou une étape d'envoi (publication), 5 ms pour le traitement MQTT
+ * et pour un ping.
+ * @return true si aucun Ticker n'est en retard et que le keepalive est toujours tenu
+ */
+inline bool sleepPlanSelfCheck(const SleepPolicy &policy, SleepSimResult &result) {
+    SleepSimTimer timers[] = {
+        {15000, 15000, 10}, {40000, 40000, 10}, {40000, 40000, 10}, {10000, 10000, 10}, {1000, 1000, 5}
+    };
+    result = sleepSimulate(policy, timers, sizeof(timers) / sizeof(timers[0]), 30000, 5, 600000);
+    return result.worstLateMs == 0 && result.worstKeepaliveGapMs <= 30000;
+}
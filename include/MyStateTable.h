@@ -0,0 +1,141 @@
+/**
+ * \file MyStateTable.h
+ * \page statetable Table d'état des distributeurs
+ * \brief État de tous les distributeurs en tableaux compacts, indexés par case, noms en flash
+ *
+ * Chaque MyDistributeur gardait son état dans l'objet : un String alloué sur le tas pour le nom, des
+ * int et des float dispersés entre le Ticker, le feed et la prévision. Les valeurs sont désormais
+ * rangées par champ (structure de tableaux), dans une case attribuée à la construction :
+ * - compteurs chauds (DistribHot) : stock, restant à envoyer, nbMin, nbMax, en int32_t parce que les
+ *   stocks de croquettes dépassent 32767. Ils forment un seul bloc contigu : l'instantané du journal
+ *   est une copie de distribHot.stock, la somme de contrôle et la persistance portent sur sizeof(DistribHot) ;
+ * - paramètres (DistribCold) : quantités par étape en uint16_t, périodes en millisecondes entières
+ *   (uint32_t, plus de float), identifiant du nom en uint8_t ;
+ * - noms : ceux du /config.json par défaut sont en flash, un nom lu dans la configuration qui n'y est
+ *   pas est copié une seule fois dans DISTRIB_NAME_POOL et partagé par les chaînes qui l'utilisent.
+ * Les cases sont attribuées dans l'ordre de construction : la chaîne par défaut, puis les chaînes
+ * de /config.json dans leur ordre. La case d'un distributeur est donc aussi son identifiant de journal.
+ *
+ * La mémoire par distributeur, avant et après la table, est affichée par /debug/chains
+ * (distribStateReport() dans MyDistributeur.h).
+ *
+ * Fichier \ref MyStateTable.h
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include "MyJournal.h"
+
+#define DISTRIB_SLOTS           JOURNAL_MAX_IDS
+#define DISTRIB_NAME_MAX        24      // Nom en flash, terminateur compris
+#define DISTRIB_NAME_POOL       96      // Noms lus dans la configuration, absents de la flash
+#define DISTRIB_NAME_NONE       UINT8_MAX
+
+// Compteurs lus et écrits à chaque étape : un seul bloc
+struct DistribHot {
+    int32_t stock[DISTRIB_SLOTS];       // nbRation
+    int32_t remaining[DISTRIB_SLOTS];   // Rations restant à envoyer (commande en cours)
+    int32_t nbMin[DISTRIB_SLOTS];
+    int32_t nbMax[DISTRIB_SLOTS];
+};
+
+// Paramètres, changés seulement par la configuration
+struct DistribCold {
+    uint32_t sendMs[DISTRIB_SLOTS];         // nbBySecSend
+    uint32_t copulationMs[DISTRIB_SLOTS];   // copulationSec, 0 sans copulation planifiée
+    uint16_t sendRation[DISTRIB_SLOTS];     // nbSendRation
+    uint16_t copulation[DISTRIB_SLOTS];
+    uint16_t eat[DISTRIB_SLOTS];
+    uint8_t nameId[DISTRIB_SLOTS];
+};
+
+// Noms du /config.json créé par défaut (voir MySPIFFS.h)
+inline const char distribFlashNames[][DISTRIB_NAME_MAX] PROGMEM = {
+    "Croquette", "Poisson Rouge", "Achigan", "Achigan du Restaurant"
+};
+constexpr uint8_t DISTRIB_FLASH_NAMES = sizeof(distribFlashNames) / sizeof(distribFlashNames[0]);
+
+inline DistribHot distribHot;
+inline DistribCold distribCold;
+inline uint8_t distribSlotCount = 0;
+inline char distribNamePool[DISTRIB_NAME_POOL];
+inline uint16_t distribNamePoolUsed = 0;
+
+// Quantité par étape ramenée à l'intervalle de uint16_t
+inline uint16_t distribNarrow(const int value) {
+    return static_cast<uint16_t>(std::min(std::max(value, 0), static_cast<int>(UINT16_MAX)));
+}
+
+// Période en secondes (configuration) vers des millisecondes entières, 0 pour une période nulle ou négative
+inline uint32_t distribPeriodMs(const float seconds) {
+    return seconds > 0 ? static_cast<uint32_t>(lroundf(seconds * 1000)) : 0;
+}
+
+/**
+ * Case d'un nouveau distributeur, avec les valeurs par défaut de MyDistributeur
+ */
+inline uint8_t distribStateAlloc() {
+    if (distribSlotCount >= DISTRIB_SLOTS) {
+        throw std::out_of_range("Table d'état des distributeurs pleine");
+    }
+    const uint8_t slot = distribSlotCount++;
+    distribHot.stock[slot] = 0;
+    distribHot.remaining[slot] = 0;
+    distribHot.nbMin[slot] = 2;
+    distribHot.nbMax[slot] = 20;
+    distribCold.sendMs[slot] = 10000;
+    distribCold.copulationMs[slot] = 10000;
+    distribCold.sendRation[slot] = 1;
+    distribCold.copulation[slot] = 2;
+    distribCold.eat[slot] = 2;
+    distribCold.nameId[slot] = DISTRIB_NAME_NONE;
+    return slot;
+}
+
+/**
+ * Identifiant d'un nom : en flash s'il y est, sinon copié une fois dans le pool
+ * @return DISTRIB_NAME_NONE si le pool est plein
+ */
+inline uint8_t distribNameIntern(const char *name) {
+    for (uint8_t i = 0; i < DISTRIB_FLASH_NAMES; i++) {
+        if (strcmp_P(name, distribFlashNames[i]) == 0) return i;
+    }
+    uint8_t id = DISTRIB_FLASH_NAMES;
+    uint16_t at = 0;
+    while (at < distribNamePoolUsed) {
+        if (strcmp(distribNamePool + at, name) == 0) return id;
+        at += strlen(distribNamePool + at) + 1;
+        id++;
+    }
+    const size_t size = strlen(name) + 1;
+    if (id == DISTRIB_NAME_NONE || at + size > DISTRIB_NAME_POOL) return DISTRIB_NAME_NONE;
+    memcpy(distribNamePool + at, name, size);
+    distribNamePoolUsed = at + size;
+    return id;
+}
+
+inline String distribNameOf(const uint8_t id) {
+    if (id < DISTRIB_FLASH_NAMES) return String(FPSTR(distribFlashNames[id]));
+    uint16_t at = 0;
+    for (uint8_t i = DISTRIB_FLASH_NAMES; at < distribNamePoolUsed; i++) {
+        if (i == id) return String(distribNamePool + at);
+        at += strlen(distribNamePool + at) + 1;
+    }
+    return String("?");
+}
+
+/**
+ * Somme de contrôle des compteurs de tous les distributeurs, en une passe sur le bloc
+ */
+inline uint32_t distribStateCrc() {
+    return rtcCrc32(reinterpret_cast<const uint8_t *>(&distribHot), sizeof(distribHot));
+}
+
+/**
+ * Stocks des count premières cases, dans l'ordre des identifiants du journal
+ */
+inline uint8_t distribStateStocks(int32_t *values, const uint8_t count) {
+    memcpy(values, distribHot.stock, count * sizeof(int32_t));
+    return count;
+}
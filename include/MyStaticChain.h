@@ -0,0 +1,282 @@
+/**
+ * \file MyStaticChain.h
+ * \page staticchain Chaîne de distributeurs figée à la compilation
+ * \brief Distributor<Traits> : limites, cadences et règles de copulation en constantes de compilation
+ *
+ * MyDistributeur garde tous ses paramètres en mémoire (table d'état, MyStateTable.h) pour que
+ * /config.json puisse les changer, et la cascade de copulation suit les pointeurs _precedent. Pour un
+ * déploiement figé, les paramètres d'un niveau sont une politique (Traits) et la chaîne une liste de types :
+ * \code
+ * using MaChaine = StaticChain<CroquetteTraits, PoissonRougeTraits, AchiganTraits, AchiganRestoTraits>;
+ * \endcode
+ * Le compilateur connaît alors la longueur de la chaîne et toutes les limites : la cascade est
+ * déroulée (pas de boucle sur des pointeurs), les comparaisons portent sur des constantes et les
+ * incohérences (nbMin > nbMax, copulation plus grande que la marge) sont refusées à la compilation.
+ *
+ * Le comportement est celui de MyDistributeur::commande() : le dernier niveau accepte la commande
+ * s'il lui reste nbMin après l'envoi. Sinon son précédent copule, en mangeant dans son propre
+ * précédent ; s'il ne peut pas, c'est au tour du niveau d'avant, jusqu'au deuxième niveau. Dès
+ * qu'une copulation réussit, la commande est réessayée. Le dernier niveau ne copule pas lui-même
+ * pendant une commande : il est réapprovisionné par son Ticker de copulation. Publications et journal
+ * sont identiques ; pas de prévision ni de précédent distant. Le test test/test_cascade vérifie que
+ * les deux chaînes finissent dans le même état après la même suite de commandes.
+ *
+ * MyDistributeur reste la classe utilisée par défaut (configuration à chaud). La comparaison des
+ * deux (cycles par commande) est faite par le benchmark du broker local, voir MyPipelineBench.h ;
+ * la taille de code se compare sur le .map du firmware (symboles Distributor<...> et MyDistributeur::).
+ *
+ * Fichier \ref MyStaticChain.h
+ */
+#pragma once
+
+#include <tuple>
+#include <utility>
+
+#include "MyDistributeur.h"
+
+/**
+ * Valeurs par défaut de MyDistributeur, à surcharger dans les Traits d'un niveau
+ */
+struct DistributorDefaults {
+    static constexpr int nbMin = 2;
+    static constexpr int nbMax = 20;
+    static constexpr int copulation = 2;
+    static constexpr int eat = 2;
+    static constexpr int nbSendRation = 1;
+    static constexpr float nbBySecSend = 10;
+};
+
+// Valeurs du /config.json créé par défaut (voir MySPIFFS.h)
+struct CroquetteTraits : DistributorDefaults {
+    static constexpr int nbRation = 30000;
+    static constexpr int nbMin = 1000;
+    static constexpr int nbMax = 50000;
+    static constexpr int nbSendRation = 1000;
+    static constexpr int copulation = 0;
+    static constexpr int eat = 0;
+};
+
+struct PoissonRougeTraits : DistributorDefaults {
+    static constexpr int nbRation = 30;
+    static constexpr int nbMin = 20;
+    static constexpr int nbMax = 100;
+    static constexpr int nbSendRation = 3;
+    static constexpr int copulation = 3;
+    static constexpr int eat = 2000;
+};
+
+struct AchiganTraits : DistributorDefaults {
+    static constexpr int nbRation = 10;
+    static constexpr int nbMin = 5;
+    static constexpr int nbSendRation = 2;
+    static constexpr int copulation = 1;
+    static constexpr int eat = 4;
+};
+
+struct AchiganRestoTraits : DistributorDefaults {
+    static constexpr int nbRation = 12;
+    static constexpr int nbMin = 5;
+    static constexpr int nbMax = 30;
+    static constexpr int copulation = 1;
+    static constexpr int eat = 1;
+};
+
+/**
+ * Paramètres et rations initiales d'un Traits recopiés sur un distributeur configurable, pour comparer
+ * les deux chaînes depuis le même état
+ */
+template <typename Traits>
+void applyTraits(MyDistributeur &distributeur) {
+    distributeur.setNbMin(Traits::nbMin);
+    distributeur.setNbMax(Traits::nbMax);
+    distributeur.setNbBySecSend(Traits::nbBySecSend);
+    distributeur.setNbSendRation(Traits::nbSendRation);
+    distributeur.setCopulation(Traits::copulation);
+    distributeur.setEat(Traits::eat);
+    distributeur.setRation(Traits::nbRation);
+}
+
+template <typename Traits>
+class Distributor {
+    static_assert(Traits::nbMin >= 0 && Traits::nbMin <= Traits::nbMax, "nbMin doit être entre 0 et nbMax");
+    static_assert(Traits::nbRation >= Traits::nbMin, "Le nombre de rations initial est inférieur au minimum");
+    static_assert(Traits::copulation >= 0 && Traits::copulation <= Traits::nbMax - Traits::nbMin,
+                  "La copulation doit tenir entre nbMin et nbMax");
+    static_assert(Traits::eat >= 0 && Traits::nbSendRation > 0, "eat et nbSendRation doivent être positifs");
+
+    int _restant = 0;
+    volatile bool _envoiDu = false;
+    Ticker _envoiTicker;
+    Adafruit_MQTT_Publish &_pub;
+
+public:
+    using traits = Traits;
+
+    int nbRation = Traits::nbRation;
+    uint8_t journalId = UINT8_MAX;   // UINT8_MAX : niveau non journalisé
+    uint8_t niveau = 0;              // Attribué par la chaîne
+    ChainFeeds *feeds = &defaultChainFeeds;
+
+    explicit Distributor(Adafruit_MQTT_Publish &pub) : _pub(pub) {
+    }
+
+    [[nodiscard]] bool accepte(const int nombre) const { return nbRation - nombre >= Traits::nbMin; }
+    [[nodiscard]] bool envoiEnCours() const { return _restant > 0; }
+
+    void journal(const JournalEventType type, const int32_t delta) const {
+        if (journalId != UINT8_MAX) journalRecord(type, journalId, delta, nbRation);
+    }
+
+    /**
+     * Démarrage de l'envoi progressif, la commande étant acceptée
+     */
+    void demarrer(const int nombre) {
+        _restant = nombre;
+        _envoiTicker.attach(Traits::nbBySecSend, [this]() { _envoiDu = true; });
+    }
+
+    void annulerEnvoi() {
+        _restant = 0;
+        _envoiDu = false;
+        _envoiTicker.detach();
+    }
+
+    /**
+     * Une étape de l'envoi progressif, si le Ticker l'a demandée
+     * @return true si des rations ont été envoyées
+     */
+    bool envoiStep() {
+        if (!_envoiDu) return false;
+        _envoiDu = false;
+        if (_restant <= 0) {
+            _envoiTicker.detach();
+            return false;
+        }
+
+        const int envoi = std::min(Traits::nbSendRation, _restant);
+        nbRation -= envoi;
+        journal(JOURNAL_DISPATCH, -envoi);
+        _restant -= envoi;
+
+        const int ready = ensureConnected() ? *feeds->readyValue : 0;
+        feeds->ready->publish(ready + envoi);
+        _pub.publish(nbRation);
+        feeds->commande->publish(_restant);
+        if (_restant <= 0) _envoiTicker.detach();
+        return true;
+    }
+
+    /**
+     * Copulation : ce niveau mange Traits::eat rations dans son précédent et en gagne Traits::copulation
+     */
+    template <typename Precedent>
+    bool copulation(Distributor<Precedent> &precedent) {
+        if constexpr (Traits::copulation == 0) return false; // Premier niveau : résolu à la compilation
+        if (nbRation < 0 || nbRation + Traits::copulation > Traits::nbMax ||
+            precedent.nbRation < Traits::eat + Precedent::nbMin || !ensureConnected()) {
+            return false;
+        }
+
+        precedent.nbRation -= Traits::eat;
+        nbRation += Traits::copulation;
+        precedent.journal(JOURNAL_COPULATION, -Traits::eat);
+        journal(JOURNAL_COPULATION, Traits::copulation);
+
+        const TxnPart parts[] = {{&precedent.feed(), precedent.niveau, precedent.nbRation}, {&_pub, niveau, nbRation}};
+        txnCommit(feeds->transaction, parts, 2);
+        return true;
+    }
+
+    Adafruit_MQTT_Publish &feed() { return _pub; }
+};
+
+/**
+ * Chaîne figée : Levels... du premier (sans précédent) au dernier (celui qui reçoit les commandes)
+ */
+template <typename... Levels>
+class StaticChain {
+    static_assert(sizeof...(Levels) > 0, "Une chaîne a au moins un niveau");
+
+public:
+    static constexpr size_t size = sizeof...(Levels);
+    std::tuple<Distributor<Levels>...> levels;
+
+    // Un Adafruit_MQTT_Publish par niveau, dans l'ordre de la chaîne
+    template <typename... Pubs>
+    explicit StaticChain(Pubs &... pubs) : levels(pubs...) {
+        static_assert(sizeof...(Pubs) == size, "Un feed par niveau");
+        std::apply([](auto &... distributor) {
+            uint8_t i = 0;
+            ((distributor.niveau = i++), ...);
+        }, levels);
+    }
+
+    template <size_t I>
+    auto &level() { return std::get<I>(levels); }
+
+    auto &last() { return level<size - 1>(); }
+
+    /**
+     * Cascade déroulée à la compilation : copulation du niveau I dans I - 1, sinon du niveau I - 1 dans
+     * I - 2... Le premier niveau n'a pas de précédent.
+     */
+    template <size_t I>
+    bool cascade() {
+        if constexpr (I == 0) {
+            return false;
+        } else {
+            return level<I>().copulation(level<I - 1>()) || cascade<I - 1>();
+        }
+    }
+
+    /**
+     * Cascade d'une commande, comme MyDistributeur::commande() : elle part du précédent du dernier niveau
+     */
+    bool cascadeCommande() {
+        if constexpr (size < 2) {
+            return false;
+        } else {
+            return cascade<size - 2>();
+        }
+    }
+
+    /**
+     * Commande sur le dernier niveau
+     * @return true si l'envoi progressif a démarré
+     */
+    bool commande(const int nombre) {
+        if (nombre < 0) return false;
+        // Une copulation réussie ne suffit pas toujours : on recommence tant que la cascade progresse
+        while (!last().accepte(nombre)) {
+            if (!cascadeCommande()) {
+                MYDEBUG_PRINTLN("Aucun distributeur n'a pu effectuer la copulation !");
+                return false;
+            }
+        }
+        last().demarrer(nombre);
+        return true;
+    }
+
+    bool envoiStep() { return last().envoiStep(); }
+
+    /**
+     * Nombres de rations, du premier au dernier niveau
+     */
+    void values(int32_t *out) {
+        std::apply([out](auto &... distributor) {
+            size_t i = 0;
+            ((out[i++] = distributor.nbRation), ...);
+        }, levels);
+    }
+
+    void setValues(const int32_t *in) {
+        std::apply([in](auto &... distributor) {
+            size_t i = 0;
+            ((distributor.nbRation = in[i++]), ...);
+        }, levels);
+    }
+};
+
+// Le déploiement par défaut, figé : mêmes feeds et mêmes valeurs initiales que les distributeurs
+using DefaultStaticChain = StaticChain<CroquetteTraits, PoissonRougeTraits, AchiganTraits, AchiganRestoTraits>;
+static_assert(DefaultStaticChain::size == DISTRIBUTEUR_COUNT, "La chaîne figée suit la chaîne par défaut");
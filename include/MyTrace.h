@@ -0,0 +1,498 @@
+/**
+ * \file MyTrace.h
+ * \page trace Capture et rejeu du trafic
+ * \brief Enregistrement des messages MQTT et des requêtes HTTP reçus, rejeu avec mesure de latence
+ *
+ * <H2>Capture</H2>
+ *
+ * Pendant une capture, chaque message MQTT routé (copie prise par le multiplexeur avant sa mise en file)
+ * et chaque requête HTTP (hook du serveur web) est ajouté à /trace/capture.bin :
+ * - un en-tête de 8 octets : décalage en ms depuis le début de la capture, type, longueur de la clé,
+ *   longueur des données ;
+ * - la clé (feed MQTT sans préfixe, ou méthode HTTP), puis les données (payload ou URL).
+ * Le feed est enregistré par son nom et non par l'index de sa route : une trace capturée en production
+ * reste rejouable sur un firmware dont la table des feeds a changé.
+ * La capture s'arrête d'elle-même à TRACE_MAX_BYTES. /trace/download télécharge la trace pour l'archiver.
+ *
+ * <H2>Rejeu</H2>
+ *
+ * Le rejeu n'existe qu'avec le broker local (-DMYMQTT_LOCAL_BROKER), pour ne rien publier sur
+ * io.adafruit.com. Sur la carte, il s'exécute dans la loop :
+ * /trace/replay?speed=1 respecte les intervalles d'origine, speed=10 les divise par 10, speed=0 enchaîne
+ * sans attente. Les messages MQTT sont injectés dans le multiplexeur et traités par processMQTT() : la
+ * latence couvre l'aiguillage, le handler et ses publications. Les requêtes HTTP sont rejouées sur
+ * &target=<ip> (une autre carte, le serveur web ne pouvant pas s'appeler lui-même), sinon comptées et ignorées.
+ * Une requête HTTP à la fois, sans attente : connexion et lecture de la réponse par les callbacks de lwIP,
+ * la loop ne fait que constater la fin ou le délai dépassé (TRACE_HTTP_TIMEOUT_MS). Au plus un
+ * enregistrement HTTP est lancé par itération, les messages MQTT suivants continuent pendant ce temps.
+ *
+ * Sur la machine hôte (environnement native), le même rejeu traite une trace téléchargée :
+ * \code
+ * .pio/build/native/program replay capture.bin [speed]
+ * \endcode
+ * les messages MQTT passent par le MyMQTT.h de la carte et le broker local ; les requêtes HTTP sont ignorées.
+ *
+ * /trace (et le rejeu de l'hôte, en fin de trace) affiche l'état, le débit et la distribution des latences
+ * (histogramme en puissances de 2).
+ *
+ * Fichier \ref MyTrace.h
+ */
+#pragma once
+
+#include <ESP8266WiFi.h>
+#include <lwip/tcp.h>
+
+#include "MyMQTT.h"
+#include "MySPIFFS.h"
+#include "MyWebServer.h"
+
+#define TRACE_DIR              "/trace"
+#define TRACE_FILE             TRACE_DIR "/capture.bin"
+#define TRACE_MAX_BYTES        65536
+#define TRACE_KEY_MAX          32
+#define TRACE_DATA_MAX         128
+#define TRACE_REPLAY_BATCH     8       // Enregistrements rejoués au plus par itération de la loop
+#define TRACE_HTTP_TIMEOUT_MS  2000
+#define TRACE_HTTP_REQUEST_MAX 256     // Ligne de requête et en-têtes d'une requête rejouée
+#define TRACE_BUCKETS          16      // Latences de 1 us à 32 ms et plus
+
+enum TraceKind : uint8_t {
+    TRACE_MQTT,
+    TRACE_HTTP,
+    TRACE_KIND_COUNT
+};
+
+inline const char *const traceKindNames[TRACE_KIND_COUNT] = {"mqtt", "http"};
+
+enum TraceState : uint8_t {
+    TRACE_IDLE,
+    TRACE_CAPTURING,
+    TRACE_REPLAYING,
+};
+
+struct TraceRecord {
+    uint32_t offsetMs = 0;
+    uint8_t kind = TRACE_MQTT;
+    uint8_t keyLen = 0;
+    uint16_t dataLen = 0;
+};
+
+static_assert(sizeof(TraceRecord) == 8, "Format des enregistrements de la trace");
+
+struct TraceLatency {
+    uint32_t count = 0;
+    uint32_t failed = 0;       // Route inconnue, file pleine, cible HTTP injoignable
+    uint32_t skipped = 0;      // Requêtes HTTP sans cible
+    uint64_t totalUs = 0;
+    uint32_t maxUs = 0;
+    uint32_t buckets[TRACE_BUCKETS] = {};
+
+    void add(const uint32_t us) {
+        count++;
+        totalUs += us;
+        maxUs = std::max(maxUs, us);
+        uint8_t bucket = 0;
+        while (bucket < TRACE_BUCKETS - 1 && (1UL << (bucket + 1)) <= us) bucket++;
+        buckets[bucket]++;
+    }
+
+    // Borne supérieure du seau qui contient le centile demandé
+    [[nodiscard]] uint32_t percentile(const uint8_t pct) const {
+        const uint32_t rank = (count * pct + 99) / 100;
+        uint32_t seen = 0;
+        for (uint8_t i = 0; i < TRACE_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen >= rank && seen > 0) return 1UL << (i + 1);
+        }
+        return maxUs;
+    }
+};
+
+inline TraceState traceState = TRACE_IDLE;
+inline File traceFile;
+inline uint32_t traceBytes = 0;
+inline uint32_t traceRecords = 0;
+inline unsigned long traceStartMs = 0;
+inline unsigned long traceEndMs = 0;
+inline float traceSpeed = 1;
+inline String traceTarget;
+inline IPAddress traceTargetIp;
+inline TraceLatency traceLatency[TRACE_KIND_COUNT];
+
+inline void traceCaptureStop();
+
+inline void traceAppend(const TraceKind kind, const char *key, const size_t keyLen, const char *data,
+                        const size_t dataLen) {
+    if (traceState != TRACE_CAPTURING) return;
+
+    TraceRecord record;
+    record.offsetMs = millis() - traceStartMs;
+    record.kind = kind;
+    record.keyLen = std::min<size_t>(keyLen, TRACE_KEY_MAX);
+    record.dataLen = std::min<size_t>(dataLen, TRACE_DATA_MAX);
+    const uint32_t size = sizeof(record) + record.keyLen + record.dataLen;
+    if (traceBytes + size > TRACE_MAX_BYTES) {
+        traceCaptureStop();
+        return;
+    }
+    traceFile.write(reinterpret_cast<const uint8_t *>(&record), sizeof(record));
+    traceFile.write(reinterpret_cast<const uint8_t *>(key), record.keyLen);
+    traceFile.write(reinterpret_cast<const uint8_t *>(data), record.dataLen);
+    traceBytes += size;
+    traceRecords++;
+}
+
+inline void traceCaptureMqtt(const char *key, const size_t keyLen, const char *payload, const uint16_t len) {
+    traceAppend(TRACE_MQTT, key, keyLen, payload, len);
+}
+
+inline ESP8266WebServer::ClientFuture traceCaptureHttp(const String &method, const String &url, WiFiClient *,
+                                                       ESP8266WebServer::ContentTypeFunction) {
+    // Les requêtes de pilotage de la trace ne font pas partie du trafic
+    if (traceState == TRACE_CAPTURING && !url.startsWith(TRACE_DIR)) {
+        traceAppend(TRACE_HTTP, method.c_str(), method.length(), url.c_str(), url.length());
+    }
+    return ESP8266WebServer::CLIENT_REQUEST_CAN_CONTINUE;
+}
+
+// Même capture pour les requêtes du serveur asynchrone (port 80)
+inline void traceCaptureAsyncHttp(AsyncWebRequest &request) {
+    if (traceState != TRACE_CAPTURING || strncmp(request.path, TRACE_DIR, strlen(TRACE_DIR)) == 0) return;
+    String url = request.path;
+    if (*request.query) url += "?" + String(request.query);
+    const char *method = request.methodName();
+    traceAppend(TRACE_HTTP, method, strlen(method), url.c_str(), url.length());
+}
+
+inline bool traceCaptureStart() {
+    if (traceState != TRACE_IDLE) return false;
+    SPIFFS.mkdir(TRACE_DIR);
+    traceFile = SPIFFS.open(TRACE_FILE, "w");
+    if (!traceFile) return false;
+    traceBytes = 0;
+    traceRecords = 0;
+    traceStartMs = millis();
+    traceState = TRACE_CAPTURING;
+    mqttMux.setCapture(traceCaptureMqtt);
+    MYDEBUG_PRINTLN("-TRACE : Capture démarrée");
+    return true;
+}
+
+inline void traceCaptureStop() {
+    if (traceState != TRACE_CAPTURING) return;
+    mqttMux.setCapture(nullptr);
+    traceFile.close();
+    traceEndMs = millis();
+    traceState = TRACE_IDLE;
+    MYDEBUG_PRINTLN("-TRACE : Capture terminée, " + String(traceRecords) + " enregistrements, " +
+        String(traceBytes) + " octets");
+}
+
+#ifdef MYMQTT_LOCAL_BROKER
+
+enum TraceHttpState : uint8_t {
+    TRACE_HTTP_IDLE,
+    TRACE_HTTP_CONNECTING,  // tcp_connect() lancé
+    TRACE_HTTP_WAITING,     // Requête envoyée, réponse lue jusqu'à la fermeture par la cible
+    TRACE_HTTP_DONE,        // Réponse complète, latence à compter par la loop
+    TRACE_HTTP_FAILED,      // Connexion refusée ou perdue
+};
+
+/**
+ * Requête HTTP rejouée en cours ; état écrit par les callbacks de lwIP, lu par la loop
+ */
+struct TraceHttp {
+    tcp_pcb *pcb = nullptr;
+    volatile TraceHttpState state = TRACE_HTTP_IDLE;
+    char request[TRACE_HTTP_REQUEST_MAX];
+    uint16_t length = 0;
+    unsigned long startUs = 0;
+    unsigned long startMs = 0;
+    volatile uint32_t latencyUs = 0;
+};
+
+inline TraceHttp traceHttp;
+
+inline void traceHttpDetach(tcp_pcb *pcb) {
+    tcp_arg(pcb, nullptr);
+    tcp_recv(pcb, nullptr);
+    tcp_err(pcb, nullptr);
+    traceHttp.pcb = nullptr;
+}
+
+// Le pcb est déjà libéré par lwIP
+inline void traceHttpOnError(void *, err_t) {
+    traceHttp.pcb = nullptr;
+    traceHttp.state = TRACE_HTTP_FAILED;
+}
+
+inline err_t traceHttpOnRecv(void *, tcp_pcb *pcb, pbuf *p, err_t) {
+    if (!p) {
+        // Connection: close : la fermeture par la cible termine la réponse
+        traceHttp.latencyUs = std::max<uint32_t>(micros() - traceHttp.startUs, 1);
+        traceHttpDetach(pcb);
+        traceHttp.state = TRACE_HTTP_DONE;
+        if (tcp_close(pcb) != ERR_OK) {
+            tcp_abort(pcb);
+            return ERR_ABRT;
+        }
+        return ERR_OK;
+    }
+    tcp_recved(pcb, p->tot_len); // Réponse ignorée, seule sa fin compte
+    pbuf_free(p);
+    return ERR_OK;
+}
+
+inline err_t traceHttpOnConnected(void *, tcp_pcb *pcb, err_t) {
+    if (tcp_write(pcb, traceHttp.request, traceHttp.length, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+        traceHttpDetach(pcb);
+        traceHttp.state = TRACE_HTTP_FAILED;
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    tcp_output(pcb);
+    traceHttp.state = TRACE_HTTP_WAITING;
+    return ERR_OK;
+}
+
+/**
+ * Lancement d'une requête sur la cible, sans attendre la connexion
+ * @return false si la requête n'a pas pu partir
+ */
+inline bool traceHttpStart(const char *method, const char *url) {
+    const int length = snprintf(traceHttp.request, sizeof(traceHttp.request),
+                                "%s %s HTTP/1.0\r\nHost: %s\r\nConnection: close\r\n\r\n", method, url,
+                                traceTarget.c_str());
+    if (length <= 0 || length >= static_cast<int>(sizeof(traceHttp.request))) return false;
+    tcp_pcb *pcb = tcp_new();
+    if (!pcb) return false;
+    traceHttp.length = length;
+    traceHttp.pcb = pcb;
+    traceHttp.state = TRACE_HTTP_CONNECTING;
+    traceHttp.startUs = micros();
+    traceHttp.startMs = millis();
+    tcp_recv(pcb, traceHttpOnRecv);
+    tcp_err(pcb, traceHttpOnError);
+    const ip_addr_t address = IPADDR4_INIT(static_cast<uint32_t>(traceTargetIp));
+    if (tcp_connect(pcb, &address, 80, traceHttpOnConnected) != ERR_OK) {
+        traceHttpDetach(pcb);
+        tcp_close(pcb);
+        traceHttp.state = TRACE_HTTP_IDLE;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Fin de la requête en cours constatée par la loop, délai dépassé compris
+ * @return true tant que la requête occupe la connexion
+ */
+inline bool traceHttpPoll() {
+    TraceLatency &latency = traceLatency[TRACE_HTTP];
+    switch (traceHttp.state) {
+        case TRACE_HTTP_IDLE:
+            return false;
+        case TRACE_HTTP_DONE:
+            latency.add(traceHttp.latencyUs);
+            break;
+        case TRACE_HTTP_FAILED:
+            latency.failed++;
+            break;
+        default:
+            if (millis() - traceHttp.startMs < TRACE_HTTP_TIMEOUT_MS) return true;
+            if (tcp_pcb *pcb = traceHttp.pcb) {
+                traceHttpDetach(pcb);
+                tcp_abort(pcb);
+            }
+            latency.failed++;
+            break;
+    }
+    traceHttp.state = TRACE_HTTP_IDLE;
+    return false;
+}
+
+inline bool traceReplayStart(const float speed, const String &target) {
+    if (traceState != TRACE_IDLE) return false;
+    if (target.length() && !traceTargetIp.fromString(target.c_str())) return false;
+    traceFile = SPIFFS.open(TRACE_FILE, "r");
+    if (!traceFile) return false;
+    for (auto &latency: traceLatency) latency = TraceLatency();
+    traceSpeed = speed;
+    traceTarget = target;
+    traceBytes = traceFile.size();
+    traceRecords = 0;
+    traceStartMs = millis();
+    traceState = TRACE_REPLAYING;
+    MYDEBUG_PRINTLN("-TRACE : Rejeu démarré, vitesse x" + String(speed, 1));
+    return true;
+}
+
+inline void traceReplayStop() {
+    traceFile.close();
+    traceEndMs = millis();
+    traceState = TRACE_IDLE;
+    MYDEBUG_PRINTLN("-TRACE : Rejeu terminé, " + String(traceRecords) + " enregistrements en " +
+        String(traceEndMs - traceStartMs) + " ms");
+}
+
+/**
+ * Rejeu des enregistrements arrivés à échéance : au plus TRACE_REPLAY_BATCH messages MQTT et une
+ * requête HTTP par itération
+ */
+inline void traceReplayStep() {
+    const bool httpBusy = traceHttpPoll();
+    for (uint8_t n = 0; n < TRACE_REPLAY_BATCH; n++) {
+        const size_t position = traceFile.position();
+        TraceRecord record;
+        if (traceFile.read(reinterpret_cast<uint8_t *>(&record), sizeof(record)) != sizeof(record) ||
+            record.kind >= TRACE_KIND_COUNT || record.keyLen > TRACE_KEY_MAX || record.dataLen > TRACE_DATA_MAX) {
+            if (httpBusy) {
+                traceFile.seek(position); // Fin de la trace après la dernière réponse
+            } else {
+                traceReplayStop();
+            }
+            return;
+        }
+        const unsigned long due = traceSpeed > 0 ? record.offsetMs / traceSpeed : 0;
+        if (millis() - traceStartMs < due || (record.kind == TRACE_HTTP && httpBusy && traceTarget.length())) {
+            traceFile.seek(position); // Pas encore : relu à la prochaine itération
+            return;
+        }
+
+        char key[TRACE_KEY_MAX + 1];
+        char data[TRACE_DATA_MAX + 1];
+        if (traceFile.read(reinterpret_cast<uint8_t *>(key), record.keyLen) != record.keyLen ||
+            traceFile.read(reinterpret_cast<uint8_t *>(data), record.dataLen) != record.dataLen) {
+            traceReplayStop();
+            return;
+        }
+        key[record.keyLen] = '\0';
+        data[record.dataLen] = '\0';
+        traceRecords++;
+
+        TraceLatency &latency = traceLatency[record.kind];
+        if (record.kind == TRACE_MQTT) {
+            const unsigned long start = micros();
+            if (mqttMux.inject(mqttMux.route(key, record.keyLen), data, record.dataLen)) {
+                processMQTT();
+                latency.add(micros() - start);
+            } else {
+                latency.failed++;
+            }
+        } else if (traceTarget.length() == 0) {
+            latency.skipped++;
+        } else {
+            if (!traceHttpStart(key, data)) latency.failed++;
+            return; // Une requête HTTP par itération
+        }
+    }
+}
+
+#endif
+
+/**
+ * Avancement de la capture ou du rejeu, dans la loop
+ */
+inline void loopTrace() {
+#ifdef MYMQTT_LOCAL_BROKER
+    if (traceState == TRACE_REPLAYING) traceReplayStep();
+#endif
+}
+
+/**
+ * État, débit et distribution des latences du dernier rejeu : texte de /trace et du rejeu de l'hôte
+ */
+inline size_t traceReport(char *out, const size_t size) {
+    static const char *const stateNames[] = {"inactive", "capture", "rejeu"};
+    const unsigned long elapsed = (traceState == TRACE_IDLE ? traceEndMs : millis()) - traceStartMs;
+    size_t n = snprintf(out, size, "etat=%s enregistrements=%u octets=%u duree=%lu ms\n",
+                        stateNames[traceState], traceRecords, traceBytes, elapsed);
+    if (elapsed > 0 && n < size) {
+        n += snprintf(out + n, size - n, "debit=%.1f msg/s\n", traceRecords * 1000.0f / elapsed);
+    }
+    for (uint8_t kind = 0; kind < TRACE_KIND_COUNT && n < size; kind++) {
+        const TraceLatency &l = traceLatency[kind];
+        n += snprintf(out + n, size - n,
+                      "%s n=%u echecs=%u ignores=%u moyenne=%u us p50<=%u us p95<=%u us p99<=%u us max=%u us\n",
+                      traceKindNames[kind], l.count, l.failed, l.skipped,
+                      l.count ? static_cast<uint32_t>(l.totalUs / l.count) : 0, l.percentile(50), l.percentile(95),
+                      l.percentile(99), l.maxUs);
+    }
+    return std::min(n, size);
+}
+
+/**
+ * Fonction de gestion de la route /trace : état et résultats du dernier rejeu
+ */
+inline void handleTrace(WebRequest &request) {
+    char out[768];
+    traceReport(out, sizeof(out));
+    request.send(200, "text/plain", String(out));
+}
+
+/**
+ * Fonction de gestion de la route /trace/capture?action=start|stop
+ */
+inline void handleTraceCapture(WebRequest &request) {
+    const String action = request.arg("action");
+    bool ok = false;
+    if (action == "start") {
+        ok = traceCaptureStart();
+    } else if (action == "stop") {
+        ok = traceState == TRACE_CAPTURING;
+        traceCaptureStop();
+    }
+    request.send(ok ? 200 : 409, "text/plain", ok ? "OK\n" : "Action impossible dans l'état courant\n");
+}
+
+/**
+ * Fonction de gestion de la route /trace/replay?speed=&target=
+ */
+inline void handleTraceReplay(WebRequest &request) {
+#ifdef MYMQTT_LOCAL_BROKER
+    const float speed = request.hasArg("speed") ? request.arg("speed").toFloat() : 1;
+    const String target = request.arg("target");
+    IPAddress address;
+    if (target.length() && !address.fromString(target.c_str())) {
+        request.send(400, "text/plain", "target : adresse IP attendue\n");
+    } else if (traceReplayStart(std::max(speed, 0.0f), target)) {
+        request.send(202, "text/plain", "Rejeu démarré, résultats sur /trace\n");
+    } else {
+        request.send(409, "text/plain", "Pas de trace ou capture en cours\n");
+    }
+#else
+    request.send(501, "text/plain", "Rejeu disponible uniquement avec le broker local\n");
+#endif
+}
+
+/**
+ * Fonction de gestion de la route /trace/download : la trace brute
+ */
+inline void handleTraceDownload() {
+    if (traceState != TRACE_IDLE) {
+        monWebServeur.send(409, "text/plain", "Capture ou rejeu en cours\n");
+        return;
+    }
+    File file = SPIFFS.open(TRACE_FILE, "r");
+    if (!file) {
+        monWebServeur.send(404, "text/plain", "Pas de trace\n");
+        return;
+    }
+    monWebServeur.setContentLength(file.size());
+    monWebServeur.send(200, "application/octet-stream", "");
+    char buffer[256];
+    while (const int n = file.read(reinterpret_cast<uint8_t *>(buffer), sizeof(buffer))) {
+        if (n < 0) break;
+        monWebServeur.sendContent(buffer, n);
+    }
+    file.close();
+}
+
+inline void setupTrace() {
+    monWebServeur.addHook(traceCaptureHttp);
+    asyncWebObserver = traceCaptureAsyncHttp;
+    webOn("/trace", HTTP_GET, handleTrace);
+    webOn("/trace/capture", HTTP_GET, handleTraceCapture);
+    webOn("/trace/replay", HTTP_GET, handleTraceReplay);
+    webOnSyncOnly("/trace/download", HTTP_GET, handleTraceDownload);
+}
@@ -0,0 +1,368 @@
+/**
+ * \file MyTracking.h
+ * \page tracking Journal de suivi
+ * \brief Journal de suivi horodaté (epoch), indexé par heure et découpé en segments de taille bornée
+ *
+ * Chaque enregistrement du journal est une ligne « epoch\ttexte », l'epoch étant en secondes UTC.
+ * Une ligne écrite avant la première synchronisation NTP porte l'epoch 0 : sa date est inconnue,
+ * elle n'est ni indexée ni renvoyée par les requêtes par date.
+ *
+ * <H2>Segments</H2>
+ *
+ * Le journal est découpé en segments numérotés dans TRACKING_DIR (<n>.log). Quand le segment courant
+ * dépasse TRACKING_SEGMENT_MAX_BYTES, un nouveau segment est ouvert et les plus anciens sont supprimés
+ * pour n'en garder que trackingRetention (clé "trackingRetention" de config.json). L'espace occupé
+ * sur la flash est donc borné.
+ *
+ * <H2>Index</H2>
+ *
+ * À côté de chaque segment, un index creux (<n>.idx) contient une entrée de 8 octets (heure, position
+ * dans le segment) pour la première ligne de chaque heure. Il est complété à l'écriture.
+ *
+ * La route /api/tracking?from=&to= (secondes epoch, bornes incluses) saute les segments entièrement
+ * antérieurs à from, fait une recherche dichotomique dans l'index du premier segment utile, se
+ * positionne directement sur la première heure demandée et diffuse les lignes jusqu'à la fin de la
+ * plage. Le coût dépend de la taille du résultat (plus au maximum une heure de lignes sautées),
+ * pas de celle du journal.
+ *
+ * <H2>Démarrage</H2>
+ *
+ * Au démarrage, seule la fin du segment courant (TRACKING_BOOT_TAIL_BYTES au plus) est affichée, lue
+ * par blocs : le temps de démarrage ne dépend pas de la quantité d'historique.
+ *
+ * Fichier \ref MyTracking.h
+ */
+#pragma once
+
+#include "MyNTP.h"
+#include "MySPIFFS.h"
+#include "MyWebServer.h"
+
+#define TRACKING_DIR                "/tracking"
+#define TRACKING_LEGACY_FILE        "/spiffs_tracking.txt"
+#define TRACKING_LEGACY_INDEX       "/spiffs_tracking.idx"
+#define TRACKING_INDEX_SEC          3600    // Granularité de l'index
+#define TRACKING_LINE_MAX           160     // Longueur maximale d'une ligne relue
+#define TRACKING_SEGMENT_MAX_BYTES  16384   // Taille d'un segment avant rotation
+#define TRACKING_RETENTION          4       // Nombre de segments conservés par défaut
+#define TRACKING_RETENTION_MAX      32
+#define TRACKING_BOOT_TAIL_BYTES    512     // Fin du journal affichée au démarrage
+
+/**
+ * Entrée de l'index : première ligne d'une heure donnée
+ */
+struct TrackingIndexEntry {
+    uint32_t hour = 0;     // epoch / TRACKING_INDEX_SEC
+    uint32_t offset = 0;   // Position de la ligne dans le segment
+};
+
+static_assert(sizeof(TrackingIndexEntry) == 8, "Format de l'index sur LittleFS");
+
+inline uint8_t trackingRetention = TRACKING_RETENTION;
+inline uint32_t trackingFirstSegment = 1;      // Plus ancien segment conservé
+inline uint32_t trackingLastSegment = 1;       // Segment en cours d'écriture
+inline uint32_t trackingLastIndexedHour = 0;   // Dernière heure indexée du segment courant
+
+inline String trackingSegmentFile(const uint32_t segment, const char *suffix) {
+    return String(TRACKING_DIR "/") + String(segment) + suffix;
+}
+
+/**
+ * Suppression des segments au-delà de la rétention
+ */
+inline void trackingApplyRetention() {
+    while (trackingLastSegment - trackingFirstSegment + 1 > trackingRetention) {
+        SPIFFS.remove(trackingSegmentFile(trackingFirstSegment, ".log"));
+        SPIFFS.remove(trackingSegmentFile(trackingFirstSegment, ".idx"));
+        trackingFirstSegment++;
+    }
+}
+
+inline void trackingRotate() {
+    trackingLastSegment++;
+    trackingLastIndexedHour = 0; // La première ligne datée du nouveau segment doit être indexée
+    trackingApplyRetention();
+    MYDEBUG_PRINTLN("-TRACKING : Nouveau segment " + String(trackingLastSegment));
+}
+
+/**
+ * Ajout d'une ligne au journal, et d'une entrée d'index si elle ouvre une nouvelle heure
+ */
+inline void logTracking(const String &strTrackingText) {
+    HeapScope scope(HEAP_SPIFFS);
+    const uint32_t epoch = clockSynced() ? nowEpoch() : 0;
+
+    File trackingFile = SPIFFS.open(trackingSegmentFile(trackingLastSegment, ".log"), "a");
+    if (!trackingFile) {
+        MYDEBUG_ERRORLN("-TRACKING : Impossible d'ouvrir le fichier");
+        return;
+    }
+    const uint32_t offset = trackingFile.size();
+    trackingFile.print(epoch);
+    trackingFile.print("\t");
+    // Un enregistrement par ligne, tronqué pour être relu d'un seul bloc
+    const unsigned int length = std::min<unsigned int>(strTrackingText.length(), TRACKING_LINE_MAX - 16);
+    for (unsigned int i = 0; i < length; i++) {
+        const char c = strTrackingText[i];
+        trackingFile.write(c == '\n' || c == '\r' ? ' ' : c);
+    }
+    trackingFile.print("\n");
+    const size_t size = trackingFile.size();
+    trackingFile.close();
+
+    const uint32_t hour = epoch / TRACKING_INDEX_SEC;
+    if (epoch > 0 && hour > trackingLastIndexedHour) {
+        File index = SPIFFS.open(trackingSegmentFile(trackingLastSegment, ".idx"), "a");
+        if (index) {
+            TrackingIndexEntry entry;
+            entry.hour = hour;
+            entry.offset = offset;
+            index.write(reinterpret_cast<const uint8_t *>(&entry), sizeof(entry));
+            index.close();
+            trackingLastIndexedHour = hour;
+        }
+    }
+
+    if (size >= TRACKING_SEGMENT_MAX_BYTES) trackingRotate();
+}
+
+/**
+ * Lecture de la première (ou de la dernière) entrée de l'index d'un segment, false si l'index est vide
+ */
+inline bool trackingIndexEntry(const uint32_t segment, const bool last, TrackingIndexEntry &entry) {
+    File index = SPIFFS.open(trackingSegmentFile(segment, ".idx"), "r");
+    if (!index) return false;
+    const bool ok = index.size() >= sizeof(TrackingIndexEntry);
+    if (ok) {
+        index.seek(last ? index.size() - sizeof(TrackingIndexEntry) : 0);
+        index.read(reinterpret_cast<uint8_t *>(&entry), sizeof(entry));
+    }
+    index.close();
+    return ok;
+}
+
+/**
+ * Position, dans un segment, de la première ligne pouvant être postérieure ou égale à from
+ */
+inline uint32_t trackingIndexLookup(const uint32_t segment, const uint32_t from) {
+    File index = SPIFFS.open(trackingSegmentFile(segment, ".idx"), "r");
+    if (!index) return 0;
+
+    // Dernière entrée dont l'heure est <= heure de from
+    const uint32_t hour = from / TRACKING_INDEX_SEC;
+    size_t lo = 0;
+    size_t hi = index.size() / sizeof(TrackingIndexEntry);
+    TrackingIndexEntry entry;
+    uint32_t offset = 0;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        index.seek(mid * sizeof(TrackingIndexEntry));
+        index.read(reinterpret_cast<uint8_t *>(&entry), sizeof(entry));
+        if (entry.hour <= hour) {
+            offset = entry.offset;
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    index.close();
+    return offset;
+}
+
+/**
+ * Tampon d'écriture JSON, envoyé par blocs
+ */
+class TrackingWriter {
+    char _buf[512];
+    size_t _len = 0;
+    bool _first = true;
+
+    void flush() {
+        if (_len > 0) {
+            monWebServeur.sendContent(_buf, _len);
+            _len = 0;
+        }
+    }
+
+    void put(const char c) {
+        if (_len >= sizeof(_buf)) flush();
+        _buf[_len++] = c;
+    }
+
+    void puts(const char *s) {
+        while (*s) put(*s++);
+    }
+
+public:
+    void begin(const uint32_t from, const uint32_t to) {
+        char head[64];
+        snprintf(head, sizeof(head), "{\"from\":%u,\"to\":%u,\"records\":[", from, to);
+        puts(head);
+    }
+
+    void record(const uint32_t epoch, const char *text) {
+        char t[16];
+        snprintf(t, sizeof(t), "%s[%u,\"", _first ? "" : ",", epoch);
+        puts(t);
+        for (; *text; text++) {
+            const char c = *text;
+            if (c == '"' || c == '\\') {
+                put('\\');
+                put(c);
+            } else if (static_cast<uint8_t>(c) < 0x20) {
+                put(' ');
+            } else {
+                put(c);
+            }
+        }
+        puts("\"]");
+        _first = false;
+    }
+
+    void end() {
+        puts("]}\n");
+        flush();
+        monWebServeur.sendContent("");
+    }
+};
+
+/**
+ * Diffusion des lignes d'un segment comprises dans [from, to]
+ * @return false si la fin de la plage a été dépassée : inutile de lire les segments suivants
+ */
+inline bool trackingStreamSegment(TrackingWriter &writer, const uint32_t segment, const uint32_t from, const uint32_t to) {
+    File file = SPIFFS.open(trackingSegmentFile(segment, ".log"), "r");
+    if (!file) return true;
+
+    file.seek(trackingIndexLookup(segment, from));
+    // L'horloge peut être légèrement corrigée en arrière : on s'arrête à l'heure qui suit to
+    const uint32_t stopHour = to / TRACKING_INDEX_SEC + 1;
+    char line[TRACKING_LINE_MAX];
+    bool more = true;
+    while (file.available()) {
+        const size_t n = file.readBytesUntil('\n', line, sizeof(line) - 1);
+        line[n] = '\0';
+        char *text = nullptr;
+        const uint32_t epoch = strtoul(line, &text, 10);
+        if (epoch / TRACKING_INDEX_SEC > stopHour) {
+            more = false;
+            break;
+        }
+        if (epoch >= from && epoch <= to && *text == '\t') writer.record(epoch, text + 1);
+        yield();
+    }
+    file.close();
+    return more;
+}
+
+/**
+ * Fonction de gestion de la route /api/tracking
+ */
+inline void handleApiTracking() {
+    HeapScope scope(HEAP_SPIFFS);
+    const uint32_t from = monWebServeur.hasArg("from") ? strtoul(monWebServeur.arg("from").c_str(), nullptr, 10) : 1;
+    const uint32_t to = monWebServeur.hasArg("to")
+                            ? strtoul(monWebServeur.arg("to").c_str(), nullptr, 10)
+                            : UINT32_MAX;
+    if (from > to) {
+        monWebServeur.send(400, "text/plain", "Plage from/to invalide\n");
+        return;
+    }
+
+    monWebServeur.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    monWebServeur.send(200, "application/json", "");
+    TrackingWriter writer;
+    writer.begin(from, to);
+
+    const uint32_t fromHour = from / TRACKING_INDEX_SEC;
+    for (uint32_t segment = trackingFirstSegment; segment <= trackingLastSegment; segment++) {
+        // Segment entièrement antérieur à from : le suivant commence avant l'heure demandée
+        TrackingIndexEntry next;
+        if (segment < trackingLastSegment && trackingIndexEntry(segment + 1, false, next) && next.hour < fromHour) {
+            continue;
+        }
+        if (!trackingStreamSegment(writer, segment, from, to)) break;
+    }
+    writer.end();
+}
+
+/**
+ * Affichage de la fin du segment courant, par blocs, à partir d'un début de ligne
+ */
+inline void trackingPrintTail() {
+    File file = SPIFFS.open(trackingSegmentFile(trackingLastSegment, ".log"), "r");
+    if (!file) return;
+
+    const size_t size = file.size();
+    MYDEBUG_PRINTLN("-TRACKING : Fin du segment " + String(trackingLastSegment) + " (" + String(size) + " octets)");
+    uint8_t block[TRACKING_LINE_MAX];
+    if (size > TRACKING_BOOT_TAIL_BYTES) {
+        // La première ligne, probablement coupée, est sautée
+        file.seek(size - TRACKING_BOOT_TAIL_BYTES);
+        file.readBytesUntil('\n', block, sizeof(block));
+    }
+    size_t n;
+    while ((n = file.read(block, sizeof(block))) > 0) {
+        Serial.write(block, n);
+    }
+    file.close();
+}
+
+/**
+ * Rétention lue dans config.json (clé "trackingRetention")
+ */
+inline void trackingLoadConfig() {
+    File configFile = SPIFFS.open(strConfigFile, "r");
+    if (!configFile) return;
+    StaticJsonDocument<32> filter;
+    filter["trackingRetention"] = true;
+    StaticJsonDocument<64> doc;
+    if (!deserializeJson(doc, configFile, DeserializationOption::Filter(filter))) {
+        trackingRetention = constrain(doc["trackingRetention"] | TRACKING_RETENTION, 1, TRACKING_RETENTION_MAX);
+    }
+    configFile.close();
+}
+
+/**
+ * Initialisation : recherche des segments existants, rétention, fin du journal et route HTTP
+ */
+inline void setupTracking() {
+    HeapScope scope(HEAP_SPIFFS);
+    trackingLoadConfig();
+    SPIFFS.mkdir(TRACKING_DIR);
+
+    // Le répertoire ne contient que trackingRetention segments : parcours en temps borné
+    uint32_t first = UINT32_MAX;
+    uint32_t last = 0;
+    Dir dir = SPIFFS.openDir(TRACKING_DIR);
+    while (dir.next()) {
+        const uint32_t segment = strtoul(dir.fileName().c_str(), nullptr, 10);
+        if (segment == 0) continue;
+        first = std::min(first, segment);
+        last = std::max(last, segment);
+    }
+
+    if (last == 0) {
+        // Ancien journal unique : il devient le premier segment
+        trackingFirstSegment = trackingLastSegment = 1;
+        if (SPIFFS.exists(TRACKING_LEGACY_FILE)) {
+            SPIFFS.rename(TRACKING_LEGACY_FILE, trackingSegmentFile(1, ".log"));
+            if (SPIFFS.exists(TRACKING_LEGACY_INDEX)) {
+                SPIFFS.rename(TRACKING_LEGACY_INDEX, trackingSegmentFile(1, ".idx"));
+            }
+        }
+    } else {
+        trackingFirstSegment = first;
+        trackingLastSegment = last;
+    }
+    trackingApplyRetention();
+
+    TrackingIndexEntry entry;
+    trackingLastIndexedHour = trackingIndexEntry(trackingLastSegment, true, entry) ? entry.hour : 0;
+
+    trackingPrintTail();
+
+    webOnSyncOnly("/api/tracking", HTTP_GET, handleApiTracking);
+    MYDEBUG_PRINTLN("-TRACKING : Segments " + String(trackingFirstSegment) + " à " + String(trackingLastSegment) +
+        ", rétention " + String(trackingRetention));
+}
@@ -0,0 +1,261 @@
+/**
+ * \file MyTransaction.h
+ * \page transaction Publications transactionnelles
+ * \brief Mise à jour de plusieurs feeds en un seul message numéroté, renvoyé jusqu'à son écho
+ *
+ * Une copulation modifie deux distributeurs. Publier leurs deux feeds l'un après l'autre laisse le
+ * nuage incohérent si la seconde publication échoue, et annuler puis refaire la copulation compte
+ * deux fois les rations déjà publiées. Les mutations sont donc envoyées en une transaction :
+ * \code
+ * <origine> <époque> <séquence> <niveau>=<valeur> [<niveau>=<valeur>]
+ * \endcode
+ * sur le feed transaction de la chaîne (« transaction », « bac2-transaction »...). L'origine est la
+ * carte (ChipId), l'époque est tirée au hasard à chaque démarrage et la séquence croît à chaque
+ * transaction. Les valeurs sont absolues : appliquer deux fois une transaction ne change rien.
+ *
+ * Émission :
+ * - l'état local est validé (et journalisé) avant la publication, qui est mise dans une boîte d'envoi ;
+ * - la transaction puis les feeds de chaque niveau (pour le tableau de bord) sont publiés ;
+ * - sans écho de la transaction (nous sommes abonnés à tous les feeds) après TXN_RETRY_MS, elle est
+ *   renvoyée avec la même séquence, ainsi que les feeds dont la publication a échoué ;
+ * - une transaction plus récente sur le même feed remplace la valeur en attente d'une plus ancienne.
+ *
+ * Réception :
+ * - une chaîne n'accepte que les transactions de la carte désignée par sa clé « origineTransactions »
+ *   de /config.json ; sans cette clé, seuls les échos des nôtres sont traités ;
+ * - chaque niveau garde la dernière (origine, époque, séquence) appliquée. Une transaction renvoyée,
+ *   dupliquée ou arrivée après une plus récente est ignorée pour ce niveau, ainsi que celles d'une
+ *   époque déjà remplacée par une plus récente de la même origine (carte redémarrée) : pas de double
+ *   comptage.
+ *
+ * Abandon : une transaction sans écho après TXN_MAX_ATTEMPTS envois laisse le nuage peut-être
+ * divergent. L'état complet de sa chaîne est alors republié en une transaction instantané
+ * (txnResync, voir MyChain.h) ; si l'instantané est lui-même abandonné, la divergence est signalée.
+ *
+ * Fichier \ref MyTransaction.h
+ */
+#pragma once
+
+#include "MyMQTT.h"
+
+#define TXN_OUTBOX_SIZE    8
+#define TXN_MAX_PARTS      4       // Niveaux d'une transaction : 2 pour une copulation, la chaîne pour un instantané
+#define TXN_RETRY_MS       2000
+#define TXN_MAX_ATTEMPTS   5
+#define TXN_RETIRED_EPOCHS 4       // Époques remplacées gardées par niveau
+
+struct TxnPart {
+    Adafruit_MQTT_Publish *feed;   // Feed nbration du niveau
+    uint8_t level;                 // Niveau dans la chaîne
+    int32_t value;
+};
+
+struct TxnEntry {
+    uint32_t seq = 0;              // 0 : case libre
+    Adafruit_MQTT_Publish *txnFeed = nullptr;
+    TxnPart parts[TXN_MAX_PARTS] = {};
+    uint8_t count = 0;
+    uint8_t pendingFeeds = 0;      // Un bit par feed de niveau encore à publier
+    bool acked = false;            // Écho de la transaction reçu
+    bool snapshot = false;         // Instantané publié après l'abandon d'une transaction
+    uint8_t attempts = 0;
+    unsigned long sentAt = 0;
+};
+
+struct TxnStats {
+    uint32_t committed = 0;
+    uint32_t sent = 0;
+    uint32_t retries = 0;
+    uint32_t acked = 0;
+    uint32_t expired = 0;          // Abandonnées après TXN_MAX_ATTEMPTS
+    uint32_t resyncs = 0;          // Instantanés publiés après un abandon
+    uint32_t diverged = 0;         // Instantanés abandonnés à leur tour : divergence signalée
+    uint32_t overflow = 0;         // Boîte d'envoi pleine : la plus ancienne est abandonnée
+    uint32_t received = 0;
+    uint32_t foreign = 0;          // Transactions d'une carte qui n'est pas l'origine de la chaîne
+    uint32_t applied = 0;          // Valeurs appliquées
+    uint32_t stale = 0;            // Valeurs ignorées : doublon ou transaction plus récente déjà appliquée
+};
+
+/**
+ * Dernière transaction appliquée à un niveau. Les époques étant tirées au hasard, une époque n'est
+ * « plus ancienne » que si elle a déjà été remplacée : les TXN_RETIRED_EPOCHS dernières sont gardées.
+ */
+struct TxnCursor {
+    char origin[MQTT_NODE_ID_SIZE] = "";
+    uint32_t epoch = 0;
+    uint32_t seq = 0;
+    uint32_t retired[TXN_RETIRED_EPOCHS] = {};
+    uint8_t retiredHead = 0;
+
+    bool accept(const char *txnOrigin, const uint32_t txnEpoch, const uint32_t txnSeq) {
+        if (strcmp(txnOrigin, origin) != 0) {
+            // Autre carte : son propre historique
+            *this = TxnCursor();
+            strlcpy(origin, txnOrigin, sizeof(origin));
+        } else if (txnEpoch == epoch) {
+            if (txnSeq <= seq) return false;
+        } else {
+            for (const uint32_t old: retired) {
+                if (old == txnEpoch) return false;
+            }
+            retired[retiredHead] = epoch;
+            retiredHead = (retiredHead + 1) % TXN_RETIRED_EPOCHS;
+        }
+        epoch = txnEpoch;
+        seq = txnSeq;
+        return true;
+    }
+};
+
+// Application d'une valeur reçue : false si le niveau l'a déjà (ou plus récente)
+typedef bool (*TxnApply)(const char *origin, uint8_t level, int32_t value, uint32_t epoch, uint32_t seq);
+// Republication de l'état complet de la chaîne d'un feed transaction
+typedef void (*TxnResync)(Adafruit_MQTT_Publish *txnFeed);
+
+inline TxnEntry txnOutbox[TXN_OUTBOX_SIZE];
+inline uint32_t txnEpoch = 0;
+inline uint32_t txnSeq = 0;
+inline TxnStats txnStats;
+inline TxnResync txnResync = nullptr;
+
+inline void txnSend(TxnEntry &entry) {
+    char payload[MQTT_MUX_PAYLOAD];
+    int n = snprintf(payload, sizeof(payload), "%s %x %u", mqttNodeId(), txnEpoch, entry.seq);
+    for (uint8_t i = 0; i < entry.count && n < static_cast<int>(sizeof(payload)); i++) {
+        n += snprintf(payload + n, sizeof(payload) - n, " %u=%d", entry.parts[i].level, entry.parts[i].value);
+    }
+    entry.sentAt = millis();
+    entry.attempts++;
+    if (!entry.acked && entry.txnFeed->publish(payload)) txnStats.sent++;
+
+    for (uint8_t i = 0; i < entry.count; i++) {
+        if ((entry.pendingFeeds & (1 << i)) && entry.parts[i].feed->publish(entry.parts[i].value)) {
+            entry.pendingFeeds &= ~(1 << i);
+        }
+    }
+}
+
+/**
+ * Nouvelle transaction, l'état local étant déjà validé ; publiée immédiatement si possible
+ * @param snapshot état complet d'une chaîne, republié après l'abandon d'une transaction
+ */
+inline void txnCommit(Adafruit_MQTT_Publish *txnFeed, const TxnPart *parts, const uint8_t count,
+                      const bool snapshot = false) {
+    TxnEntry *slot = nullptr;
+    TxnEntry *oldest = &txnOutbox[0];
+    for (TxnEntry &entry: txnOutbox) {
+        if (entry.seq == 0) {
+            if (!slot) slot = &entry;
+            continue;
+        }
+        if (entry.seq < oldest->seq || oldest->seq == 0) oldest = &entry;
+        // Valeur remplacée par cette transaction : l'ancienne ne doit plus être publiée
+        for (uint8_t i = 0; i < entry.count; i++) {
+            for (uint8_t j = 0; j < count; j++) {
+                if (entry.parts[i].feed == parts[j].feed) entry.pendingFeeds &= ~(1 << i);
+            }
+        }
+    }
+    if (!slot) {
+        txnStats.overflow++;
+        slot = oldest;
+    }
+
+    *slot = TxnEntry();
+    slot->seq = ++txnSeq;
+    slot->txnFeed = txnFeed;
+    slot->snapshot = snapshot;
+    slot->count = std::min<uint8_t>(count, TXN_MAX_PARTS);
+    for (uint8_t i = 0; i < slot->count; i++) slot->parts[i] = parts[i];
+    slot->pendingFeeds = (1 << slot->count) - 1;
+    txnStats.committed++;
+    if (MyAdafruitMqtt.connected()) txnSend(*slot);
+}
+
+/**
+ * Transaction reçue : écho d'une des nôtres, ou mise à jour venant de la carte allowedOrigin
+ * @param allowedOrigin carte autorisée à modifier la chaîne, vide pour n'accepter que nos échos
+ */
+inline void txnHandle(const char *payload, uint16_t, const char *allowedOrigin, const TxnApply apply) {
+    char origin[MQTT_NODE_ID_SIZE];
+    uint32_t epoch = 0;
+    uint32_t seq = 0;
+    int offset = 0;
+    if (sscanf(payload, "%8s %x %u%n", origin, &epoch, &seq, &offset) != 3) return;
+
+    if (strcmp(origin, mqttNodeId()) == 0) {
+        for (TxnEntry &entry: txnOutbox) {
+            if (entry.seq == seq && epoch == txnEpoch && !entry.acked) {
+                entry.acked = true;
+                txnStats.acked++;
+            }
+        }
+        return;
+    }
+
+    txnStats.received++;
+    if (strcmp(origin, allowedOrigin) != 0) {
+        txnStats.foreign++;
+        return;
+    }
+    const char *cursor = payload + offset;
+    unsigned level = 0;
+    int value = 0;
+    int used = 0;
+    while (sscanf(cursor, " %u=%d%n", &level, &value, &used) == 2) {
+        cursor += used;
+        if (apply(origin, level, value, epoch, seq)) {
+            txnStats.applied++;
+        } else {
+            txnStats.stale++;
+        }
+    }
+}
+
+/**
+ * Renvoi des transactions sans écho et des feeds non publiés, libération des transactions terminées
+ */
+inline void loopTransactions() {
+    const unsigned long now = millis();
+    for (TxnEntry &entry: txnOutbox) {
+        if (entry.seq == 0) continue;
+        if (entry.acked && entry.pendingFeeds == 0) {
+            entry.seq = 0;
+        } else if (now - entry.sentAt >= TXN_RETRY_MS && MyAdafruitMqtt.connected()) {
+            if (entry.attempts >= TXN_MAX_ATTEMPTS) {
+                txnStats.expired++;
+                if (entry.snapshot || !txnResync) {
+                    txnStats.diverged++;
+                    MYDEBUG_WARNLN("-TXN : Transaction " + String(entry.seq) + " sans écho, le nuage peut diverger");
+                    entry.seq = 0;
+                } else {
+                    entry.seq = 0; // Case libérée avant l'instantané, qui peut la reprendre
+                    txnStats.resyncs++;
+                    txnResync(entry.txnFeed);
+                }
+                continue;
+            }
+            txnStats.retries++;
+            txnSend(entry);
+        }
+    }
+}
+
+inline size_t txnReport(char *out, const size_t size) {
+    uint8_t pending = 0;
+    for (const TxnEntry &entry: txnOutbox) {
+        if (entry.seq) pending++;
+    }
+    return snprintf(out, size,
+                    "transactions %x/%u : en_attente=%u validees=%u envoyees=%u renvois=%u echos=%u expirees=%u "
+                    "instantanes=%u divergences=%u debordements=%u recues=%u etrangeres=%u appliquees=%u "
+                    "ignorees=%u\n",
+                    txnEpoch, txnSeq, pending, txnStats.committed, txnStats.sent, txnStats.retries,
+                    txnStats.acked, txnStats.expired, txnStats.resyncs, txnStats.diverged, txnStats.overflow,
+                    txnStats.received, txnStats.foreign, txnStats.applied, txnStats.stale);
+}
+
+inline void setupTransactions() {
+    txnEpoch = ESP.random(); // Les récepteurs repartent de zéro quand l'époque change
+}
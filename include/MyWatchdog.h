@@ -0,0 +1,266 @@
+/**
+ * \file MyWatchdog.h
+ * \page watchdog Surveillance de la loop
+ * \brief Budget de temps par itération, capture des itérations lentes et redémarrage contrôlé
+ *
+ * Quand la carte ne répond plus, il faut savoir qui bloquait : handleClient(), le traitement des
+ * paquets MQTT, une reconnexion WiFi ou le travail d'une chaîne de distributeurs.
+ *
+ * Chaque sous-système est encadré par un LoopScope. Le temps (en cycles CPU) est imputé au
+ * sous-système actif : à l'entrée d'un LoopScope le temps écoulé est imputé au sous-système
+ * englobant, à la sortie au sous-système qui se termine. Le temps hors LoopScope (delay() de la loop)
+ * est du repos.
+ *
+ * À la fin de chaque itération, si le temps actif dépasse loopBudgetMs (clé "loopBudgetMs" de
+ * config.json), l'itération est ajoutée à un anneau : date, sous-système le plus coûteux, cycles.
+ * L'anneau est en mémoire RTC et survit donc à un redémarrage logiciel ou du watchdog.
+ *
+ * Escalade :
+ * - un Ticker vérifie toutes les LOOP_CHECK_MS que l'itération en cours progresse. Il tourne dès
+ *   que la loop rend la main au système (attente réseau, delay()) ;
+ * - au-delà de LOOP_STALL_WARN_MS, le blocage est inscrit dans l'anneau ;
+ * - au-delà de LOOP_STALL_RESTART_MS, redémarrage contrôlé ;
+ * - si la loop boucle sans jamais rendre la main, c'est le watchdog matériel qui redémarre la carte :
+ *   le sous-système actif, noté en RTC à chaque changement, est alors inscrit au démarrage suivant.
+ *
+ * La route /debug/loop affiche l'anneau et les compteurs.
+ *
+ * Fichier \ref MyWatchdog.h
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Ticker.h>
+
+#include "MyNTP.h"
+#include "MyRTC.h"
+#include "MySPIFFS.h"
+
+#define LOOP_BUDGET_MS         100     // Budget par défaut d'une itération (temps actif)
+#define LOOP_CHECK_MS          250
+#define LOOP_STALL_WARN_MS     3000
+#define LOOP_STALL_RESTART_MS  20000
+#define LOOP_RING_SIZE         8
+
+enum LoopSubsystem : uint8_t {
+    LOOP_IDLE,
+    LOOP_WEB,
+    LOOP_MQTT,
+    LOOP_WIFI,
+    LOOP_NTP,
+    LOOP_HISTORY,
+    LOOP_HEAP,
+    LOOP_CHAIN,
+    LOOP_JOURNAL,
+    LOOP_SUBSYSTEM_COUNT
+};
+
+inline const char *const loopSubsystemNames[LOOP_SUBSYSTEM_COUNT] = {
+    "repos", "web", "mqtt", "wifi", "ntp", "history", "heap", "chaines", "journal"
+};
+
+enum LoopStallFlag : uint8_t {
+    LOOP_FLAG_OVER_BUDGET = 1,   // Itération terminée, hors budget
+    LOOP_FLAG_STALL = 2,         // Itération bloquée, constatée par le Ticker
+    LOOP_FLAG_RESTART = 4,       // Redémarrage contrôlé
+    LOOP_FLAG_WDT_RESET = 8,     // Redémarrage par le watchdog, constaté au démarrage suivant
+};
+
+struct LoopStall {
+    uint32_t epoch = 0;
+    uint32_t cycles = 0;         // Cycles du sous-système le plus coûteux
+    uint16_t ms = 0;             // Durée totale de l'itération
+    uint8_t subsystem = LOOP_IDLE;
+    uint8_t flags = 0;
+};
+
+struct LoopStallRing {
+    uint32_t overBudget = 0;
+    uint16_t restarts = 0;
+    uint8_t head = 0;
+    uint8_t count = 0;
+    LoopStall entries[LOOP_RING_SIZE];
+};
+
+// Un bloc pour le sous-système actif, puis l'anneau
+constexpr uint8_t LOOP_RTC_ACTIVE = RTC_SLOT_WATCHDOG;
+constexpr RtcSlot LOOP_RTC_RING = static_cast<RtcSlot>(RTC_SLOT_WATCHDOG + 1);
+static_assert(1 + sizeof(RtcRecord<LoopStallRing>) / RTC_BLOCK_SIZE <= RTC_SLOT_WIFI - RTC_SLOT_WATCHDOG,
+              "Anneau de la loop trop grand pour sa zone RTC");
+
+inline LoopStallRing loopRing;
+inline uint32_t loopBudgetMs = LOOP_BUDGET_MS;
+inline uint32_t loopCycles[LOOP_SUBSYSTEM_COUNT];   // Itération en cours
+inline LoopSubsystem loopActive = LOOP_IDLE;
+inline uint32_t loopMark = 0;                       // Cycle du dernier changement de sous-système
+inline volatile unsigned long loopIterationStart = 0;
+inline bool loopStallReported = false;
+inline uint32_t loopIterations = 0;
+inline Ticker loopWatchdogTicker;
+
+inline uint32_t loopCyclesToMs(const uint32_t cycles) {
+    return cycles / (ESP.getCpuFreqMHz() * 1000UL);
+}
+
+/**
+ * Le temps écoulé depuis le dernier changement est imputé au sous-système actif
+ */
+inline void loopSwitch(const LoopSubsystem next) {
+    const uint32_t now = ESP.getCycleCount();
+    loopCycles[loopActive] += now - loopMark;
+    loopMark = now;
+    if (next != loopActive) {
+        loopActive = next;
+        uint32_t marker = next;
+        ESP.rtcUserMemoryWrite(LOOP_RTC_ACTIVE, &marker, sizeof(marker));
+    }
+}
+
+inline void loopRecord(const LoopSubsystem subsystem, const uint32_t cycles, const uint32_t ms, const uint8_t flags) {
+    LoopStall &entry = loopRing.entries[loopRing.head];
+    entry.epoch = nowEpoch();
+    entry.cycles = cycles;
+    entry.ms = std::min<uint32_t>(ms, UINT16_MAX);
+    entry.subsystem = subsystem;
+    entry.flags = flags;
+    loopRing.head = (loopRing.head + 1) % LOOP_RING_SIZE;
+    loopRing.count = std::min<uint8_t>(loopRing.count + 1, LOOP_RING_SIZE);
+    rtcStore(LOOP_RTC_RING, loopRing);
+}
+
+/**
+ * Imputation automatique du temps d'un bloc de code :
+ * { LoopScope scope(LOOP_WEB); monWebServeur.handleClient(); }
+ */
+class LoopScope {
+    LoopSubsystem _previous;
+
+public:
+    explicit LoopScope(const LoopSubsystem sub) : _previous(loopActive) {
+        loopSwitch(sub);
+    }
+
+    ~LoopScope() { loopSwitch(_previous); }
+
+    LoopScope(const LoopScope &) = delete;
+    LoopScope &operator=(const LoopScope &) = delete;
+};
+
+/**
+ * Début d'une itération de la loop
+ */
+inline void loopWatchdogBegin() {
+    loopSwitch(LOOP_IDLE);
+    memset(loopCycles, 0, sizeof(loopCycles));
+    loopIterationStart = millis();
+    loopStallReported = false;
+}
+
+/**
+ * Fin d'une itération : comparaison du temps actif au budget
+ */
+inline void loopWatchdogEnd() {
+    loopSwitch(LOOP_IDLE);
+    loopIterations++;
+
+    uint32_t busy = 0;
+    uint8_t worst = LOOP_IDLE;
+    for (uint8_t i = LOOP_IDLE + 1; i < LOOP_SUBSYSTEM_COUNT; i++) {
+        busy += loopCycles[i];
+        if (loopCycles[i] > loopCycles[worst] || worst == LOOP_IDLE) worst = i;
+    }
+    if (loopCyclesToMs(busy) > loopBudgetMs) {
+        loopRing.overBudget++;
+        loopRecord(static_cast<LoopSubsystem>(worst), loopCycles[worst], millis() - loopIterationStart,
+                   LOOP_FLAG_OVER_BUDGET);
+    }
+}
+
+/**
+ * Vérification de la progression de la loop, dans le contexte système (Ticker)
+ */
+inline void loopWatchdogCheck() {
+    static bool restarting = false;
+    const unsigned long elapsed = millis() - loopIterationStart;
+    if (restarting) return;
+    if (elapsed >= LOOP_STALL_RESTART_MS) {
+        restarting = true;
+        loopRing.restarts++;
+        loopRecord(loopActive, ESP.getCycleCount() - loopMark, elapsed, LOOP_FLAG_STALL | LOOP_FLAG_RESTART);
+#ifdef MYDEBUG
+        Serial.printf("-LOOP : bloquée dans %s depuis %lu ms, redémarrage\n", loopSubsystemNames[loopActive], elapsed);
+#endif
+        system_restart(); // ESP.restart() ne peut pas être appelé depuis un Ticker
+    } else if (elapsed >= LOOP_STALL_WARN_MS && !loopStallReported) {
+        loopStallReported = true;
+        loopRecord(loopActive, ESP.getCycleCount() - loopMark, elapsed, LOOP_FLAG_STALL);
+#ifdef MYDEBUG
+        Serial.printf("-LOOP : bloquée dans %s depuis %lu ms\n", loopSubsystemNames[loopActive], elapsed);
+#endif
+    }
+}
+
+/**
+ * Rapport texte compact, écrit dans un tampon fixe
+ */
+inline size_t loopReport(char *out, const size_t size) {
+    size_t n = snprintf(out, size, "budget=%u ms iterations=%u hors_budget=%u redemarrages=%u\n",
+                        loopBudgetMs, loopIterations, loopRing.overBudget, loopRing.restarts);
+    for (uint8_t i = 0; i < loopRing.count && n < size; i++) {
+        const LoopStall &e = loopRing.entries[(loopRing.head + LOOP_RING_SIZE - 1 - i) % LOOP_RING_SIZE];
+        n += snprintf(out + n, size - n, "%u %s cycles=%u (%u ms) iteration=%u ms%s%s%s%s\n",
+                      e.epoch, e.subsystem < LOOP_SUBSYSTEM_COUNT ? loopSubsystemNames[e.subsystem] : "?",
+                      e.cycles, loopCyclesToMs(e.cycles), e.ms,
+                      e.flags & LOOP_FLAG_OVER_BUDGET ? " hors-budget" : "",
+                      e.flags & LOOP_FLAG_STALL ? " blocage" : "",
+                      e.flags & LOOP_FLAG_RESTART ? " redemarrage" : "",
+                      e.flags & LOOP_FLAG_WDT_RESET ? " watchdog" : "");
+    }
+    return std::min(n, size);
+}
+
+/**
+ * La loop progresse : à appeler dans une phase longue mais légitime (tentatives de connexion)
+ */
+inline void loopWatchdogFeed() {
+    loopIterationStart = millis();
+    loopStallReported = false;
+}
+
+/**
+ * Budget lu dans config.json (clé "loopBudgetMs")
+ */
+inline void loopLoadConfig() {
+    File configFile = SPIFFS.open(strConfigFile, "r");
+    if (!configFile) return;
+    StaticJsonDocument<32> filter;
+    filter["loopBudgetMs"] = true;
+    StaticJsonDocument<64> doc;
+    if (!deserializeJson(doc, configFile, DeserializationOption::Filter(filter))) {
+        loopBudgetMs = doc["loopBudgetMs"] | LOOP_BUDGET_MS;
+    }
+    configFile.close();
+}
+
+/**
+ * Reprise de l'anneau conservé en RTC et démarrage du Ticker de surveillance, à la fin du setup()
+ */
+inline void setupWatchdog() {
+    loopLoadConfig();
+    if (!rtcLoad(LOOP_RTC_RING, loopRing)) loopRing = LoopStallRing();
+
+    // Redémarrage par un watchdog : le dernier sous-système actif est celui qui bouclait
+    const rst_info *info = ESP.getResetInfoPtr();
+    if (info && (info->reason == REASON_WDT_RST || info->reason == REASON_SOFT_WDT_RST)) {
+        uint32_t marker = LOOP_IDLE;
+        ESP.rtcUserMemoryRead(LOOP_RTC_ACTIVE, &marker, sizeof(marker));
+        loopRecord(marker < LOOP_SUBSYSTEM_COUNT ? static_cast<LoopSubsystem>(marker) : LOOP_IDLE, 0, 0,
+                   LOOP_FLAG_WDT_RESET);
+    }
+
+    loopMark = ESP.getCycleCount();
+    loopWatchdogFeed();
+    loopWatchdogTicker.attach_ms(LOOP_CHECK_MS, loopWatchdogCheck);
+    MYDEBUG_PRINTLN("-LOOP : Budget " + String(loopBudgetMs) + " ms, " + String(loopRing.count) +
+        " itérations lentes conservées");
+}
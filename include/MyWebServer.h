@@ -24,6 +24,19 @@
  *   Affiche un formulaire pour configurer la carte
  * - ...
  * - et avec handleNotFound() si la route n'est pas connue
+ *
+ * Avec WEB_ASYNC (par défaut), le port 80 est servi par le serveur asynchrone (MyAsyncWeb.h) : un client
+ * lent ne bloque plus la loop. ESP8266WebServer passe sur le port WEB_SYNC_PORT (8080) et sert toujours
+ * toutes les routes :
+ * - les routes déclarées par webOn() (/, /debug, /debug/..., /api/config, /api/ota, /trace, /bench...) ont
+ *   un seul handler, qui reçoit un WebRequest et répond de la même façon sur les deux ports ;
+ * - les réponses diffusées en flux, sans taille connue (/api/history, /api/journal, /api/tracking,
+ *   /trace/download), restent sur ESP8266WebServer (webOnSyncOnly()) : le port 80 répond par une
+ *   redirection 307 vers le port WEB_SYNC_PORT, que les navigateurs suivent (curl -L) ;
+ * - /api/logs a ses deux handlers (long-poll différé sur le port 80, voir MyLogApi.h).
+ * Si le serveur asynchrone ne peut pas écouter (tas, port pris), ESP8266WebServer reprend le port 80
+ * et WEB_SYNC_PORT n'est pas ouvert : « ecoute=non » sur la ligne Async Web de /debug.
+ * Sans WEB_ASYNC, ESP8266WebServer sert tout sur le port 80.
  * 
  * Fichier \ref MyWebServer.h
  */
@@ -31,62 +44,233 @@
 // Librairies nécessaires, en fonction de la carte utilisée
 #pragma once
 #include <ESP8266WebServer.h>
+#include <base64.h>
 
+#include "MyAsyncWeb.h"
 #include "MyDebug.h"
+#include "MyNTP.h"
+#include "MyRenderCache.h"
+#include "MyWatchdog.h"
 #include "MyWiFi.h"
-#include <NTPClient.h>
 
 // Déclaration des fonctions externes
 extern void publishToMQTT(const char *feed, const String &value);
 
 extern int getReadyCount();
 
+#ifndef WEB_ASYNC
+#define WEB_ASYNC 1 // 0 : tout sur ESP8266WebServer, port 80
+#endif
+
+#define WEB_ASYNC_PORT 80
+#if WEB_ASYNC
+#define WEB_SYNC_PORT  8080
+#else
+#define WEB_SYNC_PORT  80
+#endif
+#define WEB_MAX_ROUTES 20
+
 // Variables
-inline ESP8266WebServer monWebServeur(80);
+inline ESP8266WebServer monWebServeur(WEB_SYNC_PORT);
+
 /**
- * Fonction de gestion de la route /
+ * Réponse minimale quand le tas est critique : pas de String, pas de page à construire
  */
-inline void handleRoot() {
-    MYDEBUG_PRINTLN("-WEBSERVER : requete root");
-    timeClient.update();
+inline void sendHeapUnavailable() {
+    monWebServeur.sendHeader("Retry-After", "30");
+    monWebServeur.send_P(503, PSTR("text/plain"), PSTR("Memoire insuffisante, reessayez plus tard\n"));
+}
 
-    if (monWebServeur.hasArg("commande")) {
-        String commande = monWebServeur.arg("commande");
-        publishToMQTT("commande", commande);
+/**
+ * Requête en cours vue par une route commune aux deux serveurs : ESP8266WebServer (sans requête
+ * asynchrone) ou le serveur asynchrone
+ */
+class WebRequest {
+    AsyncWebRequest *_async;
+
+public:
+    explicit WebRequest(AsyncWebRequest *async = nullptr) : _async(async) {
     }
 
+    [[nodiscard]] HTTPMethod method() const { return _async ? _async->method : monWebServeur.method(); }
+
+    [[nodiscard]] bool hasArg(const char *name) const {
+        return _async ? _async->hasArg(name) : monWebServeur.hasArg(name);
+    }
+
+    [[nodiscard]] String arg(const char *name) const {
+        return _async ? _async->arg(name) : monWebServeur.arg(name);
+    }
+
+    // Corps brut de la requête (document JSON d'un POST)
+    [[nodiscard]] String body() const { return _async ? String(_async->body) : monWebServeur.arg("plain"); }
+
+    /**
+     * Authentification HTTP Basic
+     */
+    [[nodiscard]] bool authenticate(const char *user, const char *password) const {
+        if (!_async) return monWebServeur.authenticate(user, password);
+        const String expected = "Basic " + base64::encode(String(user) + ":" + password, false);
+        return _async->header("Authorization") == expected;
+    }
+
+    void sendHeader(const char *name, const String &value) {
+        if (_async) _async->addHeader(name, value);
+        else monWebServeur.sendHeader(name, value);
+    }
+
+    void send(const int code, const char *type, const String &content) {
+        if (_async) _async->send(code, type, content);
+        else monWebServeur.send(code, type, content);
+    }
+
+    void requestAuthentication() {
+        sendHeader("WWW-Authenticate", "Basic realm=\"distributeur\"");
+        send(401, "text/plain", "Authentification requise\n");
+    }
+
+    /**
+     * Réponse 503 si le tas est critique (sans String construite sur ESP8266WebServer)
+     */
+    bool heapUnavailable() {
+        if (!heapShedWeb()) return false;
+        if (!_async) {
+            sendHeapUnavailable();
+            return true;
+        }
+        _async->addHeader("Retry-After", "30");
+        _async->send(503, "text/plain", "Memoire insuffisante, reessayez plus tard\n");
+        return true;
+    }
+};
+
+typedef void (*WebHandler)(WebRequest &request);
+
+struct WebRoute {
+    const char *path;
+    HTTPMethod method;
+    WebHandler handler;
+};
+
+inline WebRoute webRoutes[WEB_MAX_ROUTES];
+inline uint8_t webRouteCount = 0;
+
+inline void asyncHandleWebRoute(AsyncWebRequest &request) {
+    for (uint8_t i = 0; i < webRouteCount; i++) {
+        const WebRoute &route = webRoutes[i];
+        if (strcmp(route.path, request.path) == 0 && (route.method == HTTP_ANY || route.method == request.method)) {
+            WebRequest web(&request);
+            route.handler(web);
+            return;
+        }
+    }
+}
+
+/**
+ * Réponse en flux d'ESP8266WebServer, demandée au port 80 : redirection vers le port WEB_SYNC_PORT
+ */
+inline void asyncRedirectToSync(AsyncWebRequest &request) {
+    String host = request.header("Host");
+    const int colon = host.indexOf(':');
+    if (colon >= 0) host = host.substring(0, colon);
+    if (host.length() == 0) host = WiFi.localIP().toString();
+    String location = "http://" + host + ":" + String(WEB_SYNC_PORT) + request.path;
+    if (*request.query) location += "?" + String(request.query);
+    request.addHeader("Location", location);
+    request.send(307, "text/plain", "Réponse en flux servie sur le port " + String(WEB_SYNC_PORT) + " : " +
+                                        location + "\n");
+}
+
+/**
+ * Route servie par les deux serveurs, avec le même handler
+ */
+inline void webOn(const char *path, const HTTPMethod method, const WebHandler handler) {
+    monWebServeur.on(path, method, [handler] {
+        WebRequest request;
+        handler(request);
+    });
+#if WEB_ASYNC
+    if (webRouteCount >= WEB_MAX_ROUTES) {
+        MYDEBUG_ERRORLN("-WEBSERVER : Trop de routes, " + String(path) + " absente du port " + String(WEB_ASYNC_PORT));
+        return;
+    }
+    webRoutes[webRouteCount++] = {path, method, handler};
+    asyncWebOn(path, method, asyncHandleWebRoute);
+#endif
+}
+
+/**
+ * Route à réponse diffusée en flux (setContentLength(CONTENT_LENGTH_UNKNOWN) puis sendContent()), que le
+ * serveur asynchrone ne sait pas produire sans la garder entière en mémoire : servie par ESP8266WebServer,
+ * le port 80 y redirige
+ */
+inline void webOnSyncOnly(const char *path, const HTTPMethod method,
+                          const ESP8266WebServer::THandlerFunction &handler) {
+    monWebServeur.on(path, method, handler);
+#if WEB_ASYNC
+    asyncWebOn(path, method, asyncRedirectToSync);
+#endif
+}
+
+/**
+ * Fonction de gestion de la route /debug/heap : état du tas par sous-système
+ */
+inline void handleDebugHeap(WebRequest &request) {
+    char out[768];
+    heapReport(out, sizeof(out));
+    request.send(200, "text/plain", out);
+}
+
+/**
+ * Fonction de gestion de la route /debug/loop : itérations lentes de la loop
+ */
+inline void handleDebugLoop(WebRequest &request) {
+    char out[1024];
+    loopReport(out, sizeof(out));
+    request.send(200, "text/plain", out);
+}
+
+/**
+ * Page du tableau de bord (route /), rendue seulement quand l'état a changé
+ */
+inline String rootPage() {
     String out = "";
     out += "<html><head>";
     out += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
     out += "<meta http-equiv='refresh' content='30'/>";
     out += "<title>YNOV - Projet IoT B2</title>";
-    out += "<style>";
-    out += "* { margin: 0; padding: 0; box-sizing: border-box; }";
-    out += "body { font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; background: #f0f2f5; color: #1a1a1a; line-height: 1.6; }";
-    out += ".container { max-width: 1000px; margin: 2rem auto; padding: 0 20px; }";
-    out += ".header { background: #ffffff; padding: 2rem; border-radius: 10px; box-shadow: 0 2px 4px rgba(0,0,0,0.1); margin-bottom: 2rem; }";
-    out += ".header h1 { color: #2c3e50; font-size: 2rem; margin-bottom: 1rem; }";
-    out += ".card { background: #ffffff; padding: 2rem; border-radius: 10px; box-shadow: 0 2px 4px rgba(0,0,0,0.1); margin-bottom: 2rem; }";
-    out += ".form-group { margin-bottom: 1.5rem; }";
-    out += ".form-group h2 { color: #2c3e50; margin-bottom: 1rem; }";
-    out += "select { padding: 0.8rem; border: 1px solid #ddd; border-radius: 5px; width: 200px; margin-right: 1rem; font-size: 1rem; }";
-    out += ".btn { background: #4CAF50; color: white; padding: 0.8rem 2rem; border: none; border-radius: 5px; cursor: pointer; font-size: 1rem; transition: background 0.3s ease; }";
-    out += ".btn:hover { background: #45a049; }";
-    out += ".status { background: #ffffff; padding: 2rem; border-radius: 10px; box-shadow: 0 2px 4px rgba(0,0,0,0.1); }";
-    out += ".status h2 { color: #2c3e50; margin-bottom: 1rem; }";
-    out += ".status-value { font-size: 2rem; color: #4CAF50; font-weight: bold; }";
-    out += "@media (max-width: 600px) {";
-    out += "  .container { margin: 1rem auto; }";
-    out += "  .header, .card, .status { padding: 1rem; }";
-    out += "  select { width: 100%; margin-bottom: 1rem; }";
-    out += "  .btn { width: 100%; }";
-    out += "}";
-    out += "</style>";
+    // Tas sous pression : page servie sans mise en forme
+    if (!heapShedWebStyle()) {
+        out += "<style>";
+        out += "* { margin: 0; padding: 0; box-sizing: border-box; }";
+        out += "body { font-family: 'Segoe UI', Tahoma, Geneva, Verdana, sans-serif; background: #f0f2f5; color: #1a1a1a; line-height: 1.6; }";
+        out += ".container { max-width: 1000px; margin: 2rem auto; padding: 0 20px; }";
+        out += ".header { background: #ffffff; padding: 2rem; border-radius: 10px; box-shadow: 0 2px 4px rgba(0,0,0,0.1); margin-bottom: 2rem; }";
+        out += ".header h1 { color: #2c3e50; font-size: 2rem; margin-bottom: 1rem; }";
+        out += ".card { background: #ffffff; padding: 2rem; border-radius: 10px; box-shadow: 0 2px 4px rgba(0,0,0,0.1); margin-bottom: 2rem; }";
+        out += ".form-group { margin-bottom: 1.5rem; }";
+        out += ".form-group h2 { color: #2c3e50; margin-bottom: 1rem; }";
+        out += "select { padding: 0.8rem; border: 1px solid #ddd; border-radius: 5px; width: 200px; margin-right: 1rem; font-size: 1rem; }";
+        out += ".btn { background: #4CAF50; color: white; padding: 0.8rem 2rem; border: none; border-radius: 5px; cursor: pointer; font-size: 1rem; transition: background 0.3s ease; }";
+        out += ".btn:hover { background: #45a049; }";
+        out += ".status { background: #ffffff; padding: 2rem; border-radius: 10px; box-shadow: 0 2px 4px rgba(0,0,0,0.1); }";
+        out += ".status h2 { color: #2c3e50; margin-bottom: 1rem; }";
+        out += ".status-value { font-size: 2rem; color: #4CAF50; font-weight: bold; }";
+        out += "@media (max-width: 600px) {";
+        out += "  .container { margin: 1rem auto; }";
+        out += "  .header, .card, .status { padding: 1rem; }";
+        out += "  select { width: 100%; margin-bottom: 1rem; }";
+        out += "  .btn { width: 100%; }";
+        out += "}";
+        out += "</style>";
+    }
     out += "</head><body>";
 
     out += "<div class='container'>";
     out += "<div class='header'>";
-    out += "<h1>Tableau de bord - " + timeClient.getFormattedTime() + "</h1>";
+    out += "<h1>Tableau de bord - ";
+    out += RENDER_LIVE_MARK; // Heure, remplacée à chaque envoi (MyRenderCache.h)
+    out += "</h1>";
     out += "</div>";
 
     out += "<div class='card'>";
@@ -110,8 +294,30 @@ inline void handleRoot() {
     out += "</div>";
 
     out += "</div></body></html>";
+    return out;
+}
+
+inline String clockNow() { return clockFormattedTime(); }
 
-    monWebServeur.send(200, "text/html", out);
+inline String rootPageCached() {
+    // Variante sans mise en forme quand le tas est bas (le cache est alors vidé, voir heapShedCache())
+    return renderCached(RENDER_ROOT, heapShedWebStyle() ? 1 : 0, rootPage, clockNow);
+}
+
+/**
+ * Fonction de gestion de la route /
+ */
+inline void handleRoot(WebRequest &request) {
+    MYDEBUG_PRINTLN("-WEBSERVER : requete root");
+
+    if (request.hasArg("commande")) {
+        String commande = request.arg("commande");
+        publishToMQTT("commande", commande);
+    }
+
+    if (request.heapUnavailable()) return;
+
+    request.send(200, "text/html", rootPageCached());
 }
 
 /**
@@ -137,7 +343,10 @@ inline void handleNotFound() {
     monWebServeur.send(404, "text/plain", message);
 }
 
-inline void handleDebug() {
+/**
+ * Page de debug (route /debug)
+ */
+inline String debugPage() {
     String out = "";
     out += "<html><head>";
     out += "<meta name='viewport' content='width=device-width, initial-scale=1.0'>";
@@ -160,10 +369,24 @@ inline void handleDebug() {
     out += "ESP8266 Debug Information:\n";
     out += "-------------------------\n";
     out += "Free Heap: " + String(ESP.getFreeHeap()) + " bytes\n";
+    out += "Max Free Block: " + String(ESP.getMaxFreeBlockSize()) + " bytes\n";
+    out += "Heap Fragmentation: " + String(ESP.getHeapFragmentation()) + " %\n";
+    out += "Heap Level: " + String(heapLevelNames[heapLevel]) + "\n";
     out += "WiFi Status: " + String(WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected") + "\n";
     out += "WiFi SSID: " + String(WiFi.SSID()) + "\n";
     out += "IP Address: " + WiFi.localIP().toString() + "\n";  // Utilisation directe de toString()
+    char wifiLine[192];
+    wifiReport(wifiLine, sizeof(wifiLine));
+    out += "WiFi Link: " + String(wifiLine);
+    char webLine[288];
+    asyncWebReport(webLine, sizeof(webLine));
+    out += "Async Web: " + String(webLine);
+    renderReport(webLine, sizeof(webLine));
+    out += "Render Cache: " + String(webLine);
     out += "Uptime: " + String(millis() / 1000) + " seconds\n";
+    out += "Clock: " + clockFormattedTime() + (clockSynced() ? " (NTP, " : " (non synchronisée, ") +
+           String(ntpClock.syncs) + " sync, " + String(ntpClock.failures) + " échecs, dérive " +
+           String(ntpClock.driftPpm, 1) + " ppm)\n";
     out += "</div>";
 
     // Affichage des logs
@@ -172,14 +395,43 @@ inline void handleDebug() {
     out += "-------------------------\n";
     for (int i = 0; i < LOG_BUFFER_SIZE; i++) {
         int index = (logIndex - 1 - i + LOG_BUFFER_SIZE) % LOG_BUFFER_SIZE;
-        if (logBuffer[index].length() > 0) {
-            out += logBuffer[index] + "\n";
+        if (logBuffer[index].seq != 0) {
+            out += logBuffer[index].text + "\n";
         }
     }
     out += "</div></div>";
     out += "</body></html>";
+    return out;
+}
+
+inline void handleDebug(WebRequest &request) {
+    if (request.heapUnavailable()) return;
+
+    request.send(200, "text/html", debugPage());
+}
 
-    monWebServeur.send(200, "text/html", out);
+/**
+ * Délestage sous pression du tas, pour les handlers propres au serveur asynchrone
+ */
+inline bool asyncHeapUnavailable(AsyncWebRequest &request) {
+    WebRequest web(&request);
+    return web.heapUnavailable();
+}
+
+inline void asyncHandleNotFound(AsyncWebRequest &request) {
+    MYDEBUG_PRINTLN("-WEBSERVER : erreur de route (async)");
+    String message = "File Not Found\n\n";
+    message += "URI: ";
+    message += request.path;
+    message += "\nMethod: ";
+    message += request.methodName();
+    message += "\nArguments: ";
+    const uint8_t args = request.args();
+    message += String(args) + "\n";
+    for (uint8_t i = 0; i < args; i++) {
+        message += " " + request.argName(i) + ": " + request.arg(i) + "\n";
+    }
+    request.send(404, "text/plain", message);
 }
 
 /**
@@ -187,25 +439,42 @@ inline void handleDebug() {
  */
 inline void setupWebServer() {
     // On a besoin d'une connexion WiFi !
-    // Test de la connexion WiFi. Si elle n'est pas active alors on démarre le WiFi
-    if (WiFi.status() != WL_CONNECTED) { setupWiFi(); } // Connexion WiFi
+    // Si le WiFi n'est pas démarré on le démarre. Le point d'accès suffit : inutile d'attendre la Station
+    if (WiFi.getMode() == WIFI_OFF) { setupWiFi(); } // Connexion WiFi
     MYDEBUG_PRINTLN("-WEBSERVER : Démarrage");
 
     // Configuration de mon serveur web en définissant plusieurs routes
     // A chaque route est associée une fonction
-    monWebServeur.on("/", HTTP_GET, handleRoot);
-    monWebServeur.on("/", HTTP_POST, handleRoot);
-    monWebServeur.on("/debug", HTTP_GET, handleDebug);
+    webOn("/", HTTP_ANY, handleRoot);
+    webOn("/debug", HTTP_GET, handleDebug);
+    webOn("/debug/heap", HTTP_GET, handleDebugHeap);
+    webOn("/debug/loop", HTTP_GET, handleDebugLoop);
 
     monWebServeur.onNotFound(handleNotFound);
 
+#if WEB_ASYNC
+    asyncWebOnNotFound(asyncHandleNotFound);
+    if (!asyncWebBegin(WEB_ASYNC_PORT)) {
+        // Port 80 sans serveur asynchrone : ESP8266WebServer le reprend, toutes les routes y sont déclarées
+        MYDEBUG_ERRORLN("-WEBSERVER : Serveur asynchrone indisponible, port " + String(WEB_ASYNC_PORT) +
+                        " servi par ESP8266WebServer");
+        monWebServeur.begin(WEB_ASYNC_PORT);
+        return;
+    }
+    monWebServeur.begin(); // Démarrage du serveur
+    MYDEBUG_PRINTLN("-WEBSERVER : Serveur Web démarré (port " + String(WEB_ASYNC_PORT) + ", et port " +
+                    String(WEB_SYNC_PORT) + " pour toutes les routes)");
+#else
     monWebServeur.begin(); // Démarrage du serveur
-    MYDEBUG_PRINTLN("-WEBSERVER : Serveur Web démarré");
+    MYDEBUG_PRINTLN("-WEBSERVER : Serveur Web démarré (port " + String(WEB_SYNC_PORT) + ")");
+#endif
 }
 
 /**
  * Loop pour le serveur web afin qu'il regarde s'il a reçu des requêtes afin de les traiter
  */
 inline void loopWebServer() {
+    HeapScope scope(HEAP_WEB);
     monWebServeur.handleClient();
+    loopAsyncWeb(); // Requêtes complètes seulement : les entrées/sorties sont faites par lwIP
 }
@@ -79,56 +79,360 @@
  * - Station pour se connecter à un Access Point pour accéder au réseau externe (internet).
  * 
  * Je peux ajouter un serveur DNS pour réaliser un portail captif ...
+ *
+ * \subsection fastWiFi Reconnexion rapide
+ * Une association complète (balayage de tous les canaux puis DHCP) prend plusieurs secondes. Après
+ * chaque obtention d'une adresse, le point d'accès (BSSID), son canal, le réseau candidat et le bail
+ * (IP, passerelle, masque, DNS) sont conservés en mémoire RTC (zone RTC_SLOT_WIFI). Au démarrage
+ * suivant ou à une perte du lien, la carte s'associe directement à ce BSSID sur ce canal avec l'adresse
+ * en IP fixe : pas de balayage, pas de DHCP. Si cette tentative échoue dans WIFI_FAST_TIMEOUT_MS, un
+ * balayage asynchrone choisit le candidat connu le plus fort, avec DHCP.
+ *
+ * Les réseaux candidats sont lus dans /config.json, dans l'ordre de préférence :
+ * \code
+ * "reseaux": [{"ssid": "atelier", "password": "..."}, {"ssid": "maison", "password": "..."}]
+ * \endcode
+ * puis "ssid"/"password" et enfin station_ssid (WIFI_CREDENTIALS.h).
+ *
+ * Le lien est surveillé par les événements WiFi (déconnexion, adresse obtenue) : la reconnexion
+ * démarre à l'itération de loop suivant la perte, sans attendre une vérification périodique.
+ *
+ * \subsection apWiFi Point d'accès de configuration
+ * Le SDK ne met la radio en veille (modem ou léger, voir MySleep.h) qu'en mode Station seul. Le point
+ * d'accès est donc coupé quand la station est connectée depuis "pointAcces" secondes (/config.json,
+ * WIFI_AP_HOLD_SEC par défaut, 0 : jamais coupé) et qu'aucun terminal n'y est associé. Il est remis en
+ * service dès la perte du lien, pour que la carte reste joignable pendant la reconnexion.
 */
 
 // Librairies nécessaires, en fonction de la carte utilisée
 #pragma once
 #include <ESP8266WiFi.h>  // WiFi ESP8266
+#include <LittleFS.h>
+#include <ArduinoJson.h>
 
 // Variables
 // pour le mode STATION
 #include "MyDebug.h"
+#include "MyRTC.h"
 #include "WIFI_CREDENTIALS.h"
 
-// ------------------------------------------------------------------------------------------------
-// CONFIGURATION DU WIFI
-// ------------------------------------------------------------------------------------------------
-/**
- * Fonction de configuration WiFi de ma carte.
- * 
- * La mode WIFI_AP_STA est utilisé afin de pouvoir à la fois :
- * - Se connecter à un point d'accès réseau en tant que station
- * - Proposer une connexion à l'utilisateur pour accéder à mon serveur web
- */
 #ifndef MY_WIFI_H
 #define MY_WIFI_H
 
-inline void setupWiFi() {
+#define WIFI_CONFIG_FILE        "/config.json"   // Lu avant setupSPIFFS() : pas de strConfigFile
+#define WIFI_CANDIDATES_MAX     4
+#define WIFI_FAST_TIMEOUT_MS    1500    // Association directe (BSSID, canal, IP fixe)
+#define WIFI_JOIN_TIMEOUT_MS    10000   // Association après balayage, avec DHCP
+#define WIFI_RETRY_MS           5000    // Attente avant un nouveau balayage quand aucun candidat n'est visible
+#ifndef WIFI_AP_HOLD_SEC
+#define WIFI_AP_HOLD_SEC        300     // Point d'accès gardé après la connexion de la station (0 : toujours)
+#endif
+#ifndef WIFI_STATIC_IP
+#define WIFI_STATIC_IP          1       // 0 : DHCP même sur le chemin rapide
+#endif
+
+/**
+ * Dernière association réussie, conservée en mémoire RTC
+ */
+struct WiFiCache {
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t candidate;     // Index dans wifiCandidates
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t mask;
+    uint32_t dns;
+};
+
+static_assert(sizeof(RtcRecord<WiFiCache>) / RTC_BLOCK_SIZE <= RTC_BLOCK_COUNT - RTC_SLOT_WIFI,
+              "Cache WiFi trop grand pour sa zone RTC");
+
+enum WiFiState : uint8_t {
+    WIFI_STATE_UP,         // Adresse obtenue
+    WIFI_STATE_FAST,       // Association directe en cours
+    WIFI_STATE_SCAN,       // Balayage asynchrone en cours
+    WIFI_STATE_JOIN,       // Association au candidat choisi, DHCP
+    WIFI_STATE_WAIT,       // Aucun candidat visible, nouvel essai plus tard
+};
+
+inline const char *const wifiStateNames[] = {"connecte", "rapide", "balayage", "association", "attente"};
+
+struct WiFiStats {
+    uint32_t linkLost = 0;
+    uint32_t fastOk = 0;
+    uint32_t fastFailed = 0;
+    uint32_t scans = 0;
+    uint32_t apStops = 0;          // Point d'accès coupé, la radio peut dormir
+    uint32_t lastRecoveryMs = 0;   // Perte du lien (ou démarrage) → adresse obtenue
+    uint32_t bestRecoveryMs = UINT32_MAX;
+    uint8_t lastReason = 0;        // Raison de la dernière déconnexion (SDK)
+};
+
+inline String wifiSsids[WIFI_CANDIDATES_MAX];
+inline String wifiPasswords[WIFI_CANDIDATES_MAX];
+inline uint8_t wifiCandidateCount = 0;
+inline uint8_t wifiCandidate = 0;
+inline WiFiCache wifiCache;
+inline bool wifiCacheValid = false;
+inline WiFiState wifiState = WIFI_STATE_WAIT;
+inline unsigned long wifiStateSince = 0;
+inline unsigned long wifiDownSince = 0;
+inline WiFiStats wifiStats;
+inline uint32_t wifiApHoldMs = WIFI_AP_HOLD_SEC * 1000UL;
+inline bool wifiApActive = false;
+inline WiFiEventHandler wifiGotIpHandler;
+inline WiFiEventHandler wifiDisconnectedHandler;
+
+// Levés par les événements WiFi (contexte système), traités par loopWiFi()
+inline volatile bool wifiGotIp = false;
+inline volatile bool wifiLost = false;
+
+inline void wifiAddCandidate(const String &ssid, const String &password) {
+    if (ssid.length() == 0 || wifiCandidateCount >= WIFI_CANDIDATES_MAX) return;
+    for (uint8_t i = 0; i < wifiCandidateCount; i++) {
+        if (wifiSsids[i] == ssid) return;
+    }
+    wifiSsids[wifiCandidateCount] = ssid;
+    wifiPasswords[wifiCandidateCount] = password;
+    wifiCandidateCount++;
+}
+
+/**
+ * Réseaux candidats : "reseaux" de /config.json, puis "ssid"/"password", puis WIFI_CREDENTIALS.h
+ */
+inline void wifiLoadCandidates() {
+    wifiCandidateCount = 0;
+    if (LittleFS.begin()) {
+        if (File file = LittleFS.open(WIFI_CONFIG_FILE, "r")) {
+            StaticJsonDocument<64> filter;
+            filter["reseaux"] = true;
+            filter["ssid"] = true;
+            filter["password"] = true;
+            filter["pointAcces"] = true;
+            DynamicJsonDocument doc(768);
+            if (!deserializeJson(doc, file, DeserializationOption::Filter(filter))) {
+                for (JsonObject reseau: doc["reseaux"].as<JsonArray>()) {
+                    wifiAddCandidate(reseau["ssid"] | "", reseau["password"] | "");
+                }
+                wifiAddCandidate(doc["ssid"] | "", doc["password"] | "");
+                wifiApHoldMs = (doc["pointAcces"] | static_cast<uint32_t>(WIFI_AP_HOLD_SEC)) * 1000UL;
+            }
+            file.close();
+        }
+    }
+    wifiAddCandidate(station_ssid, station_password);
+}
+
+inline void wifiSetState(const WiFiState state) {
+    wifiState = state;
+    wifiStateSince = millis();
+}
+
+/**
+ * Association directe au dernier point d'accès, sans balayage ni DHCP
+ */
+inline void wifiBeginFast() {
+    wifiCandidate = wifiCache.candidate;
+#if WIFI_STATIC_IP
+    WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway), IPAddress(wifiCache.mask),
+                IPAddress(wifiCache.dns));
+#endif
+    WiFi.begin(wifiSsids[wifiCandidate].c_str(), wifiPasswords[wifiCandidate].c_str(), wifiCache.channel,
+               wifiCache.bssid);
+    wifiSetState(WIFI_STATE_FAST);
+}
+
+/**
+ * Chemin lent : balayage asynchrone, le résultat est traité par loopWiFi()
+ */
+inline void wifiBeginScan() {
+    WiFi.disconnect();
+    WiFi.config(0U, 0U, 0U); // Retour au DHCP : le bail en cache n'est peut-être plus valable
+    WiFi.scanNetworks(true);
+    wifiStats.scans++;
+    wifiSetState(WIFI_STATE_SCAN);
+}
+
+/**
+ * Meilleur candidat visible : le plus fort, à préférence égale l'ordre de la configuration
+ */
+inline void wifiJoinFromScan(const int8_t found) {
+    int best = -1;
+    int32_t bestRssi = INT32_MIN;
+    uint8_t bestCandidate = 0;
+    for (int8_t i = 0; i < found; i++) {
+        for (uint8_t c = 0; c < wifiCandidateCount; c++) {
+            if (WiFi.SSID(i) == wifiSsids[c] && WiFi.RSSI(i) > bestRssi) {
+                best = i;
+                bestRssi = WiFi.RSSI(i);
+                bestCandidate = c;
+            }
+        }
+    }
+    if (best < 0) {
+        WiFi.scanDelete();
+        wifiSetState(WIFI_STATE_WAIT);
+        return;
+    }
+    wifiCandidate = bestCandidate;
+    WiFi.begin(wifiSsids[wifiCandidate].c_str(), wifiPasswords[wifiCandidate].c_str(), WiFi.channel(best),
+               WiFi.BSSID(best));
+    WiFi.scanDelete();
+    MYDEBUG_PRINTLN("-WIFI : Association à " + wifiSsids[wifiCandidate] + " (" + String(bestRssi) + " dBm)");
+    wifiSetState(WIFI_STATE_JOIN);
+}
+
+inline void wifiStartAp() {
+    WiFi.softAP(ap_ssid, ap_password);
+    wifiApActive = true;
+    MYDEBUG_PRINT("-WIFI : Access Point mis à disposition : ");
+    MYDEBUG_PRINTLN(WiFi.softAPIP());
+}
+
+/**
+ * Point d'accès coupé quand la station est connectée depuis wifiApHoldMs et que personne n'y est associé
+ */
+inline void wifiApPolicy() {
+    if (!wifiApActive || wifiApHoldMs == 0 || wifiState != WIFI_STATE_UP) return;
+    if (millis() - wifiStateSince < wifiApHoldMs || WiFi.softAPgetStationNum() > 0) return;
+    WiFi.softAPdisconnect(true); // Mode Station seul
+    wifiApActive = false;
+    wifiStats.apStops++;
+    MYDEBUG_PRINTLN("-WIFI : Access Point coupé, station seule");
+}
+
+/**
+ * Adresse obtenue : nouveau cache RTC et durée de la reprise
+ */
+inline void wifiLinkUp() {
+    wifiCache.candidate = wifiCandidate;
+    memcpy(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid));
+    wifiCache.channel = WiFi.channel();
+    wifiCache.ip = WiFi.localIP();
+    wifiCache.gateway = WiFi.gatewayIP();
+    wifiCache.mask = WiFi.subnetMask();
+    wifiCache.dns = WiFi.dnsIP();
+    wifiCacheValid = rtcStore(RTC_SLOT_WIFI, wifiCache);
+
+    if (wifiState == WIFI_STATE_FAST) wifiStats.fastOk++;
+    wifiStats.lastRecoveryMs = millis() - wifiDownSince;
+    wifiStats.bestRecoveryMs = std::min(wifiStats.bestRecoveryMs, wifiStats.lastRecoveryMs);
+    wifiSetState(WIFI_STATE_UP);
+    MYDEBUG_PRINT("-WIFI : connecté en mode Station avec l'adresse IP : ");
+    MYDEBUG_PRINTLN(WiFi.localIP());
+    MYDEBUG_PRINTLN("-WIFI : reprise en " + String(wifiStats.lastRecoveryMs) + " ms");
+}
+
+/**
+ * Connexion (ou reconnexion) : chemin rapide si le cache le permet, sinon balayage
+ */
+inline void wifiConnect() {
+    wifiDownSince = millis();
+    if (wifiCacheValid && wifiCache.candidate < wifiCandidateCount) {
+        wifiBeginFast();
+    } else {
+        wifiBeginScan();
+    }
+}
+
+/**
+ * Machine à états du lien, pilotée par les événements WiFi ; à appeler à chaque itération de la loop
+ */
+inline void loopWiFi() {
+    if (wifiLost) {
+        wifiLost = false;
+        if (wifiState == WIFI_STATE_UP) {
+            wifiStats.linkLost++;
+            MYDEBUG_PRINTLN("-WIFI : Perte de connexion (raison " + String(wifiStats.lastReason) + ")");
+            if (!wifiApActive) wifiStartAp(); // Carte joignable pendant la reconnexion
+            wifiConnect();
+        }
+    }
+    if (wifiGotIp) {
+        wifiGotIp = false;
+        if (wifiState != WIFI_STATE_UP && WiFi.status() == WL_CONNECTED) wifiLinkUp();
+    }
+
+    const unsigned long elapsed = millis() - wifiStateSince;
+    switch (wifiState) {
+        case WIFI_STATE_FAST:
+            if (elapsed >= WIFI_FAST_TIMEOUT_MS) {
+                wifiStats.fastFailed++;
+                wifiCacheValid = false;
+                MYDEBUG_WARNLN("-WIFI : Association directe échouée, balayage");
+                wifiBeginScan();
+            }
+            break;
+        case WIFI_STATE_SCAN: {
+            const int8_t found = WiFi.scanComplete();
+            if (found >= 0) {
+                wifiJoinFromScan(found);
+            } else if (found != WIFI_SCAN_RUNNING) {
+                wifiSetState(WIFI_STATE_WAIT);
+            }
+            break;
+        }
+        case WIFI_STATE_JOIN:
+            if (elapsed >= WIFI_JOIN_TIMEOUT_MS) wifiBeginScan();
+            break;
+        case WIFI_STATE_WAIT:
+            if (elapsed >= WIFI_RETRY_MS) wifiBeginScan();
+            break;
+        case WIFI_STATE_UP:
+            wifiApPolicy();
+            break;
+    }
+}
+
+inline size_t wifiReport(char *out, const size_t size) {
+    const char *ssid = wifiCandidate < wifiCandidateCount ? wifiSsids[wifiCandidate].c_str() : "-";
+    return snprintf(out, size,
+                    "%s %s canal=%d pertes=%u rapides=%u/%u balayages=%u reprise=%u ms (min %u ms) ap=%s "
+                    "coupures_ap=%u\n",
+                    wifiStateNames[wifiState], ssid, WiFi.channel(), wifiStats.linkLost, wifiStats.fastOk,
+                    wifiStats.fastOk + wifiStats.fastFailed, wifiStats.scans, wifiStats.lastRecoveryMs,
+                    wifiStats.bestRecoveryMs == UINT32_MAX ? 0 : wifiStats.bestRecoveryMs,
+                    wifiApActive ? "oui" : "non", wifiStats.apStops);
+}
+
+/**
+ * Lancement de la configuration WiFi sans attendre l'association au réseau : le point d'accès est
+ * disponible immédiatement, la connexion en mode Station se poursuit dans loopWiFi().
+ */
+inline void beginWiFi() {
+    HeapScope scope(HEAP_WIFI);
     MYDEBUG_PRINTLN();
     MYDEBUG_PRINT("-WIFI : Configuration");
 
     // Configuration de la carte en mode Access Point ET Station
     WiFi.mode(WIFI_AP_STA);
     //WiFi.mode(WIFI_STA);
+    WiFi.persistent(false);        // Pas d'écriture en flash à chaque association
+    WiFi.setAutoReconnect(false);  // La reconnexion est faite par loopWiFi()
 
-    // Démarrage du mode Access Point
-    WiFi.softAP(ap_ssid, ap_password);
-    // J'affiche l'adresse IP de mon point d'accès
-    MYDEBUG_PRINT("-WIFI : Access Point mis à disposition : ");
-    MYDEBUG_PRINTLN(WiFi.softAPIP());
+    // Démarrage du mode Access Point, coupé plus tard par wifiApPolicy()
+    wifiStartAp();
+
+    wifiGotIpHandler = WiFi.onStationModeGotIP([](const WiFiEventStationModeGotIP &) { wifiGotIp = true; });
+    wifiDisconnectedHandler = WiFi.onStationModeDisconnected([](const WiFiEventStationModeDisconnected &event) {
+        wifiStats.lastReason = event.reason;
+        wifiLost = true;
+    });
 
     // Démarrage du mode Station
-    WiFi.begin(station_ssid, station_password);
+    wifiLoadCandidates();
+    wifiCacheValid = rtcLoad(RTC_SLOT_WIFI, wifiCache);
+    wifiConnect();
 
     MYDEBUG_PRINT("-WIFI : Connexion au réseau : ");
-    MYDEBUG_PRINTLN(station_ssid);
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        MYDEBUG_PRINT(".");
+    MYDEBUG_PRINTLN(wifiCandidateCount ? wifiSsids[wifiCandidate] : String("(aucun réseau configuré)"));
+}
+
+inline void setupWiFi() {
+    beginWiFi();
+    while (wifiState != WIFI_STATE_UP) {
+        loopWiFi();
+        delay(50);
     }
-    MYDEBUG_PRINTLN("");
-    // J'affiche l'adresse IP de ma carte
-    MYDEBUG_PRINT("-WIFI : connecté en mode Station avec l'adresse IP : ");
-    MYDEBUG_PRINTLN(WiFi.localIP());
 }
 #endif
@@ -7,6 +7,8 @@ inline auto station_password = "";   // Mot de passe du réseau WiFi pour accéd
 // pour le mode ACCESS POINT
 inline auto ap_ssid     = "";      // Nom du réseau WiFi pour accéder à mon serveur web
 inline auto ap_password = "";     // Mot de passe du réseau WiFi pour accéder à l'Access Point
+// pour la mise à jour OTA (/api/ota, utilisateur « ota ») ; vide : mise à jour refusée
+inline auto ota_password = "";
 inline String sstation_ssid;
 inline String sstation_password;
 
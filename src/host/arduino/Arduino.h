@@ -0,0 +1,576 @@
+/**
+ * \file Arduino.h
+ * \brief Cœur Arduino minimal pour la machine hôte (environnement native de platformio.ini)
+ *
+ * Les en-têtes de include/ se compilent tels quels sur l'hôte avec ce répertoire dans le chemin
+ * d'inclusion : String, Print et Stream, Serial sur la sortie standard, millis() et micros() sur
+ * l'horloge monotone, delay() et yield() qui font tourner les Tickers (voir Ticker.h) et un EspClass
+ * dont le tas est constant. Les bibliothèques (Adafruit MQTT, ArduinoJson) sont les vraies, compilées
+ * contre ce cœur.
+ *
+ * Sur l'hôte, ESP.getCycleCount() est dérivé de l'horloge à une fréquence nominale de
+ * HOST_CPU_MHZ (getCpuFreqMHz()) : les conversions cycles → µs du projet restent justes.
+ */
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <strings.h>
+#include <thread>
+#include <vector>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HEX 16
+#define DEC 10
+#define OCT 8
+#define BIN 2
+
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+#define ICACHE_FLASH_ATTR
+
+/************************* Mémoire flash *************************************/
+
+class __FlashStringHelper;
+
+#define PROGMEM
+#define PGM_P                   const char *
+#define PSTR(s)                 (s)
+#define F(s)                    (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+#define FPSTR(p)                (reinterpret_cast<const __FlashStringHelper *>(p))
+#define pgm_read_byte(p)        (*reinterpret_cast<const uint8_t *>(p))
+#define pgm_read_word(p)        (*reinterpret_cast<const uint16_t *>(p))
+#define pgm_read_dword(p)       (*reinterpret_cast<const uint32_t *>(p))
+#define pgm_read_float(p)       (*reinterpret_cast<const float *>(p))
+#define pgm_read_ptr(p)         (*reinterpret_cast<void *const *>(p))
+
+inline size_t strlen_P(const char *s) { return strlen(s); }
+inline int strcmp_P(const char *a, const char *b) { return strcmp(a, b); }
+inline int strncmp_P(const char *a, const char *b, const size_t n) { return strncmp(a, b, n); }
+inline int strcasecmp_P(const char *a, const char *b) { return strcasecmp(a, b); }
+inline char *strcpy_P(char *d, const char *s) { return strcpy(d, s); }
+inline char *strncpy_P(char *d, const char *s, const size_t n) { return strncpy(d, s, n); }
+inline void *memcpy_P(void *d, const void *s, const size_t n) { return memcpy(d, s, n); }
+inline int snprintf_P(char *out, const size_t size, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    const int n = vsnprintf(out, size, format, args);
+    va_end(args);
+    return n;
+}
+
+#ifndef __APPLE__
+inline size_t strlcpy(char *dst, const char *src, const size_t size) {
+    const size_t len = strlen(src);
+    if (size) {
+        const size_t n = std::min(len, size - 1);
+        memcpy(dst, src, n);
+        dst[n] = 0;
+    }
+    return len;
+}
+#endif
+
+/************************* Conversions ***************************************/
+
+inline char *ultoa(unsigned long value, char *out, const int base) {
+    char digits[sizeof(unsigned long) * 8 + 1];
+    int n = 0;
+    do {
+        const unsigned long digit = value % base;
+        digits[n++] = static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value);
+    for (int i = 0; i < n; i++) out[i] = digits[n - 1 - i];
+    out[n] = 0;
+    return out;
+}
+
+inline char *ltoa(const long value, char *out, const int base) {
+    if (value < 0 && base == 10) {
+        out[0] = '-';
+        ultoa(-static_cast<unsigned long>(value), out + 1, base);
+        return out;
+    }
+    return ultoa(static_cast<unsigned long>(value), out, base);
+}
+
+inline char *itoa(const int value, char *out, const int base) { return ltoa(value, out, base); }
+inline char *utoa(const unsigned value, char *out, const int base) { return ultoa(value, out, base); }
+
+inline char *dtostrf(const double value, const signed char width, const unsigned char prec, char *out) {
+    sprintf(out, "%*.*f", width, prec, value);
+    return out;
+}
+
+/************************* String ********************************************/
+
+class String {
+    std::string _s;
+
+    template <typename T>
+    static std::string integer(const T value, const unsigned char base) {
+        char out[72];
+        if (base == 10) return std::to_string(value);
+        ultoa(static_cast<unsigned long>(value), out, base);
+        return out;
+    }
+
+    static std::string decimal(const double value, const unsigned char places) {
+        char out[64];
+        snprintf(out, sizeof(out), "%.*f", places, value);
+        return out;
+    }
+
+public:
+    String() = default;
+    String(const char *s) : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    String(const __FlashStringHelper *s) : _s(s ? reinterpret_cast<const char *>(s) : "") {}
+    explicit String(const char c) : _s(1, c) {}
+    explicit String(const unsigned char v, const unsigned char base = 10) : _s(integer(v, base)) {}
+    explicit String(const int v, const unsigned char base = 10) : _s(integer(v, base)) {}
+    explicit String(const unsigned v, const unsigned char base = 10) : _s(integer(v, base)) {}
+    explicit String(const long v, const unsigned char base = 10) : _s(integer(v, base)) {}
+    explicit String(const unsigned long v, const unsigned char base = 10) : _s(integer(v, base)) {}
+    explicit String(const long long v, const unsigned char base = 10) : _s(integer(v, base)) {}
+    explicit String(const unsigned long long v, const unsigned char base = 10) : _s(integer(v, base)) {}
+    explicit String(const float v, const unsigned char places = 2) : _s(decimal(v, places)) {}
+    explicit String(const double v, const unsigned char places = 2) : _s(decimal(v, places)) {}
+
+    [[nodiscard]] const char *c_str() const { return _s.c_str(); }
+    [[nodiscard]] unsigned length() const { return _s.size(); }
+    [[nodiscard]] bool isEmpty() const { return _s.empty(); }
+    bool reserve(const unsigned size) {
+        _s.reserve(size);
+        return true;
+    }
+    void clear() { _s.clear(); }
+    explicit operator bool() const { return true; }
+
+    char operator[](const unsigned i) const { return i < _s.size() ? _s[i] : 0; }
+    char &operator[](const unsigned i) { return _s[i]; }
+    [[nodiscard]] char charAt(const unsigned i) const { return (*this)[i]; }
+    void setCharAt(const unsigned i, const char c) {
+        if (i < _s.size()) _s[i] = c;
+    }
+    [[nodiscard]] const char *begin() const { return _s.c_str(); }
+    [[nodiscard]] const char *end() const { return _s.c_str() + _s.size(); }
+
+    bool concat(const String &s) {
+        _s += s._s;
+        return true;
+    }
+    bool concat(const char *s) {
+        if (s) _s += s;
+        return true;
+    }
+    bool concat(const char *s, const unsigned n) {
+        if (s) _s.append(s, n);
+        return true;
+    }
+    bool concat(const __FlashStringHelper *s) { return concat(reinterpret_cast<const char *>(s)); }
+    bool concat(const char c) {
+        _s += c;
+        return true;
+    }
+    template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+    bool concat(const T v) { return concat(String(v)); }
+
+    template <typename T>
+    String &operator+=(const T &v) {
+        concat(v);
+        return *this;
+    }
+
+    [[nodiscard]] int compareTo(const String &s) const { return _s.compare(s._s); }
+    [[nodiscard]] bool equals(const String &s) const { return _s == s._s; }
+    [[nodiscard]] bool equals(const char *s) const { return _s == (s ? s : ""); }
+    [[nodiscard]] bool equalsIgnoreCase(const String &s) const { return strcasecmp(c_str(), s.c_str()) == 0; }
+    [[nodiscard]] bool startsWith(const String &s) const { return _s.compare(0, s._s.size(), s._s) == 0; }
+    [[nodiscard]] bool endsWith(const String &s) const {
+        return _s.size() >= s._s.size() && _s.compare(_s.size() - s._s.size(), s._s.size(), s._s) == 0;
+    }
+    bool operator==(const String &s) const { return _s == s._s; }
+    bool operator==(const char *s) const { return equals(s); }
+    bool operator!=(const String &s) const { return _s != s._s; }
+    bool operator!=(const char *s) const { return !equals(s); }
+    bool operator<(const String &s) const { return _s < s._s; }
+
+    [[nodiscard]] int indexOf(const char c, const unsigned from = 0) const {
+        const size_t at = _s.find(c, from);
+        return at == std::string::npos ? -1 : static_cast<int>(at);
+    }
+    [[nodiscard]] int indexOf(const String &s, const unsigned from = 0) const {
+        const size_t at = _s.find(s._s, from);
+        return at == std::string::npos ? -1 : static_cast<int>(at);
+    }
+    [[nodiscard]] int lastIndexOf(const char c) const {
+        const size_t at = _s.rfind(c);
+        return at == std::string::npos ? -1 : static_cast<int>(at);
+    }
+    [[nodiscard]] String substring(const unsigned from) const {
+        return from < _s.size() ? String(_s.substr(from)) : String();
+    }
+    [[nodiscard]] String substring(const unsigned from, const unsigned to) const {
+        if (from >= to || from >= _s.size()) return String();
+        return String(_s.substr(from, to - from));
+    }
+
+    void replace(const String &from, const String &to) {
+        if (from._s.empty()) return;
+        for (size_t at = _s.find(from._s); at != std::string::npos; at = _s.find(from._s, at + to._s.size())) {
+            _s.replace(at, from._s.size(), to._s);
+        }
+    }
+    void remove(const unsigned index) {
+        if (index < _s.size()) _s.erase(index);
+    }
+    void remove(const unsigned index, const unsigned count) {
+        if (index < _s.size()) _s.erase(index, count);
+    }
+    void toLowerCase() {
+        for (char &c: _s) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    void toUpperCase() {
+        for (char &c: _s) c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    }
+    void trim() {
+        const size_t first = _s.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) {
+            _s.clear();
+            return;
+        }
+        _s = _s.substr(first, _s.find_last_not_of(" \t\r\n") - first + 1);
+    }
+
+    [[nodiscard]] long toInt() const { return atol(c_str()); }
+    [[nodiscard]] float toFloat() const { return static_cast<float>(atof(c_str())); }
+    [[nodiscard]] double toDouble() const { return atof(c_str()); }
+};
+
+// Type des concaténations du cœur ESP8266, utilisé par les adaptateurs d'ArduinoJson
+class StringSumHelper : public String {
+public:
+    using String::String;
+    StringSumHelper(const String &s) : String(s) {}
+};
+
+template <typename T>
+String operator+(const String &a, const T &b) {
+    String out(a);
+    out.concat(b);
+    return out;
+}
+
+inline String operator+(const char *a, const String &b) {
+    String out(a);
+    out.concat(b);
+    return out;
+}
+
+inline String operator+(const char a, const String &b) {
+    String out(a);
+    out.concat(b);
+    return out;
+}
+
+inline bool operator==(const char *a, const String &b) { return b == a; }
+
+/************************* Print / Stream ************************************/
+
+class Print {
+    template <typename T>
+    size_t printInteger(const T value, const int base) {
+        if (base == DEC) return print(String(value).c_str());
+        char out[72];
+        ultoa(static_cast<unsigned long>(value), out, base);
+        return print(out);
+    }
+
+public:
+    virtual ~Print() = default;
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    size_t write(const char *s) { return s ? write(reinterpret_cast<const uint8_t *>(s), strlen(s)) : 0; }
+    size_t write(const char *s, const size_t size) { return write(reinterpret_cast<const uint8_t *>(s), size); }
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    size_t print(const char *s) { return write(s); }
+    size_t print(const String &s) { return write(s.c_str(), s.length()); }
+    size_t print(const __FlashStringHelper *s) { return write(reinterpret_cast<const char *>(s)); }
+    size_t print(const char c) { return write(static_cast<uint8_t>(c)); }
+    size_t print(const unsigned char v, const int base = DEC) { return printInteger(v, base); }
+    size_t print(const int v, const int base = DEC) { return printInteger(v, base); }
+    size_t print(const unsigned v, const int base = DEC) { return printInteger(v, base); }
+    size_t print(const long v, const int base = DEC) { return printInteger(v, base); }
+    size_t print(const unsigned long v, const int base = DEC) { return printInteger(v, base); }
+    size_t print(const long long v, const int base = DEC) { return printInteger(v, base); }
+    size_t print(const unsigned long long v, const int base = DEC) { return printInteger(v, base); }
+    size_t print(const double v, const int places = 2) { return print(String(v, places)); }
+
+    size_t println() { return write("\r\n"); }
+    // Le texte puis la fin de ligne : les opérandes de + ne sont pas ordonnés
+    template <typename T>
+    size_t println(const T &v) {
+        const size_t n = print(v);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(const T &v, const int format) {
+        const size_t n = print(v, format);
+        return n + println();
+    }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        char small[256];
+        const int n = vsnprintf(small, sizeof(small), format, args);
+        va_end(args);
+        if (n < 0) return 0;
+        if (static_cast<size_t>(n) < sizeof(small)) return write(small, n);
+        std::string big(n + 1, '\0');
+        va_start(args, format);
+        vsnprintf(&big[0], big.size(), format, args);
+        va_end(args);
+        return write(big.c_str(), n);
+    }
+};
+
+class Stream : public Print {
+protected:
+    unsigned long _timeout = 1000;
+
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(const unsigned long timeout) { _timeout = timeout; }
+    [[nodiscard]] unsigned long getTimeout() const { return _timeout; }
+
+    // Sur l'hôte les données sont déjà là ou ne viendront pas : pas d'attente
+    virtual size_t readBytes(char *buffer, const size_t length) {
+        size_t n = 0;
+        while (n < length && available() > 0) {
+            const int c = read();
+            if (c < 0) break;
+            buffer[n++] = static_cast<char>(c);
+        }
+        return n;
+    }
+    size_t readBytes(uint8_t *buffer, const size_t length) {
+        return readBytes(reinterpret_cast<char *>(buffer), length);
+    }
+
+    size_t readBytesUntil(const char terminator, char *buffer, const size_t length) {
+        size_t n = 0;
+        while (n < length && available() > 0) {
+            const int c = read();
+            if (c < 0 || c == terminator) break;
+            buffer[n++] = static_cast<char>(c);
+        }
+        return n;
+    }
+    size_t readBytesUntil(const char terminator, uint8_t *buffer, const size_t length) {
+        return readBytesUntil(terminator, reinterpret_cast<char *>(buffer), length);
+    }
+    String readStringUntil(const char terminator) {
+        String out;
+        while (available() > 0) {
+            const int c = read();
+            if (c < 0 || c == terminator) break;
+            out.concat(static_cast<char>(c));
+        }
+        return out;
+    }
+    String readString() {
+        String out;
+        for (int c = read(); c >= 0; c = read()) out.concat(static_cast<char>(c));
+        return out;
+    }
+};
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    size_t write(const uint8_t c) override { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t *buffer, const size_t size) override { return fwrite(buffer, 1, size, stdout); }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override { fflush(stdout); }
+    explicit operator bool() const { return true; }
+};
+
+inline HardwareSerial Serial;
+
+/************************* Temps et Tickers **********************************/
+
+namespace host {
+    inline const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    inline uint64_t nowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * Échéance d'un Ticker : les Tickers de l'hôte tournent dans delay() et yield(), comme les
+     * callbacks différés du cœur ESP8266
+     */
+    struct Timer {
+        unsigned long due = 0;
+        uint32_t periodMs = 0;      // 0 : une seule fois
+        std::function<void()> callback;
+    };
+
+    inline std::vector<Timer *> &timers() {
+        static std::vector<Timer *> list;
+        return list;
+    }
+
+    inline void disarm(Timer *timer) {
+        std::vector<Timer *> &list = timers();
+        list.erase(std::remove(list.begin(), list.end(), timer), list.end());
+    }
+
+    inline void arm(Timer *timer) {
+        disarm(timer);
+        timers().push_back(timer);
+    }
+
+    inline void pollTimers() {
+        const unsigned long now = static_cast<unsigned long>(nowUs() / 1000);
+        const std::vector<Timer *> due = timers(); // Un callback peut détacher ou réarmer un Ticker
+        for (Timer *timer: due) {
+            const std::vector<Timer *> &list = timers();
+            if (std::find(list.begin(), list.end(), timer) == list.end()) continue;
+            if (static_cast<long>(now - timer->due) < 0) continue;
+            if (timer->periodMs) {
+                timer->due += timer->periodMs;
+            } else {
+                disarm(timer);
+            }
+            timer->callback();
+        }
+    }
+}
+
+inline unsigned long millis() { return static_cast<unsigned long>(host::nowUs() / 1000); }
+inline unsigned long micros() { return static_cast<unsigned long>(host::nowUs()); }
+inline uint64_t micros64() { return host::nowUs(); }
+
+inline void yield() {
+    host::pollTimers();
+}
+
+inline void delay(const unsigned long ms) {
+    if (ms) std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    host::pollTimers();
+}
+
+inline void delayMicroseconds(const unsigned us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+template <typename A, typename B>
+auto min(const A a, const B b) -> decltype(a < b ? a : b) { return a < b ? a : b; }
+
+template <typename A, typename B>
+auto max(const A a, const B b) -> decltype(a > b ? a : b) { return a > b ? a : b; }
+
+template <typename A, typename B, typename C>
+A constrain(const A a, const B low, const C high) { return a < low ? low : (a > high ? high : a); }
+
+/************************* EspClass ******************************************/
+
+#define HOST_CHIP_ID        0x00c0ffeeu
+#define HOST_FREE_HEAP      40000u      // Tas constant : les garde-fous de MyHeap.h ne se déclenchent pas
+#define HOST_RTC_MEMORY     512
+#define HOST_CPU_MHZ        160
+
+enum RFMode { RF_DEFAULT };
+
+struct rst_info {
+    uint32_t reason, exccause, epc1, epc2, epc3, excvaddr, depc;
+};
+
+enum rst_reason {
+    REASON_DEFAULT_RST = 0, REASON_WDT_RST, REASON_EXCEPTION_RST, REASON_SOFT_WDT_RST, REASON_SOFT_RESTART,
+    REASON_DEEP_SLEEP_AWAKE, REASON_EXT_SYS_RST
+};
+
+class EspClass {
+    static uint8_t *rtcMemory() {
+        static uint8_t memory[HOST_RTC_MEMORY] = {};
+        return memory;
+    }
+
+public:
+    static uint32_t getFreeHeap() { return HOST_FREE_HEAP; }
+    static uint32_t getMaxFreeBlockSize() { return HOST_FREE_HEAP; }
+    static uint8_t getHeapFragmentation() { return 0; }
+    static void getHeapStats(uint32_t *free = nullptr, uint16_t *max = nullptr, uint8_t *frag = nullptr) {
+        if (free) *free = HOST_FREE_HEAP;
+        if (max) *max = UINT16_MAX;
+        if (frag) *frag = 0;
+    }
+    static uint32_t getCycleCount() { return static_cast<uint32_t>(host::nowUs() * HOST_CPU_MHZ); }
+    static uint8_t getCpuFreqMHz() { return HOST_CPU_MHZ; }
+    static uint32_t getChipId() { return HOST_CHIP_ID; }
+    static uint32_t random() {
+        static std::random_device device;
+        return device();
+    }
+    [[noreturn]] static void restart() {
+        fprintf(stderr, "ESP.restart() sur l'hôte : arrêt du programme\n");
+        std::exit(EXIT_FAILURE);
+    }
+    static bool rtcUserMemoryRead(const uint32_t offset, uint32_t *data, const size_t size) {
+        if (offset * 4 + size > HOST_RTC_MEMORY) return false;
+        memcpy(data, rtcMemory() + offset * 4, size);
+        return true;
+    }
+    static bool rtcUserMemoryWrite(const uint32_t offset, uint32_t *data, const size_t size) {
+        if (offset * 4 + size > HOST_RTC_MEMORY) return false;
+        memcpy(rtcMemory() + offset * 4, data, size);
+        return true;
+    }
+    static void wdtFeed() {}
+    static void wdtDisable() {}
+    static void wdtEnable(uint32_t) {}
+    static String getResetReason() { return String("Host"); }
+    static rst_info *getResetInfoPtr() {
+        static rst_info info = {};
+        return &info;
+    }
+    static uint32_t getFreeSketchSpace() { return 0; }
+    static uint32_t getSketchSize() { return 0; }
+    static String getSketchMD5() { return String(); }
+};
+
+inline EspClass ESP;
+
+extern "C" {
+inline void system_restart(void) { EspClass::restart(); }
+inline uint32_t system_get_time(void) { return static_cast<uint32_t>(host::nowUs()); }
+}
@@ -0,0 +1,23 @@
+// Client HTTP de l'hôte : aucune requête n'aboutit (OTA impossible sur l'hôte)
+#pragma once
+
+#include <ESP8266WiFi.h>
+
+#define HTTP_CODE_OK            200
+#define HTTPC_ERROR_CONNECTION_FAILED (-1)
+
+class HTTPClient {
+    WiFiClient _stream;
+
+public:
+    bool begin(WiFiClient &, const String &) { return true; }
+    int GET() { return HTTPC_ERROR_CONNECTION_FAILED; }
+    int getSize() { return -1; }
+    WiFiClient *getStreamPtr() { return &_stream; }
+    WiFiClient &getStream() { return _stream; }
+    String getString() { return String(); }
+    void end() {}
+    bool connected() { return false; }
+    void setTimeout(uint16_t) {}
+    static String errorToString(int) { return String("connection failed"); }
+};
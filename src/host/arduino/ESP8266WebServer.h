@@ -0,0 +1,58 @@
+/**
+ * \file ESP8266WebServer.h
+ * \brief Serveur web synchrone de l'hôte : les routes sont enregistrées, aucune requête n'arrive
+ */
+#pragma once
+
+#include <functional>
+
+#include <ESP8266WiFi.h>
+
+enum HTTPMethod { HTTP_ANY, HTTP_GET, HTTP_HEAD, HTTP_POST, HTTP_PUT, HTTP_PATCH, HTTP_DELETE, HTTP_OPTIONS };
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t) -1)
+
+class ESP8266WebServer {
+    WiFiClient _client;
+
+public:
+    typedef std::function<void()> THandlerFunction;
+    enum ClientFuture { CLIENT_REQUEST_CAN_CONTINUE, CLIENT_REQUEST_IS_HANDLED, CLIENT_MUST_STOP, CLIENT_IS_GIVEN };
+    typedef String (*ContentTypeFunction)(const String &);
+    using HookFunction = std::function<ClientFuture(const String &method, const String &url, WiFiClient *client,
+                                                    ContentTypeFunction contentType)>;
+
+    explicit ESP8266WebServer(int = 80) {}
+    void begin() {}
+    void begin(uint16_t) {}
+    void close() {}
+    void stop() {}
+    void handleClient() {}
+
+    void on(const String &, THandlerFunction) {}
+    void on(const String &, HTTPMethod, THandlerFunction) {}
+    void on(const String &, HTTPMethod, THandlerFunction, THandlerFunction) {}
+    void onNotFound(THandlerFunction) {}
+    void addHook(HookFunction) {}
+
+    [[nodiscard]] String uri() const { return String(); }
+    [[nodiscard]] HTTPMethod method() const { return HTTP_GET; }
+    [[nodiscard]] String arg(const String &) const { return String(); }
+    [[nodiscard]] String arg(int) const { return String(); }
+    [[nodiscard]] String argName(int) const { return String(); }
+    [[nodiscard]] int args() const { return 0; }
+    [[nodiscard]] bool hasArg(const String &) const { return false; }
+    String header(const String &) { return String(); }
+    bool authenticate(const char *, const char *) { return false; }
+    void requestAuthentication() {}
+
+    void send(int, const char * = nullptr, const String & = String()) {}
+    void send(int, const String &, const String &) {}
+    void send_P(int, PGM_P, PGM_P) {}
+    void setContentLength(size_t) {}
+    void sendHeader(const String &, const String &, bool = false) {}
+    void sendContent(const String &) {}
+    void sendContent(const char *, size_t) {}
+    void sendContent_P(PGM_P) {}
+    WiFiClient &client() { return _client; }
+};
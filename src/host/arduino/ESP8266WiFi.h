@@ -0,0 +1,140 @@
+/**
+ * \file ESP8266WiFi.h
+ * \brief WiFi de l'hôte : toujours associé, sans réseau (le broker local remplace le WiFiClient)
+ */
+#pragma once
+
+#include <memory>
+
+#include <Arduino.h>
+#include <Client.h>
+#include <IPAddress.h>
+
+#define WIFI_SCAN_RUNNING   (-1)
+#define WIFI_SCAN_FAILED    (-2)
+
+enum wl_status_t {
+    WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_CONNECTED = 3, WL_CONNECT_FAILED = 4, WL_DISCONNECTED = 6
+};
+enum WiFiMode_t { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA };
+enum WiFiSleepType_t { WIFI_NONE_SLEEP, WIFI_LIGHT_SLEEP, WIFI_MODEM_SLEEP };
+
+struct WiFiEventStationModeDisconnected {
+    String ssid;
+    uint8_t bssid[6];
+    uint8_t reason;
+};
+
+struct WiFiEventStationModeGotIP {
+    IPAddress ip, mask, gw;
+};
+
+struct WiFiEventStationModeConnected {
+    String ssid;
+    uint8_t bssid[6];
+    uint8_t channel;
+};
+
+struct WiFiEventHandlerOpaque {
+};
+typedef std::shared_ptr<WiFiEventHandlerOpaque> WiFiEventHandler;
+
+class WiFiClass {
+    WiFiMode_t _mode = WIFI_STA;
+    WiFiSleepType_t _sleep = WIFI_NONE_SLEEP;
+    uint8_t _bssid[6] = {};
+
+public:
+    bool mode(const WiFiMode_t mode) {
+        _mode = mode;
+        return true;
+    }
+    [[nodiscard]] WiFiMode_t getMode() const { return _mode; }
+    bool softAP(const char *, const char *) {
+        _mode = WIFI_AP_STA;
+        return true;
+    }
+    bool softAPdisconnect(const bool wifiOff = false) {
+        if (wifiOff) _mode = WIFI_STA;
+        return true;
+    }
+    uint8_t softAPgetStationNum() { return 0; }
+    IPAddress softAPIP() { return {192, 168, 4, 1}; }
+    wl_status_t begin(const char *, const char *, int32_t = 0, const uint8_t * = nullptr, bool = true) {
+        return WL_CONNECTED;
+    }
+    wl_status_t status() { return WL_CONNECTED; }
+    bool isConnected() { return true; }
+    IPAddress localIP() { return {127, 0, 0, 1}; }
+    IPAddress gatewayIP() { return {127, 0, 0, 1}; }
+    IPAddress subnetMask() { return {255, 0, 0, 0}; }
+    IPAddress dnsIP(uint8_t = 0) { return {127, 0, 0, 1}; }
+    String SSID() { return String("hote"); }
+    String SSID(uint8_t) { return SSID(); }
+    uint8_t *BSSID() { return _bssid; }
+    uint8_t *BSSID(uint8_t) { return _bssid; }
+    int32_t channel() { return 1; }
+    int32_t channel(uint8_t) { return 1; }
+    int32_t RSSI() { return -40; }
+    int32_t RSSI(uint8_t) { return -40; }
+    bool reconnect() { return true; }
+    bool disconnect(bool = false) { return true; }
+    bool config(IPAddress, IPAddress, IPAddress, IPAddress = IPAddress()) { return true; }
+    bool setSleepMode(const WiFiSleepType_t type, uint8_t = 0) {
+        _sleep = type;
+        return true;
+    }
+    [[nodiscard]] WiFiSleepType_t getSleepMode() const { return _sleep; }
+    bool setAutoReconnect(bool) { return true; }
+    bool setAutoConnect(bool) { return true; }
+    bool persistent(bool) { return true; }
+    bool forceSleepBegin(uint32_t = 0) { return true; }
+    bool forceSleepWake() { return true; }
+    int hostByName(const char *, IPAddress &, uint32_t = 10000) { return 0; }
+    int8_t scanNetworks(bool = false) { return 0; }
+    int8_t scanComplete() { return 0; }
+    void scanDelete() {}
+
+    // Les événements ne se produisent pas sur l'hôte : le lien est toujours établi
+    WiFiEventHandler onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected &)>) {
+        return std::make_shared<WiFiEventHandlerOpaque>();
+    }
+    WiFiEventHandler onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP &)>) {
+        return std::make_shared<WiFiEventHandlerOpaque>();
+    }
+    WiFiEventHandler onStationModeConnected(std::function<void(const WiFiEventStationModeConnected &)>) {
+        return std::make_shared<WiFiEventHandlerOpaque>();
+    }
+};
+
+inline WiFiClass WiFi;
+
+/**
+ * Client TCP sans réseau : aucune connexion n'aboutit
+ */
+class WiFiClient : public Client {
+public:
+    int connect(IPAddress, uint16_t) override { return 0; }
+    int connect(const char *, uint16_t) override { return 0; }
+    int connect(const String &host, const uint16_t port) { return connect(host.c_str(), port); }
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t *, size_t) override { return 0; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int read(uint8_t *, size_t) override { return 0; }
+    int peek() override { return -1; }
+    void flush() override {}
+    void stop() override {}
+    uint8_t connected() override { return 0; }
+    operator bool() override { return false; }
+    void setNoDelay(bool) {}
+    IPAddress remoteIP() { return {}; }
+};
+
+class WiFiServer {
+public:
+    explicit WiFiServer(uint16_t) {}
+    void begin() {}
+    WiFiClient available() { return {}; }
+};
@@ -0,0 +1,172 @@
+/**
+ * \file FS.h
+ * \brief Système de fichiers de l'hôte, en mémoire : vide à chaque lancement du programme
+ */
+#pragma once
+
+#include <map>
+#include <memory>
+
+#include <Arduino.h>
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+namespace fs {
+    typedef std::map<std::string, std::shared_ptr<std::string>> HostFiles;
+
+    class File : public Stream {
+        std::shared_ptr<std::string> _data;
+        std::string _path;
+        size_t _pos = 0;
+        bool _writable = false;
+        bool _append = false;
+
+    public:
+        File() = default;
+        File(std::shared_ptr<std::string> data, std::string path, const char *mode)
+            : _data(std::move(data)), _path(std::move(path)), _writable(mode[0] != 'r' || mode[1] == '+'),
+              _append(mode[0] == 'a') {
+            if (_append) _pos = _data->size();
+        }
+
+        size_t write(const uint8_t c) override { return write(&c, 1); }
+        size_t write(const uint8_t *buffer, const size_t size) override {
+            if (!_data || !_writable) return 0;
+            if (_append) _pos = _data->size();
+            if (_pos + size > _data->size()) _data->resize(_pos + size);
+            memcpy(&(*_data)[_pos], buffer, size);
+            _pos += size;
+            return size;
+        }
+        using Print::write;
+
+        int available() override { return _data ? static_cast<int>(_data->size() - std::min(_pos, _data->size())) : 0; }
+        int read() override { return available() > 0 ? static_cast<uint8_t>((*_data)[_pos++]) : -1; }
+        size_t read(uint8_t *buffer, const size_t size) {
+            const size_t n = std::min<size_t>(size, available());
+            if (n) memcpy(buffer, _data->data() + _pos, n);
+            _pos += n;
+            return n;
+        }
+        size_t readBytes(char *buffer, const size_t length) override {
+            return read(reinterpret_cast<uint8_t *>(buffer), length);
+        }
+        int peek() override { return available() > 0 ? static_cast<uint8_t>((*_data)[_pos]) : -1; }
+        void flush() override {}
+
+        bool seek(const uint32_t pos, const SeekMode mode = SeekSet) {
+            if (!_data) return false;
+            const size_t base = mode == SeekSet ? 0 : mode == SeekCur ? _pos : _data->size();
+            if (base + pos > _data->size()) return false;
+            _pos = base + pos;
+            return true;
+        }
+        [[nodiscard]] size_t position() const { return _pos; }
+        [[nodiscard]] size_t size() const { return _data ? _data->size() : 0; }
+        bool truncate(const uint32_t size) {
+            if (!_data || !_writable) return false;
+            _data->resize(size);
+            _pos = std::min<size_t>(_pos, size);
+            return true;
+        }
+        void close() { _data.reset(); }
+        operator bool() const { return static_cast<bool>(_data); }
+        [[nodiscard]] const char *name() const {
+            const size_t slash = _path.rfind('/');
+            return _path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+        }
+        [[nodiscard]] const char *fullName() const { return _path.c_str(); }
+        [[nodiscard]] bool isFile() const { return static_cast<bool>(_data); }
+        [[nodiscard]] bool isDirectory() const { return false; }
+    };
+
+    class Dir {
+        HostFiles *_files = nullptr;
+        std::vector<std::string> _names;
+        std::string _prefix;
+        int _index = -1;
+
+    public:
+        Dir() = default;
+        Dir(HostFiles &files, const std::string &path) : _files(&files), _prefix(path) {
+            if (_prefix.empty() || _prefix.back() != '/') _prefix += '/';
+            for (const auto &entry: files) {
+                if (entry.first.compare(0, _prefix.size(), _prefix) == 0 &&
+                    entry.first.find('/', _prefix.size()) == std::string::npos) {
+                    _names.push_back(entry.first);
+                }
+            }
+        }
+
+        bool next() { return ++_index < static_cast<int>(_names.size()); }
+        String fileName() { return String(_names[_index].substr(_prefix.size())); }
+        size_t fileSize() { return (*_files)[_names[_index]]->size(); }
+        [[nodiscard]] bool isFile() const { return true; }
+        File openFile(const char *mode) { return {(*_files)[_names[_index]], _names[_index], mode}; }
+    };
+
+    struct FSInfo {
+        size_t totalBytes;
+        size_t usedBytes;
+        size_t blockSize;
+        size_t pageSize;
+        size_t maxOpenFiles;
+        size_t maxPathLength;
+    };
+
+    class FS {
+        HostFiles _files;
+
+    public:
+        bool begin() { return true; }
+        void end() {}
+        bool format() {
+            _files.clear();
+            return true;
+        }
+        bool info(FSInfo &info) {
+            size_t used = 0;
+            for (const auto &entry: _files) used += entry.second->size();
+            info = {1024 * 1024, used, 8192, 256, 5, 32};
+            return true;
+        }
+
+        File open(const char *path, const char *mode) {
+            auto found = _files.find(path);
+            if (mode[0] == 'r') {
+                if (found == _files.end()) return {};
+                return {found->second, path, mode};
+            }
+            if (found == _files.end()) {
+                found = _files.emplace(path, std::make_shared<std::string>()).first;
+            } else if (mode[0] == 'w') {
+                // Le fichier ouvert ailleurs garde son contenu, comme sur LittleFS
+                found->second = std::make_shared<std::string>();
+            }
+            return {found->second, path, mode};
+        }
+        File open(const String &path, const char *mode) { return open(path.c_str(), mode); }
+        bool exists(const char *path) { return _files.count(path) > 0; }
+        bool exists(const String &path) { return exists(path.c_str()); }
+        bool remove(const char *path) { return _files.erase(path) > 0; }
+        bool remove(const String &path) { return remove(path.c_str()); }
+        bool rename(const char *from, const char *to) {
+            const auto found = _files.find(from);
+            if (found == _files.end()) return false;
+            _files[to] = found->second;
+            _files.erase(from);
+            return true;
+        }
+        bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+        bool mkdir(const char *) { return true; }
+        bool mkdir(const String &) { return true; }
+        bool rmdir(const char *) { return true; }
+        Dir openDir(const char *path) { return {_files, path}; }
+        Dir openDir(const String &path) { return openDir(path.c_str()); }
+    };
+}
+
+using fs::Dir;
+using fs::File;
+using fs::FS;
+using fs::FSInfo;
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+
+class IPAddress {
+    uint8_t _bytes[4] = {};
+
+public:
+    IPAddress() = default;
+    IPAddress(const uint8_t a, const uint8_t b, const uint8_t c, const uint8_t d) : _bytes{a, b, c, d} {}
+    IPAddress(const uint32_t address) { memcpy(_bytes, &address, sizeof(_bytes)); }
+
+    operator uint32_t() const {
+        uint32_t address;
+        memcpy(&address, _bytes, sizeof(address));
+        return address;
+    }
+    uint8_t operator[](const int i) const { return _bytes[i]; }
+    [[nodiscard]] uint32_t v4() const { return *this; }
+    [[nodiscard]] bool isSet() const { return static_cast<uint32_t>(*this) != 0; }
+
+    bool fromString(const char *text) {
+        unsigned a, b, c, d;
+        if (sscanf(text, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) return false;
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+    [[nodiscard]] String toString() const {
+        char out[16];
+        snprintf(out, sizeof(out), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+        return String(out);
+    }
+};
@@ -0,0 +1,51 @@
+/**
+ * \file Ticker.h
+ * \brief Ticker de l'hôte : échéances appelées depuis delay() et yield() (voir Arduino.h)
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class Ticker {
+    host::Timer _timer;
+
+    void arm(const uint32_t ms, const bool repeat, std::function<void()> callback) {
+        _timer.periodMs = repeat ? std::max<uint32_t>(ms, 1) : 0;
+        _timer.due = millis() + ms;
+        _timer.callback = std::move(callback);
+        host::arm(&_timer);
+    }
+
+public:
+    typedef std::function<void()> callback_function_t;
+
+    Ticker() = default;
+    Ticker(const Ticker &) = delete;
+    Ticker &operator=(const Ticker &) = delete;
+    ~Ticker() { detach(); }
+
+    void attach(const float seconds, callback_function_t callback) {
+        attach_ms(static_cast<uint32_t>(seconds * 1000), std::move(callback));
+    }
+    void attach_ms(const uint32_t ms, callback_function_t callback) { arm(ms, true, std::move(callback)); }
+    void once(const float seconds, callback_function_t callback) {
+        once_ms(static_cast<uint32_t>(seconds * 1000), std::move(callback));
+    }
+    void once_ms(const uint32_t ms, callback_function_t callback) { arm(ms, false, std::move(callback)); }
+
+    template <typename T>
+    void attach(const float seconds, void (*callback)(T), T arg) {
+        attach(seconds, [callback, arg] { callback(arg); });
+    }
+    template <typename T>
+    void attach_ms(const uint32_t ms, void (*callback)(T), T arg) { attach_ms(ms, [callback, arg] { callback(arg); }); }
+    template <typename T>
+    void once_ms(const uint32_t ms, void (*callback)(T), T arg) { once_ms(ms, [callback, arg] { callback(arg); }); }
+
+    void detach() { host::disarm(&_timer); }
+
+    [[nodiscard]] bool active() const {
+        const std::vector<host::Timer *> &list = host::timers();
+        return std::find(list.begin(), list.end(), &_timer) != list.end();
+    }
+};
@@ -0,0 +1,22 @@
+// Mise à jour de l'hôte : pas de partition, tout échoue
+#pragma once
+
+#include <Arduino.h>
+
+#define U_FLASH 0
+
+class UpdaterClass {
+public:
+    bool begin(size_t, int = U_FLASH) { return false; }
+    size_t write(uint8_t *, size_t) { return 0; }
+    bool end(bool = false) { return false; }
+    bool setMD5(const char *) { return true; }
+    String md5String() { return String(); }
+    bool hasError() { return true; }
+    String getErrorString() { return String("pas de partition sur l'hôte"); }
+    size_t progress() { return 0; }
+    size_t size() { return 0; }
+    uint8_t getError() { return 1; }
+};
+
+inline UpdaterClass Update;
@@ -0,0 +1,4 @@
+// Adafruit MQTT inclut WProgram.h quand ARDUINO n'est pas défini : l'hôte ne le définit pas
+#pragma once
+
+#include <Arduino.h>
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <ESP8266WiFi.h>
+
+class WiFiUDP : public Stream {
+public:
+    uint8_t begin(uint16_t) { return 0; }
+    void stop() {}
+    int beginPacket(const char *, uint16_t) { return 0; }
+    int beginPacket(IPAddress, uint16_t) { return 0; }
+    int endPacket() { return 0; }
+    size_t write(uint8_t) override { return 0; }
+    size_t write(const uint8_t *, size_t) override { return 0; }
+    using Print::write;
+    int parsePacket() { return 0; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int read(uint8_t *, size_t) { return 0; }
+    int read(char *, size_t) { return 0; }
+    int peek() override { return -1; }
+    void flush() override {}
+    IPAddress remoteIP() { return {}; }
+    uint16_t remotePort() { return 0; }
+};
@@ -0,0 +1,29 @@
+/**
+ * \file base64.h
+ * \brief Encodage base64 du cœur ESP8266 (authentification HTTP Basic)
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class base64 {
+public:
+    static String encode(const uint8_t *data, const size_t length, bool = true) {
+        static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        String out;
+        out.reserve((length + 2) / 3 * 4);
+        for (size_t i = 0; i < length; i += 3) {
+            const uint32_t n = data[i] << 16 | (i + 1 < length ? data[i + 1] << 8 : 0) |
+                               (i + 2 < length ? data[i + 2] : 0);
+            out += alphabet[n >> 18 & 63];
+            out += alphabet[n >> 12 & 63];
+            out += i + 1 < length ? alphabet[n >> 6 & 63] : '=';
+            out += i + 2 < length ? alphabet[n & 63] : '=';
+        }
+        return out;
+    }
+
+    static String encode(const String &text, const bool doNewLines = true) {
+        return encode(reinterpret_cast<const uint8_t *>(text.c_str()), text.length(), doNewLines);
+    }
+};
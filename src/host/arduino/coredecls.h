@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+
+inline void esp_schedule() {}
+
+template <typename T>
+bool esp_delay(const uint32_t timeout_ms, T &&blocked, const uint32_t intvl_ms) {
+    const unsigned long start = millis();
+    while (blocked() && millis() - start < timeout_ms) delay(std::min(intvl_ms, timeout_ms));
+    return blocked();
+}
+
+template <typename T>
+void esp_delay(const uint32_t timeout_ms, T &&blocked) {
+    esp_delay(timeout_ms, blocked, timeout_ms);
+}
@@ -0,0 +1,16 @@
+/**
+ * \file dns.h
+ * \brief Résolution DNS de lwIP sur l'hôte : aucun nom n'est résolu, l'horloge (MyNTP.h) reste non synchronisée
+ */
+#pragma once
+
+#include "lwip/tcp.h"
+
+#define ERR_INPROGRESS          (-5)
+#define ERR_VAL                 (-6)
+
+#define ip_2_ip4(address)       (address)
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *address, void *arg);
+
+inline err_t dns_gethostbyname(const char *, ip_addr_t *, dns_found_callback, void *) { return ERR_VAL; }
@@ -0,0 +1,68 @@
+/**
+ * \file tcp.h
+ * \brief lwIP brut de l'hôte : tcp_new() échoue, le serveur asynchrone (MyAsyncWeb.h) ne démarre pas et
+ * les requêtes HTTP du rejeu (MyTrace.h) échouent
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int8_t err_t;
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+
+#define ERR_OK                  0
+#define ERR_MEM                 (-1)
+#define ERR_ABRT                (-13)
+#define TCP_WRITE_FLAG_COPY     0x01
+#define TCP_PRIO_MIN            1
+
+struct ip_addr_t {
+    uint32_t addr;
+};
+
+inline const ip_addr_t ip_addr_any = {0};
+#define IPADDR4_INIT(u32)       {u32}
+#define IP_ADDR_ANY             (&ip_addr_any)
+#define IP_ANY_TYPE             (&ip_addr_any)
+
+struct pbuf {
+    pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+struct tcp_pcb {
+    ip_addr_t remote_ip;
+    u16_t remote_port;
+};
+
+typedef err_t (*tcp_accept_fn)(void *, tcp_pcb *, err_t);
+typedef err_t (*tcp_recv_fn)(void *, tcp_pcb *, pbuf *, err_t);
+typedef err_t (*tcp_sent_fn)(void *, tcp_pcb *, u16_t);
+typedef err_t (*tcp_poll_fn)(void *, tcp_pcb *);
+typedef void (*tcp_err_fn)(void *, err_t);
+typedef err_t (*tcp_connected_fn)(void *, tcp_pcb *, err_t);
+
+inline tcp_pcb *tcp_new() { return nullptr; }
+inline err_t tcp_bind(tcp_pcb *, const ip_addr_t *, u16_t) { return ERR_MEM; }
+inline tcp_pcb *tcp_listen(tcp_pcb *) { return nullptr; }
+inline err_t tcp_connect(tcp_pcb *, const ip_addr_t *, u16_t, tcp_connected_fn) { return ERR_MEM; }
+inline void tcp_accept(tcp_pcb *, tcp_accept_fn) {}
+inline void tcp_arg(tcp_pcb *, void *) {}
+inline void tcp_recv(tcp_pcb *, tcp_recv_fn) {}
+inline void tcp_sent(tcp_pcb *, tcp_sent_fn) {}
+inline void tcp_err(tcp_pcb *, tcp_err_fn) {}
+inline void tcp_poll(tcp_pcb *, tcp_poll_fn, u8_t) {}
+inline void tcp_recved(tcp_pcb *, u16_t) {}
+inline err_t tcp_write(tcp_pcb *, const void *, u16_t, u8_t) { return ERR_MEM; }
+inline err_t tcp_output(tcp_pcb *) { return ERR_OK; }
+inline u16_t tcp_sndbuf(tcp_pcb *) { return 0; }
+inline err_t tcp_close(tcp_pcb *) { return ERR_OK; }
+inline void tcp_abort(tcp_pcb *) {}
+inline void tcp_setprio(tcp_pcb *, u8_t) {}
+inline void tcp_nagle_disable(tcp_pcb *) {}
+inline u16_t pbuf_copy_partial(const pbuf *, void *, u16_t, u16_t) { return 0; }
+inline u8_t pbuf_free(pbuf *) { return 0; }
@@ -0,0 +1,103 @@
+/**
+ * \file bench_host.cpp
+ * \brief Programme de la machine hôte (environnement native) : les benchmarks de la carte, sans la carte
+ *
+ * \code
+ * pio run -e native && .pio/build/native/program [micro|pipeline|sleep]
+ * pio run -e native && .pio/build/native/program replay capture.bin [speed]
+ * \endcode
+ * - micro (par défaut) : cas portables de MyMicroBench.h, même sortie JSON que /bench ;
+ * - pipeline : benchmark de la chaîne (MyPipelineBench.h), le MyMQTT.h de la carte connecté au broker
+ *   local, les en-têtes Arduino étant remplacés par ceux de src/host/arduino ;
+ * - sleep : sleepPlanSelfCheck() de MySleepPlan.h, avec la politique par défaut ; code de sortie 1 si
+ *   une échéance est manquée ;
+ * - replay : rejeu d'une trace téléchargée par /trace/download (MyTrace.h), à la vitesse speed (1 par
+ *   défaut, 0 sans attente), sur la chaîne par défaut et le broker local ; affiche le rapport de /trace.
+ *
+ * (ou les cibles bench_host, pipeline_host et sleep_host de CMakeLists)
+ */
+#define MYDEBUG         1
+
+#include <stdio.h>
+#include <string.h>
+
+#include "MyMicroBench.h"
+#include "MyPipelineBench.h"
+#include "MySleepPlan.h"
+#include "MyTrace.h"
+
+static int hostMicroBench() {
+    printf("{\"plateforme\":\"" MICRO_BENCH_PLATFORM "\",\"mhz\":0,\"resultats\":[");
+    for (uint8_t i = 0; i < MICRO_BENCH_PORTABLE; i++) {
+        char line[MICRO_BENCH_LINE_MAX];
+        microBenchFormat(microBenchRun(microBenchPortableCases[i]), line, sizeof(line));
+        printf("%s%s", i ? "," : "", line);
+    }
+    printf("]}\n");
+    return 0;
+}
+
+static int hostPipelineBench() {
+    setupMQTT();
+    setupChains();
+    benchPipeline();
+    return benchChain ? 0 : 1;
+}
+
+static int hostSleepCheck() {
+    const SleepPolicy policy;
+    SleepSimResult result;
+    const bool ok = sleepPlanSelfCheck(policy, result);
+    printf("sommeil %s : retard max %u ms, écart keepalive %u ms, %u réveils, %.1f mA moyens\n",
+           ok ? "OK" : "ÉCHÉANCE MANQUÉE", static_cast<unsigned>(result.worstLateMs),
+           static_cast<unsigned>(result.worstKeepaliveGapMs), static_cast<unsigned>(result.wakeups),
+           result.meter.averageMa(policy));
+    for (uint8_t mode = 0; mode < SLEEP_MODE_COUNT; mode++) {
+        printf("  %s : %u ms\n", sleepModeNames[mode], static_cast<unsigned>(result.meter.ms[mode]));
+    }
+    return ok ? 0 : 1;
+}
+
+static int hostReplay(const char *path, const float speed) {
+    FILE *capture = fopen(path, "rb");
+    if (!capture) {
+        fprintf(stderr, "trace illisible : %s\n", path);
+        return 2;
+    }
+    // Copie dans le système de fichiers de l'hôte, où traceReplayStart() la lit comme sur la carte
+    SPIFFS.mkdir(TRACE_DIR);
+    File file = SPIFFS.open(TRACE_FILE, "w");
+    uint8_t buffer[256];
+    while (const size_t n = fread(buffer, 1, sizeof(buffer), capture)) file.write(buffer, n);
+    fclose(capture);
+    file.close();
+
+    setupMQTT();
+    setupChains();
+    MyAdafruitMqtt.connect(); // Broker local : les handlers publient comme sur la carte
+    if (!traceReplayStart(speed, "")) return 1;
+    while (traceState == TRACE_REPLAYING) {
+        loopTrace();
+        if (speed > 0) {
+            delay(1); // Attente des échéances, les Tickers tournent
+        } else {
+            yield();
+        }
+    }
+    char report[768];
+    traceReport(report, sizeof(report));
+    printf("%s", report);
+    return 0;
+}
+
+int main(const int argc, char **argv) {
+    const char *command = argc > 1 ? argv[1] : "micro";
+    if (strcmp(command, "micro") == 0) return hostMicroBench();
+    if (strcmp(command, "pipeline") == 0) return hostPipelineBench();
+    if (strcmp(command, "sleep") == 0) return hostSleepCheck();
+    if (strcmp(command, "replay") == 0 && argc > 2) {
+        return hostReplay(argv[2], argc > 3 ? std::max(atof(argv[3]), 0.0) : 1);
+    }
+    fprintf(stderr, "usage : %s [micro|pipeline|sleep] | replay <trace.bin> [speed]\n", argv[0]);
+    return 2;
+}
@@ -9,99 +9,128 @@ int i = 0;
 #include "MyWiFi.h"         // WiFi
 #include "MyTicker.h"       // Tickers
 #include "MyDistributeur.h"
-
+#include "MyChain.h"          // Chaînes de distributeurs, ordonnancées avec budgets
+#include "MyConfigApi.h"      // Configuration à chaud
+#include "MySleep.h"          // Sommeil jusqu'à la prochaine échéance
+#include "MyOta.h"            // Mise à jour OTA en flux
+#include "MyLogApi.h"         // Logs en NDJSON, long-poll
+#include "MyPipelineBench.h" // Benchmark sur broker local
+#include "MyHistory.h"       // Historique des stocks
+#include "MyTracking.h"      // Journal de suivi indexé
+#include "MyTrace.h"         // Capture et rejeu du trafic
+#include "MyBoot.h"          // Chronologie du démarrage
+#include "MyBench.h"         // Microbenchmarks (/bench)
+
+
+/**
+ * Démarrage du distributeur : il a besoin du broker MQTT, donc du WiFi
+ */
+bool distributeurStarted = false;
+
+void startDistributeur() {
+    distributeurStarted = true;
+    MYDEBUG_PRINTLN("Démarrage de l'initialisation du distributeur");
+    bootRun(BOOT_PHASE_DISTRIBUTEUR, [] {
+        setupDistributeur();
+        startChains();
+        otaRestore(); // Commandes interrompues par une mise à jour OTA
+    });
+    bootSettle(5000); // Attente de stabilisation
+
+#ifdef MYMQTT_LOCAL_BROKER
+    // Benchmark de la chaîne sur le broker local
+    benchPipeline();
+#endif
+}
 
 void setup() {
-    // 1. Initialisation du debug
+    // 1. Initialisation du debug et de la chronologie du démarrage
     Serial.begin(115200);
-    delay(2000);
+    bootSettle(2000);
+    setupBoot();
     setupDebug();
     MYDEBUG_PRINTLN("----- SETUP -----");
 
-    // 2. WiFi avec gestion d'erreur
-    try {
-        setupWiFi();
-        MYDEBUG_PRINTLN("----- WIFI OK -----");
-        delay(5000);
-        // Attente de stabilisation du WiFi
-    } catch (const std::exception &e) {
-        MYDEBUG_PRINT("Erreur WiFi : ");
-        MYDEBUG_PRINTLN(e.what());
-        return;
-    }
-    delay(5000);
-
-    // 3. WebServer avec gestion d'erreur
-    try {
-        setupWebServer(); // Initialisation du Serveur Web();
-        MYDEBUG_PRINTLN("----- WEBSERVER OK -----");
-        delay(5000);
-        // Attente de stabilisation du WiFi
-    } catch (const std::exception &e) {
-        MYDEBUG_PRINT("Erreur WEBSERVER : ");
-        MYDEBUG_PRINTLN(e.what());
-        return;
-    }
-    delay(5000);
-
-    // 4. Ticker avec délai plus long
-    try {
+    // 2. WiFi : en démarrage rapide, l'association se poursuit pendant les phases suivantes
+    bootPhaseBegin(BOOT_PHASE_WIFI_CONNECT);
+    if (!bootRun(BOOT_PHASE_WIFI, BOOT_FAST_START ? beginWiFi : setupWiFi)) return;
+    if (WiFi.status() == WL_CONNECTED) bootPhaseEnd(BOOT_PHASE_WIFI_CONNECT, BOOT_OK);
+    bootSettle(10000); // Attente de stabilisation du WiFi
+
+    // 3. SPIFFS et configuration, sans formatage : la configuration et l'historique sont conservés
+    if (!bootRun(BOOT_PHASE_SPIFFS, [] { setupSPIFFS(); })) return;
+    bootRun(BOOT_PHASE_CONFIG, [] {
+        loadDistributeurConfig();
+        setupChains();
+        setupConfigApi();
+        setupOta();
+    });
+    bootRun(BOOT_PHASE_JOURNAL, [] {
+        restoreDistributeurs(); // Instantané et rejeu par-dessus la configuration
+        setupJournal();
+    });
+    bootSettle(5000);
+
+    // 4. WebServer, joignable sur le point d'accès sans attendre la Station
+    if (!bootRun(BOOT_PHASE_WEBSERVER, [] {
+        setupWebServer();
+        setupLogApi();
+    })) return;
+    bootSettle(10000);
+
+    // 5. Ticker
+    if (!bootRun(BOOT_PHASE_TICKER, [] {
         setupTicker();
-        MYDEBUG_PRINTLN("----- TICKER OK -----");
-        delay(5000); // Attente de stabilisation du Ticker
-    } catch (const std::exception &e) {
-        MYDEBUG_PRINT("Erreur Ticker : ");
-        MYDEBUG_PRINTLN(e.what());
-        return;
-    }
+        setupSleep();
+    })) return;
+    bootSettle(5000); // Attente de stabilisation du Ticker
 
-    // 5. SPIFFS
-    try {
-        setupSPIFFS(true);
-        MYDEBUG_PRINTLN("----- SPIFFS OK -----");
-        delay(5000);
-    } catch (const std::exception &e) {
-        MYDEBUG_PRINT("Erreur SPIFFr : ");
-        MYDEBUG_PRINTLN(e.what());
-        return;
-    }
+    // 6. Horloge (synchronisée en tâche de fond), historique des stocks, journal de suivi et capture du trafic
+    bootRun(BOOT_PHASE_NTP, setupNTP);
+    bootRun(BOOT_PHASE_HISTORY, [] {
+        setupHistory();
+        setupTracking();
+        setupTrace();
+        setupBench();
+    });
 
-    // 6. Distributeur avec délai et surveillance
-    try {
-        MYDEBUG_PRINTLN("Démarrage de l'initialisation du distributeur");
-        setupDistributeur();
-        MYDEBUG_PRINTLN("----- DISTRIBUTEUR OK -----");
-        delay(5000); // Attente de stabilisation
-    } catch (const std::exception &e) {
-        MYDEBUG_PRINT("Erreur Distributeur : ");
-        MYDEBUG_PRINTLN(e.what());
-        return;
-    }
+    bootReady();
+
+#if !BOOT_FAST_START
+    // 7. Distributeur, le WiFi est déjà connecté
+    startDistributeur();
+#endif
+
+    // 8. Surveillance de la loop, une fois les phases longues du démarrage passées
+    setupWatchdog();
 
     MYDEBUG_PRINTLN("----- SETUP TERMINÉ -----");
 }
 
 void loop() {
-    static unsigned long lastWifiCheck = 0;
     static unsigned long lastMqttProcessing = 0;
     constexpr unsigned long processingInterval = 1000; // 1 seconde entre les traitements
 
-    // Ne pas utiliser yield() directement
-    delay(100);
+    // Mesure du temps actif de l'itération, par sous-système
+    loopWatchdogBegin();
 
-    // Vérification périodique du WiFi
+    // Lien WiFi : reconnexion déclenchée par les événements, sans attente bloquante
     unsigned long currentMillis = millis();
-    if (currentMillis - lastWifiCheck >= 30000) {
-        if (WiFi.status() != WL_CONNECTED) {
-            MYDEBUG_PRINTLN("Perte de connexion WiFi - Tentative de reconnexion");
-            WiFi.reconnect();
-            delay(5000);
-        }
-        lastWifiCheck = currentMillis;
+    {
+        LoopScope scope(LOOP_WIFI);
+        loopWiFi();
+    }
+
+    // Démarrage du distributeur dès que le WiFi est connecté (démarrage rapide)
+    if (!distributeurStarted && WiFi.status() == WL_CONNECTED) {
+        LoopScope scope(LOOP_MQTT);
+        bootPhaseEnd(BOOT_PHASE_WIFI_CONNECT, BOOT_OK);
+        startDistributeur();
     }
 
     // Traitement MQTT périodique
-    if (currentMillis - lastMqttProcessing >= processingInterval) {
+    if (distributeurStarted && currentMillis - lastMqttProcessing >= processingInterval) {
+        LoopScope scope(LOOP_MQTT);
         try {
             loopDistributeur();
             lastMqttProcessing = currentMillis;
@@ -112,8 +141,52 @@ void loop() {
         }
     }
 
-    loopWebServer();
+    // Écriture des mutations journalisées par les Tickers et les callbacks MQTT
+    {
+        LoopScope scope(LOOP_JOURNAL);
+        flushDistributeurJournal();
+    }
+
+    // Travail des chaînes à tour de rôle (envois, copulations, commandes), dans leurs budgets
+    if (distributeurStarted) {
+        loopChains();
+    }
+
+    // Rejeu d'une trace capturée (broker local)
+    if (distributeurStarted) {
+        LoopScope scope(LOOP_MQTT);
+        loopTrace();
+    }
+
+    // Synchronisation NTP en tâche de fond
+    {
+        LoopScope scope(LOOP_NTP);
+        loopNTP();
+    }
+
+    {
+        LoopScope scope(LOOP_WEB);
+        loopWebServer();
+        loopLogApi();
+        loopOta();
+    }
+
+    // Échantillonnage de l'historique des stocks
+    {
+        LoopScope scope(LOOP_HISTORY);
+        loopHistory();
+    }
+
+    // Surveillance du tas (dégradation progressive, redémarrage contrôlé)
+    {
+        LoopScope scope(LOOP_HEAP);
+        loopHeap();
+    }
+
+    // Comparaison au budget, capture des itérations lentes
+    loopWatchdogEnd();
 
-    // Délai de base pour éviter la surcharge
-    delay(100);
+    // Sommeil jusqu'à la prochaine échéance (Tickers, traitement MQTT, keepalive), hors mesure du watchdog
+    const unsigned long sinceProcessing = distributeurStarted ? millis() - lastMqttProcessing : 0;
+    loopSleep(sinceProcessing < processingInterval ? processingInterval - sinceProcessing : 0);
 }
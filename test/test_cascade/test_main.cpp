@@ -0,0 +1,98 @@
+/**
+ * \file test_main.cpp
+ * \brief Chaîne figée (MyStaticChain.h) et chaîne configurable (MyDistributeur) : mêmes décisions et
+ * mêmes stocks après la même suite de commandes
+ *
+ * Les copulations demandent une connexion MQTT : les deux chaînes publient sur le broker local.
+ * L'envoi progressif n'est pas attendu, les rations commandées sont retirées du dernier niveau dès
+ * que la commande est acceptée.
+ *
+ * \code
+ * pio test -e native -f test_cascade
+ * \endcode
+ */
+#include <unity.h>
+
+#include "MyStaticChain.h"
+
+static MyDistributeur croquetteTest("Croquette", 0, pubNbRationCroquette);
+static MyDistributeur poissonRougeTest("Poisson Rouge", 0, pubNbRationPoissonRouge, &croquetteTest);
+static MyDistributeur achiganTest("Achigan", 0, pubNbRationAchigan, &poissonRougeTest);
+static MyDistributeur restoTest("Achigan du Restaurant", 0, pubNbRationResto, &achiganTest);
+static MyDistributeur *const runtimeLevels[DISTRIBUTEUR_COUNT] = {
+    &croquetteTest, &poissonRougeTest, &achiganTest, &restoTest
+};
+static DefaultStaticChain staticChain(pubNbRationCroquette, pubNbRationPoissonRouge, pubNbRationAchigan,
+                                      pubNbRationResto);
+
+static void setState(const int32_t (&state)[DISTRIBUTEUR_COUNT]) {
+    for (uint8_t i = 0; i < DISTRIBUTEUR_COUNT; i++) runtimeLevels[i]->setRation(state[i]);
+    staticChain.setValues(state);
+}
+
+/**
+ * Une commande sur chaque chaîne : même décision, mêmes stocks ensuite
+ */
+static void sameOrder(const int nombre) {
+    const bool runtimeOk = restoTest.commande(nombre);
+    const bool staticOk = staticChain.commande(nombre);
+    restoTest.annulerEnvoi();
+    staticChain.last().annulerEnvoi();
+    if (runtimeOk) restoTest.setRation(restoTest.getRation() - nombre);
+    if (staticOk) staticChain.last().nbRation -= nombre;
+
+    int32_t runtimeState[DISTRIBUTEUR_COUNT];
+    int32_t staticState[DISTRIBUTEUR_COUNT];
+    for (uint8_t i = 0; i < DISTRIBUTEUR_COUNT; i++) runtimeState[i] = runtimeLevels[i]->getRation();
+    staticChain.values(staticState);
+    TEST_ASSERT_EQUAL(staticOk, runtimeOk);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(staticState, runtimeState, DISTRIBUTEUR_COUNT);
+}
+
+void setUp() {
+    applyTraits<CroquetteTraits>(croquetteTest);
+    applyTraits<PoissonRougeTraits>(poissonRougeTest);
+    applyTraits<AchiganTraits>(achiganTest);
+    applyTraits<AchiganRestoTraits>(restoTest);
+}
+
+void tearDown() {
+}
+
+// Depuis l'état initial : acceptations, puis copulations en cascade jusqu'à épuisement des précédents
+void test_same_stock_after_order_sequence() {
+    setState({CroquetteTraits::nbRation, PoissonRougeTraits::nbRation, AchiganTraits::nbRation,
+              AchiganRestoTraits::nbRation});
+    for (const int nombre: {3, 4, 2, 5, 1, 6, 2, 3, 7, 1, 4, 2, 8, 1, 1, 3, 5, 2, 6, 4}) {
+        sameOrder(nombre);
+    }
+}
+
+// Dernier niveau au minimum, précédents pleins : le précédent du dernier niveau ne peut pas copuler,
+// le dernier niveau ne copule pas lui-même, la commande est refusée par les deux chaînes
+void test_full_precedents_refuse() {
+    setState({CroquetteTraits::nbRation, PoissonRougeTraits::nbMax, AchiganTraits::nbMax,
+              AchiganRestoTraits::nbMin});
+    sameOrder(1);
+    TEST_ASSERT_EQUAL_INT(AchiganRestoTraits::nbMin, restoTest.getRation());
+}
+
+// Précédent vide : la cascade remonte au niveau d'avant
+void test_cascade_walks_up() {
+    setState({CroquetteTraits::nbRation, PoissonRougeTraits::nbMin, AchiganTraits::nbMin,
+              AchiganRestoTraits::nbMin});
+    for (const int nombre: {1, 1, 2, 1}) {
+        sameOrder(nombre);
+    }
+}
+
+int main() {
+    setupMQTT();
+    MyAdafruitMqtt.connect(); // Broker local (MYMQTT_LOCAL_BROKER) : les copulations demandent la connexion
+
+    UNITY_BEGIN();
+    RUN_TEST(test_same_stock_after_order_sequence);
+    RUN_TEST(test_full_precedents_refuse);
+    RUN_TEST(test_cascade_walks_up);
+    return UNITY_END();
+}
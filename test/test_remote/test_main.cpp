@@ -0,0 +1,109 @@
+/**
+ * \file test_main.cpp
+ * \brief Précédent distant (MyRemote.h) : carte ciblée, demandes de la carte elle-même, cache
+ * d'idempotence du producteur et réponses accordées après l'abandon de leur demande
+ *
+ * \code
+ * pio test -e native -f test_remote
+ * \endcode
+ */
+#include <unity.h>
+
+#include "MyRemote.h"
+
+static MyDistributeur producer("Poisson Rouge", 30, pubNbRationPoissonRouge);
+static MyDistributeur consumer("Achigan", 10, pubNbRationAchigan);
+
+static MyDistributeur *resolveProducer(const char *ns, const uint8_t level) {
+    return strcmp(ns, "bac1") == 0 && level == 1 ? &producer : nullptr;
+}
+
+static void request(const char *origin, const char *target, const uint32_t corr, const int eat) {
+    char payload[MQTT_MUX_PAYLOAD];
+    snprintf(payload, sizeof(payload), "%s %s %u bac1 1 %d", origin, target, corr, eat);
+    remoteHandleRequest(payload, strlen(payload), resolveProducer);
+}
+
+static void reply(const uint32_t corr, const char status) {
+    char payload[MQTT_MUX_PAYLOAD];
+    snprintf(payload, sizeof(payload), "%s %u %c 0", mqttNodeId(), corr, status);
+    remoteHandleReply(payload, strlen(payload));
+}
+
+void setUp() {
+    for (RemoteServed &entry: remoteServed) entry = RemoteServed();
+    for (RemoteAbandoned &entry: remoteAbandoned) entry = RemoteAbandoned();
+    for (RemoteRequest &pending: remotePending) pending = RemoteRequest();
+    remoteStats = RemoteStats();
+    remoteLoopback = false;
+    producer.setRation(30);
+    consumer.setRation(10);
+}
+
+void tearDown() {
+}
+
+// Une demande renvoyée (même origine, même corrélation) est répondue depuis le cache
+void test_resent_request_served_once() {
+    request("a1b2c3", mqttNodeId(), 7, 2);
+    request("a1b2c3", mqttNodeId(), 7, 2);
+    TEST_ASSERT_EQUAL_INT(28, producer.getRation());
+    TEST_ASSERT_EQUAL_UINT32(1, remoteStats.served);
+    TEST_ASSERT_EQUAL_UINT32(1, remoteStats.duplicates);
+
+    // Même corrélation, autre carte : une autre demande
+    request("d4e5f6", mqttNodeId(), 7, 2);
+    TEST_ASSERT_EQUAL_INT(26, producer.getRation());
+    TEST_ASSERT_EQUAL_UINT32(2, remoteStats.served);
+}
+
+void test_request_for_other_node_ignored() {
+    request("a1b2c3", "ffffff", 8, 2);
+    TEST_ASSERT_EQUAL_INT(30, producer.getRation());
+    TEST_ASSERT_EQUAL_UINT32(0, remoteStats.served);
+}
+
+void test_own_request_needs_loopback() {
+    request(mqttNodeId(), mqttNodeId(), 9, 2);
+    TEST_ASSERT_EQUAL_INT(30, producer.getRation());
+
+    remoteLoopback = true;
+    request(mqttNodeId(), mqttNodeId(), 9, 2);
+    TEST_ASSERT_EQUAL_INT(28, producer.getRation());
+}
+
+// Le producteur a cédé : la réponse G reçue après l'abandon est appliquée une seule fois
+void test_late_grant_applied_once() {
+    MyRemoteLink link(mqttNodeId(), "bac1", 1);
+    TEST_ASSERT_TRUE(link.request(consumer, 2));
+    const uint32_t corr = remoteNextCorr;
+    link.cancel();
+    TEST_ASSERT_EQUAL_INT(0, link.inflight(consumer));
+
+    reply(corr, 'G');
+    reply(corr, 'G'); // Réponse au renvoi, depuis le cache du producteur
+    TEST_ASSERT_EQUAL_INT(10 + consumer.getCopulation(), consumer.getRation());
+    TEST_ASSERT_EQUAL_UINT32(2, remoteStats.late);
+    TEST_ASSERT_EQUAL_UINT32(1, remoteStats.lateGranted);
+}
+
+void test_late_denial_changes_nothing() {
+    MyRemoteLink link(mqttNodeId(), "bac1", 1);
+    TEST_ASSERT_TRUE(link.request(consumer, 2));
+    const uint32_t corr = remoteNextCorr;
+    link.cancel();
+
+    reply(corr, 'D');
+    TEST_ASSERT_EQUAL_INT(10, consumer.getRation());
+    TEST_ASSERT_EQUAL_UINT32(0, remoteStats.lateGranted);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_resent_request_served_once);
+    RUN_TEST(test_request_for_other_node_ignored);
+    RUN_TEST(test_own_request_needs_loopback);
+    RUN_TEST(test_late_grant_applied_once);
+    RUN_TEST(test_late_denial_changes_nothing);
+    return UNITY_END();
+}
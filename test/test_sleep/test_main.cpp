@@ -0,0 +1,98 @@
+/**
+ * \file test_main.cpp
+ * \brief Planification du sommeil (MySleepPlan.h) : décision selon les échéances et l'activité, et
+ * simulation du bac par défaut sur l'horloge virtuelle, réveils comptés actifs
+ *
+ * \code
+ * pio test -e native -f test_sleep
+ * \endcode
+ */
+#include <unity.h>
+
+#include "MySleepPlan.h"
+
+static SleepPolicy policy;
+
+void setUp() {
+    policy = SleepPolicy();
+}
+
+void tearDown() {
+}
+
+void test_pending_work_keeps_loop_awake() {
+    SleepInputs in;
+    in.timerInMs = 5000;
+    in.workPending = true;
+    const SleepDecision decision = sleepPlan(policy, in);
+    TEST_ASSERT_EQUAL(SLEEP_NONE, decision.mode);
+    TEST_ASSERT_EQUAL_UINT32(policy.busyDelayMs, decision.durationMs);
+}
+
+void test_recent_web_request_keeps_radio_on() {
+    SleepInputs in;
+    in.webIdleMs = policy.webActiveMs - 1;
+    const SleepDecision decision = sleepPlan(policy, in);
+    TEST_ASSERT_EQUAL(SLEEP_NONE, decision.mode);
+    TEST_ASSERT_EQUAL_UINT32(policy.activeDelayMs, decision.durationMs);
+}
+
+// Point d'accès actif : même durée, radio allumée
+void test_access_point_blocks_radio_sleep() {
+    SleepInputs in;
+    in.timerInMs = 900;
+    in.radioMaySleep = false;
+    const SleepDecision decision = sleepPlan(policy, in);
+    TEST_ASSERT_EQUAL(SLEEP_NONE, decision.mode);
+    TEST_ASSERT_EQUAL_UINT32(900, decision.durationMs);
+}
+
+// Le ping part keepaliveMarginMs avant l'échéance : l'intervalle court passe en sommeil modem
+void test_keepalive_margin_shortens_sleep() {
+    SleepInputs in;
+    in.keepaliveInMs = policy.keepaliveMarginMs + 500;
+    const SleepDecision decision = sleepPlan(policy, in);
+    TEST_ASSERT_EQUAL(SLEEP_MODEM, decision.mode);
+    TEST_ASSERT_EQUAL_UINT32(500, decision.durationMs);
+}
+
+// Sans échéance, le sommeil léger est borné par orderLatencyMs et écoute un beacon sur orderLatencyMs / 2
+void test_light_sleep_bounded_by_order_latency() {
+    const SleepDecision decision = sleepPlan(policy, SleepInputs());
+    TEST_ASSERT_EQUAL(SLEEP_LIGHT, decision.mode);
+    TEST_ASSERT_EQUAL_UINT32(policy.orderLatencyMs, decision.durationMs);
+    TEST_ASSERT_EQUAL_UINT8(policy.orderLatencyMs / (2 * policy.beaconMs), decision.listenInterval);
+}
+
+void test_default_tank_meets_deadlines() {
+    SleepSimResult result;
+    TEST_ASSERT_TRUE(sleepPlanSelfCheck(policy, result));
+    TEST_ASSERT_EQUAL_UINT32(0, result.worstLateMs);
+    TEST_ASSERT_TRUE(result.worstKeepaliveGapMs <= 30000);
+}
+
+// Chaque réveil coûte : le courant moyen dépasse celui du sommeil léger et croît avec le coût d'un réveil
+void test_wakeups_cost_active_time() {
+    SleepSimResult result;
+    sleepPlanSelfCheck(policy, result);
+    TEST_ASSERT_TRUE(result.meter.ms[SLEEP_NONE] >= static_cast<uint64_t>(result.wakeups) * policy.wakeActiveMs);
+    const float average = result.meter.averageMa(policy);
+    TEST_ASSERT_TRUE(average > policy.currentMa[SLEEP_LIGHT]);
+
+    policy.wakeActiveMs *= 5;
+    SleepSimResult costly;
+    TEST_ASSERT_TRUE(sleepPlanSelfCheck(policy, costly));
+    TEST_ASSERT_TRUE(costly.meter.averageMa(policy) > average);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_pending_work_keeps_loop_awake);
+    RUN_TEST(test_recent_web_request_keeps_radio_on);
+    RUN_TEST(test_access_point_blocks_radio_sleep);
+    RUN_TEST(test_keepalive_margin_shortens_sleep);
+    RUN_TEST(test_light_sleep_bounded_by_order_latency);
+    RUN_TEST(test_default_tank_meets_deadlines);
+    RUN_TEST(test_wakeups_cost_active_time);
+    return UNITY_END();
+}
@@ -0,0 +1,134 @@
+/**
+ * \file test_main.cpp
+ * \brief Transactions (MyTransaction.h) : curseur (origine, époque, séquence) de chaque niveau, filtre de
+ * la carte d'origine et instantané après l'abandon d'une transaction
+ *
+ * \code
+ * pio test -e native -f test_txn
+ * \endcode
+ */
+#include <unity.h>
+
+#include "MyTransaction.h"
+
+static TxnCursor cursor;
+static int32_t applied[TXN_MAX_PARTS];
+static Adafruit_MQTT_Publish *resynced = nullptr;
+
+static bool applyTest(const char *origin, const uint8_t level, const int32_t value, const uint32_t epoch,
+                      const uint32_t seq) {
+    if (level >= TXN_MAX_PARTS || !cursor.accept(origin, epoch, seq)) return false;
+    applied[level] = value;
+    return true;
+}
+
+static void receive(const char *origin, const char *allowed, const uint32_t epoch, const uint32_t seq,
+                    const int32_t value) {
+    char payload[MQTT_MUX_PAYLOAD];
+    snprintf(payload, sizeof(payload), "%s %x %u 0=%d", origin, epoch, seq, value);
+    txnHandle(payload, strlen(payload), allowed, applyTest);
+}
+
+static void resyncTest(Adafruit_MQTT_Publish *txnFeed) {
+    resynced = txnFeed;
+    const TxnPart parts[] = {{&pubNbRationCroquette, 0, 30000}, {&pubNbRationPoissonRouge, 1, 30}};
+    txnCommit(txnFeed, parts, 2, true);
+}
+
+// Transaction en attente dont tous les envois sont faits, sans écho
+static void exhaust(TxnEntry &entry) {
+    entry.attempts = TXN_MAX_ATTEMPTS;
+    entry.sentAt = millis() - TXN_RETRY_MS;
+}
+
+static TxnEntry *pending() {
+    for (TxnEntry &entry: txnOutbox) {
+        if (entry.seq) return &entry;
+    }
+    return nullptr;
+}
+
+void setUp() {
+    cursor = TxnCursor();
+    for (int32_t &value: applied) value = -1;
+    for (TxnEntry &entry: txnOutbox) entry = TxnEntry();
+    txnStats = TxnStats();
+    txnResync = resyncTest;
+    resynced = nullptr;
+}
+
+void tearDown() {
+}
+
+void test_same_epoch_orders_by_sequence() {
+    TEST_ASSERT_TRUE(cursor.accept("a1b2c3", 0x10, 5));
+    TEST_ASSERT_FALSE(cursor.accept("a1b2c3", 0x10, 5));
+    TEST_ASSERT_FALSE(cursor.accept("a1b2c3", 0x10, 4));
+    TEST_ASSERT_TRUE(cursor.accept("a1b2c3", 0x10, 6));
+}
+
+// Carte redémarrée : la nouvelle époque l'emporte, l'ancienne est refusée même avec une séquence plus grande
+void test_superseded_epoch_rejected() {
+    TEST_ASSERT_TRUE(cursor.accept("a1b2c3", 0x10, 50));
+    TEST_ASSERT_TRUE(cursor.accept("a1b2c3", 0x20, 1));
+    TEST_ASSERT_FALSE(cursor.accept("a1b2c3", 0x10, 51));
+    TEST_ASSERT_TRUE(cursor.accept("a1b2c3", 0x20, 2));
+    TEST_ASSERT_TRUE(cursor.accept("a1b2c3", 0x30, 1));
+    TEST_ASSERT_FALSE(cursor.accept("a1b2c3", 0x20, 3));
+    TEST_ASSERT_FALSE(cursor.accept("a1b2c3", 0x10, 52));
+}
+
+void test_other_origin_has_its_own_history() {
+    TEST_ASSERT_TRUE(cursor.accept("a1b2c3", 0x10, 50));
+    TEST_ASSERT_TRUE(cursor.accept("d4e5f6", 0x10, 1));
+    TEST_ASSERT_EQUAL_STRING("d4e5f6", cursor.origin);
+}
+
+void test_foreign_origin_filtered() {
+    receive("d4e5f6", "a1b2c3", 0x10, 1, 42);
+    TEST_ASSERT_EQUAL_INT32(-1, applied[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, txnStats.foreign);
+
+    receive("d4e5f6", "", 0x10, 2, 42); // Sans origine configurée : aucune transaction d'une autre carte
+    TEST_ASSERT_EQUAL_INT32(-1, applied[0]);
+
+    receive("a1b2c3", "a1b2c3", 0x10, 3, 42);
+    TEST_ASSERT_EQUAL_INT32(42, applied[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, txnStats.applied);
+}
+
+// Abandon d'une transaction : un instantané de la chaîne la remplace ; l'instantané abandonné est signalé
+void test_expired_transaction_resynced() {
+    const TxnPart part = {&pubNbRationAchigan, 2, 10};
+    txnCommit(&pubTransaction, &part, 1);
+    exhaust(*pending());
+    loopTransactions();
+    TEST_ASSERT_EQUAL_PTR(&pubTransaction, resynced);
+    TEST_ASSERT_EQUAL_UINT32(1, txnStats.resyncs);
+
+    TxnEntry *snapshot = pending();
+    TEST_ASSERT_NOT_NULL(snapshot);
+    TEST_ASSERT_TRUE(snapshot->snapshot);
+    TEST_ASSERT_EQUAL_UINT8(2, snapshot->count);
+
+    resynced = nullptr;
+    exhaust(*snapshot);
+    loopTransactions();
+    TEST_ASSERT_NULL(resynced);
+    TEST_ASSERT_NULL(pending());
+    TEST_ASSERT_EQUAL_UINT32(1, txnStats.diverged);
+    TEST_ASSERT_EQUAL_UINT32(2, txnStats.expired);
+}
+
+int main() {
+    setupMQTT();
+    MyAdafruitMqtt.connect(); // Les renvois et l'abandon n'ont lieu que connecté (broker local)
+
+    UNITY_BEGIN();
+    RUN_TEST(test_same_epoch_orders_by_sequence);
+    RUN_TEST(test_superseded_epoch_rejected);
+    RUN_TEST(test_other_origin_has_its_own_history);
+    RUN_TEST(test_foreign_origin_filtered);
+    RUN_TEST(test_expired_transaction_resynced);
+    return UNITY_END();
+}